@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Minimal benchmark harness for nvy_core. Runs the body until at least
+// BENCH_MIN_DURATION has elapsed and reports the mean time per iteration.
+constexpr std::chrono::milliseconds BENCH_MIN_DURATION(250);
+
+struct BenchResult {
+	const char *name;
+	uint64_t iterations;
+	double ns_per_iteration;
+	// Optional amount of work per iteration, used to report throughput
+	double units_per_iteration;
+	const char *unit_name;
+};
+
+inline void BenchReport(BenchResult result) {
+	printf("%-48s %10llu iters %14.1f ns/iter", result.name,
+		static_cast<unsigned long long>(result.iterations), result.ns_per_iteration);
+	if (result.units_per_iteration > 0.0) {
+		double units_per_second = result.units_per_iteration / (result.ns_per_iteration * 1e-9);
+		printf(" %12.2f M%s/s", units_per_second / 1e6, result.unit_name);
+	}
+	printf("\n");
+}
+
+template<typename Fn>
+BenchResult BenchRun(const char *name, Fn &&fn, double units_per_iteration = 0.0, const char *unit_name = "") {
+	using Clock = std::chrono::steady_clock;
+
+	// Warm up caches and any lazily allocated state
+	fn();
+
+	uint64_t iterations = 0;
+	Clock::time_point start = Clock::now();
+	Clock::duration elapsed;
+	do {
+		fn();
+		++iterations;
+		elapsed = Clock::now() - start;
+	} while (elapsed < BENCH_MIN_DURATION);
+
+	BenchResult result {
+		.name = name,
+		.iterations = iterations,
+		.ns_per_iteration = std::chrono::duration<double, std::nano>(elapsed).count() / iterations,
+		.units_per_iteration = units_per_iteration,
+		.unit_name = unit_name
+	};
+	BenchReport(result);
+	return result;
+}
+
+// Keeps the optimizer from discarding benchmarked work
+template<typename T>
+inline void BenchDoNotOptimize(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const T *sink;
+	sink = &value;
+#endif
+}
+
+void BenchRedraw();
+void BenchQueue();
+void BenchEvents();
+void BenchUtf8();
+void BenchRpc();
+void BenchScroll();
+void BenchGrid();
+void BenchHighlight();
+void BenchGlyphs();
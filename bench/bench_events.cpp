@@ -0,0 +1,52 @@
+#include <cstring>
+#include "bench.h"
+#include "nvim/redraw_events.h"
+
+// The names RendererRedraw used to test in order, each with strncmp
+constexpr const char *LEGACY_HANDLED_EVENTS[] {
+	"option_set",
+	"grid_resize",
+	"grid_clear",
+	"default_colors_set",
+	"hl_attr_define",
+	"grid_line",
+	"grid_cursor_goto",
+	"mode_info_set",
+	"mode_change",
+	"set_title",
+	"busy_start",
+	"busy_stop",
+	"grid_scroll",
+	"flush",
+};
+
+static int LegacyLookup(const char *name, uint32_t length) {
+	int index = 0;
+	for (const char *event : LEGACY_HANDLED_EVENTS) {
+		if (strncmp(name, event, length) == 0) {
+			return index;
+		}
+		++index;
+	}
+	return -1;
+}
+
+// Resolves every event name of the protocol once per iteration
+void BenchEvents() {
+	uint32_t lengths[REDRAW_EVENT_COUNT];
+	for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+		lengths[i] = static_cast<uint32_t>(strlen(REDRAW_EVENT_NAMES[i]));
+	}
+
+	BenchRun("strncmp chain", [&]() {
+		for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+			BenchDoNotOptimize(LegacyLookup(REDRAW_EVENT_NAMES[i], lengths[i]));
+		}
+	}, REDRAW_EVENT_COUNT, "lookups");
+
+	BenchRun("perfect hash", [&]() {
+		for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+			BenchDoNotOptimize(RedrawEventLookup(REDRAW_EVENT_NAMES[i], lengths[i]));
+		}
+	}, REDRAW_EVENT_COUNT, "lookups");
+}
@@ -0,0 +1,175 @@
+#include "bench.h"
+#include "model/cell_glyphs.h"
+#include "model/glyph_cache.h"
+#include "model/grid.h"
+
+constexpr int GLYPH_BENCH_ROWS = 135;
+constexpr int GLYPH_BENCH_COLS = 480;
+// About the number of distinct ideographs a page of CJK prose uses
+constexpr uint32_t GLYPH_BENCH_CJK_CHARS = 2500;
+
+static uint32_t NextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+struct GlyphBenchScreen {
+	const char *name;
+	uint32_t first_char;
+	uint32_t char_count;
+	bool wide;
+};
+constexpr GlyphBenchScreen GLYPH_BENCH_SCREENS[] {
+	{ "CJK", 0x4E00, GLYPH_BENCH_CJK_CHARS, true },
+	{ "box drawing", 0x2500, 0x80, false },
+};
+
+struct PlacementBenchScreen {
+	const char *name;
+	bool wide;
+	// Every other pair of cells is shaped into a single glyph
+	bool ligatures;
+};
+constexpr PlacementBenchScreen PLACEMENT_BENCH_SCREENS[] {
+	{ "source code", false, false },
+	{ "source code with ligatures", false, true },
+	{ "CJK", true, false },
+};
+
+// Text building and glyph placement for drawing rows as glyph runs, with
+// the cluster map a shaper would return for each screen
+static void BenchGlyphPlacement() {
+	constexpr float CELL_WIDTH = 9.0f;
+	char name[128];
+	for (const PlacementBenchScreen &screen : PLACEMENT_BENCH_SCREENS) {
+		int cells = GLYPH_BENCH_ROWS * GLYPH_BENCH_COLS;
+		uint32_t *chars = new uint32_t[cells];
+		uint8_t *flags = new uint8_t[cells];
+		uint32_t rng = 1;
+		for (int i = 0; i < cells; ++i) {
+			if (screen.wide) {
+				chars[i] = (i & 1) ? L'\0' : 0x4E00 + NextRandom(&rng) % GLYPH_BENCH_CJK_CHARS;
+				flags[i] = (i & 1) ? GRID_CELL_CONTINUATION : GRID_CELL_WIDE;
+			}
+			else {
+				chars[i] = ' ' + NextRandom(&rng) % 95;
+				flags[i] = 0;
+			}
+		}
+
+		uint16_t text[GLYPH_BENCH_COLS * 2];
+		uint16_t text_cells[GLYPH_BENCH_COLS * 2];
+		uint16_t cluster_map[GLYPH_BENCH_COLS * 2];
+		float advances[GLYPH_BENCH_COLS * 2];
+		float drawn_width = 0.0f;
+		snprintf(name, sizeof(name), "glyph placement, %s screen", screen.name);
+		BenchRun(name, [&]() {
+			drawn_width = 0.0f;
+			for (int row = 0; row < GLYPH_BENCH_ROWS; ++row) {
+				int offset = row * GLYPH_BENCH_COLS;
+				int text_length = CellTextBuild(chars + offset, flags + offset, GLYPH_BENCH_COLS, text, text_cells);
+				int glyph_count = 0;
+				for (int i = 0; i < text_length; ++i) {
+					bool joined = screen.ligatures && (i & 3) == 1;
+					cluster_map[i] = static_cast<uint16_t>(joined ? glyph_count - 1 : glyph_count++);
+				}
+				CellGlyphsPlace(text_cells, cluster_map, text_length, glyph_count, GLYPH_BENCH_COLS, CELL_WIDTH, advances);
+				for (int i = 0; i < glyph_count; ++i) {
+					drawn_width += advances[i];
+				}
+			}
+			BenchDoNotOptimize(drawn_width);
+		}, cells, "cells");
+		printf("    glyphs cover %.0f of %.0f pixels\n", drawn_width, cells * CELL_WIDTH);
+
+		delete[] chars;
+		delete[] flags;
+	}
+}
+
+void BenchGlyphs() {
+	char name[128];
+	for (const GlyphBenchScreen &screen : GLYPH_BENCH_SCREENS) {
+		// A 4K screen full of the characters that each needed a
+		// throwaway text layout to measure before
+		int cells = GLYPH_BENCH_ROWS * GLYPH_BENCH_COLS / (screen.wide ? 2 : 1);
+		uint32_t *chars = new uint32_t[cells];
+		uint32_t rng = 1;
+		for (int i = 0; i < cells; ++i) {
+			chars[i] = screen.first_char + NextRandom(&rng) % screen.char_count;
+		}
+
+		GlyphCache cache {};
+		GlyphCacheInitialize(&cache);
+		uint64_t measurements = 0;
+		const auto Measure = [&]() {
+			++measurements;
+			return GlyphMetrics { .glyph_index = 1, .advance = 16.0f };
+		};
+		for (int i = 0; i < cells; ++i) {
+			GlyphCacheGet(&cache, chars[i], screen.wide, Measure);
+		}
+		uint64_t first_frame = measurements;
+
+		snprintf(name, sizeof(name), "advance lookups, %s screen", screen.name);
+		BenchRun(name, [&]() {
+			float width = 0.0f;
+			for (int i = 0; i < cells; ++i) {
+				width += GlyphCacheGet(&cache, chars[i], screen.wide, Measure).advance;
+			}
+			BenchDoNotOptimize(width);
+		}, cells, "chars");
+		printf("    %llu measurements for the first frame of %d chars, %llu after\n",
+			static_cast<unsigned long long>(first_frame), cells,
+			static_cast<unsigned long long>(measurements - first_frame));
+
+		GlyphCacheFree(&cache);
+		delete[] chars;
+	}
+
+	// A screen of source code, checked for glyphs missing from the font
+	// through the Latin-1 table and, as a baseline, through the sparse map
+	int cells = GLYPH_BENCH_ROWS * GLYPH_BENCH_COLS;
+	uint32_t *chars = new uint32_t[cells];
+	uint32_t rng = 1;
+	for (int i = 0; i < cells; ++i) {
+		chars[i] = ' ' + NextRandom(&rng) % 95;
+	}
+	GlyphCache cache {};
+	GlyphCacheInitialize(&cache);
+	uint16_t glyph_indices[GLYPH_CACHE_LATIN1_CHARS];
+	float advances[GLYPH_CACHE_LATIN1_CHARS];
+	for (uint32_t i = 0; i < GLYPH_CACHE_LATIN1_CHARS; ++i) {
+		// Control characters have no glyph in most fonts
+		glyph_indices[i] = (i < ' ' || (i >= 0x7F && i < 0xA0)) ? 0 : static_cast<uint16_t>(i);
+		advances[i] = 16.0f;
+		GlyphCacheInsert(&cache, i, false, GlyphMetrics { .glyph_index = glyph_indices[i], .advance = advances[i] });
+	}
+	GlyphCacheSetLatin1(&cache, glyph_indices, advances);
+
+	BenchRun("missing glyph check, map, source code screen", [&]() {
+		int missing = 0;
+		for (int i = 0; i < cells; ++i) {
+			GlyphMetrics metrics;
+			GlyphCacheFind(&cache, chars[i], false, &metrics);
+			missing += metrics.glyph_index == 0;
+		}
+		BenchDoNotOptimize(missing);
+	}, cells, "cells");
+	BenchRun("missing glyph check, Latin-1 table, source code screen", [&]() {
+		int missing = 0;
+		for (int i = 0; i < cells; ++i) {
+			missing += cache.latin1[chars[i]].glyph_index == 0;
+		}
+		BenchDoNotOptimize(missing);
+	}, cells, "cells");
+
+	GlyphCacheFree(&cache);
+	delete[] chars;
+
+	BenchGlyphPlacement();
+}
@@ -0,0 +1,183 @@
+#include <cstdlib>
+#include <cstring>
+#include "bench.h"
+#include "model/grid.h"
+#include "model/highlight_runs.h"
+#include "model/row_hashes.h"
+
+struct GridBenchSize {
+	const char *name;
+	int rows;
+	int cols;
+};
+constexpr GridBenchSize GRID_BENCH_SIZES[] {
+	{ "80x25", 25, 80 },
+	{ "4K 480x135", 135, 480 },
+	{ "500x200", 200, 500 },
+};
+
+// The array of structs layout the planes replaced, kept here as a baseline
+struct LegacyCellProperty {
+	uint16_t hl_attrib_id;
+	bool is_wide_char;
+};
+struct LegacyGrid {
+	uint32_t *chars;
+	LegacyCellProperty *cell_properties;
+};
+
+static bool LegacyRowEqual(LegacyGrid *a, LegacyGrid *b, int row, int cols) {
+	size_t base = static_cast<size_t>(row) * cols;
+	for (int i = 0; i < cols; ++i) {
+		if (a->chars[base + i] != b->chars[base + i] ||
+			a->cell_properties[base + i].hl_attrib_id != b->cell_properties[base + i].hl_attrib_id ||
+			a->cell_properties[base + i].is_wide_char != b->cell_properties[base + i].is_wide_char) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint32_t NextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+void BenchGrid() {
+	char name[128];
+	for (const GridBenchSize &size : GRID_BENCH_SIZES) {
+		int rows = size.rows;
+		int cols = size.cols;
+		double cells = static_cast<double>(rows) * cols;
+
+		// Two identical screens of text, as when checking which
+		// rows changed since the last frame
+		Grid grid {};
+		Grid previous {};
+		GridResize(&grid, rows, cols);
+		GridResize(&previous, rows, cols);
+		LegacyGrid legacy[2];
+		for (LegacyGrid &l : legacy) {
+			l.chars = static_cast<uint32_t *>(malloc(cells * sizeof(uint32_t)));
+			l.cell_properties = static_cast<LegacyCellProperty *>(calloc(cells, sizeof(LegacyCellProperty)));
+		}
+		uint32_t rng = 1;
+		for (int row = 0; row < rows; ++row) {
+			for (int col = 0; col < cols; ++col) {
+				uint32_t grid_char = 'a' + NextRandom(&rng) % 26;
+				// Highlights come in runs, like syntax groups do
+				uint16_t hl_attrib_id = static_cast<uint16_t>((row + col / 6) % 8);
+				GridPutCell(&grid, row, col, grid_char, hl_attrib_id, 1);
+				GridPutCell(&previous, row, col, grid_char, hl_attrib_id, 1);
+				for (LegacyGrid &l : legacy) {
+					l.chars[row * cols + col] = grid_char;
+					l.cell_properties[row * cols + col].hl_attrib_id = hl_attrib_id;
+				}
+			}
+		}
+
+		printf("%s: %.2f bytes/cell in planes, %.2f bytes/cell as structs\n", size.name,
+			static_cast<double>(GridRowSize(&grid) * rows) / cells,
+			static_cast<double>(sizeof(uint32_t) + sizeof(LegacyCellProperty)));
+
+		snprintf(name, sizeof(name), "row equal, structs %s", size.name);
+		BenchRun(name, [&]() {
+			int equal_rows = 0;
+			for (int row = 0; row < rows; ++row) {
+				equal_rows += LegacyRowEqual(&legacy[0], &legacy[1], row, cols);
+			}
+			BenchDoNotOptimize(equal_rows);
+		}, cells, "cells");
+		snprintf(name, sizeof(name), "row equal, planes %s", size.name);
+		BenchRun(name, [&]() {
+			int equal_rows = 0;
+			for (int row = 0; row < rows; ++row) {
+				equal_rows += GridRowEqual(&grid, row, &previous, row);
+			}
+			BenchDoNotOptimize(equal_rows);
+		}, cells, "cells");
+
+		// Finding where the highlight changes, once per cell as drawing
+		// used to and once per row as runs
+		HighlightRuns hl_runs {};
+		HighlightRunsResize(&hl_runs, rows, cols);
+		snprintf(name, sizeof(name), "highlight changes, per cell %s", size.name);
+		BenchRun(name, [&]() {
+			int changes = 0;
+			for (int row = 0; row < rows; ++row) {
+				uint16_t *hl_attrib_ids = GridRowHighlights(&grid, row);
+				uint16_t hl_attrib_id = hl_attrib_ids[0];
+				for (int col = 0; col < cols; ++col) {
+					if (hl_attrib_ids[col] != hl_attrib_id) {
+						hl_attrib_id = hl_attrib_ids[col];
+						++changes;
+					}
+				}
+			}
+			BenchDoNotOptimize(changes);
+		}, cells, "cells");
+		snprintf(name, sizeof(name), "highlight changes, build runs %s", size.name);
+		BenchRun(name, [&]() {
+			int run_count = 0;
+			for (int row = 0; row < rows; ++row) {
+				run_count += HighlightRunsBuild(&hl_runs, &grid, row);
+			}
+			BenchDoNotOptimize(run_count);
+		}, cells, "cells");
+		printf("%s: %.1f highlight runs per row\n", size.name,
+			static_cast<double>(hl_runs.stats.runs_built) / hl_runs.stats.rows_built);
+
+		HighlightAttributes hl_attribs[8] {};
+		snprintf(name, sizeof(name), "row hash %s", size.name);
+		BenchRun(name, [&]() {
+			uint64_t hash = 0;
+			for (int row = 0; row < rows; ++row) {
+				int run_count;
+				const HighlightRun *runs = HighlightRunsRow(&hl_runs, row, &run_count);
+				hash ^= RowHash(&grid, hl_attribs, runs, run_count, row);
+			}
+			BenchDoNotOptimize(hash);
+		}, cells, "cells");
+		HighlightRunsFree(&hl_runs);
+
+		snprintf(name, sizeof(name), "clear, structs %s", size.name);
+		BenchRun(name, [&]() {
+			for (size_t i = 0; i < static_cast<size_t>(cells); ++i) {
+				legacy[0].chars[i] = L' ';
+			}
+			memset(legacy[0].cell_properties, 0, cells * sizeof(LegacyCellProperty));
+			BenchDoNotOptimize(legacy[0].chars[0]);
+		}, cells, "cells");
+		snprintf(name, sizeof(name), "clear, planes %s", size.name);
+		BenchRun(name, [&]() {
+			GridClear(&previous);
+			BenchDoNotOptimize(previous.chars[0]);
+		}, cells, "cells");
+
+		snprintf(name, sizeof(name), "copy rows, planes %s", size.name);
+		BenchRun(name, [&]() {
+			for (int row = 0; row < rows; ++row) {
+				GridCopySpan(&previous, row, &grid, row, 0, cols);
+			}
+			BenchDoNotOptimize(previous.chars[0]);
+		}, cells, "cells");
+		snprintf(name, sizeof(name), "copy half rows, planes %s", size.name);
+		BenchRun(name, [&]() {
+			for (int row = 0; row < rows; ++row) {
+				GridCopySpan(&previous, row, &grid, row, 0, cols / 2);
+			}
+			BenchDoNotOptimize(previous.chars[0]);
+		}, cells / 2, "cells");
+
+		for (LegacyGrid &l : legacy) {
+			free(l.chars);
+			free(l.cell_properties);
+		}
+		GridFree(&previous);
+		GridFree(&grid);
+	}
+}
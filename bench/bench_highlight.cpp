@@ -0,0 +1,243 @@
+#include <atomic>
+#include <cstring>
+#include "bench.h"
+#include "workload.h"
+#include "common/mpack_cursor.h"
+#include "model/effect_pool.h"
+#include "model/grid.h"
+#include "model/ui_model.h"
+#include "nvim/highlight_keys.h"
+#include "nvim/redraw.h"
+
+// Roughly the number of highlight groups a colorscheme with treesitter
+// and LSP highlights ends up defining
+constexpr int HIGHLIGHT_BENCH_DEFINED = 400;
+constexpr int HIGHLIGHT_BENCH_ROWS = 135;
+constexpr int HIGHLIGHT_BENCH_COLS = 480;
+// A large colorscheme load, with treesitter, LSP and plugin groups all
+// linked to a few hundred base groups
+constexpr int COLORSCHEME_BENCH_IDS = 4000;
+constexpr int COLORSCHEME_BENCH_GROUPS = 300;
+
+// Each draw resolving reverse video and the default color fallbacks
+// itself, kept here as a baseline for the resolved color table
+static ColorRGBA LegacyForegroundColor(const HighlightAttributes *hl_attribs, const HighlightAttributes *default_attribs) {
+	if (hl_attribs->flags & HL_ATTRIB_REVERSE) {
+		return ColorFromRGB(hl_attribs->background == DEFAULT_COLOR ? default_attribs->background : hl_attribs->background);
+	}
+	return ColorFromRGB(hl_attribs->foreground == DEFAULT_COLOR ? default_attribs->foreground : hl_attribs->foreground);
+}
+static ColorRGBA LegacyBackgroundColor(const HighlightAttributes *hl_attribs, const HighlightAttributes *default_attribs) {
+	if (hl_attribs->flags & HL_ATTRIB_REVERSE) {
+		return ColorFromRGB(hl_attribs->foreground == DEFAULT_COLOR ? default_attribs->foreground : hl_attribs->foreground);
+	}
+	return ColorFromRGB(hl_attribs->background == DEFAULT_COLOR ? default_attribs->background : hl_attribs->background);
+}
+static ColorRGBA LegacySpecialColor(const HighlightAttributes *hl_attribs, const HighlightAttributes *default_attribs) {
+	return ColorFromRGB(hl_attribs->special == DEFAULT_COLOR ? default_attribs->special : hl_attribs->special);
+}
+
+static uint32_t NextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// Walks the highlight runs of every row the way DrawGridLine does and
+// sums the colors, so the lookups aren't optimized away
+template<typename ColorsFn>
+static float SumRunColors(Grid *grid, ColorsFn &&colors_of) {
+	float sum = 0.0f;
+	for (int row = 0; row < grid->rows; ++row) {
+		uint16_t *hl_attrib_ids = GridRowHighlights(grid, row);
+		uint16_t hl_attrib_id = hl_attrib_ids[0];
+		for (int col = 1; col <= grid->cols; ++col) {
+			if (col == grid->cols || hl_attrib_ids[col] != hl_attrib_id) {
+				ResolvedColors colors = colors_of(hl_attrib_id);
+				sum += colors.foreground.r + colors.background.g + colors.special.b;
+				if (col < grid->cols) {
+					hl_attrib_id = hl_attrib_ids[col];
+				}
+			}
+		}
+	}
+	return sum;
+}
+
+// Stands in for GlyphDrawingEffect, a reference counted heap object
+struct BenchEffect {
+	std::atomic<uint32_t> ref_count;
+	ColorRGBA foreground;
+	ColorRGBA special;
+};
+static uint64_t bench_effect_allocations;
+
+static void *CreateBenchEffect(const ColorRGBA *foreground, const ColorRGBA *special) {
+	++bench_effect_allocations;
+	return new BenchEffect { 1, *foreground, *special };
+}
+
+static void ReleaseBenchEffect(void *effect) {
+	BenchEffect *bench_effect = static_cast<BenchEffect *>(effect);
+	if (--bench_effect->ref_count == 0) {
+		delete bench_effect;
+	}
+}
+
+// Decodes and applies a colorscheme load the way the reader and UI
+// threads split it, then reports how much interning shares
+static void BenchColorschemeLoad() {
+	// The keys in the mix a colorscheme sends them, including ones Nvy skips
+	constexpr const char *KEYS[] {
+		"foreground", "foreground", "foreground", "foreground", "background", "bold",
+		"italic", "undercurl", "special", "blend", "underline", "reverse", "nocombine",
+	};
+	constexpr size_t KEY_COUNT = sizeof(KEYS) / sizeof(KEYS[0]);
+	// Copied out of the string literals in a random order, as keys come
+	// out of a message the optimizer and branch predictor can't see into
+	constexpr size_t LOOKUP_COUNT = 4096;
+	char keys[KEY_COUNT][16];
+	uint32_t key_lengths[KEY_COUNT];
+	uint32_t rng = 1;
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		key_lengths[i] = static_cast<uint32_t>(strlen(KEYS[i]));
+		memcpy(keys[i], KEYS[i], key_lengths[i]);
+	}
+	uint8_t lookups[LOOKUP_COUNT];
+	for (uint8_t &lookup : lookups) {
+		lookup = static_cast<uint8_t>(NextRandom(&rng) % KEY_COUNT);
+	}
+	BenchDoNotOptimize(keys);
+	BenchRun("attribute keys", [&]() {
+		int sum = 0;
+		for (uint8_t lookup : lookups) {
+			sum += static_cast<int>(HighlightKeyLookup(keys[lookup], key_lengths[lookup]));
+		}
+		BenchDoNotOptimize(sum);
+	}, LOOKUP_COUNT, "keys");
+
+	WorkloadMessage message = WorkloadColorschemeLoad(COLORSCHEME_BENCH_IDS, COLORSCHEME_BENCH_GROUPS, 1);
+	Arena arena;
+	ArenaInitialize(&arena, MEGABYTES(1));
+	RedrawEventStats event_stats {};
+	char name[128];
+	snprintf(name, sizeof(name), "colorscheme load encode, %d ids", COLORSCHEME_BENCH_IDS);
+	BenchRun(name, [&]() {
+		ArenaReset(&arena);
+		MPackCursor params;
+		RedrawParseNotification(message.data, message.size, &params);
+		RedrawEncodeOps(&arena, params, &event_stats);
+		BenchDoNotOptimize(arena.size);
+	}, COLORSCHEME_BENCH_IDS, "ids");
+
+	UIModel model {};
+	UIModelInitialize(&model);
+	snprintf(name, sizeof(name), "colorscheme load apply, %d ids", COLORSCHEME_BENCH_IDS);
+	BenchRun(name, [&]() {
+		RedrawOps ops = RedrawOpsInit(reinterpret_cast<const char *>(arena.data), arena.size);
+		while (const RedrawOp *op = RedrawOpsNext(&ops)) {
+			RedrawApplyOp(&model, op);
+		}
+	}, COLORSCHEME_BENCH_IDS, "ids");
+
+	printf("    %u attribute sets for %d highlight ids\n", model.hl_sets.set_count, COLORSCHEME_BENCH_IDS + 1);
+
+	UIModelShutdown(&model);
+	ArenaFree(&arena);
+	WorkloadFree(&message);
+}
+
+void BenchHighlight() {
+	UIModel model {};
+	UIModelInitialize(&model);
+	model.hl_attribs[0] = HighlightAttributes { .foreground = 0xD0D0D0, .background = 0x1C1C1C, .special = 0xFF0000 };
+	ResolvedColorsRebuild(&model.hl_colors, model.hl_attribs.data());
+
+	uint32_t rng = 1;
+	for (int i = 1; i <= HIGHLIGHT_BENCH_DEFINED; ++i) {
+		// Most groups only set a foreground, some are reversed
+		HighlightAttributes *hl_attribs = &model.hl_attribs[i];
+		hl_attribs->foreground = NextRandom(&rng) & 0xFFFFFF;
+		hl_attribs->background = NextRandom(&rng) % 4 == 0 ? NextRandom(&rng) & 0xFFFFFF : DEFAULT_COLOR;
+		hl_attribs->special = DEFAULT_COLOR;
+		hl_attribs->flags = NextRandom(&rng) % 16 == 0 ? HL_ATTRIB_REVERSE : 0;
+		ResolvedColorsUpdate(&model.hl_colors, model.hl_attribs.data(), i);
+	}
+
+	// Runs of syntax highlighting, about six cells each
+	Grid grid {};
+	GridResize(&grid, HIGHLIGHT_BENCH_ROWS, HIGHLIGHT_BENCH_COLS);
+	for (int row = 0; row < grid.rows; ++row) {
+		for (int col = 0; col < grid.cols; col += 6) {
+			uint16_t hl_attrib_id = static_cast<uint16_t>(1 + NextRandom(&rng) % HIGHLIGHT_BENCH_DEFINED);
+			GridPutCell(&grid, row, col, 'a', hl_attrib_id, 6);
+		}
+	}
+	double runs = static_cast<double>(grid.rows) * ((grid.cols + 5) / 6);
+
+	const HighlightAttributes *hl_attribs = model.hl_attribs.data();
+	BenchRun("run colors, resolved per draw 4K 480x135", [&]() {
+		BenchDoNotOptimize(SumRunColors(&grid, [&](uint16_t id) {
+			return ResolvedColors {
+				.foreground = LegacyForegroundColor(&hl_attribs[id], &hl_attribs[0]),
+				.background = LegacyBackgroundColor(&hl_attribs[id], &hl_attribs[0]),
+				.special = LegacySpecialColor(&hl_attribs[id], &hl_attribs[0])
+			};
+		}));
+	}, runs, "runs");
+	BenchRun("run colors, table 4K 480x135", [&]() {
+		BenchDoNotOptimize(SumRunColors(&grid, [&](uint16_t id) {
+			return model.hl_colors.colors[id];
+		}));
+	}, runs, "runs");
+
+	// Every run hands its effect to a layout, which takes a reference and
+	// asks for the effect back when drawing
+	BenchRun("run drawing effects, allocated per run 4K 480x135", [&]() {
+		BenchDoNotOptimize(SumRunColors(&grid, [&](uint16_t id) {
+			const ResolvedColors *colors = &model.hl_colors.colors[id];
+			BenchEffect *effect = static_cast<BenchEffect *>(CreateBenchEffect(&colors->foreground, &colors->special));
+			++effect->ref_count;
+			ResolvedColors drawn { .foreground = effect->foreground, .special = effect->special };
+			ReleaseBenchEffect(effect);
+			ReleaseBenchEffect(effect);
+			return drawn;
+		}));
+	}, runs, "runs");
+	EffectPool effect_pool {};
+	EffectPoolInitialize(&effect_pool, MAX_HIGHLIGHT_ATTRIBS, CreateBenchEffect, ReleaseBenchEffect);
+	bench_effect_allocations = 0;
+	uint64_t first_frame_allocations = 0;
+	BenchRun("run drawing effects, pooled 4K 480x135", [&]() {
+		BenchDoNotOptimize(SumRunColors(&grid, [&](uint16_t id) {
+			BenchEffect *effect = static_cast<BenchEffect *>(
+				EffectPoolGet(&effect_pool, id, &model.hl_colors.colors[id]));
+			++effect->ref_count;
+			ResolvedColors drawn { .foreground = effect->foreground, .special = effect->special };
+			ReleaseBenchEffect(effect);
+			return drawn;
+		}));
+		if (first_frame_allocations == 0) {
+			first_frame_allocations = bench_effect_allocations;
+		}
+	}, runs, "runs");
+	printf("    %llu effects allocated for the first frame, %llu after, %d color pairs\n",
+		static_cast<unsigned long long>(first_frame_allocations),
+		static_cast<unsigned long long>(bench_effect_allocations - first_frame_allocations),
+		effect_pool.count);
+	EffectPoolFree(&effect_pool);
+
+	char name[128];
+	snprintf(name, sizeof(name), "default_colors_set rebuild, %d defined", HIGHLIGHT_BENCH_DEFINED);
+	BenchRun(name, [&]() {
+		ResolvedColorsRebuild(&model.hl_colors, model.hl_attribs.data());
+	}, HIGHLIGHT_BENCH_DEFINED, "ids");
+
+	GridFree(&grid);
+	UIModelShutdown(&model);
+
+	BenchColorschemeLoad();
+}
@@ -0,0 +1,32 @@
+#include <cstring>
+#include "bench.h"
+
+struct BenchSuite {
+	const char *name;
+	void (*run)();
+};
+
+constexpr BenchSuite BENCH_SUITES[] {
+	{ "redraw", BenchRedraw },
+	{ "queue", BenchQueue },
+	{ "events", BenchEvents },
+	{ "utf8", BenchUtf8 },
+	{ "rpc", BenchRpc },
+	{ "scroll", BenchScroll },
+	{ "grid", BenchGrid },
+	{ "highlight", BenchHighlight },
+	{ "glyphs", BenchGlyphs },
+};
+
+int main(int argc, char **argv) {
+	// Optionally filter suites by name, e.g. `nvy_bench redraw`
+	const char *filter = argc > 1 ? argv[1] : nullptr;
+	for (const BenchSuite &suite : BENCH_SUITES) {
+		if (filter && strcmp(filter, suite.name) != 0) {
+			continue;
+		}
+		printf("== %s ==\n", suite.name);
+		suite.run();
+	}
+	return 0;
+}
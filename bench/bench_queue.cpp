@@ -0,0 +1,81 @@
+#include <thread>
+#include "bench.h"
+#include "nvim/message_queue.h"
+
+constexpr int QUEUE_BENCH_MESSAGES = 10000;
+
+struct QueueMessageSize {
+	const char *name;
+	size_t size;
+};
+constexpr QueueMessageSize QUEUE_BENCH_MESSAGE_SIZES[] {
+	{ "64B", 64 },
+	{ "4KB", 4096 },
+	{ "64KB", 65536 },
+};
+
+static void WakeConsumer(void *wake_context) {
+	static_cast<std::atomic<bool> *>(wake_context)->store(true, std::memory_order_release);
+}
+
+static void PrintQueueStats(NvimMessageQueue *queue) {
+	NvimMessageQueueStats *stats = &queue->stats;
+	uint64_t pushed = stats->messages_pushed.load();
+	uint64_t popped = stats->messages_popped.load();
+	printf("    %llu msgs, %.1f msgs/wake, depth avg %.1f max %llu, "
+		"producer waits %llu (%.2f ms), queued avg %.1f us max %.1f us\n",
+		static_cast<unsigned long long>(pushed),
+		static_cast<double>(pushed) / static_cast<double>(stats->wakes.load() ? stats->wakes.load() : 1),
+		static_cast<double>(stats->depth_sum.load()) / static_cast<double>(pushed ? pushed : 1),
+		static_cast<unsigned long long>(stats->depth_max.load()),
+		static_cast<unsigned long long>(stats->producer_waits.load()),
+		static_cast<double>(stats->producer_wait_ns.load()) * 1e-6,
+		static_cast<double>(stats->queued_ns_sum.load()) * 1e-3 / static_cast<double>(popped ? popped : 1),
+		static_cast<double>(stats->queued_ns_max.load()) * 1e-3);
+}
+
+// Pushes messages from a producer thread in bursts, like the nvim reader
+// does, and drains them on the benchmark thread once per wake
+void BenchQueue() {
+	char name[128];
+	for (const QueueMessageSize &message_size : QUEUE_BENCH_MESSAGE_SIZES) {
+		char *payload = static_cast<char *>(calloc(message_size.size, 1));
+		std::atomic<bool> woken = false;
+		NvimMessageQueue *queue = new NvimMessageQueue;
+		NvimMessageQueueInitialize(queue, &woken, WakeConsumer);
+
+		snprintf(name, sizeof(name), "spsc push+drain %s", message_size.name);
+		BenchRun(name, [&]() {
+			std::thread producer([&]() {
+				constexpr int BURST_SIZE = 16;
+				for (int i = 0; i < QUEUE_BENCH_MESSAGES; ++i) {
+					NvimMessageQueuePush(queue, NvimMessageKind::Rpc, payload, message_size.size);
+					if (i % BURST_SIZE == BURST_SIZE - 1 || i == QUEUE_BENCH_MESSAGES - 1) {
+						NvimMessageQueueEndBatch(queue);
+					}
+				}
+			});
+
+			int received = 0;
+			while (received < QUEUE_BENCH_MESSAGES) {
+				if (!woken.exchange(false, std::memory_order_acquire)) {
+					std::this_thread::yield();
+					continue;
+				}
+				size_t message_count = NvimMessageQueueBeginDrain(queue);
+				for (size_t i = 0; i < message_count; ++i) {
+					NvimQueuedMessage message = NvimMessageQueueFront(queue);
+					BenchDoNotOptimize(message.data[0]);
+					NvimMessageQueuePop(queue);
+				}
+				received += static_cast<int>(message_count);
+			}
+			producer.join();
+		}, QUEUE_BENCH_MESSAGES, "msgs");
+		PrintQueueStats(queue);
+
+		NvimMessageQueueDestroy(queue);
+		delete queue;
+		free(payload);
+	}
+}
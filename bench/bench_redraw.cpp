@@ -0,0 +1,300 @@
+#include "bench.h"
+#include "workload.h"
+#include "common/mpack_helper.h"
+#include "common/utf8.h"
+#include "model/layout_cache.h"
+#include "nvim/redraw.h"
+#include "nvim/rpc.h"
+
+struct GridDimensions {
+	const char *name;
+	int rows;
+	int cols;
+};
+constexpr GridDimensions BENCH_GRID_SIZES[] {
+	{ "80x25", 25, 80 },
+	{ "1080p 240x67", 67, 240 },
+	{ "4K 480x135", 135, 480 },
+};
+
+// The node tree based decoding that the cursor decoder replaced, kept here
+// as a baseline. Mirrors the model side of the old RendererRedraw.
+static void LegacyHighlightDefine(UIModel *model, mpack_node_t highlight_attribs) {
+	uint64_t attrib_count = mpack_node_array_length(highlight_attribs);
+	for (uint64_t i = 1; i < attrib_count; ++i) {
+		int64_t attrib_index = mpack_node_array_at(mpack_node_array_at(highlight_attribs, i), 0).data->value.i;
+		mpack_node_t attrib_map = mpack_node_array_at(mpack_node_array_at(highlight_attribs, i), 1);
+		HighlightAttributes *hl_attribs = &model->hl_attribs[attrib_index];
+
+		const auto SetColor = [&](const char *name, uint32_t *color) {
+			mpack_node_t color_node = mpack_node_map_cstr_optional(attrib_map, name);
+			*color = mpack_node_is_missing(color_node) ? DEFAULT_COLOR : static_cast<uint32_t>(color_node.data->value.u);
+		};
+		SetColor("foreground", &hl_attribs->foreground);
+		SetColor("background", &hl_attribs->background);
+		SetColor("special", &hl_attribs->special);
+
+		const auto SetFlag = [&](const char *flag_name, HighlightAttributeFlags flag) {
+			mpack_node_t flag_node = mpack_node_map_cstr_optional(attrib_map, flag_name);
+			if (!mpack_node_is_missing(flag_node)) {
+				if (flag_node.data->value.b) {
+					hl_attribs->flags |= flag;
+				}
+				else {
+					hl_attribs->flags &= ~flag;
+				}
+			}
+		};
+		SetFlag("reverse", HL_ATTRIB_REVERSE);
+		SetFlag("italic", HL_ATTRIB_ITALIC);
+		SetFlag("bold", HL_ATTRIB_BOLD);
+		SetFlag("strikethrough", HL_ATTRIB_STRIKETHROUGH);
+		SetFlag("underline", HL_ATTRIB_UNDERLINE);
+		SetFlag("undercurl", HL_ATTRIB_UNDERCURL);
+	}
+}
+
+static void LegacyGridLine(UIModel *model, mpack_node_t grid_line) {
+	int row = MPackIntFromArray(grid_line, 1);
+	int col_start = MPackIntFromArray(grid_line, 2);
+
+	mpack_node_t cell_array = mpack_node_array_at(grid_line, 3);
+	size_t cell_array_length = mpack_node_array_length(cell_array);
+
+	int hl_attrib_id = 0;
+	int col = col_start;
+	for (size_t j = 0; j < cell_array_length; ++j) {
+		mpack_node_t cell = mpack_node_array_at(cell_array, j);
+		size_t cell_length = mpack_node_array_length(cell);
+		mpack_node_t text = mpack_node_array_at(cell, 0);
+		if (cell_length > 1) {
+			hl_attrib_id = MPackIntFromArray(cell, 1);
+		}
+		int repeat = 1;
+		if (cell_length > 2) {
+			repeat = MPackIntFromArray(cell, 2);
+		}
+		size_t text_length = mpack_node_strlen(text);
+		uint32_t grid_char = text_length == 0 ? GRID_CHAR_WIDE_RIGHT_HALF : Utf8ToGridChar(mpack_node_str(text), text_length);
+		col = GridPutCell(&model->grid, row, col, grid_char, static_cast<uint16_t>(hl_attrib_id), repeat);
+	}
+}
+
+static void LegacyApplyRedraw(UIModel *model, mpack_node_t params) {
+	size_t event_count = mpack_node_array_length(params);
+	for (size_t i = 0; i < event_count; ++i) {
+		mpack_node_t event = mpack_node_array_at(params, i);
+		mpack_node_t name = mpack_node_array_at(event, 0);
+		if (MPackMatchString(name, "grid_resize")) {
+			mpack_node_t grid_resize_params = mpack_node_array_at(event, 1);
+			GridResize(&model->grid, MPackIntFromArray(grid_resize_params, 2), MPackIntFromArray(grid_resize_params, 1));
+		}
+		else if (MPackMatchString(name, "hl_attr_define")) {
+			LegacyHighlightDefine(model, event);
+		}
+		else if (MPackMatchString(name, "grid_line")) {
+			size_t line_count = mpack_node_array_length(event);
+			for (size_t j = 1; j < line_count; ++j) {
+				LegacyGridLine(model, mpack_node_array_at(event, j));
+			}
+		}
+	}
+}
+
+// Feeds a message to the reader in pipe sized chunks
+struct ChunkedStream {
+	const char *data;
+	size_t size;
+	size_t pos;
+};
+static size_t ReadChunked(void *io_context, char *buffer, size_t count) {
+	constexpr size_t PIPE_CHUNK_SIZE = 4096;
+	ChunkedStream *stream = static_cast<ChunkedStream *>(io_context);
+	if (stream->pos == stream->size) {
+		stream->pos = 0;
+	}
+	size_t bytes = stream->size - stream->pos;
+	bytes = bytes < count ? bytes : count;
+	bytes = bytes < PIPE_CHUNK_SIZE ? bytes : PIPE_CHUNK_SIZE;
+	memcpy(buffer, stream->data + stream->pos, bytes);
+	stream->pos += bytes;
+	return bytes;
+}
+
+// Flushes the way the renderer does, looking up the layout of every row
+// drawn. There are no layouts here, only whether one would be reused.
+static void FlushLayouts(UIModel *model, LayoutCache *layout_cache) {
+	UIModelFlushRows(model, [&](int row, DirtyRowSpan span) {
+		GridWidenSpan(&model->grid, row, true, &span.left, &span.right);
+		LayoutCacheKey key {
+			.row_hash = model->drawn_rows.hashes[row],
+			.font_generation = 0,
+			.left = static_cast<uint16_t>(span.left),
+			.right = static_cast<uint16_t>(span.right)
+		};
+		void *layout;
+		if (!LayoutCacheFind(layout_cache, key, &layout)) {
+			LayoutCacheInsert(layout_cache, key, nullptr, span.right - span.left);
+		}
+	});
+}
+
+// Applies a workload on top of a base screen and reports how many row
+// draws the dirty row tracking folded together, how many of the rows
+// left were skipped for looking the same as before, and how many of the
+// rows drawn could reuse a layout. With `repaint` the whole window is
+// drawn again afterwards, as after a resize.
+static void PrintDirtyRows(const char *name, WorkloadMessage base, WorkloadMessage message, bool repaint = false) {
+	UIModel model {};
+	UIModelInitialize(&model);
+	Arena arena;
+	ArenaInitialize(&arena, MEGABYTES(1));
+	RedrawEventStats event_stats {};
+	LayoutCache layout_cache {};
+	LayoutCacheInitialize(&layout_cache, DEFAULT_LAYOUT_CACHE_CAPACITY, [](void *) {});
+
+	const WorkloadMessage *messages[] { &base, &message };
+	for (const WorkloadMessage *m : messages) {
+		ArenaReset(&arena);
+		MPackCursor params;
+		RedrawParseNotification(m->data, m->size, &params);
+		RedrawEncodeOps(&arena, params, &event_stats);
+		RedrawOps ops = RedrawOpsInit(reinterpret_cast<const char *>(arena.data), arena.size);
+		while (const RedrawOp *op = RedrawOpsNext(&ops)) {
+			if (op->type == RedrawOpType::Flush) {
+				FlushLayouts(&model, &layout_cache);
+			}
+			else {
+				RedrawApplyOp(&model, op);
+			}
+		}
+		if (m == &base) {
+			model.dirty_rows.stats = DirtyRowStats {};
+			model.drawn_rows.stats = RowHashStats {};
+			model.compositor.stats = CompositorStats {};
+			layout_cache.stats = LayoutCacheStats {};
+		}
+	}
+	if (repaint) {
+		DirtyRowsMarkAll(&model.dirty_rows);
+		RowHashesInvalidate(&model.drawn_rows);
+		FlushLayouts(&model, &layout_cache);
+	}
+
+	DirtyRowStats *stats = &model.dirty_rows.stats;
+	RowHashStats *hash_stats = &model.drawn_rows.stats;
+	printf("%-48s %10llu marks %10llu redundant %10llu unchanged %10llu rows drawn %10llu span cells\n", name,
+		static_cast<unsigned long long>(stats->marks),
+		static_cast<unsigned long long>(stats->redundant_marks),
+		static_cast<unsigned long long>(hash_stats->hits),
+		static_cast<unsigned long long>(hash_stats->misses),
+		static_cast<unsigned long long>(stats->span_cells));
+	CompositorStats *compositor_stats = &model.compositor.stats;
+	printf("    %llu cells composed, %llu layout changes\n",
+		static_cast<unsigned long long>(compositor_stats->cells_composed),
+		static_cast<unsigned long long>(compositor_stats->layout_changes));
+	LayoutCacheStats *layout_stats = &layout_cache.stats;
+	printf("    %llu layouts reused, %llu shaped\n",
+		static_cast<unsigned long long>(layout_stats->hits),
+		static_cast<unsigned long long>(layout_stats->misses));
+
+	LayoutCacheFree(&layout_cache);
+	ArenaFree(&arena);
+	UIModelShutdown(&model);
+	WorkloadFree(&base);
+	WorkloadFree(&message);
+}
+
+void BenchRedraw() {
+	char name[128];
+	for (const GridDimensions &size : BENCH_GRID_SIZES) {
+		WorkloadMessage message = WorkloadFullRepaint(size.rows, size.cols, 1);
+		double cells = static_cast<double>(size.rows) * size.cols;
+
+		UIModel model {};
+		UIModelInitialize(&model);
+		mpack_tree_t tree;
+
+		snprintf(name, sizeof(name), "mpack_tree parse %s", size.name);
+		BenchRun(name, [&]() {
+			mpack_tree_init_data(&tree, message.data, message.size);
+			mpack_tree_parse(&tree);
+			BenchDoNotOptimize(mpack_tree_error(&tree));
+			mpack_tree_destroy(&tree);
+		}, cells, "cells");
+
+		snprintf(name, sizeof(name), "mpack_tree parse+apply %s", size.name);
+		BenchRun(name, [&]() {
+			mpack_tree_init_data(&tree, message.data, message.size);
+			mpack_tree_parse(&tree);
+			MPackMessageResult result = MPackExtractMessageResult(&tree);
+			LegacyApplyRedraw(&model, result.params);
+			mpack_tree_destroy(&tree);
+		}, cells, "cells");
+
+		snprintf(name, sizeof(name), "cursor frame %s", size.name);
+		ChunkedStream stream { message.data, message.size, 0 };
+		NvimRpcReader reader;
+		NvimRpcReaderInitialize(&reader, &stream, ReadChunked);
+		BenchRun(name, [&]() {
+			const char *data;
+			size_t data_size;
+			NvimRpcReaderNext(&reader, &data, &data_size);
+			BenchDoNotOptimize(data_size);
+		}, cells, "cells");
+		NvimRpcReaderDestroy(&reader);
+
+		// Split the same way as the reader and UI threads split the work
+		Arena arena;
+		ArenaInitialize(&arena, MEGABYTES(1));
+		RedrawEventStats event_stats {};
+		snprintf(name, sizeof(name), "ops encode (reader thread) %s", size.name);
+		BenchRun(name, [&]() {
+			ArenaReset(&arena);
+			MPackCursor params;
+			RedrawParseNotification(message.data, message.size, &params);
+			RedrawEncodeOps(&arena, params, &event_stats);
+			BenchDoNotOptimize(arena.size);
+		}, cells, "cells");
+
+		snprintf(name, sizeof(name), "ops apply (UI thread) %s", size.name);
+		BenchRun(name, [&]() {
+			RedrawOps ops = RedrawOpsInit(reinterpret_cast<const char *>(arena.data), arena.size);
+			while (const RedrawOp *op = RedrawOpsNext(&ops)) {
+				RedrawApplyOp(&model, op);
+			}
+		}, cells, "cells");
+		printf("    %zu bytes of ops for a %zu byte notification\n", arena.size, message.size);
+		ArenaFree(&arena);
+
+		UIModelShutdown(&model);
+		WorkloadFree(&message);
+	}
+
+	const GridDimensions &size = BENCH_GRID_SIZES[2];
+	const auto Repaint = [&]() { return WorkloadFullRepaint(size.rows, size.cols, 1); };
+	PrintDirtyRows("dirty rows, scroll by 1", Repaint(), WorkloadScroll(size.rows, size.cols, 1, 1));
+	PrintDirtyRows("dirty rows, scroll by half a page", Repaint(), WorkloadScroll(size.rows, size.cols, size.rows / 2, 1));
+	PrintDirtyRows("dirty rows, 200 lines of terminal output", Repaint(), WorkloadTerminalFlood(size.rows, size.cols, 200, 1));
+	// A keystroke in insert mode only sends the cells that changed
+	PrintDirtyRows("dirty rows, typing a character", Repaint(), WorkloadEcho(size.rows / 2, size.cols / 2, "x", 1));
+	// :redraw! resends the screen that is already there
+	PrintDirtyRows("dirty rows, same screen sent again", Repaint(), WorkloadFullRepaint(size.rows, size.cols, 1));
+	// Resizing or uncovering the window draws every row again
+	PrintDirtyRows("dirty rows, window repainted after scroll by 1", Repaint(), WorkloadScroll(size.rows, size.cols, 1, 1), true);
+
+	// Changing a highlight redraws the rows showing it, a default color
+	// change the rows showing a highlight that falls back to it
+	PrintDirtyRows("dirty rows, redefine a highlight on screen", Repaint(), WorkloadHighlightRedefine(1, 0xFF8000));
+	PrintDirtyRows("dirty rows, redefine a highlight not on screen", Repaint(), WorkloadHighlightRedefine(1000, 0xFF8000));
+	PrintDirtyRows("dirty rows, same default colors sent again", Repaint(), WorkloadDefaultColors(0, 0, 0));
+	PrintDirtyRows("dirty rows, new default colors", Repaint(), WorkloadDefaultColors(0xD0D0D0, 0x1C1C1C, 0xFF0000));
+
+	// With ext_multigrid every window is its own grid, so scrolling one
+	// split leaves the other alone and moving a float only redraws the
+	// cells it left and the cells it now covers
+	const auto Splits = [&]() { return WorkloadSplitLayout(size.rows, size.cols, 1); };
+	PrintDirtyRows("dirty rows, split layout", Repaint(), Splits());
+	PrintDirtyRows("dirty rows, scroll one of two splits by 1", Splits(), WorkloadSplitScroll(size.rows, size.cols, 1, 1));
+	PrintDirtyRows("dirty rows, move a float by one cell", Splits(), WorkloadFloatMove(0, 1));
+}
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include "bench.h"
+#include "common/clock.h"
+#include "nvim/rpc.h"
+
+// Messages handled in one iteration of the message loop, ie: a burst of
+// key autorepeat or the mouse moves of a drag
+constexpr int RPC_BENCH_BURST = 32;
+
+// A real write per call, so the cost of the syscall is part of the result
+static bool WriteToNull(void *io_context, const void *data, size_t size) {
+	return fwrite(data, 1, size, static_cast<FILE *>(io_context)) == size;
+}
+
+static void PrintWriteStats(NvimRpc *rpc) {
+	NvimRpcWriteStats *stats = &rpc->write_stats;
+	double write_seconds = static_cast<double>(stats->write_time_ns) * 1e-9;
+	double total_seconds = static_cast<double>(ClockNanoseconds() - stats->start_time_ns) * 1e-9;
+	double bytes = static_cast<double>(stats->byte_count);
+	printf("    %llu msgs in %llu writes, %.1f msgs/write (max %llu), %.1f MB/s overall, %.1f MB/s while writing\n",
+		static_cast<unsigned long long>(stats->message_count),
+		static_cast<unsigned long long>(stats->write_count),
+		static_cast<double>(stats->message_count) / static_cast<double>(stats->write_count ? stats->write_count : 1),
+		static_cast<unsigned long long>(stats->max_messages_per_write),
+		total_seconds > 0.0 ? bytes / total_seconds / 1e6 : 0.0,
+		write_seconds > 0.0 ? bytes / write_seconds / 1e6 : 0.0);
+}
+
+template<typename SendFn>
+static void BenchBurst(const char *name, FILE *sink, bool batched, SendFn send) {
+	NvimRpc rpc {};
+	NvimRpcInitialize(&rpc, sink, WriteToNull);
+	BenchRun(name, [&]() {
+		if (batched) {
+			NvimRpcBeginBatch(&rpc);
+		}
+		for (int i = 0; i < RPC_BENCH_BURST; ++i) {
+			send(&rpc, i);
+		}
+		NvimRpcFlush(&rpc);
+	}, RPC_BENCH_BURST, "msgs");
+	PrintWriteStats(&rpc);
+}
+
+void BenchRpc() {
+#ifdef _WIN32
+	FILE *sink = fopen("NUL", "wb");
+#else
+	FILE *sink = fopen("/dev/null", "wb");
+#endif
+	if (!sink) {
+		printf("    couldn't open the null device\n");
+		return;
+	}
+	setvbuf(sink, nullptr, _IONBF, 0);
+
+	auto send_key = [](NvimRpc *rpc, int) {
+		NvimRpcInput(rpc, "j");
+	};
+	auto send_drag = [](NvimRpc *rpc, int i) {
+		NvimRpcInputMouse(rpc, "left", "drag", "", 0, 10 + i / 8, 20 + i);
+	};
+	BenchBurst("key autorepeat, a write per message", sink, false, send_key);
+	BenchBurst("key autorepeat, batched", sink, true, send_key);
+	BenchBurst("mouse drag, a write per message", sink, false, send_drag);
+	BenchBurst("mouse drag, batched", sink, true, send_drag);
+
+	fclose(sink);
+}
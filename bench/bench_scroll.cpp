@@ -0,0 +1,76 @@
+#include <cstring>
+#include "bench.h"
+#include "model/grid.h"
+
+struct ScrollGridSize {
+	const char *name;
+	int rows;
+	int cols;
+};
+constexpr ScrollGridSize SCROLL_BENCH_GRID_SIZES[] {
+	{ "80x25", 25, 80 },
+	{ "1080p 240x67", 67, 240 },
+	{ "4K 480x135", 135, 480 },
+	{ "500x200", 200, 500 },
+};
+
+// The row by row copy that every scroll did before the row map, kept
+// here as a baseline
+static void LegacyGridScroll(Grid *grid, GridScrollRegion region) {
+	bool scrolling_down = region.rows > 0;
+	int start_row = scrolling_down ? region.top : region.bottom - 1;
+	int end_row = scrolling_down ? region.bottom - 1 : region.top;
+	int increment = scrolling_down ? 1 : -1;
+
+	for (int j = start_row; scrolling_down ? j <= end_row : j >= end_row; j += increment) {
+		int target_row = j - region.rows;
+		if (target_row < region.top || target_row >= region.bottom) {
+			continue;
+		}
+		int count = region.right - region.left;
+		memcpy(GridRowChars(grid, target_row) + region.left, GridRowChars(grid, j) + region.left, count * sizeof(uint32_t));
+		memcpy(GridRowHighlights(grid, target_row) + region.left, GridRowHighlights(grid, j) + region.left, count * sizeof(uint16_t));
+		memcpy(GridRowFlags(grid, target_row) + region.left, GridRowFlags(grid, j) + region.left, count);
+	}
+}
+
+// Scrolls down and back up again, so the grid ends up where it started
+template<typename ScrollFn>
+static void BenchScrollRegion(const char *name, Grid *grid, GridScrollRegion region, ScrollFn scroll) {
+	GridScrollRegion up = region;
+	up.rows = -region.rows;
+	BenchRun(name, [&]() {
+		scroll(grid, region);
+		scroll(grid, up);
+	}, 2.0, "scrolls");
+}
+
+void BenchScroll() {
+	char name[128];
+	for (const ScrollGridSize &size : SCROLL_BENCH_GRID_SIZES) {
+		Grid grid {};
+		GridResize(&grid, size.rows, size.cols);
+
+		// The text area above the statusline and command line, as
+		// scrolled by holding j and by <C-d>
+		GridScrollRegion by_line { .top = 0, .bottom = size.rows - 2, .left = 0, .right = size.cols, .rows = 1 };
+		GridScrollRegion by_half_page = by_line;
+		by_half_page.rows = (size.rows - 2) / 2;
+		// One side of a vertical split, which still has to be copied
+		GridScrollRegion split = by_line;
+		split.right = size.cols / 2;
+
+		snprintf(name, sizeof(name), "copy rows, scroll by 1 %s", size.name);
+		BenchScrollRegion(name, &grid, by_line, LegacyGridScroll);
+		snprintf(name, sizeof(name), "row map, scroll by 1 %s", size.name);
+		BenchScrollRegion(name, &grid, by_line, GridScroll);
+		snprintf(name, sizeof(name), "copy rows, scroll by half %s", size.name);
+		BenchScrollRegion(name, &grid, by_half_page, LegacyGridScroll);
+		snprintf(name, sizeof(name), "row map, scroll by half %s", size.name);
+		BenchScrollRegion(name, &grid, by_half_page, GridScroll);
+		snprintf(name, sizeof(name), "split, scroll by 1 %s", size.name);
+		BenchScrollRegion(name, &grid, split, GridScroll);
+
+		GridFree(&grid);
+	}
+}
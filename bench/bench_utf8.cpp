@@ -0,0 +1,147 @@
+#include <cstdlib>
+#include <cstring>
+#include "bench.h"
+#include "common/utf8.h"
+#include "nvim/redraw.h"
+
+constexpr int UTF8_BENCH_COLS = 480;
+constexpr int UTF8_BENCH_ROWS = 135;
+constexpr uint32_t UTF8_BENCH_CELLS = UTF8_BENCH_COLS * UTF8_BENCH_ROWS;
+
+static uint32_t NextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// A 4K screen worth of grid chars, `wide_percent` of them CJK
+// ideographs or (a tenth of those) emoji outside the BMP
+static void FillGridChars(uint32_t *grid_chars, uint32_t wide_percent) {
+	uint32_t rng = 1;
+	for (uint32_t i = 0; i < UTF8_BENCH_CELLS; ++i) {
+		uint32_t roll = NextRandom(&rng) % 1000;
+		if (roll < wide_percent) {
+			uint32_t codepoint = 0x1F600 + NextRandom(&rng) % 0x50 - 0x10000;
+			grid_chars[i] = ((0xD800 + (codepoint >> 10)) << 16) | (0xDC00 + (codepoint & 0x3FF));
+		}
+		else if (roll < wide_percent * 10) {
+			grid_chars[i] = 0x4E00 + NextRandom(&rng) % 0x5000;
+		}
+		else {
+			grid_chars[i] = 'a' + NextRandom(&rng) % 26;
+		}
+	}
+}
+
+// The cells array of a grid_line as msgpack, runs of `run_length` plain
+// ASCII cells each started by a cell with a highlight id
+static size_t WriteCellRuns(uint8_t *buffer, uint32_t cell_count, uint32_t run_length) {
+	uint32_t rng = 1;
+	size_t size = 0;
+	for (uint32_t i = 0; i < cell_count; ++i) {
+		uint8_t c = static_cast<uint8_t>('a' + NextRandom(&rng) % 26);
+		if (i % run_length == 0) {
+			const uint8_t cell[] { 0x92, 0xA1, c, static_cast<uint8_t>(1 + NextRandom(&rng) % 100) };
+			memcpy(buffer + size, cell, sizeof(cell));
+			size += sizeof(cell);
+		}
+		else {
+			const uint8_t cell[] { 0x91, 0xA1, c };
+			memcpy(buffer + size, cell, sizeof(cell));
+			size += sizeof(cell);
+		}
+	}
+	return size;
+}
+
+// Decodes the whole cells array the way EncodeGridLine does, returns the cell count
+template<typename DecodeFn>
+static uint32_t DecodeCellRuns(DecodeFn decode, const uint8_t *buffer, size_t size, RedrawCell *cells, uint32_t cell_count) {
+	MPackCursor cursor = MPackCursorInit(reinterpret_cast<const char *>(buffer), size);
+	uint32_t i = 0;
+	while (i < cell_count && !MPackCursorAtEnd(&cursor)) {
+		i += decode(&cursor, &cells[i], cell_count - i, 0);
+		if (i < cell_count && !MPackCursorAtEnd(&cursor)) {
+			MPackCursorReadArray(&cursor);
+			uint32_t length;
+			const char *text = MPackCursorReadStr(&cursor, &length);
+			uint16_t hl_attrib_id = static_cast<uint16_t>(MPackCursorReadInt(&cursor));
+			cells[i++] = RedrawCell {
+				.grid_char = Utf8ToGridChar(text, length),
+				.hl_attrib_id = hl_attrib_id,
+				.repeat = 1
+			};
+		}
+	}
+	return i;
+}
+
+void BenchUtf8() {
+	char name[128];
+
+	uint32_t *grid_chars = static_cast<uint32_t *>(malloc(UTF8_BENCH_CELLS * sizeof(uint32_t)));
+	uint16_t *utf16 = static_cast<uint16_t *>(malloc(UTF8_BENCH_CELLS * 2 * sizeof(uint16_t)));
+	uint16_t *utf16_scalar = static_cast<uint16_t *>(malloc(UTF8_BENCH_CELLS * 2 * sizeof(uint16_t)));
+	constexpr struct {
+		const char *name;
+		uint32_t wide_percent;
+	} TEXT_MIXES[] {
+		{ "ascii", 0 },
+		{ "5% cjk", 5 },
+		{ "50% cjk", 50 },
+	};
+	for (const auto &mix : TEXT_MIXES) {
+		FillGridChars(grid_chars, mix.wide_percent);
+		size_t length = GridCharsToUtf16(grid_chars, UTF8_BENCH_CELLS, utf16);
+		size_t scalar_length = GridCharsToUtf16Scalar(grid_chars, UTF8_BENCH_CELLS, utf16_scalar);
+		if (length != scalar_length || memcmp(utf16, utf16_scalar, length * sizeof(uint16_t)) != 0) {
+			printf("    MISMATCH between GridCharsToUtf16 and the scalar version\n");
+		}
+
+		// One call per row, as the renderer draws them
+		snprintf(name, sizeof(name), "grid chars to utf16 scalar %s", mix.name);
+		BenchRun(name, [&]() {
+			for (int row = 0; row < UTF8_BENCH_ROWS; ++row) {
+				BenchDoNotOptimize(GridCharsToUtf16Scalar(&grid_chars[row * UTF8_BENCH_COLS], UTF8_BENCH_COLS, utf16));
+			}
+		}, UTF8_BENCH_CELLS, "cells");
+		snprintf(name, sizeof(name), "grid chars to utf16 %s", mix.name);
+		BenchRun(name, [&]() {
+			for (int row = 0; row < UTF8_BENCH_ROWS; ++row) {
+				BenchDoNotOptimize(GridCharsToUtf16(&grid_chars[row * UTF8_BENCH_COLS], UTF8_BENCH_COLS, utf16));
+			}
+		}, UTF8_BENCH_CELLS, "cells");
+	}
+
+	uint8_t *buffer = static_cast<uint8_t *>(malloc(UTF8_BENCH_CELLS * 4));
+	RedrawCell *cells = static_cast<RedrawCell *>(malloc(UTF8_BENCH_CELLS * sizeof(RedrawCell)));
+	RedrawCell *cells_scalar = static_cast<RedrawCell *>(malloc(UTF8_BENCH_CELLS * sizeof(RedrawCell)));
+	for (uint32_t run_length : { 6u, 32u, 480u }) {
+		size_t size = WriteCellRuns(buffer, UTF8_BENCH_CELLS, run_length);
+		uint32_t count = DecodeCellRuns(RedrawDecodeAsciiCells, buffer, size, cells, UTF8_BENCH_CELLS);
+		uint32_t scalar_count = DecodeCellRuns(RedrawDecodeAsciiCellsScalar, buffer, size, cells_scalar, UTF8_BENCH_CELLS);
+		if (count != UTF8_BENCH_CELLS || count != scalar_count ||
+			memcmp(cells, cells_scalar, count * sizeof(RedrawCell)) != 0) {
+			printf("    MISMATCH between RedrawDecodeAsciiCells and the scalar version\n");
+		}
+
+		snprintf(name, sizeof(name), "ascii cells scalar, runs of %u", run_length);
+		BenchRun(name, [&]() {
+			BenchDoNotOptimize(DecodeCellRuns(RedrawDecodeAsciiCellsScalar, buffer, size, cells, UTF8_BENCH_CELLS));
+		}, UTF8_BENCH_CELLS, "cells");
+		snprintf(name, sizeof(name), "ascii cells, runs of %u", run_length);
+		BenchRun(name, [&]() {
+			BenchDoNotOptimize(DecodeCellRuns(RedrawDecodeAsciiCells, buffer, size, cells, UTF8_BENCH_CELLS));
+		}, UTF8_BENCH_CELLS, "cells");
+	}
+
+	free(cells_scalar);
+	free(cells);
+	free(buffer);
+	free(utf16_scalar);
+	free(utf16);
+	free(grid_chars);
+}
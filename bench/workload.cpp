@@ -0,0 +1,616 @@
+#include "workload.h"
+#include <cstdlib>
+#include <cstring>
+#include "common/mpack_helper.h"
+#include "model/highlight.h"
+
+constexpr int WORKLOAD_HIGHLIGHT_COUNT = 32;
+constexpr int WORKLOAD_MAX_CELLS = 512;
+
+// A grid_line cell as nvim sends it, `hl_id` is left out if negative
+// (repeat the previous cell's highlight) and `repeat` if it is 1
+struct WorkloadCell {
+	char text[8];
+	int hl_id;
+	int repeat;
+};
+
+static uint32_t NextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void SetCellText(WorkloadCell *cell, uint32_t codepoint) {
+	char *text = cell->text;
+	if (codepoint < 0x80) {
+		*text++ = static_cast<char>(codepoint);
+	}
+	else if (codepoint < 0x800) {
+		*text++ = static_cast<char>(0xC0 | (codepoint >> 6));
+		*text++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+	}
+	else if (codepoint < 0x10000) {
+		*text++ = static_cast<char>(0xE0 | (codepoint >> 12));
+		*text++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+		*text++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+	}
+	else {
+		*text++ = static_cast<char>(0xF0 | (codepoint >> 18));
+		*text++ = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+		*text++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+		*text++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+	}
+	*text = '\0';
+}
+
+static int PushCell(WorkloadCell *cells, int cell_count, uint32_t codepoint, int hl_id, int repeat) {
+	SetCellText(&cells[cell_count], codepoint);
+	cells[cell_count].hl_id = hl_id;
+	cells[cell_count].repeat = repeat;
+	return cell_count + 1;
+}
+
+// Splits a row into alternating runs of words and whitespace, words are
+// sent one cell per character, whitespace as a single repeated cell. This
+// is roughly the shape of syntax highlighted source code.
+static int MakeCodeLine(WorkloadCell *cells, int cols, int hl_base, uint32_t *rng) {
+	int cell_count = 0;
+	int col = 0;
+	int indent = static_cast<int>(NextRandom(rng) % 4) * 4;
+	if (indent > 0) {
+		cell_count = PushCell(cells, cell_count, ' ', 0, indent);
+		col += indent;
+	}
+	while (col < cols && cell_count < WORKLOAD_MAX_CELLS - 12) {
+		int word_length = 2 + static_cast<int>(NextRandom(rng) % 10);
+		int hl_id = hl_base + static_cast<int>(NextRandom(rng) % WORKLOAD_HIGHLIGHT_COUNT);
+		for (int i = 0; i < word_length && col < cols && cell_count < WORKLOAD_MAX_CELLS - 12; ++i) {
+			uint32_t c = 'a' + NextRandom(rng) % 26;
+			cell_count = PushCell(cells, cell_count, c, i == 0 ? hl_id : -1, 1);
+			++col;
+		}
+		if (col < cols) {
+			cell_count = PushCell(cells, cell_count, ' ', 0, 1);
+			++col;
+		}
+	}
+	if (col < cols) {
+		cell_count = PushCell(cells, cell_count, ' ', 0, cols - col);
+	}
+	return cell_count;
+}
+
+// Mixes ASCII with double width CJK ideographs and emoji, each wide
+// character is followed by the empty cell nvim sends for its right half
+static int MakeWideLine(WorkloadCell *cells, int cols, uint32_t *rng) {
+	int cell_count = 0;
+	int col = 0;
+	while (col < cols && cell_count < WORKLOAD_MAX_CELLS - 2) {
+		uint32_t kind = NextRandom(rng) % 8;
+		int hl_id = 1 + static_cast<int>(NextRandom(rng) % WORKLOAD_HIGHLIGHT_COUNT);
+		if (kind < 5 && col + 1 < cols) {
+			cell_count = PushCell(cells, cell_count, 0x4E00 + NextRandom(rng) % 0x5000, hl_id, 1);
+			cells[cell_count].text[0] = '\0';
+			cells[cell_count].hl_id = -1;
+			cells[cell_count].repeat = 1;
+			++cell_count;
+			col += 2;
+		}
+		else if (kind < 6 && col + 1 < cols) {
+			cell_count = PushCell(cells, cell_count, 0x1F600 + NextRandom(rng) % 0x50, hl_id, 1);
+			cells[cell_count].text[0] = '\0';
+			cells[cell_count].hl_id = -1;
+			cells[cell_count].repeat = 1;
+			++cell_count;
+			col += 2;
+		}
+		else {
+			cell_count = PushCell(cells, cell_count, 'a' + NextRandom(rng) % 26, hl_id, 1);
+			++col;
+		}
+	}
+	if (col < cols) {
+		cell_count = PushCell(cells, cell_count, ' ', 0, cols - col);
+	}
+	return cell_count;
+}
+
+// A line of program output as seen in a :terminal, default highlight
+// except for the odd colored prefix, padded with a repeated blank
+static int MakeTerminalLine(WorkloadCell *cells, int cols, uint32_t *rng) {
+	int cell_count = 0;
+	int length = 8 + static_cast<int>(NextRandom(rng) % 72);
+	length = length < cols ? length : cols;
+	int prefix = NextRandom(rng) % 4 == 0 ? 6 : 0;
+	for (int col = 0; col < length && cell_count < WORKLOAD_MAX_CELLS - 1; ++col) {
+		uint32_t c = NextRandom(rng) % 6 == 0 ? ' ' : '!' + NextRandom(rng) % 94;
+		int hl_id = -1;
+		if (col == 0) {
+			hl_id = prefix ? 1 + static_cast<int>(NextRandom(rng) % WORKLOAD_HIGHLIGHT_COUNT) : 0;
+		}
+		else if (col == prefix) {
+			hl_id = 0;
+		}
+		cell_count = PushCell(cells, cell_count, c, hl_id, 1);
+	}
+	if (length < cols) {
+		cell_count = PushCell(cells, cell_count, ' ', 0, cols - length);
+	}
+	return cell_count;
+}
+
+static void BeginRedraw(WorkloadMessage *message, mpack_writer_t *writer, uint32_t event_count) {
+	*message = WorkloadMessage {};
+	mpack_writer_init_growable(writer, &message->data, &message->size);
+	MPackStartNotification("redraw", writer);
+	mpack_start_array(writer, event_count);
+}
+
+static void FinishRedraw(mpack_writer_t *writer) {
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+	mpack_error_t err = mpack_writer_destroy(writer);
+	assert(err == mpack_ok);
+}
+
+static void WriteHighlightDefinitions(mpack_writer_t *writer, int first_id, uint32_t *rng) {
+	mpack_start_array(writer, WORKLOAD_HIGHLIGHT_COUNT + 1);
+	mpack_write_cstr(writer, "hl_attr_define");
+	for (int id = first_id; id < first_id + WORKLOAD_HIGHLIGHT_COUNT; ++id) {
+		mpack_start_array(writer, 4);
+		mpack_write_int(writer, id);
+		mpack_start_map(writer, 3);
+		mpack_write_cstr(writer, "foreground");
+		mpack_write_uint(writer, NextRandom(rng) & 0xFFFFFF);
+		mpack_write_cstr(writer, "background");
+		mpack_write_uint(writer, NextRandom(rng) & 0xFFFFFF);
+		mpack_write_cstr(writer, (id & 1) ? "bold" : "italic");
+		mpack_write_true(writer);
+		mpack_finish_map(writer);
+		mpack_start_map(writer, 0);
+		mpack_finish_map(writer);
+		mpack_start_array(writer, 0);
+		mpack_finish_array(writer);
+		mpack_finish_array(writer);
+	}
+	mpack_finish_array(writer);
+}
+
+// A single grid_line call, written without the event name
+static void WriteGridLine(mpack_writer_t *writer, int grid, int row, int col_start, const WorkloadCell *cells, int cell_count) {
+	mpack_start_array(writer, 5);
+	mpack_write_int(writer, grid);
+	mpack_write_int(writer, row);
+	mpack_write_int(writer, col_start);
+	mpack_start_array(writer, cell_count);
+	for (int i = 0; i < cell_count; ++i) {
+		int length = cells[i].repeat > 1 ? 3 : (cells[i].hl_id >= 0 ? 2 : 1);
+		mpack_start_array(writer, length);
+		mpack_write_cstr(writer, cells[i].text);
+		if (length > 1) {
+			mpack_write_int(writer, cells[i].hl_id >= 0 ? cells[i].hl_id : 0);
+		}
+		if (length > 2) {
+			mpack_write_int(writer, cells[i].repeat);
+		}
+		mpack_finish_array(writer);
+	}
+	mpack_finish_array(writer);
+	mpack_write_false(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteGridResize(mpack_writer_t *writer, int grid, int rows, int cols) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "grid_resize");
+	mpack_start_array(writer, 3);
+	mpack_write_int(writer, grid);
+	mpack_write_int(writer, cols);
+	mpack_write_int(writer, rows);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteGridScroll(mpack_writer_t *writer, int grid, int top, int bottom, int cols, int scroll_rows) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "grid_scroll");
+	mpack_start_array(writer, 7);
+	mpack_write_int(writer, grid);
+	mpack_write_int(writer, top);
+	mpack_write_int(writer, bottom);
+	mpack_write_int(writer, 0);
+	mpack_write_int(writer, cols);
+	mpack_write_int(writer, scroll_rows);
+	mpack_write_int(writer, 0);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteCursorGoto(mpack_writer_t *writer, int grid, int row, int col) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "grid_cursor_goto");
+	mpack_start_array(writer, 3);
+	mpack_write_int(writer, grid);
+	mpack_write_int(writer, row);
+	mpack_write_int(writer, col);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteFlush(mpack_writer_t *writer) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "flush");
+	mpack_start_array(writer, 0);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+// ext_multigrid window placement, `win` handles are left out as Nvy ignores them
+static void WriteWinPos(mpack_writer_t *writer, int grid, int row, int col, int rows, int cols) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "win_pos");
+	mpack_start_array(writer, 6);
+	mpack_write_int(writer, grid);
+	mpack_write_nil(writer);
+	mpack_write_int(writer, row);
+	mpack_write_int(writer, col);
+	mpack_write_int(writer, cols);
+	mpack_write_int(writer, rows);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteWinFloatPos(mpack_writer_t *writer, int grid, int anchor_grid, double anchor_row, double anchor_col) {
+	mpack_start_array(writer, 2);
+	mpack_write_cstr(writer, "win_float_pos");
+	mpack_start_array(writer, 8);
+	mpack_write_int(writer, grid);
+	mpack_write_nil(writer);
+	mpack_write_cstr(writer, "NW");
+	mpack_write_int(writer, anchor_grid);
+	mpack_write_double(writer, anchor_row);
+	mpack_write_double(writer, anchor_col);
+	mpack_write_true(writer);
+	mpack_write_int(writer, 50);
+	mpack_finish_array(writer);
+	mpack_finish_array(writer);
+}
+
+// Fills every row of a grid with code
+static void WriteGridContents(mpack_writer_t *writer, int grid, int rows, int cols, uint32_t *rng) {
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+	mpack_start_array(writer, rows + 1);
+	mpack_write_cstr(writer, "grid_line");
+	for (int row = 0; row < rows; ++row) {
+		int cell_count = MakeCodeLine(cells, cols, 1, rng);
+		WriteGridLine(writer, grid, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(writer);
+}
+
+WorkloadMessage WorkloadFullRepaint(int rows, int cols, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 4);
+	WriteGridResize(&writer, 1, rows, cols);
+	WriteHighlightDefinitions(&writer, 1, &rng);
+	mpack_start_array(&writer, rows + 1);
+	mpack_write_cstr(&writer, "grid_line");
+	for (int row = 0; row < rows; ++row) {
+		int cell_count = MakeCodeLine(cells, cols, 1, &rng);
+		WriteGridLine(&writer, 1, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(&writer);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadScroll(int rows, int cols, int scroll_rows, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+	scroll_rows = scroll_rows < rows ? scroll_rows : rows - 1;
+
+	// The last row is the statusline, it stays put
+	int bottom = rows - 1;
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 4);
+	WriteGridScroll(&writer, 1, 0, bottom, cols, scroll_rows);
+	mpack_start_array(&writer, scroll_rows + 1);
+	mpack_write_cstr(&writer, "grid_line");
+	for (int row = bottom - scroll_rows; row < bottom; ++row) {
+		int cell_count = MakeCodeLine(cells, cols, 1, &rng);
+		WriteGridLine(&writer, 1, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(&writer);
+	WriteCursorGoto(&writer, 1, bottom - 1, 0);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadTerminalFlood(int rows, int cols, int lines, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+
+	// nvim emits a scroll and the new line for every line of output,
+	// as separate events, and flushes once per batch
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, lines * 2 + 2);
+	for (int i = 0; i < lines; ++i) {
+		WriteGridScroll(&writer, 1, 0, rows - 1, cols, 1);
+		mpack_start_array(&writer, 2);
+		mpack_write_cstr(&writer, "grid_line");
+		int cell_count = MakeTerminalLine(cells, cols, &rng);
+		WriteGridLine(&writer, 1, rows - 2, 0, cells, cell_count);
+		mpack_finish_array(&writer);
+	}
+	WriteCursorGoto(&writer, 1, rows - 2, 0);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadWideText(int rows, int cols, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 2);
+	mpack_start_array(&writer, rows + 1);
+	mpack_write_cstr(&writer, "grid_line");
+	for (int row = 0; row < rows; ++row) {
+		int cell_count = MakeWideLine(cells, cols, &rng);
+		WriteGridLine(&writer, 1, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(&writer);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadHighlightChurn(int rows, int cols, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+
+	// Like a colorscheme change, nvim hands out fresh ids for the new
+	// definitions and every row is redrawn to use them
+	int hl_base = 1 + static_cast<int>((seed * WORKLOAD_HIGHLIGHT_COUNT) %
+		(MAX_HIGHLIGHT_ATTRIBS - WORKLOAD_HIGHLIGHT_COUNT - 1));
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 3);
+	WriteHighlightDefinitions(&writer, hl_base, &rng);
+	mpack_start_array(&writer, rows + 1);
+	mpack_write_cstr(&writer, "grid_line");
+	for (int row = 0; row < rows; ++row) {
+		int cell_count = MakeCodeLine(cells, cols, hl_base, &rng);
+		WriteGridLine(&writer, 1, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(&writer);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadEcho(int row, int col, const char *text, size_t length) {
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+	int cell_count = 0;
+	for (size_t i = 0; i < length && cell_count < WORKLOAD_MAX_CELLS;) {
+		// One cell per UTF-8 sequence
+		size_t sequence_length = 1;
+		while (i + sequence_length < length && sequence_length < 4 &&
+			(static_cast<uint8_t>(text[i + sequence_length]) & 0xC0) == 0x80) {
+			++sequence_length;
+		}
+		memcpy(cells[cell_count].text, &text[i], sequence_length);
+		cells[cell_count].text[sequence_length] = '\0';
+		cells[cell_count].hl_id = cell_count == 0 ? 0 : -1;
+		cells[cell_count].repeat = 1;
+		++cell_count;
+		i += sequence_length;
+	}
+
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 3);
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, "grid_line");
+	WriteGridLine(&writer, 1, row, col, cells, cell_count);
+	mpack_finish_array(&writer);
+	WriteCursorGoto(&writer, 1, row, col + cell_count);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadHighlightRedefine(int hl_attrib_id, uint32_t foreground) {
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 2);
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, "hl_attr_define");
+	mpack_start_array(&writer, 4);
+	mpack_write_int(&writer, hl_attrib_id);
+	mpack_start_map(&writer, 1);
+	mpack_write_cstr(&writer, "foreground");
+	mpack_write_uint(&writer, foreground);
+	mpack_finish_map(&writer);
+	mpack_start_map(&writer, 0);
+	mpack_finish_map(&writer);
+	mpack_start_array(&writer, 0);
+	mpack_finish_array(&writer);
+	mpack_finish_array(&writer);
+	mpack_finish_array(&writer);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadDefaultColors(uint32_t foreground, uint32_t background, uint32_t special) {
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 2);
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, "default_colors_set");
+	mpack_start_array(&writer, 5);
+	mpack_write_uint(&writer, foreground);
+	mpack_write_uint(&writer, background);
+	mpack_write_uint(&writer, special);
+	mpack_write_int(&writer, 0);
+	mpack_write_int(&writer, 0);
+	mpack_finish_array(&writer);
+	mpack_finish_array(&writer);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadColorschemeLoad(int count, int distinct, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 3);
+
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, "default_colors_set");
+	mpack_start_array(&writer, 5);
+	mpack_write_uint(&writer, 0xD0D0D0);
+	mpack_write_uint(&writer, 0x1C1C1C);
+	mpack_write_uint(&writer, 0xFF0000);
+	mpack_write_int(&writer, 0);
+	mpack_write_int(&writer, 0);
+	mpack_finish_array(&writer);
+	mpack_finish_array(&writer);
+
+	mpack_start_array(&writer, count + 1);
+	mpack_write_cstr(&writer, "hl_attr_define");
+	for (int id = 1; id <= count; ++id) {
+		// Every id links to one of the base groups, whose attributes
+		// follow from its index
+		uint32_t group = NextRandom(&rng) % distinct;
+		uint32_t group_rng = group * 2654435761u + 1;
+		bool has_background = group % 4 == 0;
+		bool has_special = group % 11 == 0;
+		bool bold = group % 5 == 0;
+		bool italic = group % 7 == 0;
+		bool blend = group % 13 == 0;
+		uint32_t key_count = 1 + has_background + has_special * 2 + bold + italic + blend;
+
+		mpack_start_array(&writer, 4);
+		mpack_write_int(&writer, id);
+		mpack_start_map(&writer, key_count);
+		mpack_write_cstr(&writer, "foreground");
+		mpack_write_uint(&writer, NextRandom(&group_rng) & 0xFFFFFF);
+		if (has_background) {
+			mpack_write_cstr(&writer, "background");
+			mpack_write_uint(&writer, NextRandom(&group_rng) & 0xFFFFFF);
+		}
+		if (bold) {
+			mpack_write_cstr(&writer, "bold");
+			mpack_write_true(&writer);
+		}
+		if (italic) {
+			mpack_write_cstr(&writer, "italic");
+			mpack_write_true(&writer);
+		}
+		if (has_special) {
+			mpack_write_cstr(&writer, "undercurl");
+			mpack_write_true(&writer);
+			mpack_write_cstr(&writer, "special");
+			mpack_write_uint(&writer, NextRandom(&group_rng) & 0xFFFFFF);
+		}
+		if (blend) {
+			mpack_write_cstr(&writer, "blend");
+			mpack_write_int(&writer, 20);
+		}
+		mpack_finish_map(&writer);
+		mpack_start_map(&writer, 0);
+		mpack_finish_map(&writer);
+		mpack_start_array(&writer, 0);
+		mpack_finish_array(&writer);
+		mpack_finish_array(&writer);
+	}
+	mpack_finish_array(&writer);
+
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadSplitLayout(int rows, int cols, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	int left_cols = cols / 2;
+	int right_cols = cols - left_cols - 1;
+	int window_rows = rows - 2;
+
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 13);
+	WriteGridResize(&writer, 1, rows, cols);
+	WriteHighlightDefinitions(&writer, 1, &rng);
+	WriteGridResize(&writer, WORKLOAD_LEFT_GRID, window_rows, left_cols);
+	WriteGridResize(&writer, WORKLOAD_RIGHT_GRID, window_rows, right_cols);
+	WriteGridResize(&writer, WORKLOAD_FLOAT_GRID, WORKLOAD_FLOAT_ROWS, WORKLOAD_FLOAT_COLS);
+	WriteWinPos(&writer, WORKLOAD_LEFT_GRID, 0, 0, window_rows, left_cols);
+	WriteWinPos(&writer, WORKLOAD_RIGHT_GRID, 0, left_cols + 1, window_rows, right_cols);
+	WriteWinFloatPos(&writer, WORKLOAD_FLOAT_GRID, WORKLOAD_LEFT_GRID, 2.0, 4.0);
+	WriteGridContents(&writer, WORKLOAD_LEFT_GRID, window_rows, left_cols, &rng);
+	WriteGridContents(&writer, WORKLOAD_RIGHT_GRID, window_rows, right_cols, &rng);
+	WriteGridContents(&writer, WORKLOAD_FLOAT_GRID, WORKLOAD_FLOAT_ROWS, WORKLOAD_FLOAT_COLS, &rng);
+	WriteCursorGoto(&writer, WORKLOAD_LEFT_GRID, 0, 0);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadSplitScroll(int rows, int cols, int scroll_rows, uint32_t seed) {
+	uint32_t rng = seed ? seed : 1;
+	WorkloadCell cells[WORKLOAD_MAX_CELLS];
+	int left_cols = cols / 2;
+	int window_rows = rows - 2;
+	scroll_rows = scroll_rows < window_rows ? scroll_rows : window_rows - 1;
+
+	// Within its own grid the split scrolls over its full width
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 4);
+	WriteGridScroll(&writer, WORKLOAD_LEFT_GRID, 0, window_rows, left_cols, scroll_rows);
+	mpack_start_array(&writer, scroll_rows + 1);
+	mpack_write_cstr(&writer, "grid_line");
+	for (int row = window_rows - scroll_rows; row < window_rows; ++row) {
+		int cell_count = MakeCodeLine(cells, left_cols, 1, &rng);
+		WriteGridLine(&writer, WORKLOAD_LEFT_GRID, row, 0, cells, cell_count);
+	}
+	mpack_finish_array(&writer);
+	WriteCursorGoto(&writer, WORKLOAD_LEFT_GRID, window_rows - 1, 0);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+WorkloadMessage WorkloadFloatMove(int row_delta, int col_delta) {
+	WorkloadMessage message;
+	mpack_writer_t writer;
+	BeginRedraw(&message, &writer, 2);
+	WriteWinFloatPos(&writer, WORKLOAD_FLOAT_GRID, WORKLOAD_LEFT_GRID, 2.0 + row_delta, 4.0 + col_delta);
+	WriteFlush(&writer);
+	FinishRedraw(&writer);
+	return message;
+}
+
+void WorkloadFree(WorkloadMessage *message) {
+	MPACK_FREE(message->data);
+	message->data = nullptr;
+	message->size = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Synthetic nvim `redraw` notifications for driving nvy_core headlessly.
+// The returned buffers are malloc'd msgpack-rpc messages, free with WorkloadFree.
+struct WorkloadMessage {
+	char *data;
+	size_t size;
+};
+
+// A grid_resize, a set of highlight definitions and a grid_line for every
+// row, roughly shaped like syntax highlighted source code
+WorkloadMessage WorkloadFullRepaint(int rows, int cols, uint32_t seed);
+// Scrolls the text area up by `scroll_rows` and draws the rows scrolled
+// in, holding j scrolls by 1, <C-d> by half the screen
+WorkloadMessage WorkloadScroll(int rows, int cols, int scroll_rows, uint32_t seed);
+// `lines` lines of :terminal output, each one a scroll and a grid_line
+WorkloadMessage WorkloadTerminalFlood(int rows, int cols, int lines, uint32_t seed);
+// Every row redrawn with a mix of ASCII, CJK ideographs and emoji
+WorkloadMessage WorkloadWideText(int rows, int cols, uint32_t seed);
+// A batch of new highlight definitions and every row redrawn using them
+WorkloadMessage WorkloadHighlightChurn(int rows, int cols, uint32_t seed);
+// What loading a colorscheme sends, new default colors and `count`
+// highlight ids, all of them linked to one of `distinct` base groups
+WorkloadMessage WorkloadColorschemeLoad(int count, int distinct, uint32_t seed);
+// Changes the foreground of one highlight, as :hi does
+WorkloadMessage WorkloadHighlightRedefine(int hl_attrib_id, uint32_t foreground);
+WorkloadMessage WorkloadDefaultColors(uint32_t foreground, uint32_t background, uint32_t special);
+// Draws `text` at the given position and moves the cursor past it
+WorkloadMessage WorkloadEcho(int row, int col, const char *text, size_t length);
+
+// ext_multigrid: two side by side splits with a float over the left one,
+// which WorkloadSplitScroll and WorkloadFloatMove build on
+constexpr int WORKLOAD_LEFT_GRID = 2;
+constexpr int WORKLOAD_RIGHT_GRID = 3;
+constexpr int WORKLOAD_FLOAT_GRID = 4;
+constexpr int WORKLOAD_FLOAT_ROWS = 8;
+constexpr int WORKLOAD_FLOAT_COLS = 40;
+WorkloadMessage WorkloadSplitLayout(int rows, int cols, uint32_t seed);
+// Scrolls only the left split, like holding j in it
+WorkloadMessage WorkloadSplitScroll(int rows, int cols, int scroll_rows, uint32_t seed);
+// Moves the float by the given number of cells
+WorkloadMessage WorkloadFloatMove(int row_delta, int col_delta);
+void WorkloadFree(WorkloadMessage *message);
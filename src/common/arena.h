@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+constexpr size_t ARENA_ALIGNMENT = 8;
+
+// A growable bump allocator. Memory is only ever released all at once by
+// resetting the arena, which keeps the underlying buffer for reuse. The
+// buffer may move when it grows, so allocations are position independent
+// and pointers into the arena are only valid until the next ArenaPush.
+struct Arena {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+};
+
+inline void ArenaInitialize(Arena *arena, size_t initial_capacity) {
+	arena->capacity = initial_capacity;
+	arena->data = static_cast<uint8_t *>(malloc(initial_capacity));
+	arena->size = 0;
+}
+
+inline void ArenaFree(Arena *arena) {
+	free(arena->data);
+	arena->data = nullptr;
+	arena->size = 0;
+	arena->capacity = 0;
+}
+
+inline void ArenaReset(Arena *arena) {
+	arena->size = 0;
+}
+
+// Resets the arena, and if it grew past `max_capacity` gives the buffer
+// back and starts over at `initial_capacity`
+inline void ArenaResetTrim(Arena *arena, size_t max_capacity, size_t initial_capacity) {
+	if (arena->capacity > max_capacity) {
+		free(arena->data);
+		ArenaInitialize(arena, initial_capacity);
+		return;
+	}
+	arena->size = 0;
+}
+
+// Returns `size` bytes of uninitialized memory, aligned to ARENA_ALIGNMENT
+inline void *ArenaPush(Arena *arena, size_t size) {
+	size_t offset = (arena->size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+	if (offset + size > arena->capacity) {
+		size_t new_capacity = arena->capacity ? arena->capacity : ARENA_ALIGNMENT;
+		while (offset + size > new_capacity) {
+			new_capacity *= 2;
+		}
+		arena->data = static_cast<uint8_t *>(realloc(arena->data, new_capacity));
+		arena->capacity = new_capacity;
+	}
+
+	arena->size = offset + size;
+	return arena->data + offset;
+}
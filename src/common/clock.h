@@ -0,0 +1,9 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Monotonic timestamp in nanoseconds, only meaningful relative to another
+inline int64_t ClockNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
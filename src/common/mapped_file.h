@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read-only memory mapping of a whole file
+struct MappedFile {
+	const uint8_t *data;
+	size_t size;
+};
+
+inline bool MappedFileOpen(MappedFile *mapped_file, const char *path) {
+	mapped_file->data = nullptr;
+	mapped_file->size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		return false;
+	}
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == nullptr) {
+		return false;
+	}
+	mapped_file->size = static_cast<size_t>(file_size.QuadPart);
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	mapped_file->size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+	mapped_file->data = static_cast<const uint8_t *>(data);
+	return true;
+}
+
+inline void MappedFileClose(MappedFile *mapped_file) {
+	if (mapped_file->data == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(mapped_file->data);
+#else
+	munmap(const_cast<uint8_t *>(mapped_file->data), mapped_file->size);
+#endif
+	mapped_file->data = nullptr;
+	mapped_file->size = 0;
+}
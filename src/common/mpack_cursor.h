@@ -0,0 +1,384 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// A forward-only msgpack cursor that decodes values straight out of a
+// buffer holding a complete message. Strings are returned as pointers into
+// the buffer, nothing is copied or allocated. Reading a value of the wrong
+// type or past the end sets the error flag and returns a zero value, so
+// callers can decode a whole tuple and check the flag once afterwards.
+struct MPackCursor {
+	const uint8_t *pos;
+	const uint8_t *end;
+	bool error;
+};
+
+enum class MPackCursorType {
+	Nil,
+	Bool,
+	Int,
+	Float,
+	Str,
+	Bin,
+	Array,
+	Map,
+	Ext,
+	Invalid
+};
+
+inline MPackCursor MPackCursorInit(const char *data, size_t size) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+	return MPackCursor {
+		.pos = bytes,
+		.end = bytes + size,
+		.error = false
+	};
+}
+
+inline bool MPackCursorAtEnd(const MPackCursor *cursor) {
+	return cursor->pos >= cursor->end;
+}
+
+inline uint64_t MPackLoadBigEndian(const uint8_t *p, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; ++i) {
+		value = (value << 8) | p[i];
+	}
+	return value;
+}
+
+inline bool MPackCursorHasBytes(MPackCursor *cursor, size_t count) {
+	if (static_cast<size_t>(cursor->end - cursor->pos) < count) {
+		cursor->error = true;
+		cursor->pos = cursor->end;
+		return false;
+	}
+	return true;
+}
+
+inline MPackCursorType MPackCursorPeekType(const MPackCursor *cursor) {
+	if (cursor->pos >= cursor->end) {
+		return MPackCursorType::Invalid;
+	}
+
+	uint8_t tag = *cursor->pos;
+	if (tag <= 0x7f || tag >= 0xe0) return MPackCursorType::Int;
+	if (tag <= 0x8f) return MPackCursorType::Map;
+	if (tag <= 0x9f) return MPackCursorType::Array;
+	if (tag <= 0xbf) return MPackCursorType::Str;
+	switch (tag) {
+	case 0xc0: return MPackCursorType::Nil;
+	case 0xc2:
+	case 0xc3: return MPackCursorType::Bool;
+	case 0xc4:
+	case 0xc5:
+	case 0xc6: return MPackCursorType::Bin;
+	case 0xc7:
+	case 0xc8:
+	case 0xc9:
+	case 0xd4:
+	case 0xd5:
+	case 0xd6:
+	case 0xd7:
+	case 0xd8: return MPackCursorType::Ext;
+	case 0xca:
+	case 0xcb: return MPackCursorType::Float;
+	case 0xcc:
+	case 0xcd:
+	case 0xce:
+	case 0xcf:
+	case 0xd0:
+	case 0xd1:
+	case 0xd2:
+	case 0xd3: return MPackCursorType::Int;
+	case 0xd9:
+	case 0xda:
+	case 0xdb: return MPackCursorType::Str;
+	case 0xdc:
+	case 0xdd: return MPackCursorType::Array;
+	case 0xde:
+	case 0xdf: return MPackCursorType::Map;
+	}
+	return MPackCursorType::Invalid;
+}
+
+inline int64_t MPackCursorReadInt(MPackCursor *cursor) {
+	if (!MPackCursorHasBytes(cursor, 1)) return 0;
+
+	uint8_t tag = *cursor->pos;
+	if (tag <= 0x7f) {
+		cursor->pos += 1;
+		return tag;
+	}
+	if (tag >= 0xe0) {
+		cursor->pos += 1;
+		return static_cast<int8_t>(tag);
+	}
+
+	int bytes;
+	bool is_signed;
+	switch (tag) {
+	case 0xcc: bytes = 1; is_signed = false; break;
+	case 0xcd: bytes = 2; is_signed = false; break;
+	case 0xce: bytes = 4; is_signed = false; break;
+	case 0xcf: bytes = 8; is_signed = false; break;
+	case 0xd0: bytes = 1; is_signed = true; break;
+	case 0xd1: bytes = 2; is_signed = true; break;
+	case 0xd2: bytes = 4; is_signed = true; break;
+	case 0xd3: bytes = 8; is_signed = true; break;
+	default: {
+		cursor->error = true;
+		return 0;
+	}
+	}
+	if (!MPackCursorHasBytes(cursor, 1 + bytes)) return 0;
+
+	uint64_t value = MPackLoadBigEndian(cursor->pos + 1, bytes);
+	cursor->pos += 1 + bytes;
+	if (is_signed && bytes < 8) {
+		// Sign extend
+		uint64_t sign_bit = 1ull << (bytes * 8 - 1);
+		return static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+	}
+	return static_cast<int64_t>(value);
+}
+
+// Reads a float32 or float64, integers are accepted and converted
+inline double MPackCursorReadFloat(MPackCursor *cursor) {
+	if (!MPackCursorHasBytes(cursor, 1)) return 0.0;
+
+	uint8_t tag = *cursor->pos;
+	if (tag == 0xca) {
+		if (!MPackCursorHasBytes(cursor, 5)) return 0.0;
+		uint32_t bits = static_cast<uint32_t>(MPackLoadBigEndian(cursor->pos + 1, 4));
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		cursor->pos += 5;
+		return value;
+	}
+	if (tag == 0xcb) {
+		if (!MPackCursorHasBytes(cursor, 9)) return 0.0;
+		uint64_t bits = MPackLoadBigEndian(cursor->pos + 1, 8);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		cursor->pos += 9;
+		return value;
+	}
+	return static_cast<double>(MPackCursorReadInt(cursor));
+}
+
+inline bool MPackCursorReadBool(MPackCursor *cursor) {
+	if (!MPackCursorHasBytes(cursor, 1)) return false;
+
+	uint8_t tag = *cursor->pos;
+	if (tag != 0xc2 && tag != 0xc3) {
+		cursor->error = true;
+		return false;
+	}
+	cursor->pos += 1;
+	return tag == 0xc3;
+}
+
+// Reads a str (or bin) value in place, the returned pointer is not null terminated
+inline const char *MPackCursorReadStr(MPackCursor *cursor, uint32_t *length) {
+	*length = 0;
+	if (!MPackCursorHasBytes(cursor, 1)) return nullptr;
+
+	uint8_t tag = *cursor->pos;
+	size_t header_size;
+	uint32_t str_length;
+	if (tag >= 0xa0 && tag <= 0xbf) {
+		header_size = 1;
+		str_length = tag & 0x1f;
+	}
+	else if (tag == 0xd9 || tag == 0xc4) {
+		if (!MPackCursorHasBytes(cursor, 2)) return nullptr;
+		header_size = 2;
+		str_length = cursor->pos[1];
+	}
+	else if (tag == 0xda || tag == 0xc5) {
+		if (!MPackCursorHasBytes(cursor, 3)) return nullptr;
+		header_size = 3;
+		str_length = static_cast<uint32_t>(MPackLoadBigEndian(cursor->pos + 1, 2));
+	}
+	else if (tag == 0xdb || tag == 0xc6) {
+		if (!MPackCursorHasBytes(cursor, 5)) return nullptr;
+		header_size = 5;
+		str_length = static_cast<uint32_t>(MPackLoadBigEndian(cursor->pos + 1, 4));
+	}
+	else {
+		cursor->error = true;
+		return nullptr;
+	}
+	if (!MPackCursorHasBytes(cursor, header_size + str_length)) return nullptr;
+
+	const char *str = reinterpret_cast<const char *>(cursor->pos + header_size);
+	cursor->pos += header_size + str_length;
+	*length = str_length;
+	return str;
+}
+
+inline uint32_t MPackCursorReadArray(MPackCursor *cursor) {
+	if (!MPackCursorHasBytes(cursor, 1)) return 0;
+
+	uint8_t tag = *cursor->pos;
+	if (tag >= 0x90 && tag <= 0x9f) {
+		cursor->pos += 1;
+		return tag & 0x0f;
+	}
+	int bytes = tag == 0xdc ? 2 : (tag == 0xdd ? 4 : 0);
+	if (bytes == 0) {
+		cursor->error = true;
+		return 0;
+	}
+	if (!MPackCursorHasBytes(cursor, 1 + bytes)) return 0;
+
+	uint32_t count = static_cast<uint32_t>(MPackLoadBigEndian(cursor->pos + 1, bytes));
+	cursor->pos += 1 + bytes;
+	return count;
+}
+
+inline uint32_t MPackCursorReadMap(MPackCursor *cursor) {
+	if (!MPackCursorHasBytes(cursor, 1)) return 0;
+
+	uint8_t tag = *cursor->pos;
+	if (tag >= 0x80 && tag <= 0x8f) {
+		cursor->pos += 1;
+		return tag & 0x0f;
+	}
+	int bytes = tag == 0xde ? 2 : (tag == 0xdf ? 4 : 0);
+	if (bytes == 0) {
+		cursor->error = true;
+		return 0;
+	}
+	if (!MPackCursorHasBytes(cursor, 1 + bytes)) return 0;
+
+	uint32_t count = static_cast<uint32_t>(MPackLoadBigEndian(cursor->pos + 1, bytes));
+	cursor->pos += 1 + bytes;
+	return count;
+}
+
+enum class MPackScanResult {
+	Complete,
+	Truncated,
+	Invalid
+};
+
+// Walks over `*values_remaining` msgpack values starting at `*pos` without
+// decoding them. Nested containers just add their element count to the
+// remaining values, so the walk is resumable: on Truncated, `*pos` is left
+// at the first value that isn't fully available and the scan can be
+// continued once more data has arrived.
+inline MPackScanResult MPackScanValues(const uint8_t **pos, const uint8_t *end, uint64_t *values_remaining) {
+	const uint8_t *p = *pos;
+	uint64_t remaining = *values_remaining;
+	MPackScanResult result = MPackScanResult::Complete;
+
+	while (remaining > 0) {
+		if (p >= end) {
+			result = MPackScanResult::Truncated;
+			break;
+		}
+
+		uint8_t tag = *p;
+		size_t available = static_cast<size_t>(end - p);
+		size_t size = 1;
+		uint64_t children = 0;
+		if (tag <= 0x7f || tag >= 0xe0 || tag == 0xc0 || tag == 0xc2 || tag == 0xc3) {
+			// Single byte value
+			size = 1;
+		}
+		else if (tag <= 0x8f) {
+			children = 2 * static_cast<uint64_t>(tag & 0x0f);
+		}
+		else if (tag <= 0x9f) {
+			children = tag & 0x0f;
+		}
+		else if (tag <= 0xbf) {
+			size += tag & 0x1f;
+		}
+		else {
+			// Size of the length/payload field following the tag
+			constexpr uint8_t FIXED_PAYLOAD[] {
+				/* c0 */ 0, 0, 0, 0,
+				/* c4 bin */ 0, 0, 0,
+				/* c7 ext */ 0, 0, 0,
+				/* ca float */ 4, 8,
+				/* cc uint */ 1, 2, 4, 8,
+				/* d0 int */ 1, 2, 4, 8,
+				/* d4 fixext */ 2, 3, 5, 9, 17,
+			};
+			if (tag == 0xc1) {
+				result = MPackScanResult::Invalid;
+				break;
+			}
+
+			int length_bytes = 0;
+			int ext_type_bytes = 0;
+			switch (tag) {
+			case 0xc4: case 0xd9: length_bytes = 1; break;
+			case 0xc5: case 0xda: length_bytes = 2; break;
+			case 0xc6: case 0xdb: length_bytes = 4; break;
+			case 0xc7: length_bytes = 1; ext_type_bytes = 1; break;
+			case 0xc8: length_bytes = 2; ext_type_bytes = 1; break;
+			case 0xc9: length_bytes = 4; ext_type_bytes = 1; break;
+			case 0xdc: case 0xde: length_bytes = 2; break;
+			case 0xdd: case 0xdf: length_bytes = 4; break;
+			default: size += FIXED_PAYLOAD[tag - 0xc0]; break;
+			}
+
+			if (length_bytes) {
+				if (available < 1 + static_cast<size_t>(length_bytes)) {
+					result = MPackScanResult::Truncated;
+					break;
+				}
+				uint64_t length = MPackLoadBigEndian(p + 1, length_bytes);
+				size += length_bytes;
+				if (tag == 0xdc || tag == 0xdd) {
+					children = length;
+				}
+				else if (tag == 0xde || tag == 0xdf) {
+					children = 2 * length;
+				}
+				else {
+					size += ext_type_bytes + length;
+				}
+			}
+		}
+
+		if (available < size) {
+			result = MPackScanResult::Truncated;
+			break;
+		}
+		p += size;
+		remaining += children;
+		--remaining;
+	}
+
+	*pos = p;
+	*values_remaining = remaining;
+	return result;
+}
+
+// Skips over the next value, including everything nested inside of it
+inline void MPackCursorSkip(MPackCursor *cursor) {
+	uint64_t remaining = 1;
+	if (MPackScanValues(&cursor->pos, cursor->end, &remaining) != MPackScanResult::Complete) {
+		cursor->error = true;
+		cursor->pos = cursor->end;
+	}
+}
+
+inline void MPackCursorSkipValues(MPackCursor *cursor, uint64_t count) {
+	if (count == 0) return;
+	if (MPackScanValues(&cursor->pos, cursor->end, &count) != MPackScanResult::Complete) {
+		cursor->error = true;
+		cursor->pos = cursor->end;
+	}
+}
+
+inline bool MPackStringEquals(const char *str, uint32_t length, const char *match) {
+	size_t match_length = strlen(match);
+	return length == match_length && memcmp(str, match, length) == 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction sets the hot loops may use, decided at compile time. SSE2 is
+// part of every x86-64 target, AVX2 is opt in with NVY_ENABLE_AVX2 as Nvy
+// doesn't dispatch at runtime. Everything has a scalar fallback.
+#if defined(__AVX2__)
+#define NVY_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NVY_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
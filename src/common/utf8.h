@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "common/simd.h"
+
+constexpr uint32_t UNICODE_REPLACEMENT_CHAR = 0xFFFD;
+// Drawn in place of cells that hold more than one codepoint (ie: a diacritic)
+constexpr uint32_t UNSUPPORTED_CELL_CHAR = 0x25a1;
+
+// Decodes one codepoint from a UTF-8 string, advancing *index past it.
+// Malformed sequences decode to U+FFFD, consuming a single byte.
+inline uint32_t Utf8DecodeCodepoint(const char *str, size_t length, size_t *index) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(str);
+	size_t i = *index;
+	uint8_t lead = bytes[i];
+
+	int continuation_count;
+	uint32_t codepoint;
+	uint32_t min_codepoint;
+	if (lead < 0x80) {
+		*index = i + 1;
+		return lead;
+	}
+	else if ((lead & 0xE0) == 0xC0) {
+		continuation_count = 1;
+		codepoint = lead & 0x1F;
+		min_codepoint = 0x80;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		continuation_count = 2;
+		codepoint = lead & 0x0F;
+		min_codepoint = 0x800;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		continuation_count = 3;
+		codepoint = lead & 0x07;
+		min_codepoint = 0x10000;
+	}
+	else {
+		*index = i + 1;
+		return UNICODE_REPLACEMENT_CHAR;
+	}
+
+	if (i + continuation_count >= length) {
+		*index = i + 1;
+		return UNICODE_REPLACEMENT_CHAR;
+	}
+	for (int k = 1; k <= continuation_count; ++k) {
+		uint8_t byte = bytes[i + k];
+		if ((byte & 0xC0) != 0x80) {
+			*index = i + 1;
+			return UNICODE_REPLACEMENT_CHAR;
+		}
+		codepoint = (codepoint << 6) | (byte & 0x3F);
+	}
+
+	if (codepoint < min_codepoint || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+		*index = i + 1;
+		return UNICODE_REPLACEMENT_CHAR;
+	}
+
+	*index = i + 1 + continuation_count;
+	return codepoint;
+}
+
+// Converts the UTF-8 text of a single grid cell into the packed grid
+// representation: a single UTF-16 code unit, or a surrogate pair packed
+// as (high << 16) | low. Cells that need more than one codepoint can't
+// be represented and are replaced by UNSUPPORTED_CELL_CHAR.
+inline uint32_t Utf8ToGridChar(const char *str, size_t length) {
+	size_t index = 0;
+	uint32_t codepoint = Utf8DecodeCodepoint(str, length, &index);
+	if (index != length) {
+		return UNSUPPORTED_CELL_CHAR;
+	}
+
+	if (codepoint > 0xFFFF) {
+		codepoint -= 0x10000;
+		uint32_t high = 0xD800 + (codepoint >> 10);
+		uint32_t low = 0xDC00 + (codepoint & 0x3FF);
+		return (high << 16) | low;
+	}
+	return codepoint;
+}
+
+// The codepoint of a packed grid char
+inline uint32_t GridCharToCodepoint(uint32_t grid_char) {
+	if (grid_char > 0xFFFF) {
+		uint32_t high = grid_char >> 16;
+		uint32_t low = grid_char & 0xFFFF;
+		return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+	}
+	return grid_char;
+}
+
+// Expands packed grid chars into UTF-16 code units, unpacking surrogate
+// pairs into two units. `out` needs room for 2 * count units, returns the
+// number of units written.
+inline size_t GridCharsToUtf16Scalar(const uint32_t *grid_chars, size_t count, uint16_t *out) {
+	size_t length = 0;
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t grid_char = grid_chars[i];
+		if (grid_char > 0xFFFF) {
+			out[length] = static_cast<uint16_t>(grid_char >> 16);
+			out[length + 1] = static_cast<uint16_t>(grid_char & 0xFFFF);
+			length += 2;
+		}
+		else {
+			out[length] = static_cast<uint16_t>(grid_char);
+			length += 1;
+		}
+	}
+	return length;
+}
+
+// Same as GridCharsToUtf16Scalar, blocks without surrogate pairs (nearly
+// all of them) are narrowed to 16 bits with a single pack.
+inline size_t GridCharsToUtf16(const uint32_t *grid_chars, size_t count, uint16_t *out) {
+	size_t i = 0;
+	size_t length = 0;
+#if defined(NVY_SIMD_AVX2)
+	const __m256i zero = _mm256_setzero_si256();
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(grid_chars + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(grid_chars + i + 8));
+		__m256i high = _mm256_srli_epi32(_mm256_or_si256(a, b), 16);
+		if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi32(high, zero))) != 0xFFFFFFFF) {
+			length += GridCharsToUtf16Scalar(grid_chars + i, 16, out + length);
+			continue;
+		}
+		// Sign extend the low halves so the saturating pack keeps them intact,
+		// then undo the pack's interleaving of the 128 bit lanes
+		a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+		b = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + length), packed);
+		length += 16;
+	}
+#elif defined(NVY_SIMD_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(grid_chars + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(grid_chars + i + 4));
+		__m128i high = _mm_srli_epi32(_mm_or_si128(a, b), 16);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xFFFF) {
+			length += GridCharsToUtf16Scalar(grid_chars + i, 8, out + length);
+			continue;
+		}
+		// Sign extend the low halves so the saturating pack keeps them intact
+		a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + length), _mm_packs_epi32(a, b));
+		length += 8;
+	}
+#endif
+	return length + GridCharsToUtf16Scalar(grid_chars + i, count - i, out + length);
+}
@@ -1,12 +1,53 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 constexpr uint32_t PAGE_SIZE = 0x1000;
 constexpr size_t MEGABYTES(size_t n) {
 	return n * 1024 * 1024;
 }
 
+// Thin wrappers over the platform virtual memory API so that Vec
+// (and everything in nvy_core built on it) has no Win32 dependency
+inline void *VirtualMemoryReserve(size_t size) {
+#ifdef _WIN32
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void *ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+}
+
+inline void VirtualMemoryCommit(void *ptr, size_t size) {
+#ifdef _WIN32
+	VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+	mprotect(ptr, size, PROT_READ | PROT_WRITE);
+#endif
+}
+
+inline void VirtualMemoryDecommit(void *ptr, size_t size) {
+#ifdef _WIN32
+	VirtualAlloc(ptr, size, MEM_RESET, PAGE_NOACCESS);
+#else
+	madvise(ptr, size, MADV_DONTNEED);
+	mprotect(ptr, size, PROT_NONE);
+#endif
+}
+
+inline void VirtualMemoryRelease(void *ptr, size_t size) {
+#ifdef _WIN32
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, size);
+#endif
+}
+
 // A heap-allocated vector, reserves 1GB of virtual memory,
 // commits as necessary. Ensures no reallocations.
 constexpr size_t VEC_MAX_SIZE = MEGABYTES(1024);
@@ -17,14 +58,14 @@ struct Vec {
 	T *alloc_end;
 
 	Vec() {
-		data_begin = reinterpret_cast<T *>(VirtualAlloc(nullptr, VEC_MAX_SIZE, MEM_RESERVE, PAGE_NOACCESS));
+		data_begin = reinterpret_cast<T *>(VirtualMemoryReserve(VEC_MAX_SIZE));
 		data_end = data_begin;
-		VirtualAlloc(data_begin, PAGE_SIZE * 4, MEM_COMMIT, PAGE_READWRITE);
+		VirtualMemoryCommit(data_begin, PAGE_SIZE * 4);
 		alloc_end = reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(data_begin) + PAGE_SIZE * 4);
 	}
 
 	~Vec() {
-		VirtualFree(data_begin, 0, MEM_RELEASE);
+		VirtualMemoryRelease(data_begin, VEC_MAX_SIZE);
 	}
 
 	inline T operator[](size_t i) const {
@@ -74,15 +115,15 @@ struct Vec {
 
 	inline void grow() {
 		size_t byte_capacity = reinterpret_cast<uint8_t *>(alloc_end) - reinterpret_cast<uint8_t *>(data_begin);
-		VirtualAlloc(alloc_end, byte_capacity, MEM_COMMIT, PAGE_READWRITE);
+		VirtualMemoryCommit(alloc_end, byte_capacity);
 		alloc_end = reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(alloc_end) + byte_capacity);
 	}
 
 	inline void clear() {
 		uint64_t byte_capacity = reinterpret_cast<uint8_t *>(alloc_end) - reinterpret_cast<uint8_t *>(data_begin);
-		VirtualAlloc(data_begin, byte_capacity, MEM_RESET, PAGE_NOACCESS);
+		VirtualMemoryDecommit(data_begin, byte_capacity);
 		data_end = data_begin;
-		VirtualAlloc(data_begin, PAGE_SIZE * 4, MEM_COMMIT, PAGE_READWRITE);
+		VirtualMemoryCommit(data_begin, PAGE_SIZE * 4);
 		alloc_end = reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(data_begin) + PAGE_SIZE * 4);
 	}
 
@@ -100,4 +141,4 @@ struct Vec {
 	inline const_iterator end() const {
 		return data_end;
 	}
-};
\ No newline at end of file
+};
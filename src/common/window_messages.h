@@ -1,6 +1,7 @@
 #pragma once
 
-// WPARAM: mpack_tree_t *, LPARAM: none
+// Messages are waiting in Nvim::queue
+// WPARAM: none, LPARAM: none
 #define WM_NVIM_MESSAGE WM_USER
 
 // WPARAM: none, LPARAM: none
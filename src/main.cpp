@@ -14,6 +14,8 @@ struct Context {
 	bool xbuttons[2];
 	float buffered_scroll_amount;
 	GridPoint cached_cursor_grid_pos;
+	// The grid the last mouse button was pressed on
+	int mouse_grid;
 	WINDOWPLACEMENT saved_window_placement;
 	UINT saved_dpi_scaling;
 	uint32_t saved_window_width;
@@ -24,6 +26,29 @@ struct Context {
 	HKL hkl;
 };
 
+// Mouse input goes to the grid under the mouse, in that grid's coordinates.
+// Drags and releases stay with the grid the button was pressed on.
+void SendMouseInput(Context *context, MouseButton button, MouseAction action, int row, int col) {
+	Compositor *compositor = &context->renderer->model.compositor;
+	UIGrid *ui_grid;
+	if (action == MouseAction::Drag || action == MouseAction::Release) {
+		ui_grid = CompositorFindGrid(compositor, context->mouse_grid);
+	}
+	else {
+		ui_grid = CompositorGridAt(compositor, row, col);
+		if (action == MouseAction::Press) {
+			context->mouse_grid = ui_grid ? ui_grid->id : 0;
+		}
+	}
+
+	if (ui_grid) {
+		NvimSendMouseInput(context->nvim, button, action, ui_grid->id, row - ui_grid->row, col - ui_grid->col);
+	}
+	else {
+		NvimSendMouseInput(context->nvim, button, action, 0, row, col);
+	}
+}
+
 void ToggleFullscreen(HWND hwnd, Context *context) {
 	DWORD style = GetWindowLong(hwnd, GWL_STYLE);
 	MONITORINFO mi { .cbSize = sizeof(MONITORINFO) };
@@ -51,8 +76,8 @@ void ProcessMPackMessage(Context *context, mpack_tree_t *tree) {
 
 	switch (result.type) {
 	case MPackMessageType::Response: {
-		assert(result.response.msg_id <= context->nvim->next_msg_id);
-		switch (context->nvim->msg_id_to_method[result.response.msg_id]) {
+		assert(result.response.msg_id <= context->nvim->rpc.next_msg_id);
+		switch (NvimRpcRequestMethod(&context->nvim->rpc, result.response.msg_id)) {
 		case NvimRequest::nvim_get_option_value: {
 			Vec<char> guifont_buffer;
 			NvimParseOptionValueStr(context->nvim, result.params, &guifont_buffer);
@@ -76,9 +101,7 @@ void ProcessMPackMessage(Context *context, mpack_tree_t *tree) {
 		}
 	} break;
 	case MPackMessageType::Notification: {
-		if (MPackMatchString(result.notification.name, "redraw")) {
-			RendererRedraw(context->renderer, result.params, context->start_maximized);
-		}
+		// Redraw notifications are decoded on the reader thread, see NvimMessageHandler
 	} break;
 	case MPackMessageType::Request: {
 		if (MPackMatchString(result.request.method, "vimenter")) {
@@ -91,10 +114,27 @@ void ProcessMPackMessage(Context *context, mpack_tree_t *tree) {
 	}
 }
 
+void ProcessNvimMessage(Context *context, const NvimQueuedMessage *message) {
+	// Redraw notifications make up the bulk of the traffic,
+	// they arrive already decoded by the reader thread
+	if (message->kind == NvimMessageKind::RedrawOps) {
+		RendererRedraw(context->renderer, RedrawOpsInit(message->data, message->size), context->start_maximized);
+		return;
+	}
+
+	mpack_tree_t tree;
+	mpack_tree_init_data(&tree, message->data, message->size);
+	mpack_tree_parse(&tree);
+	if (mpack_tree_error(&tree) == mpack_ok) {
+		ProcessMPackMessage(context, &tree);
+	}
+	mpack_tree_destroy(&tree);
+}
+
 bool SendResizeIfNecessary(Context *context, int rows, int cols) {
-	if (!context->renderer->grid_initialized) return false;
+	if (!context->renderer->model.grid.initialized) return false;
 
-	if (rows != context->renderer->grid_rows || cols != context->renderer->grid_cols) {
+	if (rows != context->renderer->model.grid.rows || cols != context->renderer->model.grid.cols) {
 		NvimSendResize(context->nvim, rows, cols);
 		return true;
 	}
@@ -141,8 +181,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 		PostQuitMessage(0);
 	} return 0;
 	case WM_NVIM_MESSAGE: {
-		mpack_tree_t *tree = reinterpret_cast<mpack_tree_t *>(wparam);
-		ProcessMPackMessage(context, tree);
+		// Only handle the messages that are queued right now, anything
+		// arriving in the meantime comes with its own wake up
+		NvimMessageQueue *queue = &context->nvim->queue;
+		size_t message_count = NvimMessageQueueBeginDrain(queue);
+		for (size_t i = 0; i < message_count; ++i) {
+			NvimQueuedMessage message = NvimMessageQueueFront(queue);
+			ProcessNvimMessage(context, &message);
+			NvimMessageQueuePop(queue);
+		}
 	} return 0;
 	case WM_RENDERER_FONT_UPDATE: {
 		auto [rows, cols] = RendererPixelsToGridSize(context->renderer,
@@ -236,13 +283,13 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 		if (context->cached_cursor_grid_pos.col != grid_pos.col || context->cached_cursor_grid_pos.row != grid_pos.row) {
 			switch (wparam) {
 			case MK_LBUTTON: {
-				NvimSendMouseInput(context->nvim, MouseButton::Left, MouseAction::Drag, grid_pos.row, grid_pos.col);
+				SendMouseInput(context, MouseButton::Left, MouseAction::Drag, grid_pos.row, grid_pos.col);
 			} break;
 			case MK_MBUTTON: {
-				NvimSendMouseInput(context->nvim, MouseButton::Middle, MouseAction::Drag, grid_pos.row, grid_pos.col);
+				SendMouseInput(context, MouseButton::Middle, MouseAction::Drag, grid_pos.row, grid_pos.col);
 			} break;
 			case MK_RBUTTON: {
-				NvimSendMouseInput(context->nvim, MouseButton::Right, MouseAction::Drag, grid_pos.row, grid_pos.col);
+				SendMouseInput(context, MouseButton::Right, MouseAction::Drag, grid_pos.row, grid_pos.col);
 			} break;
 			}
 			context->cached_cursor_grid_pos = grid_pos;
@@ -262,22 +309,22 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 		POINTS cursor_pos = MAKEPOINTS(lparam);
 		auto [row, col] = RendererCursorToGridPoint(context->renderer, cursor_pos.x, cursor_pos.y);
 		if (msg == WM_LBUTTONDOWN) {
-			NvimSendMouseInput(context->nvim, MouseButton::Left, MouseAction::Press, row, col);
+			SendMouseInput(context, MouseButton::Left, MouseAction::Press, row, col);
 		}
 		else if (msg == WM_MBUTTONDOWN) {
-			NvimSendMouseInput(context->nvim, MouseButton::Middle, MouseAction::Press, row, col);
+			SendMouseInput(context, MouseButton::Middle, MouseAction::Press, row, col);
 		}
 		else if (msg == WM_RBUTTONDOWN) {
-			NvimSendMouseInput(context->nvim, MouseButton::Right, MouseAction::Press, row, col);
+			SendMouseInput(context, MouseButton::Right, MouseAction::Press, row, col);
 		}
 		else if (msg == WM_LBUTTONUP) {
-			NvimSendMouseInput(context->nvim, MouseButton::Left, MouseAction::Release, row, col);
+			SendMouseInput(context, MouseButton::Left, MouseAction::Release, row, col);
 		}
 		else if (msg == WM_MBUTTONUP) {
-			NvimSendMouseInput(context->nvim, MouseButton::Middle, MouseAction::Release, row, col);
+			SendMouseInput(context, MouseButton::Middle, MouseAction::Release, row, col);
 		}
 		else if (msg == WM_RBUTTONUP) {
-			NvimSendMouseInput(context->nvim, MouseButton::Right, MouseAction::Release, row, col);
+			SendMouseInput(context, MouseButton::Right, MouseAction::Release, row, col);
 		}
 	} return 0;
 	case WM_XBUTTONDOWN: {
@@ -333,7 +380,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 			}
 			else {
 				for (int i = 0; i < abs(scroll_amount); ++i) {
-					NvimSendMouseInput(context->nvim, MouseButton::Wheel, action, row, col);
+					SendMouseInput(context, MouseButton::Wheel, action, row, col);
 				}
 			}
 
@@ -355,10 +402,11 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 			};
 			ScreenToClient(hwnd, &client_point);
 			auto [row, col] = RendererCursorToGridPoint(context->renderer, client_point.x, client_point.y);
-			NvimSendMouseInput(context->nvim, MouseButton::Left, MouseAction::Press, row, col);
-			NvimSendMouseInput(context->nvim, MouseButton::Left, MouseAction::Release, row, col);
+			SendMouseInput(context, MouseButton::Left, MouseAction::Press, row, col);
+			SendMouseInput(context, MouseButton::Left, MouseAction::Release, row, col);
 
 			// Not the most elegant solution, but must wait for mouseclick to be registered with nvim
+			NvimFlush(context->nvim);
 			Sleep(10);
 
       NvimOpenFile(context->nvim, file_to_open, (GetKeyState(VK_CONTROL) & 0x80) != 0);
@@ -373,6 +421,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 	case WM_CLOSE: { 
 		NvimQuit(context->nvim);
 	} return 0;
+	case WM_ENTERSIZEMOVE:
+	case WM_ENTERMENULOOP: {
+		// Modal loops dispatch messages without returning to our message
+		// loop, send what's batched so far and write directly until then
+		NvimFlush(context->nvim);
+	} return DefWindowProc(hwnd, msg, wparam, lparam);
 	}
 
 	return DefWindowProc(hwnd, msg, wparam, lparam);
@@ -400,6 +454,7 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 	bool start_maximized = false;
 	bool start_fullscreen = false;
 	bool disable_ligatures = false;
+	bool glyph_runs = false;
   bool disable_fullscreen = false;
 	float linespace_factor = 1.0f;
 	int64_t start_rows = 0;
@@ -408,6 +463,8 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 	int64_t start_pos_y = CW_USEDEFAULT;
 	bool enable_cursor_timeout = false;
 	uint32_t cursor_timeout_in_ms = 0;
+	FILE *record_file = nullptr;
+	char *server_address = nullptr;
 
 	static constexpr const wchar_t *NVIM_CMD = L"nvim --embed";
 	size_t nvim_cmd_len = wcslen(NVIM_CMD);
@@ -440,6 +497,9 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 		else if(!wcscmp(cmd_line_args[i], L"--disable-ligatures")) {
 			disable_ligatures = true;
 		}
+		else if(!wcscmp(cmd_line_args[i], L"--glyph-runs")) {
+			glyph_runs = true;
+		}
 		else if(!wcscmp(cmd_line_args[i], L"--disable-fullscreen")) {
 			disable_fullscreen = true;
 		}
@@ -465,6 +525,18 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 			wchar_t* end_ptr;
 			cursor_timeout_in_ms = wcstol(&cmd_line_args[i][17], &end_ptr, 10);
 		}
+		else if (!wcsncmp(cmd_line_args[i], L"--server=", wcslen(L"--server="))) {
+			int address_size = WideCharToMultiByte(CP_UTF8, 0, &cmd_line_args[i][9], -1, nullptr, 0, nullptr, nullptr);
+			free(server_address);
+			server_address = static_cast<char *>(malloc(address_size));
+			WideCharToMultiByte(CP_UTF8, 0, &cmd_line_args[i][9], -1, server_address, address_size, nullptr, nullptr);
+		}
+		else if (!wcsncmp(cmd_line_args[i], L"--record=", wcslen(L"--record="))) {
+			if (record_file) {
+				fclose(record_file);
+			}
+			record_file = _wfopen(&cmd_line_args[i][9], L"wb");
+		}
 		// Already processed
 		else if (!wcsncmp(cmd_line_args[i], L"--neovim-bin=", wcslen(L"--neovim-bin="))) {}
 		// Otherwise assume the argument is a filename to open
@@ -547,10 +619,22 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 	constexpr int DWMWA_USE_IMMERSIVE_DARK_MODE = 20;
 	BOOL should_use_dark_mode = ShouldUseDarkMode();
 	DwmSetWindowAttribute(hwnd, DWMWA_USE_IMMERSIVE_DARK_MODE, &should_use_dark_mode, sizeof(BOOL));
-	RendererInitialize(&renderer, hwnd, disable_ligatures, linespace_factor, context.saved_dpi_scaling);
+	RendererInitialize(&renderer, hwnd, disable_ligatures, glyph_runs, linespace_factor, context.saved_dpi_scaling);
 
-	NvimInitialize(&nvim, nvim_cmd, hwnd);
+	bool nvim_started = NvimInitialize(&nvim, nvim_cmd, server_address, hwnd, record_file);
 	free(nvim_cmd);
+	if (!nvim_started) {
+		char error[512];
+		if (server_address) {
+			snprintf(error, sizeof(error), "ERROR: Could not connect to nvim at %s", server_address);
+		}
+		else {
+			snprintf(error, sizeof(error), "ERROR: Could not start nvim");
+		}
+		MessageBoxA(NULL, error, "Nvy", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+	free(server_address);
 
 	// Forceably update the window to prevent any frames where the window is blank. Windows API docs
 	// specify that SetWindowPos should be called with these arguments after SetWindowLong is called.
@@ -569,14 +653,33 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev_instance, _
 	auto [rows, cols] = RendererPixelsToGridSize(context.renderer,
 		context.renderer->pixel_size.width, context.renderer->pixel_size.height);
 	NvimSendUIAttach(context.nvim, rows, cols);
+	if (nvim.attached_to_server) {
+		// No vimenter request will come from a running server,
+		// the user config has long been read so ask right away
+		NvimGetOptionValue(&nvim, "guifont");
+	}
 
 	MSG msg;
 	uint32_t previous_width = 0, previous_height = 0;
-	while (GetMessage(&msg, 0, 0, 0)) {
-		// TranslateMessage(&msg);
-		DispatchMessage(&msg);
+	bool quit = false;
+	while (!quit && GetMessage(&msg, 0, 0, 0)) {
+		// Handle what is already pending before writing to nvim, so key
+		// autorepeat, drags and wheel spins go out with a single write.
+		// Bounded so a steady stream of messages can't hold input back.
+		constexpr int MAX_MESSAGES_PER_BATCH = 64;
+		NvimBeginBatch(&nvim);
+		int message_count = 0;
+		do {
+			if (msg.message == WM_QUIT) {
+				quit = true;
+				break;
+			}
+			// TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		} while (++message_count < MAX_MESSAGES_PER_BATCH && PeekMessage(&msg, 0, 0, 0, PM_REMOVE));
+		NvimFlush(&nvim);
 
-		if (renderer.draw_active) continue;
+		if (quit || renderer.draw_active) continue;
 
 		if (previous_width != context.saved_window_width || previous_height != context.saved_window_height) {
 			previous_width = context.saved_window_width;
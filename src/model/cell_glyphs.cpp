@@ -0,0 +1,60 @@
+#include "cell_glyphs.h"
+#include "model/grid.h"
+
+int CellTextBuild(const uint32_t *chars, const uint8_t *flags, int count, uint16_t *text, uint16_t *text_cells) {
+	int length = 0;
+	for (int cell = 0; cell < count; ++cell) {
+		if (flags[cell] & GRID_CELL_CONTINUATION) {
+			continue;
+		}
+		uint32_t grid_char = chars[cell];
+		if (ContainsSurrogatePair(grid_char)) {
+			text[length] = static_cast<uint16_t>(grid_char >> 16);
+			text[length + 1] = static_cast<uint16_t>(grid_char & 0xFFFF);
+			text_cells[length] = static_cast<uint16_t>(cell);
+			text_cells[length + 1] = static_cast<uint16_t>(cell);
+			length += 2;
+		}
+		else {
+			text[length] = static_cast<uint16_t>(grid_char);
+			text_cells[length] = static_cast<uint16_t>(cell);
+			length += 1;
+		}
+	}
+	return length;
+}
+
+void CellGlyphsPlace(const uint16_t *text_cells, const uint16_t *cluster_map, int text_length,
+	int glyph_count, int end_cell, float cell_width, float *advances) {
+	for (int i = 0; i < glyph_count; ++i) {
+		advances[i] = 0.0f;
+	}
+
+	// Glyphs reordered against the text, as in a right to left run, don't
+	// split into clusters along the cells, so the whole run is one cluster
+	for (int unit = 1; unit < text_length; ++unit) {
+		if (cluster_map[unit] < cluster_map[unit - 1]) {
+			if (glyph_count > 0) {
+				advances[glyph_count - 1] = (end_cell - text_cells[0]) * cell_width;
+			}
+			return;
+		}
+	}
+
+	// Walk the clusters, each starts at the first unit mapping to a new glyph
+	int unit = 0;
+	while (unit < text_length) {
+		int first_glyph = cluster_map[unit];
+		int cluster_cell = text_cells[unit];
+		int next_unit = unit + 1;
+		while (next_unit < text_length && cluster_map[next_unit] == first_glyph) {
+			++next_unit;
+		}
+		int next_glyph = next_unit < text_length ? cluster_map[next_unit] : glyph_count;
+		int next_cell = next_unit < text_length ? text_cells[next_unit] : end_cell;
+		if (next_glyph > first_glyph) {
+			advances[next_glyph - 1] = (next_cell - cluster_cell) * cell_width;
+		}
+		unit = next_unit;
+	}
+}
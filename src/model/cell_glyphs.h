@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// Placing shaped glyphs on the cell grid, for drawing glyph runs directly
+// instead of fitting a text layout to the cells character by character.
+
+// Converts `count` cells into UTF-16 text for shaping, and records the cell
+// every code unit came from in `text_cells`. The right half of a wide
+// character holds no text, its left half covers both cells. Both outputs
+// need room for 2 * count units, returns the number of units written.
+int CellTextBuild(const uint32_t *chars, const uint8_t *flags, int count, uint16_t *text, uint16_t *text_cells);
+
+// Snaps the glyphs a piece of cell text was shaped into to the cells.
+// `cluster_map` holds the first glyph of the cluster of every code unit,
+// as shapers return it. A cluster covers the cells from its own up to the
+// next cluster's, and `end_cell` for the last one. Its last glyph takes up
+// all of that, so every cluster starts exactly at the left of its cell, a
+// double width character or a ligature spanning several cells included.
+// A `cluster_map` that goes backwards places the whole text as one cluster.
+void CellGlyphsPlace(const uint16_t *text_cells, const uint16_t *cluster_map, int text_length,
+	int glyph_count, int end_cell, float cell_width, float *advances);
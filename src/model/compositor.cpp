@@ -0,0 +1,143 @@
+#include "compositor.h"
+#include <algorithm>
+#include <cmath>
+
+UIGrid *CompositorFindGrid(Compositor *compositor, int id) {
+	for (int i = 0; i < compositor->grid_count; ++i) {
+		if (compositor->grids[i].id == id) {
+			return &compositor->grids[i];
+		}
+	}
+	return nullptr;
+}
+
+UIGrid *CompositorGetGrid(Compositor *compositor, int id) {
+	UIGrid *ui_grid = CompositorFindGrid(compositor, id);
+	if (ui_grid || id <= 0 || compositor->grid_count == MAX_UI_GRIDS) {
+		return ui_grid;
+	}
+
+	ui_grid = &compositor->grids[compositor->grid_count++];
+	*ui_grid = UIGrid {
+		.id = id,
+		.grid = {},
+		.row = 0,
+		.col = 0,
+		.zindex = 0,
+		.placement = compositor->placements++,
+		.visible = id == GLOBAL_GRID_ID
+	};
+	compositor->order_valid = false;
+	return ui_grid;
+}
+
+void CompositorDestroyGrid(Compositor *compositor, int id) {
+	UIGrid *ui_grid = CompositorFindGrid(compositor, id);
+	if (!ui_grid) {
+		return;
+	}
+	GridFree(&ui_grid->grid);
+	*ui_grid = compositor->grids[--compositor->grid_count];
+	compositor->order_valid = false;
+	compositor->stats.layout_changes++;
+}
+
+void CompositorPlaceGrid(Compositor *compositor, UIGrid *ui_grid, int row, int col, int zindex) {
+	ui_grid->row = row;
+	ui_grid->col = col;
+	ui_grid->zindex = zindex;
+	ui_grid->placement = compositor->placements++;
+	ui_grid->visible = true;
+	compositor->order_valid = false;
+	compositor->stats.layout_changes++;
+}
+
+void CompositorHideGrid(Compositor *compositor, UIGrid *ui_grid) {
+	ui_grid->visible = false;
+	compositor->stats.layout_changes++;
+}
+
+void CompositorFree(Compositor *compositor) {
+	for (int i = 0; i < compositor->grid_count; ++i) {
+		GridFree(&compositor->grids[i].grid);
+	}
+	compositor->grid_count = 0;
+	compositor->order_valid = false;
+}
+
+void CompositorFloatPosition(Compositor *compositor, int anchor_grid, FloatAnchor anchor,
+	double anchor_row, double anchor_col, int rows, int cols, int *row, int *col) {
+	UIGrid *anchor_ui_grid = CompositorFindGrid(compositor, anchor_grid);
+	int r = static_cast<int>(floor(anchor_row));
+	int c = static_cast<int>(floor(anchor_col));
+	if (anchor_ui_grid) {
+		r += anchor_ui_grid->row;
+		c += anchor_ui_grid->col;
+	}
+	if (anchor == FloatAnchor::SW || anchor == FloatAnchor::SE) {
+		r -= rows;
+	}
+	if (anchor == FloatAnchor::NE || anchor == FloatAnchor::SE) {
+		c -= cols;
+	}
+	*row = r;
+	*col = c;
+}
+
+static void CompositorSortGrids(Compositor *compositor) {
+	for (int i = 0; i < compositor->grid_count; ++i) {
+		compositor->order[i] = i;
+	}
+	const UIGrid *grids = compositor->grids;
+	std::sort(compositor->order, compositor->order + compositor->grid_count, [grids](int a, int b) {
+		// The global grid is underneath everything, whatever its zindex
+		bool a_global = grids[a].id == GLOBAL_GRID_ID;
+		bool b_global = grids[b].id == GLOBAL_GRID_ID;
+		if (a_global != b_global) {
+			return a_global;
+		}
+		if (grids[a].zindex != grids[b].zindex) {
+			return grids[a].zindex < grids[b].zindex;
+		}
+		return grids[a].placement < grids[b].placement;
+	});
+	compositor->order_valid = true;
+}
+
+void CompositorComposeSpan(Compositor *compositor, Grid *screen, int row, int left, int right) {
+	if (!compositor->order_valid) {
+		CompositorSortGrids(compositor);
+	}
+
+	for (int i = 0; i < compositor->grid_count; ++i) {
+		UIGrid *ui_grid = &compositor->grids[compositor->order[i]];
+		int grid_row = row - ui_grid->row;
+		if (!ui_grid->visible || ui_grid->grid.cells == nullptr ||
+			grid_row < 0 || grid_row >= ui_grid->grid.rows) {
+			continue;
+		}
+		int l = std::max(left, ui_grid->col);
+		int r = std::min(right, ui_grid->col + ui_grid->grid.cols);
+		if (l >= r) {
+			continue;
+		}
+		GridCopyCells(screen, row, l, &ui_grid->grid, grid_row, l - ui_grid->col, r - l);
+		compositor->stats.cells_composed += r - l;
+	}
+}
+
+UIGrid *CompositorGridAt(Compositor *compositor, int row, int col) {
+	if (!compositor->order_valid) {
+		CompositorSortGrids(compositor);
+	}
+
+	for (int i = compositor->grid_count - 1; i >= 0; --i) {
+		UIGrid *ui_grid = &compositor->grids[compositor->order[i]];
+		if (ui_grid->visible && ui_grid->grid.cells != nullptr &&
+			row >= ui_grid->row && row < ui_grid->row + ui_grid->grid.rows &&
+			col >= ui_grid->col && col < ui_grid->col + ui_grid->grid.cols) {
+			return ui_grid;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include "model/grid.h"
+
+// The global grid, which covers the whole screen below every window
+constexpr int GLOBAL_GRID_ID = 1;
+constexpr int MAX_UI_GRIDS = 256;
+// nvim's defaults for floating windows and the message grid
+constexpr int FLOAT_DEFAULT_ZINDEX = 50;
+constexpr int MESSAGE_GRID_ZINDEX = 200;
+
+enum class FloatAnchor : uint8_t {
+	NW,
+	NE,
+	SW,
+	SE
+};
+
+// One of nvim's grids under ext_multigrid, each window, float and the
+// message area draws into its own grid
+struct UIGrid {
+	int id;
+	Grid grid;
+	// Position of the top left cell on the screen
+	int row;
+	int col;
+	// Grids stack by zindex, ties go to the grid placed last
+	int zindex;
+	uint32_t placement;
+	bool visible;
+};
+
+struct CompositorStats {
+	uint64_t cells_composed;
+	uint64_t layout_changes;
+};
+
+// Keeps every grid in its own buffer and composes the screen from them
+// at flush, so a change to one grid only touches that grid, and only the
+// screen cells it covers need composing and drawing again.
+struct Compositor {
+	UIGrid grids[MAX_UI_GRIDS];
+	int grid_count;
+	// Indices into `grids` from bottom to top, rebuilt after layout changes
+	int order[MAX_UI_GRIDS];
+	bool order_valid;
+	uint32_t placements;
+	CompositorStats stats;
+};
+
+UIGrid *CompositorFindGrid(Compositor *compositor, int id);
+// Finds or adds a grid, returns nullptr if there are too many grids already.
+// New grids are hidden until placed, except the global grid.
+UIGrid *CompositorGetGrid(Compositor *compositor, int id);
+void CompositorDestroyGrid(Compositor *compositor, int id);
+void CompositorPlaceGrid(Compositor *compositor, UIGrid *ui_grid, int row, int col, int zindex);
+void CompositorHideGrid(Compositor *compositor, UIGrid *ui_grid);
+void CompositorFree(Compositor *compositor);
+
+// Screen position of a float of `rows` x `cols` cells anchored at
+// (anchor_row, anchor_col) of the anchor grid by its `anchor` corner
+void CompositorFloatPosition(Compositor *compositor, int anchor_grid, FloatAnchor anchor,
+	double anchor_row, double anchor_col, int rows, int cols, int *row, int *col);
+
+// Composes columns [left, right) of row `row` of `screen` from every
+// visible grid, bottom to top
+void CompositorComposeSpan(Compositor *compositor, Grid *screen, int row, int left, int right);
+// The top most visible grid covering a screen cell, or nullptr
+UIGrid *CompositorGridAt(Compositor *compositor, int row, int col);
@@ -0,0 +1,41 @@
+#include "dirty_rows.h"
+#include <cstdlib>
+
+void DirtyRowsResize(DirtyRows *dirty_rows, int rows, int cols) {
+	free(dirty_rows->words);
+	free(dirty_rows->spans);
+	dirty_rows->rows = rows;
+	dirty_rows->cols = cols;
+	dirty_rows->words = static_cast<uint64_t *>(calloc(DirtyRowsWordCount(rows), sizeof(uint64_t)));
+	dirty_rows->spans = static_cast<DirtyRowSpan *>(calloc(rows, sizeof(DirtyRowSpan)));
+	DirtyRowsMarkAll(dirty_rows);
+}
+
+void DirtyRowsFree(DirtyRows *dirty_rows) {
+	free(dirty_rows->words);
+	free(dirty_rows->spans);
+	dirty_rows->words = nullptr;
+	dirty_rows->spans = nullptr;
+	dirty_rows->rows = 0;
+	dirty_rows->cols = 0;
+}
+
+void DirtyRowsMarkAll(DirtyRows *dirty_rows) {
+	DirtyRowsMarkRange(dirty_rows, 0, dirty_rows->rows);
+}
+
+void DirtyRowsMarkRange(DirtyRows *dirty_rows, int first_row, int last_row) {
+	DirtyRowsMarkRect(dirty_rows, first_row, last_row, 0, dirty_rows->cols);
+}
+
+void DirtyRowsMarkRect(DirtyRows *dirty_rows, int first_row, int last_row, int left, int right) {
+	if (first_row < 0) {
+		first_row = 0;
+	}
+	if (last_row > dirty_rows->rows) {
+		last_row = dirty_rows->rows;
+	}
+	for (int row = first_row; row < last_row; ++row) {
+		DirtyRowsMarkSpan(dirty_rows, row, left, right);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+struct DirtyRowStats {
+	// Every time a row was marked, including rows that were already dirty
+	uint64_t marks;
+	// Marks of rows that were already dirty, each one a redraw avoided
+	uint64_t redundant_marks;
+	uint64_t rows_drawn;
+	// The width of the dirty spans flushed, rows_drawn * cols at most
+	uint64_t span_cells;
+	uint64_t flushes;
+};
+
+// Columns [left, right) of a row
+struct DirtyRowSpan {
+	int left;
+	int right;
+};
+
+// The rows that changed since the last flush. Grid mutations only mark
+// rows here, so every row is laid out and drawn once per frame no matter
+// how many events of a batch touch it.
+//
+// Each dirty row also keeps the span of columns that changed, so typing
+// a character only redraws the cells around it rather than the whole row.
+// A row marked more than once gets the span covering all of its marks.
+struct DirtyRows {
+	uint64_t *words;
+	DirtyRowSpan *spans;
+	int rows;
+	int cols;
+	DirtyRowStats stats;
+};
+
+constexpr int DIRTY_ROWS_PER_WORD = 64;
+
+inline int DirtyRowsWordCount(int rows) {
+	return (rows + DIRTY_ROWS_PER_WORD - 1) / DIRTY_ROWS_PER_WORD;
+}
+
+// Every row starts out dirty after a resize
+void DirtyRowsResize(DirtyRows *dirty_rows, int rows, int cols);
+void DirtyRowsFree(DirtyRows *dirty_rows);
+void DirtyRowsMarkAll(DirtyRows *dirty_rows);
+// Marks rows [first_row, last_row), clipped to the grid
+void DirtyRowsMarkRange(DirtyRows *dirty_rows, int first_row, int last_row);
+// Marks columns [left, right) of rows [first_row, last_row), clipped to the grid
+void DirtyRowsMarkRect(DirtyRows *dirty_rows, int first_row, int last_row, int left, int right);
+
+// Marks columns [left, right) of a row, clipped to the grid
+inline void DirtyRowsMarkSpan(DirtyRows *dirty_rows, int row, int left, int right) {
+	if (row < 0 || row >= dirty_rows->rows) {
+		return;
+	}
+	left = left < 0 ? 0 : left;
+	right = right > dirty_rows->cols ? dirty_rows->cols : right;
+	if (left >= right) {
+		return;
+	}
+
+	uint64_t bit = uint64_t(1) << (row % DIRTY_ROWS_PER_WORD);
+	uint64_t *word = &dirty_rows->words[row / DIRTY_ROWS_PER_WORD];
+	DirtyRowSpan *span = &dirty_rows->spans[row];
+	dirty_rows->stats.marks++;
+	if (*word & bit) {
+		dirty_rows->stats.redundant_marks++;
+		span->left = left < span->left ? left : span->left;
+		span->right = right > span->right ? right : span->right;
+	}
+	else {
+		*word |= bit;
+		*span = DirtyRowSpan { .left = left, .right = right };
+	}
+}
+
+inline void DirtyRowsMark(DirtyRows *dirty_rows, int row) {
+	DirtyRowsMarkSpan(dirty_rows, row, 0, dirty_rows->cols);
+}
+
+inline bool DirtyRowsIsDirty(const DirtyRows *dirty_rows, int row) {
+	if (row < 0 || row >= dirty_rows->rows) {
+		return false;
+	}
+	return (dirty_rows->words[row / DIRTY_ROWS_PER_WORD] >> (row % DIRTY_ROWS_PER_WORD)) & 1;
+}
+
+// Calls `draw_row(row, span)` for every dirty row from top to bottom and
+// clears the set, returns the number of rows drawn
+template<typename DrawRowFn>
+int DirtyRowsFlush(DirtyRows *dirty_rows, DrawRowFn &&draw_row) {
+	int rows_drawn = 0;
+	int word_count = DirtyRowsWordCount(dirty_rows->rows);
+	for (int i = 0; i < word_count; ++i) {
+		uint64_t word = dirty_rows->words[i];
+		dirty_rows->words[i] = 0;
+		while (word) {
+			int row = i * DIRTY_ROWS_PER_WORD + std::countr_zero(word);
+			DirtyRowSpan span = dirty_rows->spans[row];
+			draw_row(row, span);
+			dirty_rows->stats.span_cells += span.right - span.left;
+			word &= word - 1;
+			++rows_drawn;
+		}
+	}
+	dirty_rows->stats.rows_drawn += rows_drawn;
+	dirty_rows->stats.flushes++;
+	return rows_drawn;
+}
@@ -0,0 +1,105 @@
+#include "effect_pool.h"
+#include <cstdlib>
+#include <cstring>
+
+// A colorscheme rarely draws with more pairs than this
+constexpr int EFFECT_POOL_INITIAL_CAPACITY = 256;
+
+static uint32_t HashColors(const ColorRGBA *foreground, const ColorRGBA *special) {
+	uint32_t words[8];
+	memcpy(&words[0], foreground, sizeof(ColorRGBA));
+	memcpy(&words[4], special, sizeof(ColorRGBA));
+	uint64_t hash = 0;
+	for (uint32_t word : words) {
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+	}
+	return static_cast<uint32_t>(hash >> 32);
+}
+
+static bool ColorsEqual(const ColorRGBA *a, const ColorRGBA *b) {
+	return a->r == b->r && a->g == b->g && a->b == b->b && a->a == b->a;
+}
+
+// Sized to stay at most half full with `capacity` entries
+static void RebuildTable(EffectPool *pool) {
+	uint32_t slot_count = static_cast<uint32_t>(pool->capacity) * 2;
+	free(pool->table);
+	pool->table = static_cast<uint32_t *>(calloc(slot_count, sizeof(uint32_t)));
+	pool->table_mask = slot_count - 1;
+	for (int i = 0; i < pool->count; ++i) {
+		EffectPoolEntry *e = &pool->entries[i];
+		uint32_t slot = HashColors(&e->foreground, &e->special) & pool->table_mask;
+		while (pool->table[slot]) {
+			slot = (slot + 1) & pool->table_mask;
+		}
+		pool->table[slot] = static_cast<uint32_t>(i) + 1;
+	}
+}
+
+void EffectPoolInitialize(EffectPool *pool, int id_count,
+	void *(*create)(const ColorRGBA *foreground, const ColorRGBA *special), void (*release)(void *effect)) {
+	pool->capacity = EFFECT_POOL_INITIAL_CAPACITY;
+	pool->count = 0;
+	pool->entries = static_cast<EffectPoolEntry *>(malloc(pool->capacity * sizeof(EffectPoolEntry)));
+	pool->table = nullptr;
+	RebuildTable(pool);
+	pool->id_count = id_count;
+	pool->id_entries = static_cast<uint32_t *>(calloc(id_count, sizeof(uint32_t)));
+	pool->create = create;
+	pool->release = release;
+	pool->stats = EffectPoolStats {};
+}
+
+void EffectPoolFree(EffectPool *pool) {
+	for (int i = 0; i < pool->count; ++i) {
+		pool->release(pool->entries[i].effect);
+	}
+	free(pool->entries);
+	free(pool->table);
+	free(pool->id_entries);
+	*pool = EffectPool {};
+}
+
+void EffectPoolClear(EffectPool *pool) {
+	for (int i = 0; i < pool->count; ++i) {
+		pool->release(pool->entries[i].effect);
+	}
+	pool->count = 0;
+	memset(pool->table, 0, (pool->table_mask + 1) * sizeof(uint32_t));
+	memset(pool->id_entries, 0, pool->id_count * sizeof(uint32_t));
+	pool->stats.clears++;
+}
+
+void EffectPoolInvalidateId(EffectPool *pool, int hl_attrib_id) {
+	pool->id_entries[hl_attrib_id] = 0;
+	pool->stats.id_invalidations++;
+}
+
+uint32_t EffectPoolIntern(EffectPool *pool, const ColorRGBA *foreground, const ColorRGBA *special) {
+	uint32_t slot = HashColors(foreground, special) & pool->table_mask;
+	for (; pool->table[slot]; slot = (slot + 1) & pool->table_mask) {
+		EffectPoolEntry *e = &pool->entries[pool->table[slot] - 1];
+		if (ColorsEqual(&e->foreground, foreground) && ColorsEqual(&e->special, special)) {
+			return pool->table[slot] - 1;
+		}
+	}
+
+	if (pool->count == pool->capacity) {
+		pool->capacity *= 2;
+		pool->entries = static_cast<EffectPoolEntry *>(realloc(pool->entries, pool->capacity * sizeof(EffectPoolEntry)));
+		RebuildTable(pool);
+		slot = HashColors(foreground, special) & pool->table_mask;
+		while (pool->table[slot]) {
+			slot = (slot + 1) & pool->table_mask;
+		}
+	}
+	uint32_t entry = static_cast<uint32_t>(pool->count++);
+	pool->entries[entry] = EffectPoolEntry {
+		.foreground = *foreground,
+		.special = *special,
+		.effect = pool->create(foreground, special)
+	};
+	pool->table[slot] = entry + 1;
+	pool->stats.allocations++;
+	return entry;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include "model/resolved_colors.h"
+
+struct EffectPoolEntry {
+	ColorRGBA foreground;
+	ColorRGBA special;
+	void *effect;
+};
+
+struct EffectPoolStats {
+	uint64_t lookups;
+	// Every allocation is a new effect object on Windows, none once every
+	// color pair on screen has been drawn
+	uint64_t allocations;
+	// Ids redefined by hl_attr_define
+	uint64_t id_invalidations;
+	// Whole pool clears by default_colors_set
+	uint64_t clears;
+};
+
+// One drawing effect per pair of foreground and special colors text is
+// drawn with, made the first time the pair is drawn and shared by every
+// run drawn with it from then on. Each highlight id remembers the entry
+// it resolved to, so a run finds its effect with a single load.
+//
+// Redefining an id only makes that id resolve again, the effects stay as
+// they are since colors never change under an effect. New default colors
+// release everything, most pairs fall out of use with them.
+//
+// Effects are opaque here, `create` makes one for a pair of colors and
+// `release` is called on every effect the pool lets go of.
+struct EffectPool {
+	EffectPoolEntry *entries;
+	int count;
+	int capacity;
+	// Open addressing on the color pairs, entry + 1 per slot and 0 when empty
+	uint32_t *table;
+	uint32_t table_mask;
+	// Entry + 1 per highlight id, 0 until the id is drawn
+	uint32_t *id_entries;
+	int id_count;
+	void *(*create)(const ColorRGBA *foreground, const ColorRGBA *special);
+	void (*release)(void *effect);
+	EffectPoolStats stats;
+};
+
+void EffectPoolInitialize(EffectPool *pool, int id_count,
+	void *(*create)(const ColorRGBA *foreground, const ColorRGBA *special), void (*release)(void *effect));
+// Releases every effect
+void EffectPoolFree(EffectPool *pool);
+// Releases every effect, for when the default colors change
+void EffectPoolClear(EffectPool *pool);
+// Makes `hl_attrib_id` resolve its effect again after it was redefined
+void EffectPoolInvalidateId(EffectPool *pool, int hl_attrib_id);
+// The entry of a pair of colors, creating its effect on first use
+uint32_t EffectPoolIntern(EffectPool *pool, const ColorRGBA *foreground, const ColorRGBA *special);
+
+// The effect for a pair of colors that isn't in the highlight table, such
+// as the cursor's
+inline void *EffectPoolFind(EffectPool *pool, const ColorRGBA *foreground, const ColorRGBA *special) {
+	pool->stats.lookups++;
+	return pool->entries[EffectPoolIntern(pool, foreground, special)].effect;
+}
+
+// The effect text of `hl_attrib_id` is drawn with, `colors` being what
+// the id currently resolves to
+inline void *EffectPoolGet(EffectPool *pool, int hl_attrib_id, const ResolvedColors *colors) {
+	pool->stats.lookups++;
+	uint32_t entry = pool->id_entries[hl_attrib_id];
+	if (entry == 0) {
+		entry = EffectPoolIntern(pool, &colors->foreground, &colors->special) + 1;
+		pool->id_entries[hl_attrib_id] = entry;
+	}
+	return pool->entries[entry - 1].effect;
+}
@@ -0,0 +1,70 @@
+#include "glyph_cache.h"
+#include <cstdlib>
+
+// Enough for a screen of CJK text or box drawing without growing
+constexpr uint32_t GLYPH_CACHE_INITIAL_SLOTS = 1024;
+
+static void AllocateTable(GlyphCache *cache, uint32_t slot_count) {
+	cache->keys = static_cast<uint64_t *>(malloc(slot_count * sizeof(uint64_t)));
+	cache->metrics = static_cast<GlyphMetrics *>(malloc(slot_count * sizeof(GlyphMetrics)));
+	cache->table_mask = slot_count - 1;
+	for (uint32_t i = 0; i < slot_count; ++i) {
+		cache->keys[i] = GLYPH_CACHE_EMPTY;
+	}
+}
+
+static void InsertKey(GlyphCache *cache, uint64_t key, GlyphMetrics metrics) {
+	uint32_t slot = GlyphCacheSlot(key, cache->table_mask);
+	while (cache->keys[slot] != GLYPH_CACHE_EMPTY) {
+		slot = (slot + 1) & cache->table_mask;
+	}
+	cache->keys[slot] = key;
+	cache->metrics[slot] = metrics;
+}
+
+void GlyphCacheInitialize(GlyphCache *cache) {
+	AllocateTable(cache, GLYPH_CACHE_INITIAL_SLOTS);
+	cache->count = 0;
+}
+
+void GlyphCacheFree(GlyphCache *cache) {
+	free(cache->keys);
+	free(cache->metrics);
+	*cache = GlyphCache {};
+}
+
+void GlyphCacheClear(GlyphCache *cache) {
+	for (uint32_t i = 0; i <= cache->table_mask; ++i) {
+		cache->keys[i] = GLYPH_CACHE_EMPTY;
+	}
+	for (GlyphMetrics &metrics : cache->latin1) {
+		metrics = GlyphMetrics {};
+	}
+	cache->count = 0;
+	cache->stats.clears++;
+}
+
+void GlyphCacheSetLatin1(GlyphCache *cache, const uint16_t *glyph_indices, const float *advances) {
+	for (uint32_t i = 0; i < GLYPH_CACHE_LATIN1_CHARS; ++i) {
+		cache->latin1[i] = GlyphMetrics { .glyph_index = glyph_indices[i], .advance = advances[i] };
+	}
+}
+
+void GlyphCacheInsert(GlyphCache *cache, uint32_t grid_char, bool wide, GlyphMetrics metrics) {
+	// Kept at most half full
+	if ((cache->count + 1) * 2 > cache->table_mask + 1) {
+		uint64_t *keys = cache->keys;
+		GlyphMetrics *old_metrics = cache->metrics;
+		uint32_t slot_count = cache->table_mask + 1;
+		AllocateTable(cache, slot_count * 2);
+		for (uint32_t i = 0; i < slot_count; ++i) {
+			if (keys[i] != GLYPH_CACHE_EMPTY) {
+				InsertKey(cache, keys[i], old_metrics[i]);
+			}
+		}
+		free(keys);
+		free(old_metrics);
+	}
+	InsertKey(cache, GlyphCacheKey(grid_char, wide), metrics);
+	cache->count++;
+}
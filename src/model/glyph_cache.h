@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+
+struct GlyphCacheStats {
+	uint64_t hits;
+	// Every miss is a measurement, a throwaway text layout on Windows
+	uint64_t misses;
+	uint64_t clears;
+};
+
+struct GlyphMetrics {
+	// 0 when the font has no glyph for the char and a fallback font draws it
+	uint16_t glyph_index;
+	float advance;
+};
+
+constexpr uint32_t GLYPH_CACHE_LATIN1_CHARS = 256;
+
+// The glyph index and advance of every character drawn with the current
+// font, so fitting a character into its cell only looks it up.
+//
+// Latin-1 is built up front for every font, that is nearly every cell of
+// source code. Anything else is measured the first time it is seen and
+// kept in a sparse map, keyed on the char as the grid stores it (surrogate
+// pairs packed into one uint32_t). Characters are measured on their own or
+// as the first of a double width cell pair, and kept apart as such. Latin-1
+// characters missing from the font are measured through the map as well.
+struct GlyphCache {
+	GlyphMetrics latin1[GLYPH_CACHE_LATIN1_CHARS];
+	// Open addressing on the keys, GLYPH_CACHE_EMPTY marks a free slot
+	uint64_t *keys;
+	GlyphMetrics *metrics;
+	uint32_t count;
+	uint32_t table_mask;
+	GlyphCacheStats stats;
+};
+
+constexpr uint64_t GLYPH_CACHE_EMPTY = UINT64_MAX;
+
+void GlyphCacheInitialize(GlyphCache *cache);
+void GlyphCacheFree(GlyphCache *cache);
+// Forgets every glyph, for when the font changes
+void GlyphCacheClear(GlyphCache *cache);
+// Fills in Latin-1 for a new font, `glyph_indices` and `advances` hold
+// GLYPH_CACHE_LATIN1_CHARS entries
+void GlyphCacheSetLatin1(GlyphCache *cache, const uint16_t *glyph_indices, const float *advances);
+void GlyphCacheInsert(GlyphCache *cache, uint32_t grid_char, bool wide, GlyphMetrics metrics);
+
+inline uint64_t GlyphCacheKey(uint32_t grid_char, bool wide) {
+	return (static_cast<uint64_t>(grid_char) << 1) | (wide ? 1 : 0);
+}
+
+inline uint32_t GlyphCacheSlot(uint64_t key, uint32_t table_mask) {
+	return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 40) & table_mask;
+}
+
+inline bool GlyphCacheFind(GlyphCache *cache, uint32_t grid_char, bool wide, GlyphMetrics *metrics) {
+	uint64_t key = GlyphCacheKey(grid_char, wide);
+	for (uint32_t slot = GlyphCacheSlot(key, cache->table_mask);; slot = (slot + 1) & cache->table_mask) {
+		if (cache->keys[slot] == key) {
+			*metrics = cache->metrics[slot];
+			cache->stats.hits++;
+			return true;
+		}
+		if (cache->keys[slot] == GLYPH_CACHE_EMPTY) {
+			cache->stats.misses++;
+			return false;
+		}
+	}
+}
+
+// The glyph of `grid_char` from the sparse map, calling `measure()` to
+// fill it in on a miss
+template<typename MeasureFn>
+GlyphMetrics GlyphCacheGet(GlyphCache *cache, uint32_t grid_char, bool wide, MeasureFn &&measure) {
+	GlyphMetrics metrics;
+	if (!GlyphCacheFind(cache, grid_char, wide, &metrics)) {
+		metrics = measure();
+		GlyphCacheInsert(cache, grid_char, wide, metrics);
+	}
+	return metrics;
+}
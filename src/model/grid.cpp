@@ -0,0 +1,291 @@
+#include "grid.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "common/simd.h"
+
+// The widest vector the target has, rows are always a whole number of them.
+// Without SIMD a uint64_t stands in, so there is a single code path.
+#if defined(NVY_SIMD_AVX2)
+using RowVector = __m256i;
+static inline RowVector RowLoad(const void *ptr) { return _mm256_load_si256(static_cast<const __m256i *>(ptr)); }
+static inline void RowStore(void *ptr, RowVector v) { _mm256_store_si256(static_cast<__m256i *>(ptr), v); }
+static inline RowVector RowOrXor(RowVector acc, RowVector a, RowVector b) { return _mm256_or_si256(acc, _mm256_xor_si256(a, b)); }
+static inline bool RowIsZero(RowVector v) { return _mm256_testz_si256(v, v); }
+static inline RowVector RowZero() { return _mm256_setzero_si256(); }
+static inline RowVector RowSet32(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+static inline RowVector RowSet16(uint16_t value) { return _mm256_set1_epi16(static_cast<short>(value)); }
+#elif defined(NVY_SIMD_SSE2)
+using RowVector = __m128i;
+static inline RowVector RowLoad(const void *ptr) { return _mm_load_si128(static_cast<const __m128i *>(ptr)); }
+static inline void RowStore(void *ptr, RowVector v) { _mm_store_si128(static_cast<__m128i *>(ptr), v); }
+static inline RowVector RowOrXor(RowVector acc, RowVector a, RowVector b) { return _mm_or_si128(acc, _mm_xor_si128(a, b)); }
+static inline bool RowIsZero(RowVector v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF; }
+static inline RowVector RowZero() { return _mm_setzero_si128(); }
+static inline RowVector RowSet32(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+static inline RowVector RowSet16(uint16_t value) { return _mm_set1_epi16(static_cast<short>(value)); }
+#else
+using RowVector = uint64_t;
+static inline RowVector RowLoad(const void *ptr) { RowVector v; memcpy(&v, ptr, sizeof(v)); return v; }
+static inline void RowStore(void *ptr, RowVector v) { memcpy(ptr, &v, sizeof(v)); }
+static inline RowVector RowOrXor(RowVector acc, RowVector a, RowVector b) { return acc | (a ^ b); }
+static inline bool RowIsZero(RowVector v) { return v == 0; }
+static inline RowVector RowZero() { return 0; }
+static inline RowVector RowSet32(uint32_t value) { return (static_cast<uint64_t>(value) << 32) | value; }
+static inline RowVector RowSet16(uint16_t value) { return RowSet32((static_cast<uint32_t>(value) << 16) | value); }
+#endif
+static_assert(GRID_ROW_ALIGNMENT % sizeof(RowVector) == 0, "Rows must hold whole vectors");
+
+// `size` is a multiple of GRID_ROW_ALIGNMENT for all of these
+static bool RowBytesEqual(const uint8_t *a, const uint8_t *b, size_t size) {
+	for (size_t i = 0; i < size; i += GRID_ROW_ALIGNMENT) {
+		// Check once per cache line, so the compares don't wait on branches
+		RowVector diff = RowZero();
+		for (size_t k = 0; k < GRID_ROW_ALIGNMENT; k += sizeof(RowVector)) {
+			diff = RowOrXor(diff, RowLoad(a + i + k), RowLoad(b + i + k));
+		}
+		if (!RowIsZero(diff)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void RowBytesFill(uint8_t *dst, RowVector value, size_t size) {
+	for (size_t i = 0; i < size; i += sizeof(RowVector)) {
+		RowStore(dst + i, value);
+	}
+}
+
+static int AlignedRowStride(int cols, size_t element_size) {
+	size_t row_size = (cols * element_size + GRID_ROW_ALIGNMENT - 1) & ~(GRID_ROW_ALIGNMENT - 1);
+	return static_cast<int>(row_size / element_size);
+}
+
+static void *AlignedAlloc(size_t size) {
+#ifdef _WIN32
+	return _aligned_malloc(size, GRID_ROW_ALIGNMENT);
+#else
+	return aligned_alloc(GRID_ROW_ALIGNMENT, size);
+#endif
+}
+
+static void AlignedFree(void *ptr) {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+bool GridResize(Grid *grid, int rows, int cols) {
+	if (grid->cells != nullptr &&
+		grid->cols == cols &&
+		grid->rows == rows) {
+		return false;
+	}
+
+	grid->cols = cols;
+	grid->rows = rows;
+	grid->chars_stride = AlignedRowStride(cols, sizeof(uint32_t));
+	grid->hl_attrib_ids_stride = AlignedRowStride(cols, sizeof(uint16_t));
+	grid->flags_stride = AlignedRowStride(cols, sizeof(uint8_t));
+
+	AlignedFree(grid->cells);
+	free(grid->row_map);
+	grid->cells = AlignedAlloc(GridRowSize(grid) * rows);
+	grid->chars = static_cast<uint32_t *>(grid->cells);
+	grid->hl_attrib_ids = reinterpret_cast<uint16_t *>(grid->chars + static_cast<size_t>(grid->chars_stride) * rows);
+	grid->flags = reinterpret_cast<uint8_t *>(grid->hl_attrib_ids + static_cast<size_t>(grid->hl_attrib_ids_stride) * rows);
+	grid->row_map = static_cast<int *>(malloc(static_cast<size_t>(rows) * sizeof(int)));
+	for (int i = 0; i < rows; ++i) {
+		grid->row_map[i] = i;
+	}
+	GridClear(grid);
+
+	grid->initialized = true;
+	return true;
+}
+
+void GridFree(Grid *grid) {
+	AlignedFree(grid->cells);
+	free(grid->row_map);
+	grid->cells = nullptr;
+	grid->chars = nullptr;
+	grid->hl_attrib_ids = nullptr;
+	grid->flags = nullptr;
+	grid->row_map = nullptr;
+}
+
+void GridClear(Grid *grid) {
+	// Initialize all grid character to a space. An empty grid cell is
+	// equivalent to a space in a text layout. Every row is the same so
+	// the row map doesn't matter, the planes are filled in one go.
+	size_t rows = static_cast<size_t>(grid->rows);
+	RowBytesFill(reinterpret_cast<uint8_t *>(grid->chars), RowSet32(L' '), rows * grid->chars_stride * sizeof(uint32_t));
+	memset(grid->hl_attrib_ids, 0, rows * grid->hl_attrib_ids_stride * sizeof(uint16_t));
+	memset(grid->flags, 0, rows * grid->flags_stride);
+}
+
+int GridPutCell(Grid *grid, int row, int col, uint32_t grid_char, uint16_t hl_attrib_id, int repeat) {
+	uint32_t *chars = GridRowChars(grid, row);
+	uint16_t *hl_attrib_ids = GridRowHighlights(grid, row);
+	uint8_t *flags = GridRowFlags(grid, row);
+
+	if (grid_char == GRID_CHAR_WIDE_RIGHT_HALF) {
+		// This is the right part of the wide char. Sadly grid_line
+		// event can be splitted at the middle of wide character.
+
+		// Be careful not to overwrite right half of surrogate pair.
+		// It never happens that col == 0, since it is the right
+		// half of wide char, but add check for safety.
+		if (col == 0 || !IsSurrogatePair(chars[col - 1], chars[col])) {
+			chars[col] = L'\0';
+		}
+
+		// This cell itself is not a wide character.
+		flags[col] = GRID_CELL_CONTINUATION;
+
+		// Adjust properties. Again it never happens that col == 0,
+		// since it is the right half of wide char, but adding check
+		// for safety.
+		if (col > 0) {
+			// Set the wide flag for the left cell.
+			flags[col - 1] |= GRID_CELL_WIDE;
+
+			// Inherit hl_attrib_id from left half.
+			hl_attrib_ids[col] = hl_attrib_ids[col - 1];
+		}
+
+		return col + 1;
+	}
+
+	// This is single width character or left half cell of wide
+	// character.
+
+	// Left cell should not be a wide character, so reset the
+	// flag. This time checking col > 0 is mandatory.
+	if (col > 0) {
+		flags[col - 1] &= ~GRID_CELL_WIDE;
+	}
+
+	// Wide character will never be repeated, so we don't have to
+	// handle wide character specially.
+	for (int k = 0; k < repeat; ++k) {
+		chars[col] = grid_char;
+		hl_attrib_ids[col] = hl_attrib_id;
+
+		// Here we clear the wide flag unconditionally. This is
+		// because if it is actually a wide character, then the
+		// right half of the char, empty string, should be appear
+		// soon, and the flag will be set there (first branch of
+		// this `if`).
+		flags[col] = 0;
+
+		++col;
+	}
+	return col;
+}
+
+void GridWidenSpan(Grid *grid, int row, bool ligatures, int *left, int *right) {
+	uint32_t *chars = GridRowChars(grid, row);
+	uint8_t *flags = GridRowFlags(grid, row);
+	int l = *left;
+	int r = *right;
+	if (ligatures) {
+		while (l > 0 && chars[l - 1] != L' ') {
+			--l;
+		}
+		while (r < grid->cols && chars[r] != L' ') {
+			++r;
+		}
+	}
+	else {
+		if (l > 0 && (flags[l] & GRID_CELL_CONTINUATION)) {
+			--l;
+		}
+		if (r < grid->cols && (flags[r] & GRID_CELL_CONTINUATION)) {
+			++r;
+		}
+	}
+	*left = l;
+	*right = r;
+}
+
+void GridScroll(Grid *grid, GridScrollRegion region) {
+	bool scrolling_down = region.rows > 0;
+
+	// A full width region is scrolled by rotating its rows in the row map,
+	// the rows that scroll out end up where nvim will draw the new ones
+	if (region.left == 0 && region.right == grid->cols) {
+		int *first = &grid->row_map[region.top];
+		int *last = &grid->row_map[region.bottom];
+		int count = scrolling_down ? region.rows : -region.rows;
+		if (count >= region.bottom - region.top) {
+			return;
+		}
+		std::rotate(first, scrolling_down ? first + count : last - count, last);
+		return;
+	}
+
+	// This part is slightly cryptic, basically we're just
+	// iterating from top to bottom or vice versa depending on scroll direction.
+	int start_row = scrolling_down ? region.top : region.bottom - 1;
+	int end_row = scrolling_down ? region.bottom - 1 : region.top;
+	int increment = scrolling_down ? 1 : -1;
+
+	for (int j = start_row; scrolling_down ? j <= end_row : j >= end_row; j += increment) {
+		// Clip anything outside the scroll region
+		int target_row = j - region.rows;
+		if (target_row < region.top || target_row >= region.bottom) {
+			continue;
+		}
+
+		GridCopySpan(grid, target_row, grid, j, region.left, region.right);
+	}
+}
+
+bool GridRowEqual(Grid *grid, int row, Grid *other, int other_row) {
+	assert(grid->cols == other->cols);
+	return RowBytesEqual(
+			reinterpret_cast<const uint8_t *>(GridRowChars(grid, row)),
+			reinterpret_cast<const uint8_t *>(GridRowChars(other, other_row)),
+			grid->chars_stride * sizeof(uint32_t)) &&
+		RowBytesEqual(
+			reinterpret_cast<const uint8_t *>(GridRowHighlights(grid, row)),
+			reinterpret_cast<const uint8_t *>(GridRowHighlights(other, other_row)),
+			grid->hl_attrib_ids_stride * sizeof(uint16_t)) &&
+		RowBytesEqual(GridRowFlags(grid, row), GridRowFlags(other, other_row), grid->flags_stride);
+}
+
+void GridFillRow(Grid *grid, int row, uint32_t grid_char, uint16_t hl_attrib_id) {
+	// The padding is filled too, so it stays the same in every row
+	RowBytesFill(reinterpret_cast<uint8_t *>(GridRowChars(grid, row)), RowSet32(grid_char),
+		grid->chars_stride * sizeof(uint32_t));
+	RowBytesFill(reinterpret_cast<uint8_t *>(GridRowHighlights(grid, row)), RowSet16(hl_attrib_id),
+		grid->hl_attrib_ids_stride * sizeof(uint16_t));
+	memset(GridRowFlags(grid, row), 0, grid->flags_stride);
+}
+
+void GridCopySpan(Grid *grid, int dst_row, Grid *src, int src_row, int left, int right) {
+	assert(grid->cols == src->cols);
+
+	// Whole rows are copied padding and all, as whole cache lines. The
+	// library memcpy already picks the widest copy the CPU supports and
+	// beat a hand written loop in the grid benchmark.
+	if (left == 0 && right == grid->cols) {
+		memcpy(GridRowChars(grid, dst_row), GridRowChars(src, src_row), grid->chars_stride * sizeof(uint32_t));
+		memcpy(GridRowHighlights(grid, dst_row), GridRowHighlights(src, src_row), grid->hl_attrib_ids_stride * sizeof(uint16_t));
+		memcpy(GridRowFlags(grid, dst_row), GridRowFlags(src, src_row), grid->flags_stride);
+		return;
+	}
+
+	GridCopyCells(grid, dst_row, left, src, src_row, left, right - left);
+}
+
+void GridCopyCells(Grid *grid, int dst_row, int dst_col, Grid *src, int src_row, int src_col, int count) {
+	memcpy(GridRowChars(grid, dst_row) + dst_col, GridRowChars(src, src_row) + src_col, count * sizeof(uint32_t));
+	memcpy(GridRowHighlights(grid, dst_row) + dst_col, GridRowHighlights(src, src_row) + src_col, count * sizeof(uint16_t));
+	memcpy(GridRowFlags(grid, dst_row) + dst_col, GridRowFlags(src, src_row) + src_col, count);
+}
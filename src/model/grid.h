@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum GridCellFlags : uint8_t {
+	// The left half of a double width character
+	GRID_CELL_WIDE = 1 << 0,
+	// The right half of a double width character
+	GRID_CELL_CONTINUATION = 1 << 1
+};
+
+// Every row of every plane starts on its own cache line
+constexpr size_t GRID_ROW_ALIGNMENT = 64;
+
+// The character and highlight contents of the nvim grid. Characters are
+// stored as UTF-16, with surrogate pairs packed into a single cell.
+//
+// Cells are split into planes of chars, highlight ids and GridCellFlags,
+// 7 bytes per cell. Rows are padded to a multiple of GRID_ROW_ALIGNMENT so
+// the row kernels below work on whole aligned vectors, the padding is
+// kept the same in every row so it never makes two rows differ.
+//
+// Rows are stored out of order behind `row_map`, so scrolling a full width
+// region only moves row indices around, go through the GridRow* accessors
+// rather than indexing the planes directly.
+struct Grid {
+	bool initialized;
+	int rows;
+	int cols;
+	// Row strides of each plane, in elements
+	int chars_stride;
+	int hl_attrib_ids_stride;
+	int flags_stride;
+	// A single allocation holding all three planes
+	void *cells;
+	uint32_t *chars;
+	uint16_t *hl_attrib_ids;
+	uint8_t *flags;
+	// Logical row -> row in the planes
+	int *row_map;
+};
+
+struct GridScrollRegion {
+	int top;
+	int bottom;
+	int left;
+	int right;
+	int rows;
+};
+
+// Marks the right half of a wide character, which nvim sends as an empty
+// cell. Never a valid grid char, since packed high surrogates are < 0xDC00.
+constexpr uint32_t GRID_CHAR_WIDE_RIGHT_HALF = 0xFFFFFFFF;
+
+inline bool ContainsSurrogatePair(uint32_t cell) {
+	return cell > 0xFFFF;
+}
+
+inline bool IsSurrogatePair(uint32_t left, uint32_t right) {
+	return (0xD800 <= left && left <= 0xDBFF) && (0xDC00 <= right && right <= 0xDFFF);
+}
+
+inline uint32_t *GridRowChars(Grid *grid, int row) {
+	return &grid->chars[static_cast<size_t>(grid->row_map[row]) * grid->chars_stride];
+}
+
+inline uint16_t *GridRowHighlights(Grid *grid, int row) {
+	return &grid->hl_attrib_ids[static_cast<size_t>(grid->row_map[row]) * grid->hl_attrib_ids_stride];
+}
+
+inline uint8_t *GridRowFlags(Grid *grid, int row) {
+	return &grid->flags[static_cast<size_t>(grid->row_map[row]) * grid->flags_stride];
+}
+
+// Bytes per row across all three planes, the padding included
+inline size_t GridRowSize(const Grid *grid) {
+	return grid->chars_stride * sizeof(uint32_t) + grid->hl_attrib_ids_stride * sizeof(uint16_t) + grid->flags_stride;
+}
+
+bool GridResize(Grid *grid, int rows, int cols);
+void GridFree(Grid *grid);
+void GridClear(Grid *grid);
+// Applies a single grid_line cell (repeated `repeat` times) at the given
+// position, returns the column following the written cells
+int GridPutCell(Grid *grid, int row, int col, uint32_t grid_char, uint16_t hl_attrib_id, int repeat);
+void GridScroll(Grid *grid, GridScrollRegion region);
+// Widens columns [*left, *right) of a row until they can be laid out on
+// their own. Double width characters are never split, and with ligatures
+// on neither are words, since glyphs may join across any non blank cells.
+void GridWidenSpan(Grid *grid, int row, bool ligatures, int *left, int *right);
+
+// Row kernels over whole aligned rows, vectorised where the target allows.
+// Both grids must have the same number of columns.
+bool GridRowEqual(Grid *grid, int row, Grid *other, int other_row);
+void GridFillRow(Grid *grid, int row, uint32_t grid_char, uint16_t hl_attrib_id);
+// Copies columns [left, right) of a row, all three planes
+void GridCopySpan(Grid *grid, int dst_row, Grid *src, int src_row, int left, int right);
+// Copies `count` cells between grids of any size, the cells must be in bounds
+// of both and mustn't overlap
+void GridCopyCells(Grid *grid, int dst_row, int dst_col, Grid *src, int src_row, int src_col, int count);
@@ -0,0 +1,162 @@
+#include "highlight_rows.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+void HighlightRowsResize(HighlightRows *hl_rows, int rows, int cols) {
+	free(hl_rows->row_ids);
+	free(hl_rows->row_id_counts);
+	free(hl_rows->scratch_ids);
+	free(hl_rows->slot_rows);
+	free(hl_rows->slot_ids);
+	free(hl_rows->marked_rows);
+	if (!hl_rows->id_slots) {
+		hl_rows->id_slots = static_cast<uint32_t *>(malloc(MAX_HIGHLIGHT_ATTRIBS * sizeof(uint32_t)));
+	}
+	memset(hl_rows->id_slots, 0, MAX_HIGHLIGHT_ATTRIBS * sizeof(uint32_t));
+
+	hl_rows->rows = rows;
+	hl_rows->cols = cols;
+	hl_rows->row_ids = static_cast<uint16_t *>(malloc(static_cast<size_t>(rows) * cols * sizeof(uint16_t)));
+	hl_rows->row_id_counts = static_cast<int *>(calloc(rows, sizeof(int)));
+	hl_rows->scratch_ids = static_cast<uint16_t *>(malloc(cols * sizeof(uint16_t)));
+	hl_rows->marked_rows = static_cast<uint64_t *>(calloc(DirtyRowsWordCount(rows), sizeof(uint64_t)));
+	hl_rows->slot_rows = nullptr;
+	hl_rows->slot_ids = nullptr;
+	hl_rows->slot_count = 0;
+	hl_rows->slot_capacity = 0;
+}
+
+void HighlightRowsFree(HighlightRows *hl_rows) {
+	free(hl_rows->row_ids);
+	free(hl_rows->row_id_counts);
+	free(hl_rows->scratch_ids);
+	free(hl_rows->id_slots);
+	free(hl_rows->slot_rows);
+	free(hl_rows->slot_ids);
+	free(hl_rows->marked_rows);
+	*hl_rows = HighlightRows {};
+}
+
+static uint64_t *SlotRows(HighlightRows *hl_rows, uint32_t slot) {
+	return hl_rows->slot_rows + static_cast<size_t>(slot) * DirtyRowsWordCount(hl_rows->rows);
+}
+
+static uint64_t *GetSlotRows(HighlightRows *hl_rows, uint16_t hl_attrib_id) {
+	uint32_t slot = hl_rows->id_slots[hl_attrib_id];
+	if (slot) {
+		return SlotRows(hl_rows, slot - 1);
+	}
+
+	if (hl_rows->slot_count == hl_rows->slot_capacity) {
+		int word_count = DirtyRowsWordCount(hl_rows->rows);
+		int capacity = hl_rows->slot_capacity ? hl_rows->slot_capacity * 2 : 64;
+		hl_rows->slot_rows = static_cast<uint64_t *>(realloc(hl_rows->slot_rows,
+			static_cast<size_t>(capacity) * word_count * sizeof(uint64_t)));
+		hl_rows->slot_ids = static_cast<uint16_t *>(realloc(hl_rows->slot_ids, capacity * sizeof(uint16_t)));
+		hl_rows->slot_capacity = capacity;
+	}
+	slot = hl_rows->slot_count++;
+	hl_rows->id_slots[hl_attrib_id] = slot + 1;
+	hl_rows->slot_ids[slot] = hl_attrib_id;
+	uint64_t *slot_rows = SlotRows(hl_rows, slot);
+	memset(slot_rows, 0, DirtyRowsWordCount(hl_rows->rows) * sizeof(uint64_t));
+	return slot_rows;
+}
+
+void HighlightRowsUpdate(HighlightRows *hl_rows, const HighlightRun *runs, int run_count, int row) {
+	if (row < 0 || row >= hl_rows->rows || run_count > hl_rows->cols) {
+		return;
+	}
+
+	// The same id can show up in several runs, sort out the duplicates
+	uint16_t *new_ids = hl_rows->scratch_ids;
+	for (int i = 0; i < run_count; ++i) {
+		new_ids[i] = runs[i].hl_attrib_id;
+	}
+	int new_count = run_count;
+	std::sort(new_ids, new_ids + new_count);
+	new_count = static_cast<int>(std::unique(new_ids, new_ids + new_count) - new_ids);
+
+	// Both lists are sorted, walk them together to find the ids the row
+	// stopped and started using
+	uint16_t *old_ids = hl_rows->row_ids + static_cast<size_t>(row) * hl_rows->cols;
+	int old_count = hl_rows->row_id_counts[row];
+	uint64_t bit = uint64_t(1) << (row % DIRTY_ROWS_PER_WORD);
+	int word = row / DIRTY_ROWS_PER_WORD;
+	int i = 0;
+	int j = 0;
+	while (i < old_count || j < new_count) {
+		if (j == new_count || (i < old_count && old_ids[i] < new_ids[j])) {
+			SlotRows(hl_rows, hl_rows->id_slots[old_ids[i]] - 1)[word] &= ~bit;
+			++i;
+		}
+		else if (i == old_count || new_ids[j] < old_ids[i]) {
+			GetSlotRows(hl_rows, new_ids[j])[word] |= bit;
+			++j;
+		}
+		else {
+			++i;
+			++j;
+		}
+	}
+	memcpy(old_ids, new_ids, new_count * sizeof(uint16_t));
+	hl_rows->row_id_counts[row] = new_count;
+}
+
+static void GatherSlotRows(HighlightRows *hl_rows, uint32_t slot) {
+	uint64_t *slot_rows = SlotRows(hl_rows, slot);
+	int word_count = DirtyRowsWordCount(hl_rows->rows);
+	for (int i = 0; i < word_count; ++i) {
+		hl_rows->marked_rows[i] |= slot_rows[i];
+	}
+}
+
+// Marks the gathered rows and clears them for next time
+static int MarkGatheredRows(HighlightRows *hl_rows, DirtyRows *dirty_rows) {
+	int rows_marked = 0;
+	int word_count = DirtyRowsWordCount(hl_rows->rows);
+	for (int i = 0; i < word_count; ++i) {
+		for (uint64_t word = hl_rows->marked_rows[i]; word; word &= word - 1) {
+			DirtyRowsMark(dirty_rows, i * DIRTY_ROWS_PER_WORD + std::countr_zero(word));
+			++rows_marked;
+		}
+		hl_rows->marked_rows[i] = 0;
+	}
+	hl_rows->stats.redefinitions++;
+	hl_rows->stats.rows_marked += rows_marked;
+	return rows_marked;
+}
+
+int HighlightRowsMarkId(HighlightRows *hl_rows, int hl_attrib_id, DirtyRows *dirty_rows) {
+	if (!hl_rows->id_slots || !hl_rows->id_slots[hl_attrib_id]) {
+		return 0;
+	}
+	GatherSlotRows(hl_rows, hl_rows->id_slots[hl_attrib_id] - 1);
+	return MarkGatheredRows(hl_rows, dirty_rows);
+}
+
+int HighlightRowsMarkDefaults(HighlightRows *hl_rows, const HighlightAttributes *hl_attribs,
+	const HighlightAttributes *previous_defaults, DirtyRows *dirty_rows) {
+	const HighlightAttributes *defaults = &hl_attribs[0];
+	bool foreground_changed = defaults->foreground != previous_defaults->foreground;
+	bool background_changed = defaults->background != previous_defaults->background;
+	bool special_changed = defaults->special != previous_defaults->special;
+	if (hl_rows->slot_count == 0 || (!foreground_changed && !background_changed && !special_changed)) {
+		return 0;
+	}
+
+	for (int slot = 0; slot < hl_rows->slot_count; ++slot) {
+		uint16_t hl_attrib_id = hl_rows->slot_ids[slot];
+		const HighlightAttributes *slot_attribs = &hl_attribs[hl_attrib_id];
+		// The special color is only ever seen in underlines
+		bool shows_special = slot_attribs->flags & (HL_ATTRIB_UNDERLINE | HL_ATTRIB_UNDERCURL);
+		if (hl_attrib_id == 0 ||
+			(foreground_changed && slot_attribs->foreground == DEFAULT_COLOR) ||
+			(background_changed && slot_attribs->background == DEFAULT_COLOR) ||
+			(special_changed && shows_special && slot_attribs->special == DEFAULT_COLOR)) {
+			GatherSlotRows(hl_rows, slot);
+		}
+	}
+	return MarkGatheredRows(hl_rows, dirty_rows);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include "model/dirty_rows.h"
+#include "model/grid.h"
+#include "model/highlight.h"
+#include "model/highlight_runs.h"
+
+struct HighlightRowStats {
+	// hl_attr_define and default_colors_set that changed a highlight on screen
+	uint64_t redefinitions;
+	// Rows marked dirty by those
+	uint64_t rows_marked;
+};
+
+// Which screen rows use each highlight id, so that redefining a highlight
+// or changing the default colors redraws exactly the rows showing it.
+//
+// Every row keeps the sorted list of ids it was last drawn with, and every
+// id that made it on screen gets a slot holding a bitset of its rows.
+// Slots are only handed back on resize, a screen only ever shows a few
+// hundred distinct highlights.
+struct HighlightRows {
+	int rows;
+	int cols;
+	// The ids of row `r` are `row_ids[r * cols]` onwards, `row_id_counts[r]` of them
+	uint16_t *row_ids;
+	int *row_id_counts;
+	// Room for the ids of one row while they are collected
+	uint16_t *scratch_ids;
+	// Slot + 1 for every id, 0 for ids not on screen since the last resize
+	uint32_t *id_slots;
+	uint16_t *slot_ids;
+	// DirtyRowsWordCount(rows) words per slot
+	uint64_t *slot_rows;
+	int slot_count;
+	int slot_capacity;
+	// The rows to mark, gathered from every slot first so each row is marked once
+	uint64_t *marked_rows;
+	HighlightRowStats stats;
+};
+
+// Forgets every row, they are recorded again as they are drawn
+void HighlightRowsResize(HighlightRows *hl_rows, int rows, int cols);
+void HighlightRowsFree(HighlightRows *hl_rows);
+// Records the ids a screen row was just drawn with, from its highlight runs
+void HighlightRowsUpdate(HighlightRows *hl_rows, const HighlightRun *runs, int run_count, int row);
+// Marks the rows showing `hl_attrib_id` dirty, returns the number of rows
+int HighlightRowsMarkId(HighlightRows *hl_rows, int hl_attrib_id, DirtyRows *dirty_rows);
+// Marks the rows showing a highlight that falls back to one of the changed
+// default colors, `previous_defaults` being the default colors before
+int HighlightRowsMarkDefaults(HighlightRows *hl_rows, const HighlightAttributes *hl_attribs,
+	const HighlightAttributes *previous_defaults, DirtyRows *dirty_rows);
@@ -0,0 +1,77 @@
+#include "highlight_runs.h"
+#include <bit>
+#include <cstdlib>
+#include "common/simd.h"
+
+void HighlightRunsResize(HighlightRuns *hl_runs, int rows, int cols) {
+	free(hl_runs->runs);
+	free(hl_runs->run_counts);
+	hl_runs->rows = rows;
+	hl_runs->cols = cols;
+	hl_runs->runs = static_cast<HighlightRun *>(malloc(static_cast<size_t>(rows) * cols * sizeof(HighlightRun)));
+	hl_runs->run_counts = static_cast<int *>(calloc(rows, sizeof(int)));
+}
+
+void HighlightRunsFree(HighlightRuns *hl_runs) {
+	free(hl_runs->runs);
+	free(hl_runs->run_counts);
+	*hl_runs = HighlightRuns {};
+}
+
+// Ends the last run at `col` and starts a new one there
+static inline int StartRun(HighlightRun *runs, int run_count, int col, uint16_t hl_attrib_id) {
+	runs[run_count - 1].length = static_cast<uint16_t>(col - runs[run_count - 1].start);
+	runs[run_count] = HighlightRun { .start = static_cast<uint16_t>(col), .length = 0, .hl_attrib_id = hl_attrib_id };
+	return run_count + 1;
+}
+
+int HighlightRunsBuild(HighlightRuns *hl_runs, Grid *grid, int row) {
+	if (row < 0 || row >= hl_runs->rows || grid->cols != hl_runs->cols || grid->cols == 0) {
+		return 0;
+	}
+
+	const uint16_t *hl_attrib_ids = GridRowHighlights(grid, row);
+	HighlightRun *runs = hl_runs->runs + static_cast<size_t>(row) * hl_runs->cols;
+	runs[0] = HighlightRun { .start = 0, .length = 0, .hl_attrib_id = hl_attrib_ids[0] };
+	int run_count = 1;
+	int cols = grid->cols;
+	int col = 1;
+
+	// Compare each id with the one before it a vector at a time, a run
+	// starts wherever they differ. Rows are mostly long runs, so the
+	// vectors are nearly always all equal and skipped in one branch.
+#if defined(NVY_SIMD_AVX2)
+	constexpr int VECTOR_IDS = 16;
+	for (; col + VECTOR_IDS <= cols; col += VECTOR_IDS) {
+		__m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hl_attrib_ids + col));
+		__m256i previous_ids = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hl_attrib_ids + col - 1));
+		uint32_t changed = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(ids, previous_ids))) & 0x55555555;
+		for (; changed; changed &= changed - 1) {
+			int i = col + std::countr_zero(changed) / 2;
+			run_count = StartRun(runs, run_count, i, hl_attrib_ids[i]);
+		}
+	}
+#elif defined(NVY_SIMD_SSE2)
+	constexpr int VECTOR_IDS = 8;
+	for (; col + VECTOR_IDS <= cols; col += VECTOR_IDS) {
+		__m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hl_attrib_ids + col));
+		__m128i previous_ids = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hl_attrib_ids + col - 1));
+		uint32_t changed = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(ids, previous_ids))) & 0x5555;
+		for (; changed; changed &= changed - 1) {
+			int i = col + std::countr_zero(changed) / 2;
+			run_count = StartRun(runs, run_count, i, hl_attrib_ids[i]);
+		}
+	}
+#endif
+	for (; col < cols; ++col) {
+		if (hl_attrib_ids[col] != hl_attrib_ids[col - 1]) {
+			run_count = StartRun(runs, run_count, col, hl_attrib_ids[col]);
+		}
+	}
+	runs[run_count - 1].length = static_cast<uint16_t>(cols - runs[run_count - 1].start);
+
+	hl_runs->run_counts[row] = run_count;
+	hl_runs->stats.rows_built++;
+	hl_runs->stats.runs_built += run_count;
+	return run_count;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include "model/grid.h"
+
+// Columns [start, start + length) of a row, all drawn with one highlight id
+struct HighlightRun {
+	uint16_t start;
+	uint16_t length;
+	uint16_t hl_attrib_id;
+};
+
+struct HighlightRunStats {
+	uint64_t rows_built;
+	uint64_t runs_built;
+};
+
+// The highlight ids of every screen row as runs, rebuilt for each row the
+// flush composes. A line of code has a handful of highlights across a
+// couple hundred columns, so hashing, invalidation and drawing walk the
+// runs rather than compare the id of every cell again.
+struct HighlightRuns {
+	int rows;
+	int cols;
+	// The runs of row `r` are `runs[r * cols]` onwards, `run_counts[r]` of them
+	HighlightRun *runs;
+	int *run_counts;
+	HighlightRunStats stats;
+};
+
+// Every row starts out with no runs, they are built as rows are flushed
+void HighlightRunsResize(HighlightRuns *hl_runs, int rows, int cols);
+void HighlightRunsFree(HighlightRuns *hl_runs);
+// Splits a row of `grid` into runs, returns the number of runs
+int HighlightRunsBuild(HighlightRuns *hl_runs, Grid *grid, int row);
+
+inline const HighlightRun *HighlightRunsRow(const HighlightRuns *hl_runs, int row, int *run_count) {
+	*run_count = hl_runs->run_counts[row];
+	return hl_runs->runs + static_cast<size_t>(row) * hl_runs->cols;
+}
+
+// The run covering column `col`
+inline int HighlightRunsFind(const HighlightRun *runs, int run_count, int col) {
+	int first = 0;
+	int last = run_count - 1;
+	while (first < last) {
+		int middle = (first + last + 1) / 2;
+		if (runs[middle].start <= col) {
+			first = middle;
+		}
+		else {
+			last = middle - 1;
+		}
+	}
+	return first;
+}
+
+// Ids that look the same share a set in `id_sets` and are drawn as one run.
+// Returns the column the joined runs from `*run` onwards end at and moves
+// `*run` past them.
+inline int HighlightRunsJoin(const HighlightRun *runs, int run_count, int *run, const uint32_t *id_sets) {
+	uint32_t set = id_sets[runs[*run].hl_attrib_id];
+	int end = runs[*run].start + runs[*run].length;
+	for (++*run; *run < run_count && id_sets[runs[*run].hl_attrib_id] == set; ++*run) {
+		end = runs[*run].start + runs[*run].length;
+	}
+	return end;
+}
@@ -0,0 +1,70 @@
+#include "highlight_sets.h"
+#include <cstdlib>
+
+constexpr uint32_t HIGHLIGHT_SETS_INITIAL_CAPACITY = 256;
+
+static uint32_t HashAttributes(const HighlightAttributes *hl_attribs) {
+	uint64_t hash = (static_cast<uint64_t>(hl_attribs->foreground) << 32) | hl_attribs->background;
+	hash ^= (static_cast<uint64_t>(hl_attribs->special) << 16) ^ hl_attribs->flags;
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<uint32_t>(hash >> 32);
+}
+
+static void InsertSet(HighlightSets *hl_sets, uint32_t set) {
+	uint32_t slot = HashAttributes(&hl_sets->sets[set]) & hl_sets->table_mask;
+	while (hl_sets->table[slot]) {
+		slot = (slot + 1) & hl_sets->table_mask;
+	}
+	hl_sets->table[slot] = set + 1;
+}
+
+void HighlightSetsInitialize(HighlightSets *hl_sets, int id_count) {
+	hl_sets->id_sets = static_cast<uint32_t *>(calloc(id_count, sizeof(uint32_t)));
+	hl_sets->set_capacity = HIGHLIGHT_SETS_INITIAL_CAPACITY;
+	hl_sets->sets = static_cast<HighlightAttributes *>(malloc(hl_sets->set_capacity * sizeof(HighlightAttributes)));
+	// Kept at most half full
+	hl_sets->table_mask = hl_sets->set_capacity * 2 - 1;
+	hl_sets->table = static_cast<uint32_t *>(calloc(hl_sets->table_mask + 1, sizeof(uint32_t)));
+
+	// Set 0 holds the zeroed attributes of ids not defined yet
+	hl_sets->sets[0] = HighlightAttributes {};
+	hl_sets->set_count = 1;
+	InsertSet(hl_sets, 0);
+}
+
+void HighlightSetsFree(HighlightSets *hl_sets) {
+	free(hl_sets->id_sets);
+	free(hl_sets->sets);
+	free(hl_sets->table);
+	*hl_sets = HighlightSets {};
+}
+
+uint32_t HighlightSetsIntern(HighlightSets *hl_sets, int hl_attrib_id, const HighlightAttributes *hl_attribs) {
+	hl_sets->stats.interned++;
+	uint32_t slot = HashAttributes(hl_attribs) & hl_sets->table_mask;
+	while (uint32_t entry = hl_sets->table[slot]) {
+		if (HighlightAttributesEqual(&hl_sets->sets[entry - 1], hl_attribs)) {
+			hl_sets->id_sets[hl_attrib_id] = entry - 1;
+			hl_sets->stats.shared++;
+			return entry - 1;
+		}
+		slot = (slot + 1) & hl_sets->table_mask;
+	}
+
+	if (hl_sets->set_count == hl_sets->set_capacity) {
+		hl_sets->set_capacity *= 2;
+		hl_sets->sets = static_cast<HighlightAttributes *>(realloc(hl_sets->sets,
+			hl_sets->set_capacity * sizeof(HighlightAttributes)));
+		free(hl_sets->table);
+		hl_sets->table_mask = hl_sets->set_capacity * 2 - 1;
+		hl_sets->table = static_cast<uint32_t *>(calloc(hl_sets->table_mask + 1, sizeof(uint32_t)));
+		for (uint32_t set = 0; set < hl_sets->set_count; ++set) {
+			InsertSet(hl_sets, set);
+		}
+	}
+	uint32_t set = hl_sets->set_count++;
+	hl_sets->sets[set] = *hl_attribs;
+	InsertSet(hl_sets, set);
+	hl_sets->id_sets[hl_attrib_id] = set;
+	return set;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include "model/highlight.h"
+
+struct HighlightSetStats {
+	// Every time an id was (re)defined
+	uint64_t interned;
+	// Definitions that found an identical set already interned
+	uint64_t shared;
+};
+
+// Interns the attributes of every highlight id, so ids that look exactly
+// the same share one set. Colorschemes link most of their groups to a few
+// base groups, so a few thousand ids tend to make up only a few hundred
+// sets. Neighbouring cells with different ids but the same set are drawn
+// as one run, and anything derived from the attributes alone can be kept
+// per set rather than per id.
+//
+// Sets are never released, a redefined id just moves to another one.
+struct HighlightSets {
+	// The set of every highlight id, undefined ids are in set 0
+	uint32_t *id_sets;
+	HighlightAttributes *sets;
+	uint32_t set_count;
+	uint32_t set_capacity;
+	// Open addressing on the attributes, set + 1 per slot and 0 when empty
+	uint32_t *table;
+	uint32_t table_mask;
+	HighlightSetStats stats;
+};
+
+void HighlightSetsInitialize(HighlightSets *hl_sets, int id_count);
+void HighlightSetsFree(HighlightSets *hl_sets);
+// Moves `hl_attrib_id` to the set of `hl_attribs`, returns the set
+uint32_t HighlightSetsIntern(HighlightSets *hl_sets, int hl_attrib_id, const HighlightAttributes *hl_attribs);
+
+inline bool HighlightAttributesEqual(const HighlightAttributes *a, const HighlightAttributes *b) {
+	return a->foreground == b->foreground && a->background == b->background &&
+		a->special == b->special && a->flags == b->flags;
+}
@@ -0,0 +1,146 @@
+#include "layout_cache.h"
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+static uint32_t HashKey(LayoutCacheKey key) {
+	uint64_t hash = key.row_hash ^ ((static_cast<uint64_t>(key.font_generation) << 32) |
+		(static_cast<uint32_t>(key.left) << 16) | key.right);
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<uint32_t>(hash >> 32);
+}
+
+static bool KeysEqual(LayoutCacheKey a, LayoutCacheKey b) {
+	return a.row_hash == b.row_hash && a.font_generation == b.font_generation &&
+		a.left == b.left && a.right == b.right;
+}
+
+static void Unlink(LayoutCache *cache, int entry) {
+	LayoutCacheEntry *e = &cache->entries[entry];
+	if (e->newer >= 0) {
+		cache->entries[e->newer].older = e->older;
+	}
+	else {
+		cache->newest = e->older;
+	}
+	if (e->older >= 0) {
+		cache->entries[e->older].newer = e->newer;
+	}
+	else {
+		cache->oldest = e->newer;
+	}
+}
+
+static void LinkNewest(LayoutCache *cache, int entry) {
+	LayoutCacheEntry *e = &cache->entries[entry];
+	e->newer = -1;
+	e->older = cache->newest;
+	if (cache->newest >= 0) {
+		cache->entries[cache->newest].newer = entry;
+	}
+	else {
+		cache->oldest = entry;
+	}
+	cache->newest = entry;
+}
+
+// Shifts the entries after the removed one back, so no probe
+// sequence is cut short by the hole it leaves
+static void RemoveFromTable(LayoutCache *cache, int entry) {
+	uint32_t mask = cache->table_mask;
+	uint32_t hole = HashKey(cache->entries[entry].key) & mask;
+	while (cache->table[hole] != static_cast<uint32_t>(entry) + 1) {
+		hole = (hole + 1) & mask;
+	}
+	for (uint32_t slot = (hole + 1) & mask; cache->table[slot]; slot = (slot + 1) & mask) {
+		uint32_t home = HashKey(cache->entries[cache->table[slot] - 1].key) & mask;
+		if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+			cache->table[hole] = cache->table[slot];
+			hole = slot;
+		}
+	}
+	cache->table[hole] = 0;
+}
+
+void LayoutCacheInitialize(LayoutCache *cache, int capacity, void (*release)(void *layout)) {
+	cache->capacity = capacity;
+	cache->entries = static_cast<LayoutCacheEntry *>(malloc(capacity * sizeof(LayoutCacheEntry)));
+	// Kept at most half full
+	cache->table_mask = std::bit_ceil(static_cast<uint32_t>(capacity) * 2) - 1;
+	cache->table = static_cast<uint32_t *>(calloc(cache->table_mask + 1, sizeof(uint32_t)));
+	cache->release = release;
+	cache->count = 0;
+	cache->newest = -1;
+	cache->oldest = -1;
+	cache->cached_cells = 0;
+}
+
+void LayoutCacheFree(LayoutCache *cache) {
+	LayoutCacheClear(cache);
+	free(cache->entries);
+	free(cache->table);
+	*cache = LayoutCache {};
+}
+
+void LayoutCacheClear(LayoutCache *cache) {
+	for (int i = 0; i < cache->count; ++i) {
+		cache->release(cache->entries[i].layout);
+	}
+	if (cache->table) {
+		memset(cache->table, 0, (cache->table_mask + 1) * sizeof(uint32_t));
+	}
+	cache->count = 0;
+	cache->newest = -1;
+	cache->oldest = -1;
+	cache->cached_cells = 0;
+}
+
+bool LayoutCacheFind(LayoutCache *cache, LayoutCacheKey key, void **layout) {
+	uint32_t slot = HashKey(key) & cache->table_mask;
+	while (uint32_t entry = cache->table[slot]) {
+		if (KeysEqual(cache->entries[entry - 1].key, key)) {
+			if (cache->newest != static_cast<int>(entry - 1)) {
+				Unlink(cache, entry - 1);
+				LinkNewest(cache, entry - 1);
+			}
+			*layout = cache->entries[entry - 1].layout;
+			cache->stats.hits++;
+			return true;
+		}
+		slot = (slot + 1) & cache->table_mask;
+	}
+	cache->stats.misses++;
+	return false;
+}
+
+void LayoutCacheInsert(LayoutCache *cache, LayoutCacheKey key, void *layout, int cells) {
+	int entry;
+	if (cache->count == cache->capacity) {
+		entry = cache->oldest;
+		LayoutCacheEntry *evicted = &cache->entries[entry];
+		cache->release(evicted->layout);
+		cache->cached_cells -= evicted->cells;
+		RemoveFromTable(cache, entry);
+		Unlink(cache, entry);
+		cache->stats.evictions++;
+	}
+	else {
+		entry = cache->count++;
+	}
+
+	cache->entries[entry].key = key;
+	cache->entries[entry].layout = layout;
+	cache->entries[entry].cells = cells;
+	cache->cached_cells += cells;
+	LinkNewest(cache, entry);
+
+	uint32_t slot = HashKey(key) & cache->table_mask;
+	while (cache->table[slot]) {
+		slot = (slot + 1) & cache->table_mask;
+	}
+	cache->table[slot] = entry + 1;
+}
+
+size_t LayoutCacheSize(const LayoutCache *cache) {
+	return cache->capacity * sizeof(LayoutCacheEntry) + (cache->table_mask + 1) * sizeof(uint32_t);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// What a laid out row depends on: its contents and highlights (the row
+// hash), the font it was shaped with and the columns it covers
+struct LayoutCacheKey {
+	uint64_t row_hash;
+	uint32_t font_generation;
+	uint16_t left;
+	uint16_t right;
+};
+
+struct LayoutCacheEntry {
+	LayoutCacheKey key;
+	void *layout;
+	int cells;
+	// Neighbours in the recently used list, -1 at either end
+	int newer;
+	int older;
+};
+
+struct LayoutCacheStats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+// The most recently drawn row layouts, so a row that shows up again with
+// the same contents skips shaping. That covers repainting the whole
+// window after a resize or occlusion, rows scrolled back into view and
+// rows nvim redraws as they were. Holds `capacity` layouts at most, the
+// least recently used one makes room for a new one.
+//
+// Layouts are opaque here, `release` is called on every layout the cache
+// lets go of.
+struct LayoutCache {
+	LayoutCacheEntry *entries;
+	int capacity;
+	int count;
+	// Open addressing on the keys, entry + 1 per slot and 0 when empty
+	uint32_t *table;
+	uint32_t table_mask;
+	int newest;
+	int oldest;
+	void (*release)(void *layout);
+	// The cells laid out by all the cached layouts together
+	uint64_t cached_cells;
+	LayoutCacheStats stats;
+};
+
+constexpr int DEFAULT_LAYOUT_CACHE_CAPACITY = 1024;
+
+void LayoutCacheInitialize(LayoutCache *cache, int capacity, void (*release)(void *layout));
+// Releases every layout
+void LayoutCacheFree(LayoutCache *cache);
+void LayoutCacheClear(LayoutCache *cache);
+// Returns true and the layout if `key` is cached, marking it most recently used
+bool LayoutCacheFind(LayoutCache *cache, LayoutCacheKey key, void **layout);
+// Caches a layout `key` isn't cached with yet, the cache takes ownership
+void LayoutCacheInsert(LayoutCache *cache, LayoutCacheKey key, void *layout, int cells);
+// The memory the cache itself takes, not counting the layouts
+size_t LayoutCacheSize(const LayoutCache *cache);
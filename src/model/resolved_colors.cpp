@@ -0,0 +1,44 @@
+#include "resolved_colors.h"
+
+ResolvedColors ResolveColors(const HighlightAttributes *default_attribs, const HighlightAttributes *hl_attribs) {
+	uint32_t foreground = hl_attribs->foreground == DEFAULT_COLOR ? default_attribs->foreground : hl_attribs->foreground;
+	uint32_t background = hl_attribs->background == DEFAULT_COLOR ? default_attribs->background : hl_attribs->background;
+	uint32_t special = hl_attribs->special == DEFAULT_COLOR ? default_attribs->special : hl_attribs->special;
+	if (hl_attribs->flags & HL_ATTRIB_REVERSE) {
+		uint32_t temp = foreground;
+		foreground = background;
+		background = temp;
+	}
+	return ResolvedColors {
+		.foreground = ColorFromRGB(foreground),
+		.background = ColorFromRGB(background),
+		.special = ColorFromRGB(special)
+	};
+}
+
+void ResolvedColorsInitialize(ResolvedColorTable *table, int count) {
+	// Undefined ids have zeroed attributes, which resolve to opaque black
+	// no matter what the default colors are
+	table->colors.resize(count);
+	HighlightAttributes undefined_attribs {};
+	ResolvedColors undefined_colors = ResolveColors(&undefined_attribs, &undefined_attribs);
+	for (int i = 0; i < count; ++i) {
+		table->colors[i] = undefined_colors;
+	}
+	table->defined_count = 1;
+}
+
+void ResolvedColorsUpdate(ResolvedColorTable *table, const HighlightAttributes *hl_attribs, int hl_attrib_id) {
+	table->colors[hl_attrib_id] = ResolveColors(&hl_attribs[0], &hl_attribs[hl_attrib_id]);
+	if (hl_attrib_id >= table->defined_count) {
+		table->defined_count = hl_attrib_id + 1;
+	}
+	table->stats.updates++;
+}
+
+void ResolvedColorsRebuild(ResolvedColorTable *table, const HighlightAttributes *hl_attribs) {
+	for (int i = 0; i < table->defined_count; ++i) {
+		table->colors[i] = ResolveColors(&hl_attribs[0], &hl_attribs[i]);
+	}
+	table->stats.rebuilds++;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include "common/vec.h"
+#include "model/highlight.h"
+
+// A color in the float RGBA layout of D2D1_COLOR_F, so the renderer can
+// hand it to a brush without converting
+struct ColorRGBA {
+	float r;
+	float g;
+	float b;
+	float a;
+};
+
+// The colors a highlight is drawn with, reverse video and the fallbacks to
+// the default colors already applied
+struct ResolvedColors {
+	ColorRGBA foreground;
+	ColorRGBA background;
+	ColorRGBA special;
+};
+
+struct ResolvedColorStats {
+	// Single entries resolved by hl_attr_define
+	uint64_t updates;
+	// Whole table rebuilds by default_colors_set
+	uint64_t rebuilds;
+};
+
+// The resolved colors of every highlight id. An hl_attr_define resolves
+// just its own entry, only new default colors touch every entry, since
+// those are what the DEFAULT_COLOR fallbacks point at.
+struct ResolvedColorTable {
+	Vec<ResolvedColors> colors;
+	// One past the highest id defined so far, the part a rebuild covers
+	int defined_count;
+	ResolvedColorStats stats;
+};
+
+inline ColorRGBA ColorFromRGB(uint32_t rgb) {
+	return ColorRGBA {
+		.r = static_cast<float>((rgb >> 16) & 0xFF) / 255.0f,
+		.g = static_cast<float>((rgb >> 8) & 0xFF) / 255.0f,
+		.b = static_cast<float>(rgb & 0xFF) / 255.0f,
+		.a = 1.0f
+	};
+}
+
+// Resolves the colors of `hl_attribs` against the default colors, for
+// attributes that are not in the table such as the cursor's
+ResolvedColors ResolveColors(const HighlightAttributes *default_attribs, const HighlightAttributes *hl_attribs);
+
+void ResolvedColorsInitialize(ResolvedColorTable *table, int count);
+// Resolves `hl_attrib_id` again after it was (re)defined
+void ResolvedColorsUpdate(ResolvedColorTable *table, const HighlightAttributes *hl_attribs, int hl_attrib_id);
+// Resolves every defined id again after the default colors changed
+void ResolvedColorsRebuild(ResolvedColorTable *table, const HighlightAttributes *hl_attribs);
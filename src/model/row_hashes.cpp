@@ -0,0 +1,92 @@
+#include "row_hashes.h"
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+// The xxHash64 primes and round, four independent lanes keep the
+// multiplies from waiting on each other
+constexpr uint64_t ROW_HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t ROW_HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t ROW_HASH_PRIME_3 = 0x165667B19E3779F9ull;
+
+static inline uint64_t RowHashRound(uint64_t acc, uint64_t value) {
+	acc += value * ROW_HASH_PRIME_2;
+	acc = std::rotl(acc, 31);
+	return acc * ROW_HASH_PRIME_1;
+}
+
+static inline uint64_t RowHashLoad(const uint8_t *ptr) {
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+// `size` is a multiple of GRID_ROW_ALIGNMENT, so always whole 32 byte blocks
+static void RowHashBytes(uint64_t lanes[4], const uint8_t *data, size_t size) {
+	for (size_t i = 0; i < size; i += 32) {
+		lanes[0] = RowHashRound(lanes[0], RowHashLoad(data + i));
+		lanes[1] = RowHashRound(lanes[1], RowHashLoad(data + i + 8));
+		lanes[2] = RowHashRound(lanes[2], RowHashLoad(data + i + 16));
+		lanes[3] = RowHashRound(lanes[3], RowHashLoad(data + i + 24));
+	}
+}
+
+static uint64_t RowHashAttributes(uint64_t acc, const HighlightAttributes *hl_attribs) {
+	acc = RowHashRound(acc, (static_cast<uint64_t>(hl_attribs->foreground) << 32) | hl_attribs->background);
+	return RowHashRound(acc, (static_cast<uint64_t>(hl_attribs->special) << 32) | hl_attribs->flags);
+}
+
+void RowHashesResize(RowHashes *row_hashes, int rows) {
+	free(row_hashes->hashes);
+	row_hashes->rows = rows;
+	row_hashes->hashes = static_cast<uint64_t *>(calloc(rows, sizeof(uint64_t)));
+}
+
+void RowHashesFree(RowHashes *row_hashes) {
+	free(row_hashes->hashes);
+	row_hashes->hashes = nullptr;
+	row_hashes->rows = 0;
+}
+
+void RowHashesInvalidate(RowHashes *row_hashes) {
+	memset(row_hashes->hashes, 0, static_cast<size_t>(row_hashes->rows) * sizeof(uint64_t));
+}
+
+void RowHashesInvalidateRow(RowHashes *row_hashes, int row) {
+	if (row >= 0 && row < row_hashes->rows) {
+		row_hashes->hashes[row] = 0;
+	}
+}
+
+uint64_t RowHash(Grid *grid, const HighlightAttributes *hl_attribs, const HighlightRun *runs, int run_count, int row) {
+	uint64_t lanes[4] {
+		ROW_HASH_PRIME_1 + ROW_HASH_PRIME_2,
+		ROW_HASH_PRIME_2,
+		0,
+		0 - ROW_HASH_PRIME_1
+	};
+	const uint16_t *hl_attrib_ids = GridRowHighlights(grid, row);
+	RowHashBytes(lanes, reinterpret_cast<const uint8_t *>(GridRowChars(grid, row)), grid->chars_stride * sizeof(uint32_t));
+	RowHashBytes(lanes, reinterpret_cast<const uint8_t *>(hl_attrib_ids), grid->hl_attrib_ids_stride * sizeof(uint16_t));
+	RowHashBytes(lanes, GridRowFlags(grid, row), grid->flags_stride);
+
+	uint64_t hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+
+	// Colors are resolved against the defaults, so those go in first. The
+	// ids already place each highlight, so the attributes of the runs are
+	// summed rather than chained, which lets the rounds run side by side.
+	hash = RowHashAttributes(hash, &hl_attribs[0]);
+	uint64_t run_sum = 0;
+	for (int i = 0; i < run_count; ++i) {
+		run_sum += RowHashAttributes(ROW_HASH_PRIME_3, &hl_attribs[runs[i].hl_attrib_id]);
+	}
+	hash = RowHashRound(hash, run_sum);
+
+	// The xxHash64 avalanche
+	hash ^= hash >> 33;
+	hash *= ROW_HASH_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= ROW_HASH_PRIME_3;
+	hash ^= hash >> 32;
+	return hash != 0 ? hash : 1;
+}
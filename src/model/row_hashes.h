@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include "model/grid.h"
+#include "model/highlight.h"
+#include "model/highlight_runs.h"
+
+struct RowHashStats {
+	// Dirty rows that turned out to look exactly like the last frame
+	uint64_t hits;
+	uint64_t misses;
+};
+
+// A hash of every row as of the last time it was drawn. nvim often resends
+// rows that are already on screen (:redraw!, focus changes, statuslines
+// ticking every second), those are skipped instead of laid out again.
+// A hash of 0 means the row is not on screen and has to be drawn.
+struct RowHashes {
+	uint64_t *hashes;
+	int rows;
+	RowHashStats stats;
+};
+
+void RowHashesResize(RowHashes *row_hashes, int rows);
+void RowHashesFree(RowHashes *row_hashes);
+// Forgets everything drawn, for when the window contents are lost
+void RowHashesInvalidate(RowHashes *row_hashes);
+void RowHashesInvalidateRow(RowHashes *row_hashes, int row);
+
+// Hashes the chars, highlight ids and flags of a row together with the
+// attributes of every highlight used on it and the default colors, which
+// is everything the resolved colors of its cells depend on. `runs` are the
+// row's highlight runs as built by HighlightRunsBuild. Never 0.
+uint64_t RowHash(Grid *grid, const HighlightAttributes *hl_attribs, const HighlightRun *runs, int run_count, int row);
+
+// Records `hash` as the row's on screen contents, returns false if the
+// row already looks like that and doesn't need to be drawn
+inline bool RowHashesUpdate(RowHashes *row_hashes, int row, uint64_t hash) {
+	if (row < 0 || row >= row_hashes->rows) {
+		return true;
+	}
+	if (row_hashes->hashes[row] == hash) {
+		row_hashes->stats.hits++;
+		return false;
+	}
+	row_hashes->hashes[row] = hash;
+	row_hashes->stats.misses++;
+	return true;
+}
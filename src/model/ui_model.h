@@ -0,0 +1,96 @@
+#pragma once
+#include "common/vec.h"
+#include "model/compositor.h"
+#include "model/dirty_rows.h"
+#include "model/grid.h"
+#include "model/highlight.h"
+#include "model/highlight_rows.h"
+#include "model/highlight_runs.h"
+#include "model/highlight_sets.h"
+#include "model/resolved_colors.h"
+#include "model/row_hashes.h"
+
+enum class CursorShape {
+	None,
+	Block,
+	Vertical,
+	Horizontal
+};
+
+struct CursorModeInfo {
+	CursorShape shape;
+	uint16_t hl_attrib_id;
+};
+struct Cursor {
+	CursorModeInfo *mode_info;
+	// Screen position, follows the grid when the grid moves
+	int row;
+	int col;
+	int grid;
+	int grid_row;
+	int grid_col;
+};
+
+constexpr int MAX_CURSOR_MODE_INFOS = 64;
+
+// Everything nvim tells the UI about the screen contents, kept free of
+// any rendering state so it can be driven headlessly
+struct UIModel {
+	// The screen as composed from the grids in `compositor`
+	Grid grid;
+	Compositor compositor;
+	// Rows to draw at the next flush, marked by the RedrawApply functions
+	DirtyRows dirty_rows;
+	// What each row looked like when it was last flushed
+	RowHashes drawn_rows;
+	Vec<HighlightAttributes> hl_attribs;
+	// Which entries of `hl_attribs` look the same
+	HighlightSets hl_sets;
+	// The colors each entry of `hl_attribs` is drawn with
+	ResolvedColorTable hl_colors;
+	// The highlight runs of every screen row as of the last flush
+	HighlightRuns hl_runs;
+	// The screen rows each highlight was last drawn on
+	HighlightRows hl_rows;
+	CursorModeInfo cursor_mode_infos[MAX_CURSOR_MODE_INFOS];
+	Cursor cursor;
+	bool ui_busy;
+};
+
+inline void UIModelInitialize(UIModel *model) {
+	model->hl_attribs.resize(MAX_HIGHLIGHT_ATTRIBS);
+	HighlightSetsInitialize(&model->hl_sets, MAX_HIGHLIGHT_ATTRIBS);
+	ResolvedColorsInitialize(&model->hl_colors, MAX_HIGHLIGHT_ATTRIBS);
+}
+
+inline void UIModelShutdown(UIModel *model) {
+	GridFree(&model->grid);
+	CompositorFree(&model->compositor);
+	DirtyRowsFree(&model->dirty_rows);
+	RowHashesFree(&model->drawn_rows);
+	HighlightRunsFree(&model->hl_runs);
+	HighlightRowsFree(&model->hl_rows);
+	HighlightSetsFree(&model->hl_sets);
+}
+
+// Composes the dirty cells of the screen from the grids and splits those
+// rows into highlight runs, then calls `draw_row(row, span)` for the dirty
+// rows whose contents differ from what the last flush drew, returns the
+// number of rows drawn
+template<typename DrawRowFn>
+int UIModelFlushRows(UIModel *model, DrawRowFn &&draw_row) {
+	int rows_drawn = 0;
+	DirtyRowsFlush(&model->dirty_rows, [&](int row, DirtyRowSpan span) {
+		CompositorComposeSpan(&model->compositor, &model->grid, row, span.left, span.right);
+		HighlightRunsBuild(&model->hl_runs, &model->grid, row);
+		int run_count;
+		const HighlightRun *runs = HighlightRunsRow(&model->hl_runs, row, &run_count);
+		uint64_t hash = RowHash(&model->grid, &model->hl_attribs[0], runs, run_count, row);
+		if (RowHashesUpdate(&model->drawn_rows, row, hash)) {
+			HighlightRowsUpdate(&model->hl_rows, runs, run_count, row);
+			draw_row(row, span);
+			++rows_drawn;
+		}
+	});
+	return rows_drawn;
+}
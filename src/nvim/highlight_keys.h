@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "common/mpack_cursor.h"
+
+// The keys of an hl_attr_define attribute map that Nvy reads, every
+// other key is skipped. Keep in sync with HIGHLIGHT_KEY_NAMES.
+enum class HighlightKey : uint8_t {
+	foreground,
+	background,
+	special,
+	reverse,
+	italic,
+	bold,
+	strikethrough,
+	underline,
+	undercurl,
+	Unknown
+};
+constexpr size_t HIGHLIGHT_KEY_COUNT = static_cast<size_t>(HighlightKey::Unknown);
+
+constexpr const char *HIGHLIGHT_KEY_NAMES[] {
+	"foreground",
+	"background",
+	"special",
+	"reverse",
+	"italic",
+	"bold",
+	"strikethrough",
+	"underline",
+	"undercurl",
+};
+static_assert(sizeof(HIGHLIGHT_KEY_NAMES) / sizeof(HIGHLIGHT_KEY_NAMES[0]) == HIGHLIGHT_KEY_COUNT,
+	"HIGHLIGHT_KEY_NAMES is out of sync with HighlightKey");
+
+// Nine keys is few enough that a chain of compares beats hashing them: the
+// length test fails fast and rejects most keys without touching their
+// characters, and the compiler turns the constant sized compares into a
+// couple of loads each. Keys nvim sends that Nvy doesn't read (blend,
+// nocombine, underdouble, ...) resolve to Unknown.
+inline HighlightKey HighlightKeyLookup(const char *key, uint32_t length) {
+	for (size_t i = 0; i < HIGHLIGHT_KEY_COUNT; ++i) {
+		if (MPackStringEquals(key, length, HIGHLIGHT_KEY_NAMES[i])) {
+			return static_cast<HighlightKey>(i);
+		}
+	}
+	return HighlightKey::Unknown;
+}
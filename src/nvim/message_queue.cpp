@@ -0,0 +1,126 @@
+#include "message_queue.h"
+#include <cstring>
+#include <initializer_list>
+#include <thread>
+#include "common/clock.h"
+
+static void AtomicMax(std::atomic<uint64_t> *value, uint64_t candidate) {
+	uint64_t current = value->load(std::memory_order_relaxed);
+	while (candidate > current && !value->compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+}
+
+static void AtomicMax(std::atomic<int64_t> *value, int64_t candidate) {
+	int64_t current = value->load(std::memory_order_relaxed);
+	while (candidate > current && !value->compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+}
+
+static void Wake(NvimMessageQueue *queue) {
+	if (!queue->wake_pending.exchange(true, std::memory_order_seq_cst)) {
+		queue->stats.wakes.fetch_add(1, std::memory_order_relaxed);
+		queue->wake(queue->wake_context);
+	}
+}
+
+void NvimMessageQueueInitialize(NvimMessageQueue *queue, void *wake_context, NvimMessageQueueWakeFn wake) {
+	queue->head.store(0, std::memory_order_relaxed);
+	queue->tail.store(0, std::memory_order_relaxed);
+	queue->wake_pending.store(false, std::memory_order_relaxed);
+	queue->wake_context = wake_context;
+	queue->wake = wake;
+
+	NvimMessageQueueStats *stats = &queue->stats;
+	for (std::atomic<uint64_t> *counter : { &stats->messages_pushed, &stats->messages_popped, &stats->bytes_pushed,
+		&stats->wakes, &stats->depth_sum, &stats->depth_max, &stats->producer_waits }) {
+		counter->store(0, std::memory_order_relaxed);
+	}
+	for (std::atomic<int64_t> *counter : { &stats->producer_wait_ns, &stats->queued_ns_sum, &stats->queued_ns_max }) {
+		counter->store(0, std::memory_order_relaxed);
+	}
+
+	for (NvimMessageSlot &slot : queue->slots) {
+		ArenaInitialize(&slot.arena, NVIM_MESSAGE_QUEUE_INITIAL_SLOT_SIZE);
+		slot.kind = NvimMessageKind::Rpc;
+		slot.enqueue_time_ns = 0;
+	}
+}
+
+void NvimMessageQueueDestroy(NvimMessageQueue *queue) {
+	for (NvimMessageSlot &slot : queue->slots) {
+		ArenaFree(&slot.arena);
+	}
+}
+
+Arena *NvimMessageQueueBeginPush(NvimMessageQueue *queue) {
+	size_t tail = queue->tail.load(std::memory_order_relaxed);
+
+	// Wait for the consumer to free up a slot, make sure it is actually
+	// awake first, otherwise both sides could end up waiting on each other
+	if (tail - queue->head.load(std::memory_order_acquire) == NVIM_MESSAGE_QUEUE_CAPACITY) {
+		Wake(queue);
+		int64_t wait_start = ClockNanoseconds();
+		while (tail - queue->head.load(std::memory_order_acquire) == NVIM_MESSAGE_QUEUE_CAPACITY) {
+			std::this_thread::yield();
+		}
+		queue->stats.producer_waits.fetch_add(1, std::memory_order_relaxed);
+		queue->stats.producer_wait_ns.fetch_add(ClockNanoseconds() - wait_start, std::memory_order_relaxed);
+	}
+
+	NvimMessageSlot *slot = &queue->slots[tail & (NVIM_MESSAGE_QUEUE_CAPACITY - 1)];
+	ArenaResetTrim(&slot->arena, NVIM_MESSAGE_QUEUE_MAX_SLOT_SIZE, NVIM_MESSAGE_QUEUE_INITIAL_SLOT_SIZE);
+	return &slot->arena;
+}
+
+void NvimMessageQueueEndPush(NvimMessageQueue *queue, NvimMessageKind kind) {
+	size_t tail = queue->tail.load(std::memory_order_relaxed);
+	NvimMessageSlot *slot = &queue->slots[tail & (NVIM_MESSAGE_QUEUE_CAPACITY - 1)];
+	slot->kind = kind;
+	slot->enqueue_time_ns = ClockNanoseconds();
+	// Sequentially consistent together with the wake flag, see BeginDrain
+	queue->tail.store(tail + 1, std::memory_order_seq_cst);
+
+	uint64_t depth = tail + 1 - queue->head.load(std::memory_order_relaxed);
+	queue->stats.messages_pushed.fetch_add(1, std::memory_order_relaxed);
+	queue->stats.bytes_pushed.fetch_add(slot->arena.size, std::memory_order_relaxed);
+	queue->stats.depth_sum.fetch_add(depth, std::memory_order_relaxed);
+	AtomicMax(&queue->stats.depth_max, depth);
+}
+
+void NvimMessageQueuePush(NvimMessageQueue *queue, NvimMessageKind kind, const char *data, size_t size) {
+	Arena *arena = NvimMessageQueueBeginPush(queue);
+	memcpy(ArenaPush(arena, size), data, size);
+	NvimMessageQueueEndPush(queue, kind);
+}
+
+void NvimMessageQueueEndBatch(NvimMessageQueue *queue) {
+	Wake(queue);
+}
+
+size_t NvimMessageQueueBeginDrain(NvimMessageQueue *queue) {
+	// Clear the flag before looking at the queue. If the producer still saw
+	// the flag set after its push, the push is visible here, otherwise the
+	// producer will wake us again.
+	queue->wake_pending.store(false, std::memory_order_seq_cst);
+	return queue->tail.load(std::memory_order_seq_cst) - queue->head.load(std::memory_order_relaxed);
+}
+
+NvimQueuedMessage NvimMessageQueueFront(NvimMessageQueue *queue) {
+	size_t head = queue->head.load(std::memory_order_relaxed);
+	const NvimMessageSlot *slot = &queue->slots[head & (NVIM_MESSAGE_QUEUE_CAPACITY - 1)];
+	return NvimQueuedMessage {
+		.kind = slot->kind,
+		.data = reinterpret_cast<const char *>(slot->arena.data),
+		.size = slot->arena.size
+	};
+}
+
+void NvimMessageQueuePop(NvimMessageQueue *queue) {
+	size_t head = queue->head.load(std::memory_order_relaxed);
+	const NvimMessageSlot *slot = &queue->slots[head & (NVIM_MESSAGE_QUEUE_CAPACITY - 1)];
+
+	int64_t queued_ns = ClockNanoseconds() - slot->enqueue_time_ns;
+	queue->stats.messages_popped.fetch_add(1, std::memory_order_relaxed);
+	queue->stats.queued_ns_sum.fetch_add(queued_ns, std::memory_order_relaxed);
+	AtomicMax(&queue->stats.queued_ns_max, queued_ns);
+
+	queue->head.store(head + 1, std::memory_order_release);
+}
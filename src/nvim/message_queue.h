@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "common/arena.h"
+
+// Must be a power of two
+constexpr size_t NVIM_MESSAGE_QUEUE_CAPACITY = 256;
+constexpr size_t NVIM_MESSAGE_QUEUE_INITIAL_SLOT_SIZE = 4096;
+// Slots that grew past this for a large redraw batch are shrunk back when
+// reused, so the queue holds at most CAPACITY * MAX_SLOT_SIZE for long
+constexpr size_t NVIM_MESSAGE_QUEUE_MAX_SLOT_SIZE = 128 * 1024;
+
+// Wakes the consumer thread, ie: posts a window message to the UI thread
+using NvimMessageQueueWakeFn = void (*)(void *wake_context);
+
+enum class NvimMessageKind : uint8_t {
+	// A msgpack-rpc message as read from nvim
+	Rpc,
+	// A redraw notification, already decoded into a stream of RedrawOps
+	RedrawOps
+};
+
+struct NvimQueuedMessage {
+	NvimMessageKind kind;
+	const char *data;
+	size_t size;
+};
+
+// A message buffer owned by the queue. Slot arenas are reused once the
+// consumer is done with them, so steady state traffic doesn't allocate.
+struct NvimMessageSlot {
+	Arena arena;
+	NvimMessageKind kind;
+	int64_t enqueue_time_ns;
+};
+
+// Counters are updated with relaxed atomics so they can be read from
+// either thread at any time, they are diagnostics and not synchronization.
+struct NvimMessageQueueStats {
+	std::atomic<uint64_t> messages_pushed;
+	std::atomic<uint64_t> messages_popped;
+	std::atomic<uint64_t> bytes_pushed;
+	std::atomic<uint64_t> wakes;
+
+	// Depth of the queue sampled right after every push
+	std::atomic<uint64_t> depth_sum;
+	std::atomic<uint64_t> depth_max;
+
+	// Time the producer spent blocked on a full queue
+	std::atomic<uint64_t> producer_waits;
+	std::atomic<int64_t> producer_wait_ns;
+
+	// Time messages spent in the queue before the consumer picked them up
+	std::atomic<int64_t> queued_ns_sum;
+	std::atomic<int64_t> queued_ns_max;
+};
+
+// Single-producer/single-consumer ring between the thread reading from
+// nvim and the UI thread. The producer copies each framed message into a
+// slot and keeps reading, the consumer is only woken once per batch.
+struct NvimMessageQueue {
+	// Next slot to be consumed, only written by the consumer
+	alignas(64) std::atomic<size_t> head;
+	// Next slot to be filled, only written by the producer
+	alignas(64) std::atomic<size_t> tail;
+	// Set while a wake is in flight that the consumer hasn't picked up yet
+	alignas(64) std::atomic<bool> wake_pending;
+
+	void *wake_context;
+	NvimMessageQueueWakeFn wake;
+
+	NvimMessageSlot slots[NVIM_MESSAGE_QUEUE_CAPACITY];
+	NvimMessageQueueStats stats;
+};
+
+void NvimMessageQueueInitialize(NvimMessageQueue *queue, void *wake_context, NvimMessageQueueWakeFn wake);
+void NvimMessageQueueDestroy(NvimMessageQueue *queue);
+
+// Producer side. BeginPush blocks while the queue is full and returns the
+// empty arena of the next slot to be written into directly, EndPush then
+// publishes it. Push does both for a message that is already encoded.
+// EndBatch wakes the consumer unless a wake is still pending.
+Arena *NvimMessageQueueBeginPush(NvimMessageQueue *queue);
+void NvimMessageQueueEndPush(NvimMessageQueue *queue, NvimMessageKind kind);
+void NvimMessageQueuePush(NvimMessageQueue *queue, NvimMessageKind kind, const char *data, size_t size);
+void NvimMessageQueueEndBatch(NvimMessageQueue *queue);
+
+// Consumer side. BeginDrain acknowledges the wake and returns the number of
+// messages available, each of which is then read with Front and released
+// with Pop. Messages pushed during the drain will trigger another wake.
+size_t NvimMessageQueueBeginDrain(NvimMessageQueue *queue);
+NvimQueuedMessage NvimMessageQueueFront(NvimMessageQueue *queue);
+void NvimMessageQueuePop(NvimMessageQueue *queue);
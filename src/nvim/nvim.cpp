@@ -1,47 +1,62 @@
 #include "nvim.h"
 #include "common/mpack_helper.h"
+#include "nvim/redraw.h"
 #include "third_party/mpack/mpack.h"
 
-constexpr int Megabytes(int n) {
-    return 1024 * 1024 * n;
-}
-
-int64_t RegisterRequest(Nvim *nvim, NvimRequest request) {
-	nvim->msg_id_to_method.push_back(request);
-	return nvim->next_msg_id++;
-}
-
-static size_t ReadFromNvim(mpack_tree_t *tree, char *buffer, size_t count) {
-	HANDLE nvim_stdout_read = mpack_tree_context(tree);
-	DWORD bytes_read;
-	BOOL success = ReadFile(nvim_stdout_read, buffer, static_cast<DWORD>(count), &bytes_read, nullptr);
-	if (!success) {
-		mpack_tree_flag_error(tree, mpack_error_io);
-	}
-	return bytes_read;
+static void WakeUIThread(void *wake_context) {
+	HWND hwnd = static_cast<HWND>(wake_context);
+	PostMessage(hwnd, WM_NVIM_MESSAGE, 0, 0);
 }
 
 DWORD WINAPI NvimMessageHandler(LPVOID param) {
 	Nvim *nvim = static_cast<Nvim *>(param);
-	mpack_tree_t *tree = static_cast<mpack_tree_t *>(malloc(sizeof(mpack_tree_t)));
-	mpack_tree_init_stream(tree, ReadFromNvim, nvim->stdout_read, Megabytes(20), 1'048'576);
 
-	while (true) {
-		mpack_tree_parse(tree);
-		if (mpack_tree_error(tree) != mpack_ok) {
-			break;
+	// Keep draining nvim's stdout into the queue while the UI thread is busy
+	// drawing, the UI thread is only woken once everything read so far is queued.
+	// Redraw notifications are decoded into ops right here, off the UI thread.
+	const char *data;
+	size_t size;
+	while (NvimRpcReaderNext(&nvim->reader, &data, &size)) {
+		bool flushed = false;
+		MPackCursor redraw_params;
+		if (RedrawParseNotification(data, size, &redraw_params)) {
+			Arena *arena = NvimMessageQueueBeginPush(&nvim->queue);
+			flushed = RedrawEncodeOps(arena, redraw_params, &nvim->redraw_event_stats);
+			NvimMessageQueueEndPush(&nvim->queue, NvimMessageKind::RedrawOps);
+		}
+		else {
+			NvimMessageQueuePush(&nvim->queue, NvimMessageKind::Rpc, data, size);
+		}
+		if (nvim->recording.file) {
+			RecordingWriterAppend(&nvim->recording, data, size, flushed ? RECORDING_MESSAGE_ENDS_FRAME : 0);
+		}
+		if (!NvimRpcReaderHasMessage(&nvim->reader)) {
+			NvimMessageQueueEndBatch(&nvim->queue);
 		}
-
-		// Blocking, dubious thread safety. Seems to work though...
-		SendMessage(nvim->hwnd, WM_NVIM_MESSAGE, reinterpret_cast<WPARAM>(tree), 0);
 	}
 
-	mpack_tree_destroy(tree);
-	free(tree);
+	NvimRpcReaderDestroy(&nvim->reader);
+	RecordingWriterClose(&nvim->recording);
 	PostMessage(nvim->hwnd, WM_DESTROY, 0, 0);
 	return 0;
 }
 
+// Blocks until the next message from nvim has been read and parses it into `tree`,
+// only used for the handful of messages exchanged in sync during startup
+static bool ReadMessageSync(Nvim *nvim, mpack_tree_t *tree) {
+	const char *data;
+	size_t size;
+	if (!NvimRpcReaderNext(&nvim->reader, &data, &size)) {
+		return false;
+	}
+	if (nvim->recording.file) {
+		RecordingWriterAppend(&nvim->recording, data, size, 0);
+	}
+	mpack_tree_init_data(tree, data, size);
+	mpack_tree_parse(tree);
+	return mpack_tree_error(tree) == mpack_ok;
+}
+
 DWORD WINAPI NvimProcessMonitor(LPVOID param) {
 	Nvim *nvim = static_cast<Nvim *>(param);
 	while (true) {
@@ -58,8 +73,7 @@ DWORD WINAPI NvimProcessMonitor(LPVOID param) {
 	return 0;
 }
 
-void NvimInitialize(Nvim *nvim, wchar_t *command_line, HWND hwnd) {
-	nvim->hwnd = hwnd;
+static bool SpawnNvim(Nvim *nvim, wchar_t *command_line) {
 
 	HANDLE job_object = CreateJobObjectW(nullptr, nullptr);
 	JOBOBJECT_EXTENDED_LIMIT_INFORMATION job_info {
@@ -73,10 +87,14 @@ void NvimInitialize(Nvim *nvim, wchar_t *command_line, HWND hwnd) {
 		.nLength = sizeof(SECURITY_ATTRIBUTES),
 		.bInheritHandle = true
 	};
-	HANDLE stdin_read, stdout_write, stderr_write;
-	CreatePipe(&stdin_read, &nvim->stdin_write, &sec_attribs, 0);
-	CreatePipe(&nvim->stdout_read, &stdout_write, &sec_attribs, 0);
+	HANDLE stdin_read, stdin_write, stdout_read, stdout_write, stderr_write;
+	CreatePipe(&stdin_read, &stdin_write, &sec_attribs, NVIM_TRANSPORT_BUFFER_SIZE);
+	CreatePipe(&stdout_read, &stdout_write, &sec_attribs, NVIM_TRANSPORT_BUFFER_SIZE);
 	CreatePipe(&nvim->stderr_read, &stderr_write, &sec_attribs, 0);
+	// Only the child's ends of the pipes are to be inherited
+	SetHandleInformation(stdin_write, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(stdout_read, HANDLE_FLAG_INHERIT, 0);
+	NvimTransportInitializePipes(&nvim->transport, stdout_read, stdin_write);
 
 	STARTUPINFO startup_info {
 		.cb = sizeof(STARTUPINFO),
@@ -87,7 +105,7 @@ void NvimInitialize(Nvim *nvim, wchar_t *command_line, HWND hwnd) {
 	};
 
 	// wchar_t command_line[] = L"nvim --embed";
-	CreateProcessW(
+	BOOL created = CreateProcessW(
 		nullptr,
 		command_line,
 		nullptr,
@@ -107,118 +125,136 @@ void NvimInitialize(Nvim *nvim, wchar_t *command_line, HWND hwnd) {
 	CloseHandle(stderr_write);
 	CloseHandle(nvim->process_info.hThread);
 
+	if (!created) {
+		return false;
+	}
+
 	// Start process monitor thread
 	DWORD _;
-	CreateThread( nullptr, 0, NvimProcessMonitor, nvim, 0, &_);
-
-	// Do the initial messages with nvim in sync
-	mpack_tree_t *tree_reader = static_cast<mpack_tree_t *>(malloc(sizeof(mpack_tree_t)));
-	mpack_tree_init_stream(tree_reader, ReadFromNvim, nvim->stdout_read, Megabytes(20), 1'048'576);
+	CreateThread(nullptr, 0, NvimProcessMonitor, nvim, 0, &_);
+	return true;
+}
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
+// Do the initial messages with nvim in sync
+static bool Handshake(Nvim *nvim) {
+	mpack_tree_t tree;
 
 	// Query api info
-	MPackStartRequest(RegisterRequest(nvim, vim_get_api_info), NVIM_REQUEST_NAMES[vim_get_api_info], &writer);
-	mpack_start_array(&writer, 0);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	if (!MPackSendData(nvim->stdin_write, data, size)) {
-		return;
+	if (!NvimRpcGetApiInfo(&nvim->rpc)) {
+		return false;
 	}
-	mpack_tree_parse(tree_reader);
-	if (mpack_tree_error(tree_reader)) {
-		return;
+	if (!ReadMessageSync(nvim, &tree)) {
+		mpack_tree_destroy(&tree);
+		return false;
 	}
-	MPackMessageResult result = MPackExtractMessageResult(tree_reader);
+	MPackMessageResult result = MPackExtractMessageResult(&tree);
 	if (result.type == MPackMessageType::Response){
 		mpack_node_t top_level_map = mpack_node_array_at(result.params, 1);
 		mpack_node_t version_map = mpack_node_map_value_at(top_level_map, 0);
 		int64_t api_level = mpack_node_map_cstr(version_map, "api_level").data->value.i;
 		assert(api_level > 6);
 	}
+	mpack_tree_destroy(&tree);
 
 	// Set g:nvy global variable
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_set_var], &writer);
-	mpack_start_array(&writer, 2);
-	mpack_write_cstr(&writer, "nvy");
-	mpack_write_int(&writer, 1);
-	mpack_finish_array(&writer);
-	size = MPackFinishMessage(&writer);
-	if (!MPackSendData(nvim->stdin_write, data, size)) {
-		return;
+	if (!NvimRpcSetVar(&nvim->rpc, "nvy", 1)) {
+		return false;
+	}
+
+	// A server is long past VimEnter, the UI thread
+	// finishes setting up as soon as it has attached
+	if (nvim->attached_to_server) {
+		return true;
 	}
 
 	// Setup neovim to send a blocking request so we can finalize seting up before
 	// buffer
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, "autocmd VimEnter * call rpcrequest(1, 'vimenter')");
-	mpack_finish_array(&writer);
-	size = MPackFinishMessage(&writer);
-	if (!MPackSendData(nvim->stdin_write, data, size)) {
-		return;
+	if (!NvimRpcCommand(&nvim->rpc, "autocmd VimEnter * call rpcrequest(1, 'vimenter')")) {
+		return false;
 	}
-	mpack_tree_parse(tree_reader);
-	if (mpack_tree_error(tree_reader)) {
-		return;
+	// Wait for the result just in case...
+	bool command_result = ReadMessageSync(nvim, &tree);
+	mpack_tree_destroy(&tree);
+	return command_result;
+}
+
+bool NvimInitialize(Nvim *nvim, wchar_t *command_line, const char *server_address, HWND hwnd, FILE *record_file) {
+	nvim->hwnd = hwnd;
+	nvim->attached_to_server = server_address != nullptr;
+	if (nvim->attached_to_server) {
+		if (!NvimTransportConnect(&nvim->transport, server_address)) {
+			return false;
+		}
+	}
+	else if (!SpawnNvim(nvim, command_line)) {
+		return false;
 	}
-	result = MPackExtractMessageResult(tree_reader); // get the result just in case...
 
-	mpack_tree_destroy(tree_reader);
-	free(tree_reader);
+	if (record_file) {
+		RecordingWriterInitialize(&nvim->recording, record_file);
+	}
+	NvimRpcInitialize(&nvim->rpc, &nvim->transport, NvimTransportWrite);
+	NvimRpcReaderInitialize(&nvim->reader, &nvim->transport, NvimTransportRead);
+	NvimMessageQueueInitialize(&nvim->queue, hwnd, WakeUIThread);
+
+	if (!Handshake(nvim)) {
+		// A child that exited is reported by the process monitor,
+		// a server that went away has nothing to report it
+		return !nvim->attached_to_server;
+	}
 
-	CreateThread(nullptr, 0, NvimMessageHandler, nvim, 0, &_);
+	DWORD _;
+	nvim->reader_thread = CreateThread(nullptr, 0, NvimMessageHandler, nvim, 0, &_);
+	return true;
 }
 
 void NvimShutdown(Nvim *nvim) {
-	DWORD exit_code;
-	GetExitCodeProcess(nvim->process_info.hProcess, &exit_code);
-
-	if(exit_code == STILL_ACTIVE) {
-		CloseHandle(nvim->stdin_write);
-		CloseHandle(nvim->stdout_read);
-		CloseHandle(nvim->stderr_read);
-		TerminateProcess(nvim->process_info.hProcess, 0);
-		CloseHandle(nvim->process_info.hProcess);
-		CloseHandle(nvim->process_info.hThread);
+	if (nvim->attached_to_server) {
+		// Leave the server running for other clients
+		NvimTransportClose(&nvim->transport);
+	}
+	else {
+		DWORD exit_code;
+		GetExitCodeProcess(nvim->process_info.hProcess, &exit_code);
+
+		if(exit_code == STILL_ACTIVE) {
+			NvimTransportClose(&nvim->transport);
+			CloseHandle(nvim->stderr_read);
+			TerminateProcess(nvim->process_info.hProcess, 0);
+			CloseHandle(nvim->process_info.hProcess);
+			CloseHandle(nvim->process_info.hThread);
+		}
 	}
+
+	// With nvim gone the reader thread stops pushing into the queue. It may
+	// still be waiting on a full queue nobody drains anymore, in which case
+	// the queue is left to the process exit rather than freed under it.
+	constexpr DWORD READER_EXIT_TIMEOUT_MS = 1000;
+	bool reader_stopped = !nvim->reader_thread ||
+		WaitForSingleObject(nvim->reader_thread, READER_EXIT_TIMEOUT_MS) == WAIT_OBJECT_0;
+	if (nvim->reader_thread) {
+		CloseHandle(nvim->reader_thread);
+		nvim->reader_thread = nullptr;
+	}
+	if (reader_stopped) {
+		NvimMessageQueueDestroy(&nvim->queue);
+	}
+}
+
+void NvimBeginBatch(Nvim *nvim) {
+	NvimRpcBeginBatch(&nvim->rpc);
+}
+
+void NvimFlush(Nvim *nvim) {
+	NvimRpcFlush(&nvim->rpc);
 }
 
 void NvimSendUIAttach(Nvim *nvim, int grid_rows, int grid_cols) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-
-	// Send UI attach notification
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_ui_attach], &writer);
-	mpack_start_array(&writer, 3);
-	mpack_write_int(&writer, grid_cols);
-	mpack_write_int(&writer, grid_rows);
-	mpack_start_map(&writer, 1);
-	mpack_write_cstr(&writer, "ext_linegrid");
-	mpack_write_true(&writer);
-	mpack_finish_map(&writer);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcUIAttach(&nvim->rpc, grid_rows, grid_cols);
 }
 
 void NvimSendResize(Nvim *nvim, int grid_rows, int grid_cols) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-
-	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_ui_try_resize], &writer);
-	mpack_start_array(&writer, 2);
-	mpack_write_int(&writer, grid_cols);
-	mpack_write_int(&writer, grid_rows);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcUITryResize(&nvim->rpc, grid_rows, grid_cols);
 }
 
 void NvimSendModifiedInput(Nvim *nvim, const char *input) {
@@ -232,15 +268,7 @@ void NvimSendModifiedInput(Nvim *nvim, const char *input) {
 	snprintf(input_string, MAX_INPUT_STRING_SIZE, "<%s%s%s%s>", ctrl_down ? "C-" : "", 
 			shift_down ? "S-" : "", alt_down ? "M-" : "", input);
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_input), NVIM_REQUEST_NAMES[nvim_input], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, input_string);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcInput(&nvim->rpc, input_string);
 }
 
 void NvimSendChar(Nvim *nvim, wchar_t input_char) {
@@ -257,15 +285,7 @@ void NvimSendChar(Nvim *nvim, wchar_t input_char) {
 	}
 	WideCharToMultiByte(CP_UTF8, 0, &input_char, 1, utf8_encoded, 64, NULL, NULL);
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_input), NVIM_REQUEST_NAMES[nvim_input], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, utf8_encoded);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcInput(&nvim->rpc, utf8_encoded);
 }
 
 void NvimSendSysChar(Nvim *nvim, wchar_t input_char) {
@@ -279,60 +299,48 @@ void NvimSendSysChar(Nvim *nvim, wchar_t input_char) {
 }
 
 void NvimSendInput(Nvim *nvim, const char *input_chars) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-
-	MPackStartRequest(RegisterRequest(nvim, nvim_input), NVIM_REQUEST_NAMES[nvim_input], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, input_chars);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcInput(&nvim->rpc, input_chars);
 }
 
-void NvimSendMouseInput(Nvim *nvim, MouseButton button, MouseAction action, int mouse_row, int mouse_col) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_input_mouse), NVIM_REQUEST_NAMES[nvim_input_mouse], &writer);
-	mpack_start_array(&writer, 6);
-
+void NvimSendMouseInput(Nvim *nvim, MouseButton button, MouseAction action, int grid, int mouse_row, int mouse_col) {
+	const char *button_str = "";
 	switch (button) {
 	case MouseButton::Left: {
-		mpack_write_cstr(&writer, "left");
+		button_str = "left";
 	} break;
 	case MouseButton::Right: {
-		mpack_write_cstr(&writer, "right");
+		button_str = "right";
 	} break;
 	case MouseButton::Middle: {
-		mpack_write_cstr(&writer, "middle");
+		button_str = "middle";
 	} break;
 	case MouseButton::Wheel: {
-		mpack_write_cstr(&writer, "wheel");
+		button_str = "wheel";
 	} break;
 	}
+
+	const char *action_str = "";
 	switch (action) {
 	case MouseAction::Press: {
-		mpack_write_cstr(&writer, "press");
+		action_str = "press";
 	} break;
 	case MouseAction::Drag: {
-		mpack_write_cstr(&writer, "drag");
+		action_str = "drag";
 	} break;
 	case MouseAction::Release: {
-		mpack_write_cstr(&writer, "release");
+		action_str = "release";
 	} break;
 	case MouseAction::MouseWheelUp: {
-		mpack_write_cstr(&writer, "up");
+		action_str = "up";
 	} break;
 	case MouseAction::MouseWheelDown: {
-		mpack_write_cstr(&writer, "down");
+		action_str = "down";
 	} break;
 	case MouseAction::MouseWheelLeft: {
-		mpack_write_cstr(&writer, "left");
+		action_str = "left";
 	} break;
 	case MouseAction::MouseWheelRight: {
-		mpack_write_cstr(&writer, "right");
+		action_str = "right";
 	} break;
 	}
 
@@ -342,15 +350,8 @@ void NvimSendMouseInput(Nvim *nvim, MouseButton button, MouseAction action, int
 	constexpr int MAX_INPUT_STRING_SIZE = 64;
 	char input_string[MAX_INPUT_STRING_SIZE];
 	snprintf(input_string, MAX_INPUT_STRING_SIZE, "%s%s%s", ctrl_down ? "C-" : "", shift_down ? "S-" : "", alt_down ? "M-" : "");
-	mpack_write_cstr(&writer, input_string);
-
-	mpack_write_i64(&writer, 0);
-	mpack_write_i64(&writer, mouse_row);
-	mpack_write_i64(&writer, mouse_col);
-	mpack_finish_array(&writer);
 
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcInputMouse(&nvim->rpc, button_str, action_str, input_string, grid, mouse_row, mouse_col);
 }
 
 bool NvimProcessKeyDown(Nvim *nvim, int virtual_key) {
@@ -527,17 +528,7 @@ bool NvimProcessKeyDown(Nvim *nvim, int virtual_key) {
 }
 
 void NvimGetOptionValue(Nvim *nvim, const char *option) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_get_option_value), NVIM_REQUEST_NAMES[nvim_get_option_value], &writer);
-	mpack_start_array(&writer, 2);
-	mpack_write_cstr(&writer, option);
-	mpack_start_map(&writer, 0);
-	mpack_finish_map(&writer);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcGetOptionValue(&nvim->rpc, option);
 }
 
 void NvimParseOptionValueStr(Nvim *nvim, mpack_node_t value_node, Vec<char> *value_out) {
@@ -552,29 +543,11 @@ void NvimParseOptionValueStr(Nvim *nvim, mpack_node_t value_node, Vec<char> *val
 }
 
 void NvimSendCommand(Nvim *nvim, const char *command) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, command);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcCommand(&nvim->rpc, command);
 }
 
 void NvimSendResponse(Nvim *nvim, int64_t req_id) {
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-
-	mpack_start_array(&writer, 4);
-	mpack_write_i64(&writer, 1);
-	mpack_write_i64(&writer, req_id);
-	mpack_write_nil(&writer);
-	mpack_write_int(&writer, 0);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcResponse(&nvim->rpc, req_id);
 }
 
 void NvimOpenFile(Nvim *nvim, const wchar_t *file_name, bool open_new_buffer) {
@@ -590,55 +563,31 @@ void NvimOpenFile(Nvim *nvim, const wchar_t *file_name, bool open_new_buffer) {
 	}
 	strcat_s(file_command, MAX_PATH, utf8_encoded);
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, file_command);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcCommand(&nvim->rpc, file_command);
 }
 
 void NvimSetFocus(Nvim *nvim) {
 	const char *set_focus_command = "doautocmd <nomodeline> FocusGained";
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, set_focus_command);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcCommand(&nvim->rpc, set_focus_command);
 }
 
 void NvimKillFocus(Nvim *nvim) {
 	const char *set_focus_command = "doautocmd <nomodeline> FocusLost";
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, set_focus_command);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcCommand(&nvim->rpc, set_focus_command);
 }
 void NvimQuit(Nvim *nvim)
 {
+	// Detach from a server rather than quitting it, the reader thread
+	// sees the connection close and tears down the window as usual
+	if (nvim->attached_to_server) {
+		NvimRpcFlush(&nvim->rpc);
+		NvimTransportShutdown(&nvim->transport);
+		return;
+	}
+
 	const char *quit_command = "qa";
 
-	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
-	mpack_writer_t writer;
-	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
-	MPackStartRequest(RegisterRequest(nvim, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
-	mpack_start_array(&writer, 1);
-	mpack_write_cstr(&writer, quit_command);
-	mpack_finish_array(&writer);
-	size_t size = MPackFinishMessage(&writer);
-	MPackSendData(nvim->stdin_write, data, size);
+	NvimRpcCommand(&nvim->rpc, quit_command);
 }
@@ -1,29 +1,10 @@
 #pragma once
+#include "nvim/message_queue.h"
+#include "nvim/recording.h"
+#include "nvim/redraw_events.h"
+#include "nvim/rpc.h"
+#include "nvim/transport.h"
 
-enum NvimRequest : uint8_t {
-	vim_get_api_info = 0,
-	nvim_input = 1,
-	nvim_input_mouse = 2,
-	nvim_command = 3,
-	nvim_get_option_value = 4
-};
-constexpr const char *NVIM_REQUEST_NAMES[] {
-	"nvim_get_api_info",
-	"nvim_input",
-	"nvim_input_mouse",
-	"nvim_command",
-	"nvim_get_option_value"
-};
-enum NvimOutboundNotification : uint8_t {
-	nvim_ui_attach = 0,
-	nvim_ui_try_resize = 1,
-	nvim_set_var = 2
-};
-constexpr const char *NVIM_OUTBOUND_NOTIFICATION_NAMES[] {
-	"nvim_ui_attach",
-	"nvim_ui_try_resize",
-	"nvim_set_var"
-};
 enum class MouseButton {
 	Left,
 	Right,
@@ -39,33 +20,49 @@ enum class MouseAction {
 	MouseWheelLeft,
 	MouseWheelRight
 };
-constexpr int MAX_MPACK_OUTBOUND_MESSAGE_SIZE = 4096;
-
 struct Nvim {
-	int64_t next_msg_id;
-	Vec<NvimRequest> msg_id_to_method;
+	NvimRpc rpc;
+	NvimRpcReader reader;
+	NvimMessageQueue queue;
+	// Only touched by the reader thread
+	RedrawEventStats redraw_event_stats;
+	// Only recording if `recording.file` is set, see --record=
+	RecordingWriter recording;
 
 	HWND hwnd;
-	HANDLE stdin_write;
-	HANDLE stdout_read;
+	NvimTransport transport;
+	// Runs NvimMessageHandler, the only producer of `queue`
+	HANDLE reader_thread;
+	// Attached to an `nvim --listen` server with --server= instead of a child
+	bool attached_to_server;
 	HANDLE stderr_read;
 	PROCESS_INFORMATION process_info;
 	DWORD exit_code;
 };
 
-void NvimInitialize(Nvim *nvim, wchar_t *command_line, HWND hwnd);
+// Spawns `command_line` as an embedded nvim, or if `server_address` is set
+// attaches to a running server instead. Returns false if nvim couldn't be
+// reached. `record_file` may be null, otherwise everything nvim sends is
+// recorded to it.
+bool NvimInitialize(Nvim *nvim, wchar_t *command_line, const char *server_address, HWND hwnd, FILE *record_file);
 void NvimShutdown(Nvim *nvim);
 
 void NvimGetOptionValue(Nvim *nvim, const char *option);
 void NvimParseOptionValueStr(Nvim *nvim, mpack_node_t value_node, Vec<char> *value_out);
 
+// Everything sent to nvim in between goes out with a single write,
+// see NvimRpcBeginBatch
+void NvimBeginBatch(Nvim *nvim);
+void NvimFlush(Nvim *nvim);
+
 void NvimSendCommand(Nvim *nvim, const char *command);
 void NvimSendUIAttach(Nvim *nvim, int grid_rows, int grid_cols);
 void NvimSendResize(Nvim *nvim, int grid_rows, int grid_cols);
 void NvimSendChar(Nvim *nvim, wchar_t input_char);
 void NvimSendSysChar(Nvim *nvim, wchar_t sys_char);
 void NvimSendInput(Nvim *nvim, const char* input_chars);
-void NvimSendMouseInput(Nvim *nvim, MouseButton button, MouseAction action, int mouse_row, int mouse_col);
+// `grid` is the grid under the mouse and the position relative to it, 0 for the screen
+void NvimSendMouseInput(Nvim *nvim, MouseButton button, MouseAction action, int grid, int mouse_row, int mouse_col);
 void NvimSendResponse(Nvim *nvim, int64_t req_id);
 bool NvimProcessKeyDown(Nvim *nvim, int virtual_key);
 void NvimOpenFile(Nvim *nvim, const wchar_t *file_name, bool open_new_buffer = false);
@@ -0,0 +1,189 @@
+#include "recording.h"
+#include <cstdlib>
+#include <cstring>
+#include "common/clock.h"
+
+static uint64_t AlignRecordSize(uint64_t size) {
+	return (size + RECORDING_ALIGNMENT - 1) & ~(RECORDING_ALIGNMENT - 1);
+}
+
+void RecordingWriterInitialize(RecordingWriter *writer, FILE *file) {
+	writer->file = file;
+	writer->start_time_ns = ClockNanoseconds();
+	writer->frame_message_count = 0;
+
+	RecordingFileHeader header {};
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	header.index_offset = 0;
+	fwrite(&header, sizeof(header), 1, file);
+	writer->offset = sizeof(header);
+	writer->frame_begin_offset = writer->offset;
+}
+
+void RecordingWriterAppend(RecordingWriter *writer, const char *data, size_t size, uint32_t flags) {
+	RecordingMessageHeader header {
+		.time_ns = ClockNanoseconds() - writer->start_time_ns,
+		.size = static_cast<uint32_t>(size),
+		.flags = flags
+	};
+	fwrite(&header, sizeof(header), 1, writer->file);
+	fwrite(data, 1, size, writer->file);
+
+	constexpr char PADDING[RECORDING_ALIGNMENT] {};
+	uint64_t record_size = AlignRecordSize(sizeof(header) + size);
+	fwrite(PADDING, 1, record_size - sizeof(header) - size, writer->file);
+	writer->offset += record_size;
+
+	++writer->frame_message_count;
+	if (flags & RECORDING_MESSAGE_ENDS_FRAME) {
+		writer->frames.push_back(RecordingFrame {
+			.begin_offset = writer->frame_begin_offset,
+			.end_offset = writer->offset,
+			.time_ns = header.time_ns,
+			.message_count = writer->frame_message_count,
+			.reserved = 0
+		});
+		writer->frame_begin_offset = writer->offset;
+		writer->frame_message_count = 0;
+	}
+}
+
+void RecordingWriterClose(RecordingWriter *writer) {
+	if (writer->file == nullptr) {
+		return;
+	}
+
+	// Messages after the last flush still make up a frame of their own
+	if (writer->frame_message_count > 0) {
+		writer->frames.push_back(RecordingFrame {
+			.begin_offset = writer->frame_begin_offset,
+			.end_offset = writer->offset,
+			.time_ns = ClockNanoseconds() - writer->start_time_ns,
+			.message_count = writer->frame_message_count,
+			.reserved = 0
+		});
+	}
+
+	RecordingIndexHeader index_header {
+		.frame_count = writer->frames.size()
+	};
+	fwrite(&index_header, sizeof(index_header), 1, writer->file);
+	fwrite(writer->frames.data(), sizeof(RecordingFrame), writer->frames.size(), writer->file);
+
+	// Only point the header at the index once it is complete
+	fflush(writer->file);
+	fseek(writer->file, offsetof(RecordingFileHeader, index_offset), SEEK_SET);
+	fwrite(&writer->offset, sizeof(writer->offset), 1, writer->file);
+	fclose(writer->file);
+	writer->file = nullptr;
+}
+
+bool RecordingReadMessage(const Recording *recording, uint64_t *offset, RecordedMessage *message) {
+	if (*offset + sizeof(RecordingMessageHeader) > recording->records_end) {
+		return false;
+	}
+
+	RecordingMessageHeader header;
+	memcpy(&header, recording->file.data + *offset, sizeof(header));
+	uint64_t record_size = AlignRecordSize(sizeof(header) + header.size);
+	if (*offset + sizeof(header) + header.size > recording->records_end) {
+		return false;
+	}
+
+	*message = RecordedMessage {
+		.time_ns = header.time_ns,
+		.flags = header.flags,
+		.data = reinterpret_cast<const char *>(recording->file.data + *offset + sizeof(header)),
+		.size = header.size
+	};
+	*offset += record_size;
+	return true;
+}
+
+static void AppendRebuiltFrame(Recording *recording, uint64_t *frame_capacity, RecordingFrame frame) {
+	if (recording->frame_count == *frame_capacity) {
+		*frame_capacity *= 2;
+		recording->rebuilt_frames = static_cast<RecordingFrame *>(
+			realloc(recording->rebuilt_frames, *frame_capacity * sizeof(RecordingFrame)));
+	}
+	recording->rebuilt_frames[recording->frame_count++] = frame;
+}
+
+static void RebuildIndex(Recording *recording) {
+	uint64_t frame_capacity = 1024;
+	recording->rebuilt_frames = static_cast<RecordingFrame *>(malloc(frame_capacity * sizeof(RecordingFrame)));
+
+	uint64_t offset = sizeof(RecordingFileHeader);
+	RecordingFrame frame {
+		.begin_offset = offset,
+		.end_offset = offset,
+		.time_ns = 0,
+		.message_count = 0,
+		.reserved = 0
+	};
+	RecordedMessage message;
+	while (RecordingReadMessage(recording, &offset, &message)) {
+		frame.end_offset = offset;
+		frame.time_ns = message.time_ns;
+		++frame.message_count;
+		if (message.flags & RECORDING_MESSAGE_ENDS_FRAME) {
+			AppendRebuiltFrame(recording, &frame_capacity, frame);
+			frame = RecordingFrame {
+				.begin_offset = offset,
+				.end_offset = offset,
+				.time_ns = 0,
+				.message_count = 0,
+				.reserved = 0
+			};
+		}
+	}
+	if (frame.message_count > 0) {
+		AppendRebuiltFrame(recording, &frame_capacity, frame);
+	}
+
+	recording->frames = recording->rebuilt_frames;
+}
+
+bool RecordingOpen(Recording *recording, const char *path) {
+	*recording = Recording {};
+	if (!MappedFileOpen(&recording->file, path)) {
+		return false;
+	}
+
+	RecordingFileHeader header;
+	if (recording->file.size < sizeof(header)) {
+		RecordingClose(recording);
+		return false;
+	}
+	memcpy(&header, recording->file.data, sizeof(header));
+	if (memcmp(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0) {
+		RecordingClose(recording);
+		return false;
+	}
+
+	uint64_t index_offset = header.index_offset;
+	if (index_offset != 0 && index_offset + sizeof(RecordingIndexHeader) <= recording->file.size) {
+		RecordingIndexHeader index_header;
+		memcpy(&index_header, recording->file.data + index_offset, sizeof(index_header));
+		uint64_t frames_offset = index_offset + sizeof(index_header);
+		if (frames_offset + index_header.frame_count * sizeof(RecordingFrame) <= recording->file.size) {
+			recording->records_end = index_offset;
+			recording->frames = reinterpret_cast<const RecordingFrame *>(recording->file.data + frames_offset);
+			recording->frame_count = index_header.frame_count;
+			return true;
+		}
+	}
+
+	// The recording wasn't closed properly, walk the records instead
+	recording->records_end = recording->file.size;
+	RebuildIndex(recording);
+	return true;
+}
+
+void RecordingClose(Recording *recording) {
+	MappedFileClose(&recording->file);
+	free(recording->rebuilt_frames);
+	recording->rebuilt_frames = nullptr;
+	recording->frames = nullptr;
+	recording->frame_count = 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "common/mapped_file.h"
+#include "common/vec.h"
+
+// A recording of the inbound nvim RPC stream, one record per message as
+// framed by the reader, each stamped with the time it arrived. Frames are
+// the runs of messages up to and including a redraw batch ending in a
+// flush. An index of all frames is appended once the recording is closed,
+// so a single frame can be located without walking the records. If the
+// index is missing (ie: Nvy was killed) it is rebuilt when opening.
+//
+// [RecordingFileHeader]
+// [RecordingMessageHeader, message bytes padded to 8]...
+// [RecordingIndexHeader, RecordingFrame...]
+constexpr char RECORDING_MAGIC[8] { 'N', 'V', 'Y', 'R', 'E', 'C', '0', '1' };
+constexpr size_t RECORDING_ALIGNMENT = 8;
+
+struct RecordingFileHeader {
+	char magic[8];
+	// 0 until the index has been written
+	uint64_t index_offset;
+};
+
+enum RecordingMessageFlags : uint32_t {
+	RECORDING_MESSAGE_ENDS_FRAME = 1 << 0
+};
+
+struct RecordingMessageHeader {
+	// Relative to the start of the recording
+	int64_t time_ns;
+	uint32_t size;
+	uint32_t flags;
+};
+
+struct RecordingIndexHeader {
+	uint64_t frame_count;
+};
+
+struct RecordingFrame {
+	// File offsets of the first message record and one past the last
+	uint64_t begin_offset;
+	uint64_t end_offset;
+	// Arrival time of the message ending the frame
+	int64_t time_ns;
+	uint32_t message_count;
+	uint32_t reserved;
+};
+
+struct RecordingWriter {
+	FILE *file;
+	uint64_t offset;
+	int64_t start_time_ns;
+
+	uint64_t frame_begin_offset;
+	uint32_t frame_message_count;
+	Vec<RecordingFrame> frames;
+};
+
+// Takes ownership of a file opened for binary writing
+void RecordingWriterInitialize(RecordingWriter *writer, FILE *file);
+void RecordingWriterAppend(RecordingWriter *writer, const char *data, size_t size, uint32_t flags);
+// Writes the frame index and closes the file
+void RecordingWriterClose(RecordingWriter *writer);
+
+struct RecordedMessage {
+	int64_t time_ns;
+	uint32_t flags;
+	const char *data;
+	uint32_t size;
+};
+
+struct Recording {
+	MappedFile file;
+	uint64_t records_end;
+	// Points into the mapped file, or to a rebuilt index
+	const RecordingFrame *frames;
+	uint64_t frame_count;
+	RecordingFrame *rebuilt_frames;
+};
+
+bool RecordingOpen(Recording *recording, const char *path);
+void RecordingClose(Recording *recording);
+// Reads the message record at *offset and advances past it, returns false
+// at the end of the records or if the record is truncated
+bool RecordingReadMessage(const Recording *recording, uint64_t *offset, RecordedMessage *message);
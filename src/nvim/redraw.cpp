@@ -0,0 +1,750 @@
+#include "redraw.h"
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include "common/mpack_helper.h"
+#include "common/simd.h"
+#include "common/utf8.h"
+#include "nvim/highlight_keys.h"
+
+bool RedrawParseNotification(const char *data, size_t size, MPackCursor *params) {
+	MPackCursor cursor = MPackCursorInit(data, size);
+	if (MPackCursorReadArray(&cursor) != 3) {
+		return false;
+	}
+	if (MPackCursorReadInt(&cursor) != static_cast<int64_t>(MPackMessageType::Notification)) {
+		return false;
+	}
+
+	uint32_t name_length;
+	const char *name = MPackCursorReadStr(&cursor, &name_length);
+	if (cursor.error || !MPackStringEquals(name, name_length, "redraw")) {
+		return false;
+	}
+
+	*params = cursor;
+	return true;
+}
+
+void RedrawDecoderInitialize(RedrawDecoder *decoder, MPackCursor params) {
+	decoder->cursor = params;
+	decoder->events_remaining = MPackCursorReadArray(&decoder->cursor);
+	decoder->name = nullptr;
+	decoder->name_length = 0;
+	decoder->tuples_remaining = 0;
+	decoder->tuple = RedrawTuple {
+		.cursor = &decoder->cursor,
+		.params_remaining = 0
+	};
+}
+
+bool RedrawNextEvent(RedrawDecoder *decoder) {
+	// Skip whatever the caller didn't consume of the previous event
+	RedrawTupleSkip(&decoder->tuple);
+	MPackCursorSkipValues(&decoder->cursor, decoder->tuples_remaining);
+	decoder->tuples_remaining = 0;
+
+	if (decoder->events_remaining == 0 || decoder->cursor.error) {
+		return false;
+	}
+	--decoder->events_remaining;
+
+	uint32_t event_length = MPackCursorReadArray(&decoder->cursor);
+	if (event_length == 0) {
+		return !decoder->cursor.error && RedrawNextEvent(decoder);
+	}
+	decoder->name = MPackCursorReadStr(&decoder->cursor, &decoder->name_length);
+	decoder->tuples_remaining = event_length - 1;
+	return !decoder->cursor.error;
+}
+
+bool RedrawNextTuple(RedrawDecoder *decoder) {
+	RedrawTupleSkip(&decoder->tuple);
+	if (decoder->tuples_remaining == 0 || decoder->cursor.error) {
+		return false;
+	}
+	--decoder->tuples_remaining;
+
+	decoder->tuple.params_remaining = MPackCursorReadArray(&decoder->cursor);
+	return !decoder->cursor.error;
+}
+
+int64_t RedrawTupleInt(RedrawTuple *tuple) {
+	if (tuple->params_remaining == 0) {
+		return 0;
+	}
+	--tuple->params_remaining;
+	return MPackCursorReadInt(tuple->cursor);
+}
+
+double RedrawTupleFloat(RedrawTuple *tuple) {
+	if (tuple->params_remaining == 0) {
+		return 0.0;
+	}
+	--tuple->params_remaining;
+	return MPackCursorReadFloat(tuple->cursor);
+}
+
+bool RedrawTupleBool(RedrawTuple *tuple) {
+	if (tuple->params_remaining == 0) {
+		return false;
+	}
+	--tuple->params_remaining;
+	return MPackCursorReadBool(tuple->cursor);
+}
+
+const char *RedrawTupleStr(RedrawTuple *tuple, uint32_t *length) {
+	if (tuple->params_remaining == 0) {
+		*length = 0;
+		return "";
+	}
+	--tuple->params_remaining;
+	const char *str = MPackCursorReadStr(tuple->cursor, length);
+	return str ? str : "";
+}
+
+void RedrawTupleSkipValue(RedrawTuple *tuple) {
+	if (tuple->params_remaining == 0) {
+		return;
+	}
+	--tuple->params_remaining;
+	MPackCursorSkip(tuple->cursor);
+}
+
+void RedrawTupleSkip(RedrawTuple *tuple) {
+	MPackCursorSkipValues(tuple->cursor, tuple->params_remaining);
+	tuple->params_remaining = 0;
+}
+
+// Allocates an op with `trailing_size` bytes of array data following it
+template<typename T>
+static T *PushOp(Arena *arena, RedrawOpType type, size_t trailing_size = 0) {
+	size_t size = (sizeof(T) + trailing_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+	T *op = static_cast<T *>(ArenaPush(arena, size));
+	op->header = RedrawOp {
+		.type = type,
+		.size = static_cast<uint32_t>(size)
+	};
+	return op;
+}
+
+// Ops without a payload are just the header
+static void PushEmptyOp(Arena *arena, RedrawOpType type) {
+	RedrawOp *op = static_cast<RedrawOp *>(ArenaPush(arena, sizeof(RedrawOp)));
+	*op = RedrawOp {
+		.type = type,
+		.size = sizeof(RedrawOp)
+	};
+}
+
+static void PushStringOp(Arena *arena, RedrawOpType type, const char *str, uint32_t length) {
+	RedrawOpString *op = PushOp<RedrawOpString>(arena, type, length);
+	op->length = length;
+	memcpy(op + 1, str, length);
+}
+
+static void EncodeGridResize(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	int grid_cols = static_cast<int>(RedrawTupleInt(tuple));
+	int grid_rows = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpGridResize *op = PushOp<RedrawOpGridResize>(arena, RedrawOpType::GridResize);
+	op->grid = grid;
+	op->rows = grid_rows;
+	op->cols = grid_cols;
+}
+
+static void EncodeDefaultColors(Arena *arena, RedrawTuple *tuple) {
+	uint32_t foreground = static_cast<uint32_t>(RedrawTupleInt(tuple));
+	uint32_t background = static_cast<uint32_t>(RedrawTupleInt(tuple));
+	uint32_t special = static_cast<uint32_t>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpDefaultColors *op = PushOp<RedrawOpDefaultColors>(arena, RedrawOpType::DefaultColorsSet);
+	op->foreground = foreground;
+	op->background = background;
+	op->special = special;
+}
+
+// Every per id table holds MAX_HIGHLIGHT_ATTRIBS entries, ids past that are
+// never defined by hl_attr_define and fall back to the default highlight
+static uint16_t DecodeHighlightId(int64_t hl_attrib_id) {
+	if (hl_attrib_id < 0 || hl_attrib_id >= MAX_HIGHLIGHT_ATTRIBS) {
+		return 0;
+	}
+	return static_cast<uint16_t>(hl_attrib_id);
+}
+
+static void EncodeHighlightDefine(Arena *arena, RedrawTuple *tuple) {
+	int64_t attrib_index = RedrawTupleInt(tuple);
+	if (tuple->params_remaining == 0 || attrib_index < 0 || attrib_index >= MAX_HIGHLIGHT_ATTRIBS) {
+		return;
+	}
+
+	// The header is filled in once the op is pushed
+	RedrawOpHlAttrDefine hl_define {
+		.header = {},
+		.hl_attrib_id = static_cast<uint16_t>(attrib_index),
+		.foreground = DEFAULT_COLOR,
+		.background = DEFAULT_COLOR,
+		.special = DEFAULT_COLOR,
+		.flags = 0,
+		.flags_mask = 0
+	};
+
+	--tuple->params_remaining;
+	MPackCursor *cursor = tuple->cursor;
+	uint32_t attrib_count = MPackCursorReadMap(cursor);
+	for (uint32_t i = 0; i < attrib_count && !cursor->error; ++i) {
+		uint32_t key_length;
+		const char *key = MPackCursorReadStr(cursor, &key_length);
+
+		const auto SetFlag = [&](HighlightAttributeFlags flag) {
+			hl_define.flags_mask |= flag;
+			if (MPackCursorReadBool(cursor)) {
+				hl_define.flags |= flag;
+			}
+		};
+
+		switch (HighlightKeyLookup(key, key_length)) {
+		case HighlightKey::foreground: {
+			hl_define.foreground = static_cast<uint32_t>(MPackCursorReadInt(cursor));
+		} break;
+		case HighlightKey::background: {
+			hl_define.background = static_cast<uint32_t>(MPackCursorReadInt(cursor));
+		} break;
+		case HighlightKey::special: {
+			hl_define.special = static_cast<uint32_t>(MPackCursorReadInt(cursor));
+		} break;
+		case HighlightKey::reverse: {
+			SetFlag(HL_ATTRIB_REVERSE);
+		} break;
+		case HighlightKey::italic: {
+			SetFlag(HL_ATTRIB_ITALIC);
+		} break;
+		case HighlightKey::bold: {
+			SetFlag(HL_ATTRIB_BOLD);
+		} break;
+		case HighlightKey::strikethrough: {
+			SetFlag(HL_ATTRIB_STRIKETHROUGH);
+		} break;
+		case HighlightKey::underline: {
+			SetFlag(HL_ATTRIB_UNDERLINE);
+		} break;
+		case HighlightKey::undercurl: {
+			SetFlag(HL_ATTRIB_UNDERCURL);
+		} break;
+		case HighlightKey::Unknown: {
+			MPackCursorSkip(cursor);
+		} break;
+		}
+	}
+	if (cursor->error) {
+		return;
+	}
+
+	RedrawOpHlAttrDefine *op = PushOp<RedrawOpHlAttrDefine>(arena, RedrawOpType::HlAttrDefine);
+	hl_define.header = op->header;
+	*op = hl_define;
+}
+
+// Most grid_line cells continue the highlight of the cell before them and
+// hold a single ASCII character, which msgpack encodes as the three bytes
+// [fixarray(1), fixstr(1), char]. Runs of these are matched 16 (or 32)
+// cells at a time against a repeating byte pattern.
+constexpr uint8_t ASCII_CELL_ARRAY = 0x91;
+constexpr uint8_t ASCII_CELL_STR = 0xA1;
+constexpr size_t ASCII_CELL_SIZE = 3;
+
+struct AsciiCellPattern {
+	// The expected bytes after masking, the char byte only keeps its
+	// top bit which must be clear
+	alignas(32) uint8_t bytes[96];
+	alignas(32) uint8_t mask[96];
+};
+constexpr AsciiCellPattern BuildAsciiCellPattern() {
+	AsciiCellPattern pattern {};
+	for (size_t i = 0; i < sizeof(pattern.bytes); ++i) {
+		switch (i % ASCII_CELL_SIZE) {
+		case 0: {
+			pattern.bytes[i] = ASCII_CELL_ARRAY;
+			pattern.mask[i] = 0xFF;
+		} break;
+		case 1: {
+			pattern.bytes[i] = ASCII_CELL_STR;
+			pattern.mask[i] = 0xFF;
+		} break;
+		case 2: {
+			pattern.bytes[i] = 0;
+			pattern.mask[i] = 0x80;
+		} break;
+		}
+	}
+	return pattern;
+}
+constexpr AsciiCellPattern ASCII_CELL_PATTERN = BuildAsciiCellPattern();
+
+uint32_t RedrawDecodeAsciiCellsScalar(MPackCursor *cursor, RedrawCell *cells, uint32_t max_cells, uint16_t hl_attrib_id) {
+	const uint8_t *pos = cursor->pos;
+	uint32_t count = 0;
+	while (count < max_cells && cursor->end - pos >= static_cast<ptrdiff_t>(ASCII_CELL_SIZE) &&
+		pos[0] == ASCII_CELL_ARRAY && pos[1] == ASCII_CELL_STR && pos[2] < 0x80) {
+		cells[count++] = RedrawCell {
+			.grid_char = pos[2],
+			.hl_attrib_id = hl_attrib_id,
+			.repeat = 1
+		};
+		pos += ASCII_CELL_SIZE;
+	}
+	cursor->pos = pos;
+	return count;
+}
+
+uint32_t RedrawDecodeAsciiCells(MPackCursor *cursor, RedrawCell *cells, uint32_t max_cells, uint16_t hl_attrib_id) {
+	uint32_t count = 0;
+#if defined(NVY_SIMD_AVX2) || defined(NVY_SIMD_SSE2)
+#if defined(NVY_SIMD_AVX2)
+	constexpr uint32_t BLOCK_CELLS = 32;
+	constexpr uint32_t VECTOR_SIZE = 32;
+	constexpr uint32_t ALL_MATCHED = 0xFFFFFFFF;
+#else
+	constexpr uint32_t BLOCK_CELLS = 16;
+	constexpr uint32_t VECTOR_SIZE = 16;
+	constexpr uint32_t ALL_MATCHED = 0xFFFF;
+#endif
+	constexpr size_t BLOCK_SIZE = BLOCK_CELLS * ASCII_CELL_SIZE;
+	// Most runs are a word or two between highlight changes, only
+	// switch to whole blocks once the run has proven to be longer
+	constexpr uint32_t SCALAR_PREFIX_CELLS = 8;
+
+	uint32_t prefix_cells = max_cells < SCALAR_PREFIX_CELLS ? max_cells : SCALAR_PREFIX_CELLS;
+	count = RedrawDecodeAsciiCellsScalar(cursor, cells, prefix_cells, hl_attrib_id);
+	if (count < prefix_cells) {
+		return count;
+	}
+
+	const uint8_t *pos = cursor->pos;
+	while (max_cells - count >= BLOCK_CELLS && static_cast<size_t>(cursor->end - pos) >= BLOCK_SIZE) {
+		// Count the leading bytes that match the pattern, a block is
+		// exactly three vectors so the pattern lines up with every block
+		uint32_t matched_bytes = 0;
+		for (uint32_t k = 0; k < ASCII_CELL_SIZE; ++k) {
+#if defined(NVY_SIMD_AVX2)
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos + k * VECTOR_SIZE));
+			__m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i *>(ASCII_CELL_PATTERN.mask + k * VECTOR_SIZE));
+			__m256i expected = _mm256_load_si256(reinterpret_cast<const __m256i *>(ASCII_CELL_PATTERN.bytes + k * VECTOR_SIZE));
+			uint32_t matched = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(v, mask), expected)));
+#else
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos + k * VECTOR_SIZE));
+			__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(ASCII_CELL_PATTERN.mask + k * VECTOR_SIZE));
+			__m128i expected = _mm_load_si128(reinterpret_cast<const __m128i *>(ASCII_CELL_PATTERN.bytes + k * VECTOR_SIZE));
+			uint32_t matched = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask), expected)));
+#endif
+			if (matched != ALL_MATCHED) {
+				matched_bytes += std::countr_one(matched);
+				break;
+			}
+			matched_bytes += VECTOR_SIZE;
+		}
+
+		// The end of a run is left to the scalar loop, short runs are
+		// the common case and shouldn't pay for converting a full block
+		if (matched_bytes < BLOCK_SIZE) {
+			break;
+		}
+		for (uint32_t i = 0; i < BLOCK_CELLS; ++i) {
+			cells[count + i] = RedrawCell {
+				.grid_char = pos[i * ASCII_CELL_SIZE + 2],
+				.hl_attrib_id = hl_attrib_id,
+				.repeat = 1
+			};
+		}
+		count += BLOCK_CELLS;
+		pos += BLOCK_SIZE;
+	}
+	cursor->pos = pos;
+#endif
+	return count + RedrawDecodeAsciiCellsScalar(cursor, cells + count, max_cells - count, hl_attrib_id);
+}
+
+static void EncodeGridLine(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	int row = static_cast<int>(RedrawTupleInt(tuple));
+	int col_start = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->params_remaining == 0 || tuple->cursor->error) {
+		return;
+	}
+
+	--tuple->params_remaining;
+	MPackCursor *cursor = tuple->cursor;
+	uint32_t cell_count = MPackCursorReadArray(cursor);
+	if (cursor->error || !MPackCursorHasBytes(cursor, cell_count)) {
+		// Every cell takes at least one byte, don't let a bogus
+		// length make us allocate a huge op
+		return;
+	}
+
+	RedrawOpGridLine *op = PushOp<RedrawOpGridLine>(arena, RedrawOpType::GridLine, cell_count * sizeof(RedrawCell));
+	op->grid = grid;
+	op->row = row;
+	op->col_start = col_start;
+	op->cell_count = 0;
+
+	RedrawCell *cells = reinterpret_cast<RedrawCell *>(op + 1);
+	uint16_t hl_attrib_id = 0;
+	for (uint32_t i = 0; i < cell_count; ++i) {
+		i += RedrawDecodeAsciiCells(cursor, &cells[i], cell_count - i, hl_attrib_id);
+		op->cell_count = i;
+		if (i == cell_count) {
+			break;
+		}
+
+		// Cells are of the form [text, hl_id?, repeat?]
+		uint32_t cell_length = MPackCursorReadArray(cursor);
+		uint32_t text_length;
+		const char *text = MPackCursorReadStr(cursor, &text_length);
+
+		if (cell_length > 1) {
+			hl_attrib_id = DecodeHighlightId(MPackCursorReadInt(cursor));
+		}
+
+		int64_t repeat = 1;
+		if (cell_length > 2) {
+			repeat = MPackCursorReadInt(cursor);
+		}
+		if (cell_length > 3) {
+			MPackCursorSkipValues(cursor, cell_length - 3);
+		}
+		if (cursor->error) {
+			break;
+		}
+
+		cells[i] = RedrawCell {
+			.grid_char = text_length == 0 ? GRID_CHAR_WIDE_RIGHT_HALF : Utf8ToGridChar(text, text_length),
+			.hl_attrib_id = hl_attrib_id,
+			.repeat = static_cast<uint16_t>(repeat < 0 ? 0 : (repeat > UINT16_MAX ? UINT16_MAX : repeat))
+		};
+		op->cell_count = i + 1;
+	}
+}
+
+static void EncodeGridScroll(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	GridScrollRegion region {
+		.top = static_cast<int>(RedrawTupleInt(tuple)),
+		.bottom = static_cast<int>(RedrawTupleInt(tuple)),
+		.left = static_cast<int>(RedrawTupleInt(tuple)),
+		.right = static_cast<int>(RedrawTupleInt(tuple)),
+		.rows = static_cast<int>(RedrawTupleInt(tuple))
+	};
+
+	// Currently nvim does not support horizontal scrolling,
+	// the parameter is reserved for later use
+	[[maybe_unused]] int64_t cols = RedrawTupleInt(tuple);
+	assert(cols == 0);
+
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpGridScroll *op = PushOp<RedrawOpGridScroll>(arena, RedrawOpType::GridScroll);
+	op->grid = grid;
+	op->region = region;
+}
+
+static void EncodeCursorGoto(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	int row = static_cast<int>(RedrawTupleInt(tuple));
+	int col = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpCursorGoto *op = PushOp<RedrawOpCursorGoto>(arena, RedrawOpType::GridCursorGoto);
+	op->grid = grid;
+	op->row = row;
+	op->col = col;
+}
+
+// Used by grid_clear, win_hide, win_close and grid_destroy, which
+// only take the grid
+static void EncodeGridOp(Arena *arena, RedrawTuple *tuple, RedrawOpType type) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpGrid *op = PushOp<RedrawOpGrid>(arena, type);
+	op->grid = grid;
+}
+
+static void EncodeWinPos(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	RedrawTupleSkipValue(tuple); // win
+	int start_row = static_cast<int>(RedrawTupleInt(tuple));
+	int start_col = static_cast<int>(RedrawTupleInt(tuple));
+	int width = static_cast<int>(RedrawTupleInt(tuple));
+	int height = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpWinPos *op = PushOp<RedrawOpWinPos>(arena, RedrawOpType::WinPos);
+	op->grid = grid;
+	op->row = start_row;
+	op->col = start_col;
+	op->rows = height;
+	op->cols = width;
+}
+
+static void EncodeWinFloatPos(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	RedrawTupleSkipValue(tuple); // win
+	uint32_t anchor_length;
+	const char *anchor_str = RedrawTupleStr(tuple, &anchor_length);
+	FloatAnchor anchor = FloatAnchor::NW;
+	if (MPackStringEquals(anchor_str, anchor_length, "NE")) {
+		anchor = FloatAnchor::NE;
+	}
+	else if (MPackStringEquals(anchor_str, anchor_length, "SW")) {
+		anchor = FloatAnchor::SW;
+	}
+	else if (MPackStringEquals(anchor_str, anchor_length, "SE")) {
+		anchor = FloatAnchor::SE;
+	}
+	int anchor_grid = static_cast<int>(RedrawTupleInt(tuple));
+	double anchor_row = RedrawTupleFloat(tuple);
+	double anchor_col = RedrawTupleFloat(tuple);
+	RedrawTupleBool(tuple); // focusable
+	// Older nvim versions don't send a zindex
+	int zindex = tuple->params_remaining > 0 ? static_cast<int>(RedrawTupleInt(tuple)) : FLOAT_DEFAULT_ZINDEX;
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpWinFloatPos *op = PushOp<RedrawOpWinFloatPos>(arena, RedrawOpType::WinFloatPos);
+	op->grid = grid;
+	op->anchor_grid = anchor_grid;
+	op->anchor = anchor;
+	op->anchor_row = anchor_row;
+	op->anchor_col = anchor_col;
+	op->zindex = zindex;
+}
+
+static void EncodeMsgSetPos(Arena *arena, RedrawTuple *tuple) {
+	int grid = static_cast<int>(RedrawTupleInt(tuple));
+	int row = static_cast<int>(RedrawTupleInt(tuple));
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpMsgSetPos *op = PushOp<RedrawOpMsgSetPos>(arena, RedrawOpType::MsgSetPos);
+	op->grid = grid;
+	op->row = row;
+}
+
+static void EncodeModeInfoSet(Arena *arena, RedrawTuple *tuple) {
+	RedrawTupleBool(tuple); // cursor_style_enabled
+	if (tuple->params_remaining == 0) {
+		return;
+	}
+
+	--tuple->params_remaining;
+	MPackCursor *cursor = tuple->cursor;
+	uint32_t mode_infos_length = MPackCursorReadArray(cursor);
+	uint32_t mode_info_count = mode_infos_length < MAX_CURSOR_MODE_INFOS ? mode_infos_length : MAX_CURSOR_MODE_INFOS;
+
+	RedrawOpModeInfoSet *op = PushOp<RedrawOpModeInfoSet>(arena, RedrawOpType::ModeInfoSet,
+		mode_info_count * sizeof(CursorModeInfo));
+	op->mode_info_count = mode_info_count;
+
+	CursorModeInfo *mode_infos = reinterpret_cast<CursorModeInfo *>(op + 1);
+	for (uint32_t i = 0; i < mode_infos_length && !cursor->error; ++i) {
+		if (i >= MAX_CURSOR_MODE_INFOS) {
+			MPackCursorSkip(cursor);
+			continue;
+		}
+
+		CursorModeInfo *mode_info = &mode_infos[i];
+		mode_info->shape = CursorShape::None;
+		mode_info->hl_attrib_id = 0;
+
+		uint32_t map_length = MPackCursorReadMap(cursor);
+		for (uint32_t j = 0; j < map_length && !cursor->error; ++j) {
+			uint32_t key_length;
+			const char *key = MPackCursorReadStr(cursor, &key_length);
+			if (MPackStringEquals(key, key_length, "cursor_shape")) {
+				uint32_t shape_length;
+				const char *shape = MPackCursorReadStr(cursor, &shape_length);
+				if (MPackStringEquals(shape, shape_length, "block")) {
+					mode_info->shape = CursorShape::Block;
+				}
+				else if (MPackStringEquals(shape, shape_length, "vertical")) {
+					mode_info->shape = CursorShape::Vertical;
+				}
+				else if (MPackStringEquals(shape, shape_length, "horizontal")) {
+					mode_info->shape = CursorShape::Horizontal;
+				}
+			}
+			else if (MPackStringEquals(key, key_length, "attr_id")) {
+				mode_info->hl_attrib_id = DecodeHighlightId(MPackCursorReadInt(cursor));
+			}
+			else {
+				MPackCursorSkip(cursor);
+			}
+		}
+	}
+
+	// Don't apply a partially decoded set of mode infos
+	if (cursor->error) {
+		op->mode_info_count = 0;
+	}
+}
+
+static void EncodeModeChange(Arena *arena, RedrawTuple *tuple) {
+	uint32_t mode_length;
+	RedrawTupleStr(tuple, &mode_length); // mode name
+	int64_t mode_idx = RedrawTupleInt(tuple);
+	if (tuple->cursor->error) {
+		return;
+	}
+
+	RedrawOpModeChange *op = PushOp<RedrawOpModeChange>(arena, RedrawOpType::ModeChange);
+	op->mode_idx = static_cast<int>(mode_idx);
+}
+
+static void EncodeOptionSet(Arena *arena, RedrawTuple *tuple) {
+	uint32_t name_length;
+	const char *name = RedrawTupleStr(tuple, &name_length);
+	if (MPackStringEquals(name, name_length, "guifont") &&
+		MPackCursorPeekType(tuple->cursor) == MPackCursorType::Str) {
+		uint32_t font_length;
+		const char *font = RedrawTupleStr(tuple, &font_length);
+		PushStringOp(arena, RedrawOpType::SetGuiFont, font, font_length);
+	}
+}
+
+RedrawEvent RedrawEncodeEvent(Arena *arena, RedrawDecoder *decoder, RedrawEventStats *stats) {
+	RedrawTuple *tuple = &decoder->tuple;
+	RedrawEvent event = RedrawEventLookup(decoder->name, decoder->name_length);
+	switch (event) {
+	case RedrawEvent::grid_line: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridLine(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::grid_scroll: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridScroll(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::grid_cursor_goto: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeCursorGoto(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::flush: {
+		PushEmptyOp(arena, RedrawOpType::Flush);
+	} break;
+	case RedrawEvent::hl_attr_define: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeHighlightDefine(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::grid_resize: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridResize(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::grid_clear: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridOp(arena, tuple, RedrawOpType::GridClear);
+		}
+	} break;
+	case RedrawEvent::grid_destroy: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridOp(arena, tuple, RedrawOpType::GridDestroy);
+		}
+	} break;
+	case RedrawEvent::win_pos: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeWinPos(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::win_float_pos: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeWinFloatPos(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::win_hide: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridOp(arena, tuple, RedrawOpType::WinHide);
+		}
+	} break;
+	case RedrawEvent::win_close: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeGridOp(arena, tuple, RedrawOpType::WinClose);
+		}
+	} break;
+	case RedrawEvent::msg_set_pos: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeMsgSetPos(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::default_colors_set: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeDefaultColors(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::mode_info_set: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeModeInfoSet(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::mode_change: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeModeChange(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::option_set: {
+		while (RedrawNextTuple(decoder)) {
+			EncodeOptionSet(arena, tuple);
+		}
+	} break;
+	case RedrawEvent::set_title: {
+		if (RedrawNextTuple(decoder)) {
+			uint32_t title_length;
+			const char *title = RedrawTupleStr(tuple, &title_length);
+			PushStringOp(arena, RedrawOpType::SetTitle, title, title_length);
+		}
+	} break;
+	case RedrawEvent::busy_start: {
+		PushEmptyOp(arena, RedrawOpType::BusyStart);
+	} break;
+	case RedrawEvent::busy_stop: {
+		PushEmptyOp(arena, RedrawOpType::BusyStop);
+	} break;
+	case RedrawEvent::Unknown: {
+		++stats->unknown;
+	} break;
+	default: {
+		++stats->unhandled[static_cast<size_t>(event)];
+	} break;
+	}
+	return event;
+}
+
+bool RedrawEncodeOps(Arena *arena, MPackCursor params, RedrawEventStats *stats) {
+	RedrawDecoder decoder;
+	RedrawDecoderInitialize(&decoder, params);
+	bool has_flush = false;
+	while (RedrawNextEvent(&decoder)) {
+		has_flush |= RedrawEncodeEvent(arena, &decoder, stats) == RedrawEvent::flush;
+	}
+	return has_flush;
+}
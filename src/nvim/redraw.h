@@ -0,0 +1,56 @@
+#pragma once
+#include "common/arena.h"
+#include "common/mpack_cursor.h"
+#include "nvim/redraw_events.h"
+#include "nvim/redraw_ops.h"
+
+// The parameter tuple of a single redraw event call. Parameters are read in
+// order, reading past the end of the tuple yields zero values and any
+// parameters left unread are skipped when moving on to the next tuple.
+struct RedrawTuple {
+	MPackCursor *cursor;
+	uint32_t params_remaining;
+};
+
+// Streams the events of a `redraw` notification straight out of the
+// message buffer, without building a node tree.
+struct RedrawDecoder {
+	MPackCursor cursor;
+	uint32_t events_remaining;
+
+	// The current event, redraw events are of the form [name, tuple...]
+	const char *name;
+	uint32_t name_length;
+	uint32_t tuples_remaining;
+	RedrawTuple tuple;
+};
+
+// Checks whether a complete msgpack-rpc message is a `redraw` notification,
+// and if so returns a cursor positioned at its array of events
+bool RedrawParseNotification(const char *data, size_t size, MPackCursor *params);
+
+void RedrawDecoderInitialize(RedrawDecoder *decoder, MPackCursor params);
+bool RedrawNextEvent(RedrawDecoder *decoder);
+bool RedrawNextTuple(RedrawDecoder *decoder);
+
+int64_t RedrawTupleInt(RedrawTuple *tuple);
+double RedrawTupleFloat(RedrawTuple *tuple);
+bool RedrawTupleBool(RedrawTuple *tuple);
+const char *RedrawTupleStr(RedrawTuple *tuple, uint32_t *length);
+// Skips over the next parameter without decoding it
+void RedrawTupleSkipValue(RedrawTuple *tuple);
+void RedrawTupleSkip(RedrawTuple *tuple);
+
+// Decodes the events of a `redraw` notification into a stream of RedrawOps
+// appended to `arena`. Events the UI doesn't handle are dropped here and
+// counted in `stats`. Returns true if the batch contained a flush.
+bool RedrawEncodeOps(Arena *arena, MPackCursor params, RedrawEventStats *stats);
+// Encodes only the decoder's current event, returns which event it was
+RedrawEvent RedrawEncodeEvent(Arena *arena, RedrawDecoder *decoder, RedrawEventStats *stats);
+
+// Decodes the run of single ASCII character cells without a highlight of
+// their own at the cursor, which make up most of a grid_line, into at most
+// `max_cells` cells. Returns the number decoded, the scalar version is
+// only kept for comparison.
+uint32_t RedrawDecodeAsciiCells(MPackCursor *cursor, RedrawCell *cells, uint32_t max_cells, uint16_t hl_attrib_id);
+uint32_t RedrawDecodeAsciiCellsScalar(MPackCursor *cursor, RedrawCell *cells, uint32_t max_cells, uint16_t hl_attrib_id);
@@ -0,0 +1,247 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Every event of the nvim UI protocol (the `ui_events` of nvim's api
+// metadata), including the ones Nvy ignores. Keep in sync with
+// REDRAW_EVENT_NAMES, the order is only used for indexing.
+enum class RedrawEvent : uint8_t {
+	// Global events
+	mode_info_set,
+	update_menu,
+	busy_start,
+	busy_stop,
+	mouse_on,
+	mouse_off,
+	mode_change,
+	bell,
+	visual_bell,
+	flush,
+	suspend,
+	set_title,
+	set_icon,
+	screenshot,
+	option_set,
+	chdir,
+	// Legacy grid events (no ext_linegrid)
+	update_fg,
+	update_bg,
+	update_sp,
+	resize,
+	clear,
+	eol_clear,
+	cursor_goto,
+	highlight_set,
+	put,
+	set_scroll_region,
+	scroll,
+	// ext_linegrid
+	default_colors_set,
+	hl_attr_define,
+	hl_group_set,
+	grid_resize,
+	grid_clear,
+	grid_cursor_goto,
+	grid_line,
+	grid_scroll,
+	grid_destroy,
+	// ext_multigrid
+	win_pos,
+	win_float_pos,
+	win_external_pos,
+	win_hide,
+	win_close,
+	msg_set_pos,
+	win_viewport,
+	win_viewport_margins,
+	win_extmark,
+	// ext_popupmenu
+	popupmenu_show,
+	popupmenu_hide,
+	popupmenu_select,
+	// ext_tabline
+	tabline_update,
+	// ext_cmdline
+	cmdline_show,
+	cmdline_pos,
+	cmdline_special_char,
+	cmdline_hide,
+	cmdline_block_show,
+	cmdline_block_append,
+	cmdline_block_hide,
+	// ext_wildmenu
+	wildmenu_show,
+	wildmenu_select,
+	wildmenu_hide,
+	// ext_messages
+	msg_show,
+	msg_clear,
+	msg_showcmd,
+	msg_showmode,
+	msg_ruler,
+	msg_history_show,
+	msg_history_clear,
+	error_exit,
+
+	Count,
+	// Not part of the protocol as known to Nvy
+	Unknown = 0xFF
+};
+constexpr size_t REDRAW_EVENT_COUNT = static_cast<size_t>(RedrawEvent::Count);
+
+constexpr const char *REDRAW_EVENT_NAMES[] {
+	"mode_info_set",
+	"update_menu",
+	"busy_start",
+	"busy_stop",
+	"mouse_on",
+	"mouse_off",
+	"mode_change",
+	"bell",
+	"visual_bell",
+	"flush",
+	"suspend",
+	"set_title",
+	"set_icon",
+	"screenshot",
+	"option_set",
+	"chdir",
+	"update_fg",
+	"update_bg",
+	"update_sp",
+	"resize",
+	"clear",
+	"eol_clear",
+	"cursor_goto",
+	"highlight_set",
+	"put",
+	"set_scroll_region",
+	"scroll",
+	"default_colors_set",
+	"hl_attr_define",
+	"hl_group_set",
+	"grid_resize",
+	"grid_clear",
+	"grid_cursor_goto",
+	"grid_line",
+	"grid_scroll",
+	"grid_destroy",
+	"win_pos",
+	"win_float_pos",
+	"win_external_pos",
+	"win_hide",
+	"win_close",
+	"msg_set_pos",
+	"win_viewport",
+	"win_viewport_margins",
+	"win_extmark",
+	"popupmenu_show",
+	"popupmenu_hide",
+	"popupmenu_select",
+	"tabline_update",
+	"cmdline_show",
+	"cmdline_pos",
+	"cmdline_special_char",
+	"cmdline_hide",
+	"cmdline_block_show",
+	"cmdline_block_append",
+	"cmdline_block_hide",
+	"wildmenu_show",
+	"wildmenu_select",
+	"wildmenu_hide",
+	"msg_show",
+	"msg_clear",
+	"msg_showcmd",
+	"msg_showmode",
+	"msg_ruler",
+	"msg_history_show",
+	"msg_history_clear",
+	"error_exit",
+};
+static_assert(sizeof(REDRAW_EVENT_NAMES) / sizeof(REDRAW_EVENT_NAMES[0]) == REDRAW_EVENT_COUNT,
+	"REDRAW_EVENT_NAMES is out of sync with RedrawEvent");
+
+constexpr uint32_t REDRAW_EVENT_TABLE_SIZE = 256;
+static_assert(REDRAW_EVENT_TABLE_SIZE > REDRAW_EVENT_COUNT, "Too many events for the hash table");
+
+// FNV-1a, seeded so a seed without collisions can be searched for
+constexpr uint32_t RedrawEventHash(const char *name, uint32_t length, uint32_t seed) {
+	uint32_t hash = 2166136261u ^ seed;
+	for (uint32_t i = 0; i < length; ++i) {
+		hash ^= static_cast<uint8_t>(name[i]);
+		hash *= 16777619u;
+	}
+	return (hash ^ (hash >> 16)) & (REDRAW_EVENT_TABLE_SIZE - 1);
+}
+
+constexpr uint32_t RedrawEventNameLength(const char *name) {
+	uint32_t length = 0;
+	while (name[length] != '\0') {
+		++length;
+	}
+	return length;
+}
+
+// A collision free table mapping hash slots to events, built at compile time
+struct RedrawEventTable {
+	uint32_t seed;
+	RedrawEvent slots[REDRAW_EVENT_TABLE_SIZE];
+};
+
+constexpr RedrawEventTable RedrawEventBuildTable() {
+	for (uint32_t seed = 0;; ++seed) {
+		RedrawEventTable table { .seed = seed, .slots = {} };
+		for (RedrawEvent &slot : table.slots) {
+			slot = RedrawEvent::Unknown;
+		}
+
+		bool collision = false;
+		for (size_t i = 0; i < REDRAW_EVENT_COUNT && !collision; ++i) {
+			const char *name = REDRAW_EVENT_NAMES[i];
+			uint32_t slot = RedrawEventHash(name, RedrawEventNameLength(name), seed);
+			collision = table.slots[slot] != RedrawEvent::Unknown;
+			table.slots[slot] = static_cast<RedrawEvent>(i);
+		}
+		if (!collision) {
+			return table;
+		}
+	}
+}
+constexpr RedrawEventTable REDRAW_EVENT_TABLE = RedrawEventBuildTable();
+
+// One hash and one compare, names that are merely a prefix
+// or extension of a known event resolve to Unknown
+constexpr RedrawEvent RedrawEventLookup(const char *name, uint32_t length) {
+	RedrawEvent event = REDRAW_EVENT_TABLE.slots[RedrawEventHash(name, length, REDRAW_EVENT_TABLE.seed)];
+	if (event == RedrawEvent::Unknown) {
+		return RedrawEvent::Unknown;
+	}
+
+	const char *event_name = REDRAW_EVENT_NAMES[static_cast<size_t>(event)];
+	for (uint32_t i = 0; i < length; ++i) {
+		if (event_name[i] == '\0' || event_name[i] != name[i]) {
+			return RedrawEvent::Unknown;
+		}
+	}
+	return event_name[length] == '\0' ? event : RedrawEvent::Unknown;
+}
+
+constexpr bool RedrawEventTableIsComplete() {
+	for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+		const char *name = REDRAW_EVENT_NAMES[i];
+		if (RedrawEventLookup(name, RedrawEventNameLength(name)) != static_cast<RedrawEvent>(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+static_assert(RedrawEventTableIsComplete(), "Every redraw event must resolve to itself");
+static_assert(RedrawEventLookup("grid", 4) == RedrawEvent::Unknown, "Prefixes must not match");
+static_assert(RedrawEventLookup("flushed", 7) == RedrawEvent::Unknown, "Extensions must not match");
+
+// Calls of known events that Nvy doesn't handle, and of event names that
+// aren't part of the protocol at all, ie: from a newer nvim
+struct RedrawEventStats {
+	uint64_t unhandled[REDRAW_EVENT_COUNT];
+	uint64_t unknown;
+};
@@ -0,0 +1,288 @@
+#include "redraw_ops.h"
+#include <cassert>
+
+// Marks rows [first_row, last_row) and columns [left, right) of a grid
+// dirty, translated to screen coordinates
+static void MarkGridRect(UIModel *model, const UIGrid *ui_grid, int first_row, int last_row, int left, int right) {
+	if (!ui_grid->visible) {
+		return;
+	}
+	DirtyRowsMarkRect(&model->dirty_rows, ui_grid->row + first_row, ui_grid->row + last_row,
+		ui_grid->col + left, ui_grid->col + right);
+}
+
+static void MarkGrid(UIModel *model, const UIGrid *ui_grid) {
+	MarkGridRect(model, ui_grid, 0, ui_grid->grid.rows, 0, ui_grid->grid.cols);
+}
+
+// The grid a drawing op targets, if it exists and has been sized
+static UIGrid *FindSizedGrid(UIModel *model, int grid) {
+	UIGrid *ui_grid = CompositorFindGrid(&model->compositor, grid);
+	return ui_grid && ui_grid->grid.cells ? ui_grid : nullptr;
+}
+
+static void UpdateCursorPosition(UIModel *model) {
+	UIGrid *ui_grid = CompositorFindGrid(&model->compositor, model->cursor.grid);
+	model->cursor.row = model->cursor.grid_row + (ui_grid ? ui_grid->row : 0);
+	model->cursor.col = model->cursor.grid_col + (ui_grid ? ui_grid->col : 0);
+}
+
+bool RedrawApplyGridResize(UIModel *model, const RedrawOpGridResize *op) {
+	if (op->rows <= 0 || op->cols <= 0) {
+		return false;
+	}
+	UIGrid *ui_grid = CompositorGetGrid(&model->compositor, op->grid);
+	if (!ui_grid) {
+		return false;
+	}
+
+	Grid *grid = &ui_grid->grid;
+	if (grid->cells && grid->rows == op->rows && grid->cols == op->cols) {
+		return false;
+	}
+
+	// Whatever the grid covered before is composed again
+	if (grid->cells) {
+		MarkGrid(model, ui_grid);
+	}
+	GridResize(grid, op->rows, op->cols);
+	MarkGrid(model, ui_grid);
+
+	// The global grid is the size of the screen
+	if (op->grid != GLOBAL_GRID_ID || !GridResize(&model->grid, op->rows, op->cols)) {
+		return false;
+	}
+	DirtyRowsResize(&model->dirty_rows, op->rows, op->cols);
+	RowHashesResize(&model->drawn_rows, op->rows);
+	HighlightRunsResize(&model->hl_runs, op->rows, op->cols);
+	HighlightRowsResize(&model->hl_rows, op->rows, op->cols);
+	return true;
+}
+
+void RedrawApplyGridClear(UIModel *model, const RedrawOpGrid *op) {
+	UIGrid *ui_grid = FindSizedGrid(model, op->grid);
+	if (!ui_grid) {
+		return;
+	}
+	GridClear(&ui_grid->grid);
+	MarkGrid(model, ui_grid);
+}
+
+void RedrawApplyDefaultColors(UIModel *model, const RedrawOpDefaultColors *op) {
+	// Default colors occupy the first index of the highlight attribs array
+	HighlightAttributes previous_defaults = model->hl_attribs[0];
+	model->hl_attribs[0].foreground = op->foreground;
+	model->hl_attribs[0].background = op->background;
+	model->hl_attribs[0].special = op->special;
+	model->hl_attribs[0].flags = 0;
+	HighlightSetsIntern(&model->hl_sets, 0, &model->hl_attribs[0]);
+	ResolvedColorsRebuild(&model->hl_colors, model->hl_attribs.data());
+	// Only the rows showing a highlight that falls back to a changed
+	// default color look any different
+	HighlightRowsMarkDefaults(&model->hl_rows, model->hl_attribs.data(), &previous_defaults, &model->dirty_rows);
+}
+
+void RedrawApplyHighlightDefine(UIModel *model, const RedrawOpHlAttrDefine *op) {
+	HighlightAttributes *hl_attribs = &model->hl_attribs[op->hl_attrib_id];
+	HighlightAttributes previous = *hl_attribs;
+	hl_attribs->foreground = op->foreground;
+	hl_attribs->background = op->background;
+	hl_attribs->special = op->special;
+	hl_attribs->flags = (hl_attribs->flags & ~op->flags_mask) | op->flags;
+	HighlightSetsIntern(&model->hl_sets, op->hl_attrib_id, hl_attribs);
+	ResolvedColorsUpdate(&model->hl_colors, model->hl_attribs.data(), op->hl_attrib_id);
+
+	// An id redefined while on screen, redraw the rows showing it
+	if (!HighlightAttributesEqual(&previous, hl_attribs)) {
+		HighlightRowsMarkId(&model->hl_rows, op->hl_attrib_id, &model->dirty_rows);
+	}
+}
+
+int RedrawApplyGridLine(UIModel *model, const RedrawOpGridLine *op) {
+	UIGrid *ui_grid = FindSizedGrid(model, op->grid);
+	if (!ui_grid) {
+		return -1;
+	}
+
+	Grid *grid = &ui_grid->grid;
+	int row = op->row;
+	if (row < 0 || row >= grid->rows || op->col_start < 0 || op->col_start >= grid->cols) {
+		return -1;
+	}
+
+	const RedrawCell *cells = RedrawOpGridLineCells(op);
+	int col = op->col_start;
+	int cols = grid->cols;
+	for (uint32_t i = 0; i < op->cell_count && col < cols; ++i) {
+		// Never write past the end of the row, even if nvim and the
+		// model disagree on the grid size mid resize
+		int repeat = cells[i].repeat;
+		if (repeat > cols - col) {
+			repeat = cols - col;
+		}
+		col = GridPutCell(grid, row, col, cells[i].grid_char, cells[i].hl_attrib_id, repeat);
+	}
+
+	// GridPutCell also sets or clears the wide flag of the cell on the left
+	int left = op->col_start > 0 ? op->col_start - 1 : 0;
+	MarkGridRect(model, ui_grid, row, row + 1, left, col);
+	return row;
+}
+
+bool RedrawApplyGridScroll(UIModel *model, const RedrawOpGridScroll *op) {
+	UIGrid *ui_grid = FindSizedGrid(model, op->grid);
+	if (!ui_grid) {
+		return false;
+	}
+
+	Grid *grid = &ui_grid->grid;
+	GridScrollRegion region = op->region;
+	if (region.top < 0 || region.bottom > grid->rows || region.top >= region.bottom ||
+		region.left < 0 || region.right > grid->cols || region.left >= region.right) {
+		return false;
+	}
+
+	GridScroll(grid, region);
+
+	// The rows the region moved into, nvim sends grid_lines for the rest
+	int first_row = region.rows > 0 ? region.top : region.top - region.rows;
+	int last_row = region.rows > 0 ? region.bottom - region.rows : region.bottom;
+	MarkGridRect(model, ui_grid, first_row, last_row, region.left, region.right);
+	return true;
+}
+
+void RedrawApplyCursorGoto(UIModel *model, const RedrawOpCursorGoto *op) {
+	model->cursor.grid = op->grid;
+	model->cursor.grid_row = op->row;
+	model->cursor.grid_col = op->col;
+	UpdateCursorPosition(model);
+}
+
+void RedrawApplyModeInfoSet(UIModel *model, const RedrawOpModeInfoSet *op) {
+	const CursorModeInfo *mode_infos = RedrawOpModeInfos(op);
+	for (uint32_t i = 0; i < op->mode_info_count && i < MAX_CURSOR_MODE_INFOS; ++i) {
+		model->cursor_mode_infos[i] = mode_infos[i];
+	}
+}
+
+void RedrawApplyModeChange(UIModel *model, const RedrawOpModeChange *op) {
+	if (op->mode_idx >= 0 && op->mode_idx < MAX_CURSOR_MODE_INFOS) {
+		model->cursor.mode_info = &model->cursor_mode_infos[op->mode_idx];
+	}
+}
+
+// Moving a grid composes both where it was and where it is now
+static void PlaceGrid(UIModel *model, UIGrid *ui_grid, int row, int col, int zindex) {
+	MarkGrid(model, ui_grid);
+	CompositorPlaceGrid(&model->compositor, ui_grid, row, col, zindex);
+	MarkGrid(model, ui_grid);
+	if (model->cursor.grid == ui_grid->id) {
+		UpdateCursorPosition(model);
+	}
+}
+
+void RedrawApplyWinPos(UIModel *model, const RedrawOpWinPos *op) {
+	UIGrid *ui_grid = CompositorGetGrid(&model->compositor, op->grid);
+	if (ui_grid && op->grid != GLOBAL_GRID_ID) {
+		PlaceGrid(model, ui_grid, op->row, op->col, 0);
+	}
+}
+
+void RedrawApplyWinFloatPos(UIModel *model, const RedrawOpWinFloatPos *op) {
+	UIGrid *ui_grid = CompositorGetGrid(&model->compositor, op->grid);
+	if (!ui_grid || op->grid == GLOBAL_GRID_ID) {
+		return;
+	}
+	int row;
+	int col;
+	CompositorFloatPosition(&model->compositor, op->anchor_grid, op->anchor, op->anchor_row, op->anchor_col,
+		ui_grid->grid.rows, ui_grid->grid.cols, &row, &col);
+	PlaceGrid(model, ui_grid, row, col, op->zindex);
+}
+
+void RedrawApplyMsgSetPos(UIModel *model, const RedrawOpMsgSetPos *op) {
+	UIGrid *ui_grid = CompositorGetGrid(&model->compositor, op->grid);
+	if (ui_grid && op->grid != GLOBAL_GRID_ID) {
+		PlaceGrid(model, ui_grid, op->row, 0, MESSAGE_GRID_ZINDEX);
+	}
+}
+
+void RedrawApplyWinHide(UIModel *model, const RedrawOpGrid *op) {
+	UIGrid *ui_grid = CompositorFindGrid(&model->compositor, op->grid);
+	if (ui_grid && op->grid != GLOBAL_GRID_ID) {
+		MarkGrid(model, ui_grid);
+		CompositorHideGrid(&model->compositor, ui_grid);
+	}
+}
+
+void RedrawApplyGridDestroy(UIModel *model, const RedrawOpGrid *op) {
+	UIGrid *ui_grid = CompositorFindGrid(&model->compositor, op->grid);
+	if (ui_grid && op->grid != GLOBAL_GRID_ID) {
+		MarkGrid(model, ui_grid);
+		CompositorDestroyGrid(&model->compositor, op->grid);
+	}
+}
+
+void RedrawApplyOp(UIModel *model, const RedrawOp *op) {
+	switch (op->type) {
+	case RedrawOpType::GridResize: {
+		RedrawApplyGridResize(model, reinterpret_cast<const RedrawOpGridResize *>(op));
+	} break;
+	case RedrawOpType::GridClear: {
+		RedrawApplyGridClear(model, reinterpret_cast<const RedrawOpGrid *>(op));
+	} break;
+	case RedrawOpType::GridLine: {
+		RedrawApplyGridLine(model, reinterpret_cast<const RedrawOpGridLine *>(op));
+	} break;
+	case RedrawOpType::GridScroll: {
+		RedrawApplyGridScroll(model, reinterpret_cast<const RedrawOpGridScroll *>(op));
+	} break;
+	case RedrawOpType::GridCursorGoto: {
+		RedrawApplyCursorGoto(model, reinterpret_cast<const RedrawOpCursorGoto *>(op));
+	} break;
+	case RedrawOpType::DefaultColorsSet: {
+		RedrawApplyDefaultColors(model, reinterpret_cast<const RedrawOpDefaultColors *>(op));
+	} break;
+	case RedrawOpType::HlAttrDefine: {
+		RedrawApplyHighlightDefine(model, reinterpret_cast<const RedrawOpHlAttrDefine *>(op));
+	} break;
+	case RedrawOpType::ModeInfoSet: {
+		RedrawApplyModeInfoSet(model, reinterpret_cast<const RedrawOpModeInfoSet *>(op));
+	} break;
+	case RedrawOpType::ModeChange: {
+		RedrawApplyModeChange(model, reinterpret_cast<const RedrawOpModeChange *>(op));
+	} break;
+	case RedrawOpType::BusyStart: {
+		model->ui_busy = true;
+	} break;
+	case RedrawOpType::BusyStop: {
+		model->ui_busy = false;
+	} break;
+	case RedrawOpType::Flush: {
+		UIModelFlushRows(model, [](int, DirtyRowSpan) {});
+	} break;
+	case RedrawOpType::WinPos: {
+		RedrawApplyWinPos(model, reinterpret_cast<const RedrawOpWinPos *>(op));
+	} break;
+	case RedrawOpType::WinFloatPos: {
+		RedrawApplyWinFloatPos(model, reinterpret_cast<const RedrawOpWinFloatPos *>(op));
+	} break;
+	case RedrawOpType::MsgSetPos: {
+		RedrawApplyMsgSetPos(model, reinterpret_cast<const RedrawOpMsgSetPos *>(op));
+	} break;
+	case RedrawOpType::WinHide:
+	case RedrawOpType::WinClose: {
+		RedrawApplyWinHide(model, reinterpret_cast<const RedrawOpGrid *>(op));
+	} break;
+	case RedrawOpType::GridDestroy: {
+		RedrawApplyGridDestroy(model, reinterpret_cast<const RedrawOpGrid *>(op));
+	} break;
+	// Only concern the window
+	case RedrawOpType::SetGuiFont:
+	case RedrawOpType::SetTitle: {
+	} break;
+	// Not an op, only sizes tables indexed by op type
+	case RedrawOpType::Count: {
+	} break;
+	}
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "model/ui_model.h"
+
+// A redraw notification decoded into a flat stream of plain structs. The
+// reader thread does all the msgpack walking, string matching and UTF-8
+// conversion, the UI thread only applies the resulting ops. Ops are laid
+// out back to back, each starting with a RedrawOp header whose size covers
+// the op and any trailing array, so the stream is position independent.
+enum class RedrawOpType : uint8_t {
+	GridResize,
+	GridClear,
+	GridLine,
+	GridScroll,
+	GridCursorGoto,
+	DefaultColorsSet,
+	HlAttrDefine,
+	ModeInfoSet,
+	ModeChange,
+	SetGuiFont,
+	SetTitle,
+	BusyStart,
+	BusyStop,
+	Flush,
+	// ext_multigrid
+	WinPos,
+	WinFloatPos,
+	WinHide,
+	WinClose,
+	GridDestroy,
+	MsgSetPos,
+
+	Count
+};
+constexpr size_t REDRAW_OP_TYPE_COUNT = static_cast<size_t>(RedrawOpType::Count);
+
+struct RedrawOp {
+	RedrawOpType type;
+	uint32_t size;
+};
+
+// Used by GridClear, WinHide, WinClose and GridDestroy
+struct RedrawOpGrid {
+	RedrawOp header;
+	int grid;
+};
+
+struct RedrawOpGridResize {
+	RedrawOp header;
+	int grid;
+	int rows;
+	int cols;
+};
+
+// A grid_line cell with its text already converted to the grid representation
+struct RedrawCell {
+	uint32_t grid_char;
+	uint16_t hl_attrib_id;
+	uint16_t repeat;
+};
+
+// Followed by `cell_count` RedrawCells
+struct RedrawOpGridLine {
+	RedrawOp header;
+	int grid;
+	int row;
+	int col_start;
+	uint32_t cell_count;
+};
+
+struct RedrawOpGridScroll {
+	RedrawOp header;
+	int grid;
+	GridScrollRegion region;
+};
+
+struct RedrawOpCursorGoto {
+	RedrawOp header;
+	int grid;
+	int row;
+	int col;
+};
+
+struct RedrawOpWinPos {
+	RedrawOp header;
+	int grid;
+	int row;
+	int col;
+	int rows;
+	int cols;
+};
+
+struct RedrawOpWinFloatPos {
+	RedrawOp header;
+	int grid;
+	int anchor_grid;
+	FloatAnchor anchor;
+	double anchor_row;
+	double anchor_col;
+	int zindex;
+};
+
+struct RedrawOpMsgSetPos {
+	RedrawOp header;
+	int grid;
+	int row;
+};
+
+struct RedrawOpDefaultColors {
+	RedrawOp header;
+	uint32_t foreground;
+	uint32_t background;
+	uint32_t special;
+};
+
+struct RedrawOpHlAttrDefine {
+	RedrawOp header;
+	uint16_t hl_attrib_id;
+	uint32_t foreground;
+	uint32_t background;
+	uint32_t special;
+	// Flags only change where their key was present in the definition
+	uint32_t flags;
+	uint32_t flags_mask;
+};
+
+// Followed by `mode_info_count` CursorModeInfos
+struct RedrawOpModeInfoSet {
+	RedrawOp header;
+	uint32_t mode_info_count;
+};
+
+struct RedrawOpModeChange {
+	RedrawOp header;
+	int mode_idx;
+};
+
+// Used by SetGuiFont and SetTitle, followed by `length` bytes of UTF-8 text
+struct RedrawOpString {
+	RedrawOp header;
+	uint32_t length;
+};
+
+inline const RedrawCell *RedrawOpGridLineCells(const RedrawOpGridLine *op) {
+	return reinterpret_cast<const RedrawCell *>(op + 1);
+}
+inline const CursorModeInfo *RedrawOpModeInfos(const RedrawOpModeInfoSet *op) {
+	return reinterpret_cast<const CursorModeInfo *>(op + 1);
+}
+inline const char *RedrawOpStringData(const RedrawOpString *op) {
+	return reinterpret_cast<const char *>(op + 1);
+}
+
+struct RedrawOps {
+	const uint8_t *pos;
+	const uint8_t *end;
+};
+
+inline RedrawOps RedrawOpsInit(const char *data, size_t size) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+	return RedrawOps {
+		.pos = bytes,
+		.end = bytes + size
+	};
+}
+
+// Returns the next op in the stream, or nullptr once all ops are consumed
+inline const RedrawOp *RedrawOpsNext(RedrawOps *ops) {
+	if (static_cast<size_t>(ops->end - ops->pos) < sizeof(RedrawOp)) {
+		return nullptr;
+	}
+	const RedrawOp *op = reinterpret_cast<const RedrawOp *>(ops->pos);
+	ops->pos += op->size;
+	return op;
+}
+
+// Apply the model side of an op, leaving any drawing to the caller. The
+// reader thread knows nothing about the grid, so all bounds are checked here.
+// Grid changes are marked in `model->dirty_rows` in screen coordinates, the
+// flush composes those cells from the grids before drawing them.
+// Returns true if the global grid, and so the screen, changed size
+bool RedrawApplyGridResize(UIModel *model, const RedrawOpGridResize *op);
+void RedrawApplyGridClear(UIModel *model, const RedrawOpGrid *op);
+void RedrawApplyDefaultColors(UIModel *model, const RedrawOpDefaultColors *op);
+void RedrawApplyHighlightDefine(UIModel *model, const RedrawOpHlAttrDefine *op);
+// Returns the row that was updated, or -1 if the line was out of bounds
+int RedrawApplyGridLine(UIModel *model, const RedrawOpGridLine *op);
+// Returns false if the region was out of bounds
+bool RedrawApplyGridScroll(UIModel *model, const RedrawOpGridScroll *op);
+void RedrawApplyCursorGoto(UIModel *model, const RedrawOpCursorGoto *op);
+void RedrawApplyModeInfoSet(UIModel *model, const RedrawOpModeInfoSet *op);
+void RedrawApplyModeChange(UIModel *model, const RedrawOpModeChange *op);
+void RedrawApplyWinPos(UIModel *model, const RedrawOpWinPos *op);
+void RedrawApplyWinFloatPos(UIModel *model, const RedrawOpWinFloatPos *op);
+void RedrawApplyMsgSetPos(UIModel *model, const RedrawOpMsgSetPos *op);
+// Used for win_hide and win_close, the grid lives on until grid_destroy
+void RedrawApplyWinHide(UIModel *model, const RedrawOpGrid *op);
+void RedrawApplyGridDestroy(UIModel *model, const RedrawOpGrid *op);
+// Applies any op to the model, for driving the model without a renderer.
+// A flush clears the dirty rows as if they had been drawn.
+void RedrawApplyOp(UIModel *model, const RedrawOp *op);
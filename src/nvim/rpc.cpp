@@ -0,0 +1,249 @@
+#include "rpc.h"
+#include <cstdlib>
+#include "common/clock.h"
+#include "common/mpack_cursor.h"
+#include "common/mpack_helper.h"
+#include "third_party/mpack/mpack.h"
+
+void NvimRpcReaderInitialize(NvimRpcReader *reader, void *io_context, NvimRpcReadFn read) {
+	reader->io_context = io_context;
+	reader->read = read;
+	reader->capacity = NVIM_RPC_READER_INITIAL_CAPACITY;
+	reader->buffer = static_cast<char *>(malloc(reader->capacity));
+	reader->begin = 0;
+	reader->end = 0;
+	reader->scan_pos = 0;
+	reader->scan_values_remaining = 1;
+}
+
+void NvimRpcReaderDestroy(NvimRpcReader *reader) {
+	free(reader->buffer);
+	reader->buffer = nullptr;
+}
+
+static MPackScanResult ScanBufferedData(NvimRpcReader *reader) {
+	const uint8_t *buffer = reinterpret_cast<const uint8_t *>(reader->buffer);
+	const uint8_t *scan_pos = buffer + reader->scan_pos;
+	MPackScanResult result = MPackScanValues(&scan_pos, buffer + reader->end, &reader->scan_values_remaining);
+	reader->scan_pos = scan_pos - buffer;
+	return result;
+}
+
+bool NvimRpcReaderHasMessage(NvimRpcReader *reader) {
+	// The scan progress is kept, so the following NvimRpcReaderNext
+	// doesn't have to go over the same bytes again
+	return ScanBufferedData(reader) != MPackScanResult::Truncated;
+}
+
+bool NvimRpcReaderNext(NvimRpcReader *reader, const char **data, size_t *size) {
+	while (true) {
+		MPackScanResult result = ScanBufferedData(reader);
+
+		if (result == MPackScanResult::Complete) {
+			*data = reader->buffer + reader->begin;
+			*size = reader->scan_pos - reader->begin;
+			reader->begin = reader->scan_pos;
+			reader->scan_values_remaining = 1;
+			return true;
+		}
+		if (result == MPackScanResult::Invalid) {
+			return false;
+		}
+
+		// Need more data, move the partial message to the front of the
+		// buffer and grow the buffer if the message doesn't fit
+		if (reader->begin > 0) {
+			size_t partial = reader->end - reader->begin;
+			memmove(reader->buffer, reader->buffer + reader->begin, partial);
+			reader->scan_pos -= reader->begin;
+			reader->end = partial;
+			reader->begin = 0;
+		}
+		if (reader->end == reader->capacity) {
+			reader->capacity *= 2;
+			reader->buffer = static_cast<char *>(realloc(reader->buffer, reader->capacity));
+		}
+
+		size_t bytes_read = reader->read(reader->io_context, reader->buffer + reader->end, reader->capacity - reader->end);
+		if (bytes_read == 0) {
+			return false;
+		}
+		reader->end += bytes_read;
+	}
+}
+
+void NvimRpcInitialize(NvimRpc *rpc, void *io_context, NvimRpcWriteFn write) {
+	rpc->io_context = io_context;
+	rpc->write = write;
+	rpc->outbound_message_count = 0;
+	rpc->batching = false;
+	rpc->write_stats = NvimRpcWriteStats {};
+	rpc->write_stats.start_time_ns = ClockNanoseconds();
+}
+
+void NvimRpcBeginBatch(NvimRpc *rpc) {
+	rpc->batching = true;
+}
+
+bool NvimRpcFlush(NvimRpc *rpc) {
+	rpc->batching = false;
+
+	size_t size = rpc->outbound.size();
+	if (size == 0) {
+		return true;
+	}
+
+	int64_t start_time_ns = ClockNanoseconds();
+	bool written = rpc->write(rpc->io_context, rpc->outbound.data(), size);
+
+	NvimRpcWriteStats *stats = &rpc->write_stats;
+	stats->write_time_ns += ClockNanoseconds() - start_time_ns;
+	stats->write_count++;
+	stats->message_count += rpc->outbound_message_count;
+	stats->byte_count += size;
+	if (rpc->outbound_message_count > stats->max_messages_per_write) {
+		stats->max_messages_per_write = rpc->outbound_message_count;
+	}
+
+	// Keeps the committed pages around for the next batch
+	rpc->outbound.resize(0);
+	rpc->outbound_message_count = 0;
+	return written;
+}
+
+int64_t NvimRpcRegisterRequest(NvimRpc *rpc, NvimRequest request) {
+	rpc->msg_id_to_method.push_back(request);
+	return rpc->next_msg_id++;
+}
+
+NvimRequest NvimRpcRequestMethod(NvimRpc *rpc, int64_t msg_id) {
+	assert(msg_id < rpc->next_msg_id);
+	return rpc->msg_id_to_method[msg_id];
+}
+
+// Starts a message at the end of the outbound buffer
+static char *StartMessage(NvimRpc *rpc, mpack_writer_t *writer) {
+	size_t offset = rpc->outbound.size();
+	rpc->outbound.resize(offset + MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
+	char *data = rpc->outbound.data() + offset;
+	mpack_writer_init(writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
+	return data;
+}
+
+static bool WriteMessage(NvimRpc *rpc, mpack_writer_t *writer, char *data) {
+	size_t size = MPackFinishMessage(writer);
+	rpc->outbound.resize(data - rpc->outbound.data() + size);
+	rpc->outbound_message_count++;
+	if (rpc->batching) {
+		return true;
+	}
+	return NvimRpcFlush(rpc);
+}
+
+bool NvimRpcGetApiInfo(NvimRpc *rpc) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartRequest(NvimRpcRegisterRequest(rpc, vim_get_api_info), NVIM_REQUEST_NAMES[vim_get_api_info], &writer);
+	mpack_start_array(&writer, 0);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcSetVar(NvimRpc *rpc, const char *name, int value) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_set_var], &writer);
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, name);
+	mpack_write_int(&writer, value);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcCommand(NvimRpc *rpc, const char *command) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartRequest(NvimRpcRegisterRequest(rpc, nvim_command), NVIM_REQUEST_NAMES[nvim_command], &writer);
+	mpack_start_array(&writer, 1);
+	mpack_write_cstr(&writer, command);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcInput(NvimRpc *rpc, const char *input) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartRequest(NvimRpcRegisterRequest(rpc, nvim_input), NVIM_REQUEST_NAMES[nvim_input], &writer);
+	mpack_start_array(&writer, 1);
+	mpack_write_cstr(&writer, input);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcInputMouse(NvimRpc *rpc, const char *button, const char *action,
+	const char *modifiers, int grid, int row, int col) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartRequest(NvimRpcRegisterRequest(rpc, nvim_input_mouse), NVIM_REQUEST_NAMES[nvim_input_mouse], &writer);
+	mpack_start_array(&writer, 6);
+	mpack_write_cstr(&writer, button);
+	mpack_write_cstr(&writer, action);
+	mpack_write_cstr(&writer, modifiers);
+	mpack_write_i64(&writer, grid);
+	mpack_write_i64(&writer, row);
+	mpack_write_i64(&writer, col);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcGetOptionValue(NvimRpc *rpc, const char *option) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartRequest(NvimRpcRegisterRequest(rpc, nvim_get_option_value), NVIM_REQUEST_NAMES[nvim_get_option_value], &writer);
+	mpack_start_array(&writer, 2);
+	mpack_write_cstr(&writer, option);
+	mpack_start_map(&writer, 0);
+	mpack_finish_map(&writer);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcUIAttach(NvimRpc *rpc, int grid_rows, int grid_cols) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_ui_attach], &writer);
+	mpack_start_array(&writer, 3);
+	mpack_write_int(&writer, grid_cols);
+	mpack_write_int(&writer, grid_rows);
+	mpack_start_map(&writer, 2);
+	mpack_write_cstr(&writer, "ext_linegrid");
+	mpack_write_true(&writer);
+	// Every window gets a grid of its own, composed into the screen at flush
+	mpack_write_cstr(&writer, "ext_multigrid");
+	mpack_write_true(&writer);
+	mpack_finish_map(&writer);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcUITryResize(NvimRpc *rpc, int grid_rows, int grid_cols) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	MPackStartNotification(NVIM_OUTBOUND_NOTIFICATION_NAMES[nvim_ui_try_resize], &writer);
+	mpack_start_array(&writer, 2);
+	mpack_write_int(&writer, grid_cols);
+	mpack_write_int(&writer, grid_rows);
+	mpack_finish_array(&writer);
+	return WriteMessage(rpc, &writer, data);
+}
+
+bool NvimRpcResponse(NvimRpc *rpc, int64_t req_id) {
+	mpack_writer_t writer;
+	char *data = StartMessage(rpc, &writer);
+	mpack_start_array(&writer, 4);
+	mpack_write_i64(&writer, static_cast<int64_t>(MPackMessageType::Response));
+	mpack_write_i64(&writer, req_id);
+	mpack_write_nil(&writer);
+	mpack_write_int(&writer, 0);
+	return WriteMessage(rpc, &writer, data);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "common/vec.h"
+
+enum NvimRequest : uint8_t {
+	vim_get_api_info = 0,
+	nvim_input = 1,
+	nvim_input_mouse = 2,
+	nvim_command = 3,
+	nvim_get_option_value = 4
+};
+constexpr const char *NVIM_REQUEST_NAMES[] {
+	"nvim_get_api_info",
+	"nvim_input",
+	"nvim_input_mouse",
+	"nvim_command",
+	"nvim_get_option_value"
+};
+enum NvimOutboundNotification : uint8_t {
+	nvim_ui_attach = 0,
+	nvim_ui_try_resize = 1,
+	nvim_set_var = 2
+};
+constexpr const char *NVIM_OUTBOUND_NOTIFICATION_NAMES[] {
+	"nvim_ui_attach",
+	"nvim_ui_try_resize",
+	"nvim_set_var"
+};
+constexpr int MAX_MPACK_OUTBOUND_MESSAGE_SIZE = 4096;
+
+// Writes an encoded message to nvim, returns false if the write failed
+using NvimRpcWriteFn = bool (*)(void *io_context, const void *data, size_t size);
+// Reads up to `count` bytes from nvim, blocking until some are available.
+// Returns 0 once the connection is closed or broken.
+using NvimRpcReadFn = size_t (*)(void *io_context, char *buffer, size_t count);
+
+// Totals over the lifetime of the connection, messages per write shows
+// how well input is being batched
+struct NvimRpcWriteStats {
+	uint64_t write_count;
+	uint64_t message_count;
+	uint64_t byte_count;
+	uint64_t max_messages_per_write;
+	// Time spent blocked in the write callback
+	int64_t write_time_ns;
+	// When the connection was set up, for the overall rate
+	int64_t start_time_ns;
+};
+
+// The platform independent half of the nvim connection. Keeps track of
+// outstanding requests and encodes outbound messages, the actual I/O
+// is done through the write callback supplied by the front end.
+struct NvimRpc {
+	int64_t next_msg_id;
+	Vec<NvimRequest> msg_id_to_method;
+
+	void *io_context;
+	NvimRpcWriteFn write;
+
+	// Messages are encoded straight into this buffer and held back
+	// while batching, so a batch goes out with a single write
+	Vec<char> outbound;
+	uint64_t outbound_message_count;
+	bool batching;
+	NvimRpcWriteStats write_stats;
+};
+
+constexpr size_t NVIM_RPC_READER_INITIAL_CAPACITY = MEGABYTES(1);
+
+// Splits the inbound byte stream into complete msgpack-rpc messages.
+// Messages are only framed, not parsed, and are handed out as spans of
+// the read buffer so they can be decoded in place.
+struct NvimRpcReader {
+	void *io_context;
+	NvimRpcReadFn read;
+
+	char *buffer;
+	size_t capacity;
+	size_t begin;
+	size_t end;
+
+	// Resumable framing state of the message starting at `begin`
+	size_t scan_pos;
+	uint64_t scan_values_remaining;
+};
+
+void NvimRpcReaderInitialize(NvimRpcReader *reader, void *io_context, NvimRpcReadFn read);
+void NvimRpcReaderDestroy(NvimRpcReader *reader);
+// Blocks until the next complete message has been read. The span stays
+// valid until the next call, returns false on EOF or malformed input.
+bool NvimRpcReaderNext(NvimRpcReader *reader, const char **data, size_t *size);
+// Returns true if the next call to NvimRpcReaderNext won't have to block
+bool NvimRpcReaderHasMessage(NvimRpcReader *reader);
+
+void NvimRpcInitialize(NvimRpc *rpc, void *io_context, NvimRpcWriteFn write);
+// Holds back outbound messages until NvimRpcFlush, the front end batches
+// everything produced in one iteration of its message loop. Outside of a
+// batch every message is written as soon as it is encoded.
+void NvimRpcBeginBatch(NvimRpc *rpc);
+// Writes the held back messages in order with a single write and ends
+// the batch, returns false if the write failed
+bool NvimRpcFlush(NvimRpc *rpc);
+int64_t NvimRpcRegisterRequest(NvimRpc *rpc, NvimRequest request);
+NvimRequest NvimRpcRequestMethod(NvimRpc *rpc, int64_t msg_id);
+
+bool NvimRpcGetApiInfo(NvimRpc *rpc);
+bool NvimRpcSetVar(NvimRpc *rpc, const char *name, int value);
+bool NvimRpcCommand(NvimRpc *rpc, const char *command);
+bool NvimRpcInput(NvimRpc *rpc, const char *input);
+bool NvimRpcInputMouse(NvimRpc *rpc, const char *button, const char *action,
+	const char *modifiers, int grid, int row, int col);
+bool NvimRpcGetOptionValue(NvimRpc *rpc, const char *option);
+bool NvimRpcUIAttach(NvimRpc *rpc, int grid_rows, int grid_cols);
+bool NvimRpcUITryResize(NvimRpc *rpc, int grid_rows, int grid_cols);
+bool NvimRpcResponse(NvimRpc *rpc, int64_t req_id);
@@ -0,0 +1,403 @@
+#ifdef _WIN32
+// Must come before windows.h, which otherwise drags in the old winsock.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "transport.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+using Socket = SOCKET;
+constexpr Socket INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+static void CloseSocket(Socket socket) {
+	closesocket(socket);
+}
+#else
+using Socket = int;
+constexpr Socket INVALID_SOCKET_HANDLE = -1;
+static void CloseSocket(Socket socket) {
+	close(socket);
+}
+#endif
+
+#ifdef MSG_NOSIGNAL
+// Report a closed connection as a failed write instead of raising SIGPIPE
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Splits `host:port` (or `[v6 host]:port`), returns false if the
+// address doesn't end in a port and so names a pipe or socket path
+static bool ParseTcpAddress(const char *address, char *host, size_t host_size, const char **port) {
+	if (address[0] == '/' || address[0] == '\\' || address[0] == '.') {
+		return false;
+	}
+	const char *separator = strrchr(address, ':');
+	if (separator == nullptr || separator[1] == '\0') {
+		return false;
+	}
+	for (const char *c = separator + 1; *c; ++c) {
+		if (*c < '0' || *c > '9') {
+			return false;
+		}
+	}
+
+	const char *host_begin = address;
+	const char *host_end = separator;
+	if (*host_begin == '[' && host_end > host_begin && host_end[-1] == ']') {
+		++host_begin;
+		--host_end;
+	}
+	size_t host_length = static_cast<size_t>(host_end - host_begin);
+	if (host_length == 0 || host_length >= host_size) {
+		return false;
+	}
+	memcpy(host, host_begin, host_length);
+	host[host_length] = '\0';
+	*port = separator + 1;
+	return true;
+}
+
+static void InitializeSockets() {
+#ifdef _WIN32
+	// Reference counted by winsock, never cleaned up as Nvy only exits once
+	WSADATA wsa_data;
+	WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+static void SetSocketOptions(Socket socket, NvimTransportKind kind) {
+	int buffer_size = NVIM_TRANSPORT_BUFFER_SIZE;
+	setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char *>(&buffer_size), sizeof(buffer_size));
+	setsockopt(socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char *>(&buffer_size), sizeof(buffer_size));
+	if (kind == NvimTransportKind::Tcp) {
+		// Keystrokes are tiny writes that must go out immediately
+		int no_delay = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&no_delay), sizeof(no_delay));
+	}
+#if defined(SO_NOSIGPIPE)
+	int no_sigpipe = 1;
+	setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+}
+
+// The socket's options must be set already
+static void InitializeSocket(NvimTransport *transport, NvimTransportKind kind, Socket socket) {
+	*transport = NvimTransport {};
+	transport->kind = kind;
+#ifdef _WIN32
+	transport->read_handle = INVALID_HANDLE_VALUE;
+	transport->write_handle = INVALID_HANDLE_VALUE;
+	transport->socket = static_cast<uintptr_t>(socket);
+#else
+	transport->read_fd = socket;
+	transport->write_fd = socket;
+#endif
+}
+
+static bool MakeUnixAddress(const char *path, sockaddr_un *address) {
+	*address = sockaddr_un {};
+	address->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address->sun_path)) {
+		return false;
+	}
+	strcpy(address->sun_path, path);
+	return true;
+}
+
+// Returns a connected or listening socket for `address`, a connected one
+// with its options set
+static Socket OpenSocket(const char *address, bool listen_socket, NvimTransportKind *kind) {
+	InitializeSockets();
+
+	char host[256];
+	const char *port;
+	if (!ParseTcpAddress(address, host, sizeof(host), &port)) {
+		*kind = NvimTransportKind::UnixSocket;
+		sockaddr_un unix_address;
+		if (!MakeUnixAddress(address, &unix_address)) {
+			return INVALID_SOCKET_HANDLE;
+		}
+		Socket unix_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (unix_socket == INVALID_SOCKET_HANDLE) {
+			return INVALID_SOCKET_HANDLE;
+		}
+		const sockaddr *socket_address = reinterpret_cast<const sockaddr *>(&unix_address);
+		bool success;
+		if (listen_socket) {
+			success = bind(unix_socket, socket_address, sizeof(unix_address)) == 0 && listen(unix_socket, 1) == 0;
+		}
+		else {
+			SetSocketOptions(unix_socket, NvimTransportKind::UnixSocket);
+			success = connect(unix_socket, socket_address, sizeof(unix_address)) == 0;
+		}
+		if (!success) {
+			CloseSocket(unix_socket);
+			return INVALID_SOCKET_HANDLE;
+		}
+		return unix_socket;
+	}
+
+	*kind = NvimTransportKind::Tcp;
+	addrinfo hints {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = listen_socket ? AI_PASSIVE : 0;
+	addrinfo *addresses;
+	if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+		return INVALID_SOCKET_HANDLE;
+	}
+
+	Socket tcp_socket = INVALID_SOCKET_HANDLE;
+	for (addrinfo *info = addresses; info; info = info->ai_next) {
+		tcp_socket = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if (tcp_socket == INVALID_SOCKET_HANDLE) {
+			continue;
+		}
+		bool success;
+		if (listen_socket) {
+			int reuse_address = 1;
+			setsockopt(tcp_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse_address), sizeof(reuse_address));
+			success = bind(tcp_socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0 && listen(tcp_socket, 1) == 0;
+		}
+		else {
+			// Size the buffers before connecting, the window scale is fixed by the handshake
+			SetSocketOptions(tcp_socket, NvimTransportKind::Tcp);
+			success = connect(tcp_socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0;
+		}
+		if (success) {
+			break;
+		}
+		CloseSocket(tcp_socket);
+		tcp_socket = INVALID_SOCKET_HANDLE;
+	}
+	freeaddrinfo(addresses);
+	return tcp_socket;
+}
+
+void NvimTransportInitializePipes(NvimTransport *transport, NvimTransportHandle read, NvimTransportHandle write) {
+	*transport = NvimTransport {};
+	transport->kind = NvimTransportKind::Pipe;
+#ifdef _WIN32
+	transport->read_handle = read;
+	transport->write_handle = write;
+	transport->socket = static_cast<uintptr_t>(INVALID_SOCKET);
+#else
+	transport->read_fd = read;
+	transport->write_fd = write;
+#endif
+}
+
+bool NvimTransportConnect(NvimTransport *transport, const char *address) {
+#ifdef _WIN32
+	if (!strncmp(address, "\\\\.\\pipe\\", strlen("\\\\.\\pipe\\"))) {
+		HANDLE pipe = CreateFileA(address, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+			OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+		if (pipe == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		*transport = NvimTransport {
+			.kind = NvimTransportKind::NamedPipe,
+			.read_handle = pipe,
+			.write_handle = pipe,
+			.read_event = CreateEventW(nullptr, TRUE, FALSE, nullptr),
+			.write_event = CreateEventW(nullptr, TRUE, FALSE, nullptr),
+			.socket = static_cast<uintptr_t>(INVALID_SOCKET)
+		};
+		return true;
+	}
+#endif
+
+	NvimTransportKind kind;
+	Socket socket = OpenSocket(address, false, &kind);
+	if (socket == INVALID_SOCKET_HANDLE) {
+		return false;
+	}
+	InitializeSocket(transport, kind, socket);
+	return true;
+}
+
+bool NvimTransportAccept(NvimTransport *transport, const char *address) {
+	NvimTransportKind kind;
+	Socket listen_socket = OpenSocket(address, true, &kind);
+	if (listen_socket == INVALID_SOCKET_HANDLE) {
+		return false;
+	}
+	Socket socket = accept(listen_socket, nullptr, nullptr);
+	CloseSocket(listen_socket);
+	if (kind == NvimTransportKind::UnixSocket) {
+		remove(address);
+	}
+	if (socket == INVALID_SOCKET_HANDLE) {
+		return false;
+	}
+	SetSocketOptions(socket, kind);
+	InitializeSocket(transport, kind, socket);
+	return true;
+}
+
+void NvimTransportShutdown(NvimTransport *transport) {
+#ifdef _WIN32
+	switch (transport->kind) {
+	case NvimTransportKind::Pipe: {
+		// Only connections to a server are shut down, a child's pipes
+		// break when the child exits
+	} break;
+	case NvimTransportKind::NamedPipe: {
+		CancelIoEx(transport->read_handle, nullptr);
+	} break;
+	case NvimTransportKind::UnixSocket:
+	case NvimTransportKind::Tcp: {
+		shutdown(static_cast<SOCKET>(transport->socket), SD_BOTH);
+	} break;
+	}
+#else
+	if (transport->kind != NvimTransportKind::Pipe) {
+		shutdown(transport->read_fd, SHUT_RDWR);
+	}
+#endif
+}
+
+void NvimTransportClose(NvimTransport *transport) {
+#ifdef _WIN32
+	switch (transport->kind) {
+	case NvimTransportKind::Pipe: {
+		CloseHandle(transport->read_handle);
+		CloseHandle(transport->write_handle);
+	} break;
+	case NvimTransportKind::NamedPipe: {
+		CloseHandle(transport->read_handle);
+		CloseHandle(transport->read_event);
+		CloseHandle(transport->write_event);
+	} break;
+	case NvimTransportKind::UnixSocket:
+	case NvimTransportKind::Tcp: {
+		closesocket(static_cast<SOCKET>(transport->socket));
+	} break;
+	}
+	transport->read_handle = INVALID_HANDLE_VALUE;
+	transport->write_handle = INVALID_HANDLE_VALUE;
+	transport->socket = static_cast<uintptr_t>(INVALID_SOCKET);
+#else
+	if (transport->read_fd >= 0) {
+		close(transport->read_fd);
+	}
+	if (transport->write_fd >= 0 && transport->write_fd != transport->read_fd) {
+		close(transport->write_fd);
+	}
+	transport->read_fd = -1;
+	transport->write_fd = -1;
+#endif
+}
+
+#ifdef _WIN32
+// Blocks until an overlapped read or write on a named pipe has completed
+static DWORD NamedPipeIo(HANDLE pipe, HANDLE event, bool write, void *buffer, DWORD count) {
+	OVERLAPPED overlapped {};
+	overlapped.hEvent = event;
+	ResetEvent(event);
+	BOOL success = write ?
+		WriteFile(pipe, buffer, count, nullptr, &overlapped) :
+		ReadFile(pipe, buffer, count, nullptr, &overlapped);
+	if (!success && GetLastError() != ERROR_IO_PENDING) {
+		return 0;
+	}
+	DWORD bytes_transferred;
+	if (!GetOverlappedResult(pipe, &overlapped, &bytes_transferred, TRUE)) {
+		return 0;
+	}
+	return bytes_transferred;
+}
+#endif
+
+size_t NvimTransportRead(void *io_context, char *buffer, size_t count) {
+	NvimTransport *transport = static_cast<NvimTransport *>(io_context);
+	// Reads go straight into the RPC reader's buffer and ask for all of
+	// its free space, which is as much read-ahead as a transport can do
+#ifdef _WIN32
+	DWORD capped_count = static_cast<DWORD>(count < MAXDWORD ? count : MAXDWORD);
+	switch (transport->kind) {
+	case NvimTransportKind::Pipe: {
+		DWORD bytes_read;
+		if (!ReadFile(transport->read_handle, buffer, capped_count, &bytes_read, nullptr)) {
+			return 0;
+		}
+		return bytes_read;
+	}
+	case NvimTransportKind::NamedPipe: {
+		return NamedPipeIo(transport->read_handle, transport->read_event, false, buffer, capped_count);
+	}
+	case NvimTransportKind::UnixSocket:
+	case NvimTransportKind::Tcp: {
+		int bytes_read = recv(static_cast<SOCKET>(transport->socket), buffer,
+			static_cast<int>(count < INT_MAX ? count : INT_MAX), 0);
+		return bytes_read > 0 ? static_cast<size_t>(bytes_read) : 0;
+	}
+	}
+	return 0;
+#else
+	while (true) {
+		ssize_t bytes_read = read(transport->read_fd, buffer, count);
+		if (bytes_read < 0 && errno == EINTR) {
+			continue;
+		}
+		return bytes_read > 0 ? static_cast<size_t>(bytes_read) : 0;
+	}
+#endif
+}
+
+bool NvimTransportWrite(void *io_context, const void *data, size_t size) {
+	NvimTransport *transport = static_cast<NvimTransport *>(io_context);
+	const char *bytes = static_cast<const char *>(data);
+	while (size > 0) {
+		size_t bytes_written;
+#ifdef _WIN32
+		DWORD capped_size = static_cast<DWORD>(size < MAXDWORD ? size : MAXDWORD);
+		switch (transport->kind) {
+		case NvimTransportKind::Pipe: {
+			DWORD written;
+			if (!WriteFile(transport->write_handle, bytes, capped_size, &written, nullptr)) {
+				return false;
+			}
+			bytes_written = written;
+		} break;
+		case NvimTransportKind::NamedPipe: {
+			bytes_written = NamedPipeIo(transport->write_handle, transport->write_event, true,
+				const_cast<char *>(bytes), capped_size);
+		} break;
+		case NvimTransportKind::UnixSocket:
+		case NvimTransportKind::Tcp: {
+			int sent = send(static_cast<SOCKET>(transport->socket), bytes,
+				static_cast<int>(size < INT_MAX ? size : INT_MAX), 0);
+			bytes_written = sent > 0 ? static_cast<size_t>(sent) : 0;
+		} break;
+		}
+#else
+		ssize_t sent = transport->kind == NvimTransportKind::Pipe ?
+			write(transport->write_fd, bytes, size) :
+			send(transport->write_fd, bytes, size, SEND_FLAGS);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		bytes_written = sent > 0 ? static_cast<size_t>(sent) : 0;
+#endif
+		if (bytes_written == 0) {
+			return false;
+		}
+		bytes += bytes_written;
+		size -= bytes_written;
+	}
+	return true;
+}
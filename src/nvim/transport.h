@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// The byte stream between Nvy and nvim. Either the stdio pipes of a child
+// `nvim --embed`, or a connection to a running `nvim --listen` over a Unix
+// domain socket, a Windows named pipe or TCP.
+enum class NvimTransportKind : uint8_t {
+	Pipe,
+	NamedPipe,
+	UnixSocket,
+	Tcp
+};
+
+// Pipes and socket buffers are sized to hold a full screen repaint,
+// so nvim rarely has to block on the UI while it is busy drawing
+constexpr int NVIM_TRANSPORT_BUFFER_SIZE = 1024 * 1024;
+
+#ifdef _WIN32
+using NvimTransportHandle = HANDLE;
+#else
+using NvimTransportHandle = int;
+#endif
+
+struct NvimTransport {
+	NvimTransportKind kind;
+#ifdef _WIN32
+	// Pipes and named pipes, the same handle for both directions of a named pipe
+	HANDLE read_handle;
+	HANDLE write_handle;
+	// Named pipes are opened for overlapped I/O so a pending read
+	// doesn't block writes from the UI thread
+	HANDLE read_event;
+	HANDLE write_event;
+	// A SOCKET, kept as an integer so this header doesn't pull in winsock
+	uintptr_t socket;
+#else
+	// The same descriptor for both directions of a socket
+	int read_fd;
+	int write_fd;
+#endif
+};
+
+// Takes ownership of the two ends of a pair of pipes
+void NvimTransportInitializePipes(NvimTransport *transport, NvimTransportHandle read, NvimTransportHandle write);
+// Addresses take the same form as `nvim --listen`: `host:port` for TCP,
+// `\\.\pipe\name` for a named pipe and a path for a Unix domain socket
+bool NvimTransportConnect(NvimTransport *transport, const char *address);
+// Waits for a single client to connect to `address`, used by the stand-in
+// nvim. Only sockets can be listened on.
+bool NvimTransportAccept(NvimTransport *transport, const char *address);
+// Stops both directions of a connection to a server, waking up a thread
+// blocked in a read. Does nothing to the pipes of a child.
+void NvimTransportShutdown(NvimTransport *transport);
+void NvimTransportClose(NvimTransport *transport);
+
+// Usable as NvimRpcReadFn and NvimRpcWriteFn, with the transport as io_context
+size_t NvimTransportRead(void *io_context, char *buffer, size_t count);
+bool NvimTransportWrite(void *io_context, const void *data, size_t size);
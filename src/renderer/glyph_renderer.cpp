@@ -36,13 +36,12 @@ HRESULT GlyphRenderer::DrawGlyphRun(void *client_drawing_context, float baseline
 	
 	if (client_drawing_effect)
 	{
-		GlyphDrawingEffect *drawing_effect;
-		client_drawing_effect->QueryInterface(__uuidof(GlyphDrawingEffect), reinterpret_cast<void **>(&drawing_effect));
-		drawing_effect_brush->SetColor(D2D1::ColorF(drawing_effect->text_color));
-		SafeRelease(&drawing_effect);
+		// Every effect comes from the renderer's pool, no need to ask
+		GlyphDrawingEffect *drawing_effect = static_cast<GlyphDrawingEffect *>(client_drawing_effect);
+		drawing_effect_brush->SetColor(drawing_effect->text_color);
 	}
 	else {
-		drawing_effect_brush->SetColor(D2D1::ColorF(renderer->hl_attribs[0].foreground));
+		drawing_effect_brush->SetColor(D2DColor(renderer->model.hl_colors.colors[0].foreground));
 	}
 
 	DWRITE_GLYPH_IMAGE_FORMATS supported_formats =
@@ -163,15 +162,12 @@ HRESULT GlyphRenderer::DrawLine(void *client_drawing_context, float baseline_ori
 
 	if (client_drawing_effect)
 	{
-		GlyphDrawingEffect *drawing_effect;
-		client_drawing_effect->QueryInterface(__uuidof(GlyphDrawingEffect), reinterpret_cast<void **>(&drawing_effect));
-		uint32_t line_color = use_special_color ? drawing_effect->special_color : drawing_effect->text_color;
-		temp_brush->SetColor(D2D1::ColorF(line_color));
-		SafeRelease(&drawing_effect);
+		GlyphDrawingEffect *drawing_effect = static_cast<GlyphDrawingEffect *>(client_drawing_effect);
+		temp_brush->SetColor(use_special_color ? drawing_effect->special_color : drawing_effect->text_color);
 	}
 	else {
-		uint32_t line_color = use_special_color ? renderer->hl_attribs[0].special : renderer->hl_attribs[0].foreground;
-		temp_brush->SetColor(D2D1::ColorF(line_color));
+		const ResolvedColors *default_colors = &renderer->model.hl_colors.colors[0];
+		temp_brush->SetColor(D2DColor(use_special_color ? default_colors->special : default_colors->foreground));
 	} 
 
 	D2D1_RECT_F rect = D2D1_RECT_F {
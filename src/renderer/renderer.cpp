@@ -1,4 +1,6 @@
 #include "renderer.h"
+#include "common/utf8.h"
+#include "model/cell_glyphs.h"
 #include "renderer/glyph_renderer.h"
 
 void InitializeD2D(Renderer *renderer) {
@@ -51,6 +53,7 @@ void InitializeDWrite(Renderer *renderer) {
 			.parameter = 0		
 		}));
 	}
+	WIN_CHECK(renderer->dwrite_factory->CreateTextAnalyzer(&renderer->dwrite_text_analyzer));
 }
 
 void HandleDeviceLost(Renderer *renderer);
@@ -155,7 +158,10 @@ void HandleDeviceLost(Renderer *renderer) {
 	SafeRelease(&renderer->d2d_background_rect_brush);
 	SafeRelease(&renderer->dwrite_factory);
 	SafeRelease(&renderer->dwrite_text_format);
+	SafeRelease(&renderer->dwrite_text_analyzer);
 	delete renderer->glyph_renderer;
+	// The cached layouts belong to the old factory
+	LayoutCacheClear(&renderer->layout_cache);
 
 	InitializeD2D(renderer);
 	InitializeD3D(renderer);
@@ -169,13 +175,30 @@ void HandleDeviceLost(Renderer *renderer) {
 	);
 }
 
-void RendererInitialize(Renderer *renderer, HWND hwnd, bool disable_ligatures, float linespace_factor, float monitor_dpi) {
+void ReleaseRowLayout(void *layout) {
+	static_cast<IDWriteTextLayout1 *>(layout)->Release();
+}
+
+// The pool holds a reference to every effect, layouts that still use one
+// keep it alive after the pool let go of it
+void *CreateDrawingEffect(const ColorRGBA *foreground, const ColorRGBA *special) {
+	GlyphDrawingEffect *drawing_effect = new GlyphDrawingEffect(D2DColor(*foreground), D2DColor(*special));
+	drawing_effect->AddRef();
+	return drawing_effect;
+}
+
+void ReleaseDrawingEffect(void *drawing_effect) {
+	static_cast<GlyphDrawingEffect *>(drawing_effect)->Release();
+}
+
+void RendererInitialize(Renderer *renderer, HWND hwnd, bool disable_ligatures, bool glyph_runs, float linespace_factor, float monitor_dpi) {
 	renderer->hwnd = hwnd;
 	renderer->disable_ligatures = disable_ligatures;
+	renderer->glyph_runs = glyph_runs;
 	renderer->linespace_factor = linespace_factor;
 
 	renderer->dpi_scale = monitor_dpi / 96.0f;
-	renderer->hl_attribs.resize(MAX_HIGHLIGHT_ATTRIBS);
+	UIModelInitialize(&renderer->model);
 
 	wcscpy_s(renderer->fallback_font, MAX_FONT_LENGTH, L"Consolas");
 
@@ -183,6 +206,9 @@ void RendererInitialize(Renderer *renderer, HWND hwnd, bool disable_ligatures, f
 	InitializeD3D(renderer);
 	InitializeDWrite(renderer);
 	renderer->glyph_renderer = new GlyphRenderer(renderer);
+	LayoutCacheInitialize(&renderer->layout_cache, DEFAULT_LAYOUT_CACHE_CAPACITY, ReleaseRowLayout);
+	GlyphCacheInitialize(&renderer->glyph_cache);
+	EffectPoolInitialize(&renderer->effect_pool, MAX_HIGHLIGHT_ATTRIBS, CreateDrawingEffect, ReleaseDrawingEffect);
 	RendererUpdateFont(renderer, DEFAULT_FONT_SIZE, DEFAULT_FONT, static_cast<int>(strlen(DEFAULT_FONT)));
 }
 
@@ -197,6 +223,9 @@ void RendererAttach(Renderer *renderer) {
 }
 
 void RendererShutdown(Renderer *renderer) {
+	LayoutCacheFree(&renderer->layout_cache);
+	GlyphCacheFree(&renderer->glyph_cache);
+	EffectPoolFree(&renderer->effect_pool);
 	SafeRelease(&renderer->d3d_device);
 	SafeRelease(&renderer->d3d_context);
 	SafeRelease(&renderer->dxgi_swapchain);
@@ -207,37 +236,30 @@ void RendererShutdown(Renderer *renderer) {
 	SafeRelease(&renderer->d2d_background_rect_brush);
 	SafeRelease(&renderer->dwrite_factory);
 	SafeRelease(&renderer->dwrite_text_format);
+	SafeRelease(&renderer->dwrite_text_analyzer);
+	SafeRelease(&renderer->font_face_bold);
 	delete renderer->glyph_renderer;
 
-	free(renderer->grid_chars);
+	UIModelShutdown(&renderer->model);
 	free(renderer->wchar_buffer);
-	free(renderer->grid_cell_properties);
+	GlyphRunBuffers *buffers = &renderer->glyph_run_buffers;
+	free(buffers->text);
+	free(buffers->text_cells);
+	free(buffers->cluster_map);
+	free(buffers->text_props);
+	free(buffers->glyph_indices);
+	free(buffers->glyph_props);
+	free(buffers->glyph_advances);
 }
 
 void RendererResize(Renderer *renderer, uint32_t width, uint32_t height) {
 	InitializeWindowDependentResources(renderer, width, height);
 }
 
-bool ContainsSurrogatePair(uint32_t cell) {
-	return cell > 0xFFFF;
-}
-
 void ConvertToWide(Renderer *renderer, uint32_t *text, uint32_t length) {
-	size_t wchar_i = 0;
-	for (size_t i = 0; i < length; i++) {
-		// Unpack surrogate pairs into two sequential wchars.
-		if (ContainsSurrogatePair(text[i])) {
-			renderer->wchar_buffer[wchar_i] = static_cast<wchar_t>(text[i] >> 16);
-			renderer->wchar_buffer[wchar_i + 1] = static_cast<wchar_t>(text[i] & 0xFFFF);
-			wchar_i += 2;
-			continue;
-		}
-
-		renderer->wchar_buffer[wchar_i] = static_cast<wchar_t>(text[i]);
-		wchar_i += 1;
-	}
-
-	renderer->wchar_buffer_length = wchar_i;
+	// Unpacks surrogate pairs into two sequential wchars
+	static_assert(sizeof(wchar_t) == sizeof(uint16_t));
+	renderer->wchar_buffer_length = GridCharsToUtf16(text, length, reinterpret_cast<uint16_t *>(renderer->wchar_buffer));
 }
 
 float GetTextWidth(Renderer *renderer, uint32_t *text, uint32_t length) {
@@ -262,6 +284,38 @@ float GetTextWidth(Renderer *renderer, uint32_t *text, uint32_t length) {
 	return metrics.width;
 }
 
+// The glyph of a single cell, looked up and measured once per character
+// and font. Double width characters are measured together with the cell
+// they cover.
+GlyphMetrics GetCellGlyph(Renderer *renderer, uint32_t *grid_char, bool wide) {
+	return GlyphCacheGet(&renderer->glyph_cache, *grid_char, wide, [&]() {
+		GlyphMetrics metrics {};
+		uint32_t codepoint = GridCharToCodepoint(*grid_char);
+		WIN_CHECK(renderer->font_face->GetGlyphIndicesW(&codepoint, 1, &metrics.glyph_index));
+		metrics.advance = GetTextWidth(renderer, grid_char, wide ? 2 : 1);
+		return metrics;
+	});
+}
+
+// Looks up the glyph of every Latin-1 character in one go, with its
+// advance at the font size the cells were sized for
+void BuildLatin1Glyphs(Renderer *renderer) {
+	uint32_t codepoints[GLYPH_CACHE_LATIN1_CHARS];
+	for (uint32_t i = 0; i < GLYPH_CACHE_LATIN1_CHARS; ++i) {
+		codepoints[i] = i;
+	}
+	uint16_t glyph_indices[GLYPH_CACHE_LATIN1_CHARS];
+	WIN_CHECK(renderer->font_face->GetGlyphIndicesW(codepoints, GLYPH_CACHE_LATIN1_CHARS, glyph_indices));
+	int32_t design_advances[GLYPH_CACHE_LATIN1_CHARS];
+	WIN_CHECK(renderer->font_face->GetDesignGlyphAdvances(GLYPH_CACHE_LATIN1_CHARS, glyph_indices, design_advances));
+
+	float advances[GLYPH_CACHE_LATIN1_CHARS];
+	for (uint32_t i = 0; i < GLYPH_CACHE_LATIN1_CHARS; ++i) {
+		advances[i] = renderer->font_size * design_advances[i] / renderer->font_metrics.designUnitsPerEm;
+	}
+	GlyphCacheSetLatin1(&renderer->glyph_cache, glyph_indices, advances);
+}
+
 bool UpdateFontMetrics(Renderer *renderer, float font_size, const char* font_string, int strlen) {
 	font_size = max(5.0f, min(font_size, 150.0f));
 	renderer->last_requested_font_size = font_size;
@@ -315,13 +369,14 @@ bool UpdateFontMetrics(Renderer *renderer, float font_size, const char* font_str
 
 	IDWriteFontFace* font_face_bold;
 	WIN_CHECK(write_font_bold->CreateFontFace(&font_face_bold));
-	IDWriteFontFace1* font_size_scale_bold1;
-	WIN_CHECK(font_face_bold->QueryInterface<IDWriteFontFace1>(&font_size_scale_bold1));
+	// Kept for shaping bold runs into glyph runs
+	SafeRelease(&renderer->font_face_bold);
+	WIN_CHECK(font_face_bold->QueryInterface<IDWriteFontFace1>(&renderer->font_face_bold));
 	DWRITE_FONT_METRICS1 font_metrics_bold;
-	font_size_scale_bold1->GetMetrics(&font_metrics_bold);
+	renderer->font_face_bold->GetMetrics(&font_metrics_bold);
 
 	int32_t glyph_advance_in_em_bold;
-	WIN_CHECK(font_size_scale_bold1->GetDesignGlyphAdvances(1, &glyph_index, &glyph_advance_in_em_bold));
+	WIN_CHECK(renderer->font_face_bold->GetDesignGlyphAdvances(1, &glyph_index, &glyph_advance_in_em_bold));
 
 	float desired_height = font_size * renderer->dpi_scale * (DEFAULT_DPI / POINTS_PER_INCH);
 	float width_advance = static_cast<float>(glyph_advance_in_em) / renderer->font_metrics.designUnitsPerEm;
@@ -337,6 +392,7 @@ bool UpdateFontMetrics(Renderer *renderer, float font_size, const char* font_str
 	renderer->font_size = renderer->font_width / width_advance;
 
 	renderer->font_size_scale_bold = renderer->font_size * bold_scale;
+	BuildLatin1Glyphs(renderer);
 
 	float frac_font_ascent = (renderer->font_size * renderer->font_metrics.ascent) / renderer->font_metrics.designUnitsPerEm;
 	float frac_font_descent = (renderer->font_size * renderer->font_metrics.descent) / renderer->font_metrics.designUnitsPerEm;
@@ -379,92 +435,13 @@ bool RendererUpdateFont(Renderer *renderer, float font_size, const char *font_st
 	}
 
 	renderer->draws_invalidated = true;
+	renderer->font_generation++;
+	GlyphCacheClear(&renderer->glyph_cache);
 	return UpdateFontMetrics(renderer, font_size, font_string, strlen);
 }
 
-void UpdateDefaultColors(Renderer *renderer, mpack_node_t default_colors) {
-	size_t default_colors_arr_length = mpack_node_array_length(default_colors);
-
-	for (size_t i = 1; i < default_colors_arr_length; ++i) {
-		mpack_node_t color_arr = mpack_node_array_at(default_colors, i);
-
-		// Default colors occupy the first index of the highlight attribs array
-		renderer->hl_attribs[0].foreground = static_cast<uint32_t>(mpack_node_array_at(color_arr, 0).data->value.u);
-		renderer->hl_attribs[0].background = static_cast<uint32_t>(mpack_node_array_at(color_arr, 1).data->value.u);
-		renderer->hl_attribs[0].special = static_cast<uint32_t>(mpack_node_array_at(color_arr, 2).data->value.u);
-		renderer->hl_attribs[0].flags = 0;
-	}
-}
-
-void UpdateHighlightAttributes(Renderer *renderer, mpack_node_t highlight_attribs) {
-	uint64_t attrib_count = mpack_node_array_length(highlight_attribs);
-	for (uint64_t i = 1; i < attrib_count; ++i) {
-		int64_t attrib_index = mpack_node_array_at(mpack_node_array_at(highlight_attribs, i), 0).data->value.i;
-		assert(attrib_index <= MAX_HIGHLIGHT_ATTRIBS);
-
-		mpack_node_t attrib_map = mpack_node_array_at(mpack_node_array_at(highlight_attribs, i), 1);
-
-		const auto SetColor = [&](const char *name, uint32_t *color) {
-			mpack_node_t color_node = mpack_node_map_cstr_optional(attrib_map, name);
-			if (!mpack_node_is_missing(color_node)) {
-				*color = static_cast<uint32_t>(color_node.data->value.u);
-			}
-			else {
-				*color = DEFAULT_COLOR;
-			}
-		};
-		SetColor("foreground", &renderer->hl_attribs[attrib_index].foreground);
-		SetColor("background", &renderer->hl_attribs[attrib_index].background);
-		SetColor("special", &renderer->hl_attribs[attrib_index].special);
-
-		const auto SetFlag = [&](const char *flag_name, HighlightAttributeFlags flag) {
-			mpack_node_t flag_node = mpack_node_map_cstr_optional(attrib_map, flag_name);
-			if (!mpack_node_is_missing(flag_node)) {
-				if (flag_node.data->value.b) {
-					renderer->hl_attribs[attrib_index].flags |= flag;
-				}
-				else {
-					renderer->hl_attribs[attrib_index].flags &= ~flag;
-				}
-			}
-		};
-		SetFlag("reverse", HL_ATTRIB_REVERSE);
-		SetFlag("italic", HL_ATTRIB_ITALIC);
-		SetFlag("bold", HL_ATTRIB_BOLD);
-		SetFlag("strikethrough", HL_ATTRIB_STRIKETHROUGH);
-		SetFlag("underline", HL_ATTRIB_UNDERLINE);
-		SetFlag("undercurl", HL_ATTRIB_UNDERCURL);
-	}
-}
-
-uint32_t CreateForegroundColor(Renderer *renderer, HighlightAttributes *hl_attribs) {
-	if (hl_attribs->flags & HL_ATTRIB_REVERSE) {
-		return hl_attribs->background == DEFAULT_COLOR ? renderer->hl_attribs[0].background : hl_attribs->background;
-	}
-	else {
-		return hl_attribs->foreground == DEFAULT_COLOR ? renderer->hl_attribs[0].foreground : hl_attribs->foreground;
-	}
-}
-
-uint32_t CreateBackgroundColor(Renderer *renderer, HighlightAttributes *hl_attribs) {
-	if (hl_attribs->flags & HL_ATTRIB_REVERSE) {
-		return hl_attribs->foreground == DEFAULT_COLOR ? renderer->hl_attribs[0].foreground : hl_attribs->foreground;
-	}
-	else {
-		return hl_attribs->background == DEFAULT_COLOR ? renderer->hl_attribs[0].background : hl_attribs->background;
-	}
-}
-
-uint32_t CreateSpecialColor(Renderer *renderer, HighlightAttributes *hl_attribs) {
-	return hl_attribs->special == DEFAULT_COLOR ? renderer->hl_attribs[0].special : hl_attribs->special;
-}
-
-void ApplyHighlightAttributes(Renderer *renderer, HighlightAttributes *hl_attribs,
+void ApplyHighlightAttributes(Renderer *renderer, HighlightAttributes *hl_attribs, void *drawing_effect,
 	IDWriteTextLayout *text_layout, int start, int end) {
-	GlyphDrawingEffect *drawing_effect = new GlyphDrawingEffect(
-			CreateForegroundColor(renderer, hl_attribs),
-			CreateSpecialColor(renderer, hl_attribs)
-	);
 	DWRITE_TEXT_RANGE range {
 		.startPosition = static_cast<uint32_t>(start),
 		.length = static_cast<uint32_t>(end - start)
@@ -486,19 +463,18 @@ void ApplyHighlightAttributes(Renderer *renderer, HighlightAttributes *hl_attrib
 	if (hl_attribs->flags & HL_ATTRIB_UNDERCURL) {
 		text_layout->SetUnderline(true, range);
 	}
-	text_layout->SetDrawingEffect(drawing_effect, range);
+	text_layout->SetDrawingEffect(static_cast<GlyphDrawingEffect *>(drawing_effect), range);
 }
 
-void DrawBackgroundRect(Renderer *renderer, D2D1_RECT_F rect, HighlightAttributes *hl_attribs) {
-	uint32_t color = CreateBackgroundColor(renderer, hl_attribs);
-	renderer->d2d_background_rect_brush->SetColor(D2D1::ColorF(color));
+void DrawBackgroundRect(Renderer *renderer, D2D1_RECT_F rect, const ResolvedColors *colors) {
+	renderer->d2d_background_rect_brush->SetColor(D2DColor(colors->background));
 
 	renderer->d2d_context->FillRectangle(rect, renderer->d2d_background_rect_brush);
 }
 
 D2D1_RECT_F GetCursorForegroundRect(Renderer *renderer, D2D1_RECT_F cursor_bg_rect) {
-	if (renderer->cursor.mode_info) {
-		switch (renderer->cursor.mode_info->shape) {
+	if (renderer->model.cursor.mode_info) {
+		switch (renderer->model.cursor.mode_info->shape) {
 		case CursorShape::None: {
 		} return cursor_bg_rect;
 		case CursorShape::Block: {
@@ -514,7 +490,8 @@ D2D1_RECT_F GetCursorForegroundRect(Renderer *renderer, D2D1_RECT_F cursor_bg_re
 	return cursor_bg_rect;
 }
 
-void DrawHighlightedText(Renderer *renderer, D2D1_RECT_F rect, uint32_t *text, uint32_t length, HighlightAttributes *hl_attribs) {
+void DrawHighlightedText(Renderer *renderer, D2D1_RECT_F rect, uint32_t *text, uint32_t length,
+	HighlightAttributes *hl_attribs, const ResolvedColors *colors) {
 	ConvertToWide(renderer, text, length);
 
 	IDWriteTextLayout *text_layout = nullptr;
@@ -526,7 +503,8 @@ void DrawHighlightedText(Renderer *renderer, D2D1_RECT_F rect, uint32_t *text, u
 		rect.bottom - rect.top,
 		&text_layout
 	));
-	ApplyHighlightAttributes(renderer, hl_attribs, text_layout, 0, 1);
+	ApplyHighlightAttributes(renderer, hl_attribs,
+		EffectPoolFind(&renderer->effect_pool, &colors->foreground, &colors->special), text_layout, 0, 1);
 
 	renderer->d2d_context->PushAxisAlignedClip(rect, D2D1_ANTIALIAS_MODE_ALIASED);
 	text_layout->Draw(renderer, renderer->glyph_renderer, rect.left, rect.top);
@@ -534,18 +512,35 @@ void DrawHighlightedText(Renderer *renderer, D2D1_RECT_F rect, uint32_t *text, u
 	renderer->d2d_context->PopAxisAlignedClip();
 }
 
-void DrawGridLine(Renderer *renderer, int row) {
-	int base = row * renderer->grid_cols;
+// Fills the background of columns [left, right) of a row run by run
+void DrawRowBackground(Renderer *renderer, int row, int left, int right) {
+	const uint32_t *id_sets = renderer->model.hl_sets.id_sets;
+	int run_count;
+	const HighlightRun *runs = HighlightRunsRow(&renderer->model.hl_runs, row, &run_count);
+	int run = HighlightRunsFind(runs, run_count, left);
+	for (int run_start = left; run_start < right;) {
+		uint16_t hl_attrib_id = runs[run].hl_attrib_id;
+		int run_end = HighlightRunsJoin(runs, run_count, &run, id_sets);
+		run_end = run_end < right ? run_end : right;
+		D2D1_RECT_F bg_rect {
+			.left = run_start * renderer->font_width,
+			.top = row * renderer->font_height,
+			.right = run_end * renderer->font_width,
+			.bottom = (row * renderer->font_height) + renderer->font_height
+		};
+		DrawBackgroundRect(renderer, bg_rect, &renderer->model.hl_colors.colors[hl_attrib_id]);
+		run_start = run_end;
+	}
+}
 
-	D2D1_RECT_F rect {
-		.left = 0.0f,
-		.top = row * renderer->font_height,
-		.right = renderer->grid_cols * renderer->font_width,
-		.bottom = (row * renderer->font_height) + renderer->font_height
-	};
+// Shapes columns [left, right) of a row into a layout with the highlights
+// applied and every character fitted to the cell grid
+IDWriteTextLayout1 *CreateRowLayout(Renderer *renderer, int row, int left, int right, D2D1_RECT_F rect) {
+	uint32_t *chars = GridRowChars(&renderer->model.grid, row);
+	uint8_t *flags = GridRowFlags(&renderer->model.grid, row);
 
 	IDWriteTextLayout *temp_text_layout = nullptr;
-	ConvertToWide(renderer, &renderer->grid_chars[base], renderer->grid_cols);
+	ConvertToWide(renderer, chars + left, right - left);
 	WIN_CHECK(renderer->dwrite_factory->CreateTextLayout(
 		renderer->wchar_buffer,
 		renderer->wchar_buffer_length,
@@ -559,15 +554,34 @@ void DrawGridLine(Renderer *renderer, int row) {
 	temp_text_layout->QueryInterface<IDWriteTextLayout1>(&text_layout);
 	temp_text_layout->Release();
 
-	uint16_t hl_attrib_id = renderer->grid_cell_properties[base].hl_attrib_id;
-	int col_offset = 0;
+	// The runs were built for this row by the flush, start with the one
+	// covering the left edge. Ids that look the same share a set and are
+	// drawn as one run.
+	const uint32_t *id_sets = renderer->model.hl_sets.id_sets;
+	int run_count;
+	const HighlightRun *runs = HighlightRunsRow(&renderer->model.hl_runs, row, &run_count);
+	int run = HighlightRunsFind(runs, run_count, left);
+	uint16_t hl_attrib_id = runs[run].hl_attrib_id;
+	int run_end = HighlightRunsJoin(runs, run_count, &run, id_sets);
 	int col_offset_wchars = 0;
-	for (int i = 0, i_wchars = 0; i < renderer->grid_cols;
-		i_wchars += ContainsSurrogatePair(renderer->grid_chars[base + i]) ? 2 : 1, ++i) {
+	for (int i = left, i_wchars = 0; i < right;
+		i_wchars += ContainsSurrogatePair(chars[i]) ? 2 : 1, ++i) {
+
+		// At the end of a run apply its attributes up to this point
+		// and continue with the next one
+		if (i == run_end) {
+			ApplyHighlightAttributes(renderer, &renderer->model.hl_attribs[hl_attrib_id],
+				EffectPoolGet(&renderer->effect_pool, hl_attrib_id, &renderer->model.hl_colors.colors[hl_attrib_id]),
+				text_layout, col_offset_wchars, i_wchars);
+
+			hl_attrib_id = runs[run].hl_attrib_id;
+			run_end = HighlightRunsJoin(runs, run_count, &run, id_sets);
+			col_offset_wchars = i_wchars;
+		}
 
 		// Add spacing for wide chars
-		if (renderer->grid_cell_properties[base + i].is_wide_char) {
-			float char_width = GetTextWidth(renderer, &renderer->grid_chars[base + i], 2);
+		if (flags[i] & GRID_CELL_WIDE) {
+			float char_width = GetCellGlyph(renderer, &chars[i], true).advance;
 			DWRITE_TEXT_RANGE range { .startPosition = static_cast<uint32_t>(i_wchars), .length = 1 };
 			text_layout->SetCharacterSpacing(0, (renderer->font_width * 2) - char_width, 0, range);
 		}
@@ -575,8 +589,8 @@ void DrawGridLine(Renderer *renderer, int row) {
 		// Add spacing for unicode chars. These characters are still single char width, 
 		// but some of them by default will take up a bit more or less, leading to issues. 
 		// So we realign them here.	
-		else if(renderer->grid_chars[base + i] > 0xFF) {
-			float char_width = GetTextWidth(renderer, &renderer->grid_chars[base + i], 1);
+		else if(chars[i] > 0xFF) {
+			float char_width = GetCellGlyph(renderer, &chars[i], false).advance;
 			if(abs(char_width - renderer->font_width) > 0.01f) {
 				DWRITE_TEXT_RANGE range { .startPosition = static_cast<uint32_t>(i_wchars), .length = 1 };
 				text_layout->SetCharacterSpacing(0, renderer->font_width - char_width, 0, range);
@@ -584,12 +598,9 @@ void DrawGridLine(Renderer *renderer, int row) {
 		}
 		else {
 			// Add spacing for character not existing in this font
-			uint16_t glyph_index;
-			uint32_t code = static_cast<uint32_t>(renderer->grid_chars[base + i]);
-			WIN_CHECK(renderer->font_face->GetGlyphIndicesW(&code, 1, &glyph_index));
-			if (glyph_index == 0)
+			if (renderer->glyph_cache.latin1[chars[i]].glyph_index == 0)
 			{
-				float char_width = GetTextWidth(renderer, &renderer->grid_chars[base + i], 1);
+				float char_width = GetCellGlyph(renderer, &chars[i], false).advance;
 				float d_width = renderer->font_width - char_width;
 				if (d_width > 0)
 				{
@@ -598,242 +609,286 @@ void DrawGridLine(Renderer *renderer, int row) {
 				}
 			}
 		}
-
-		// Check if the attributes change, 
-		// if so draw until this point and continue with the new attributes
-		if (renderer->grid_cell_properties[base + i].hl_attrib_id != hl_attrib_id) {
-			D2D1_RECT_F bg_rect {
-				.left = col_offset * renderer->font_width,
-				.top = row * renderer->font_height,
-				.right = col_offset * renderer->font_width + renderer->font_width * (i - col_offset),
-				.bottom = (row * renderer->font_height) + renderer->font_height
-			};
-			DrawBackgroundRect(renderer, bg_rect, &renderer->hl_attribs[hl_attrib_id]);
-			ApplyHighlightAttributes(renderer, &renderer->hl_attribs[hl_attrib_id], text_layout, col_offset_wchars, i_wchars);
-
-			hl_attrib_id = renderer->grid_cell_properties[base + i].hl_attrib_id;
-			col_offset = i;
-			col_offset_wchars = i_wchars;
-		}
 	}
 	
-	// Draw the remaining columns, there is always atleast the last column to draw,
-	// but potentially more in case the last X columns share the same hl_attrib
-	D2D1_RECT_F last_rect = rect;
-	last_rect.left = col_offset * renderer->font_width;
-	DrawBackgroundRect(renderer, last_rect, &renderer->hl_attribs[hl_attrib_id]);
-	ApplyHighlightAttributes(renderer, &renderer->hl_attribs[hl_attrib_id], text_layout, col_offset_wchars, grid_chars_length);
+	// The last run always reaches the end of the span
+	ApplyHighlightAttributes(renderer, &renderer->model.hl_attribs[hl_attrib_id],
+		EffectPoolGet(&renderer->effect_pool, hl_attrib_id, &renderer->model.hl_colors.colors[hl_attrib_id]),
+		text_layout, col_offset_wchars, grid_chars_length);
 
-	renderer->d2d_context->PushAxisAlignedClip(rect, D2D1_ANTIALIAS_MODE_ALIASED);
 	if(renderer->disable_ligatures) {
 		text_layout->SetTypography(renderer->dwrite_typography, DWRITE_TEXT_RANGE { 
 			.startPosition = 0, 
 			.length = static_cast<uint32_t>(grid_chars_length)
 		});
 	}
-	text_layout->Draw(renderer, renderer->glyph_renderer, 0.0f, rect.top);
-	renderer->d2d_context->PopAxisAlignedClip();
-	text_layout->Release();
+	return text_layout;
 }
 
-void DrawAllGridLines(Renderer *renderer) {
-	for (size_t i = 0; i < renderer->grid_rows; ++i) {
-		DrawGridLine(renderer, i);
+// Whether columns [left, right) of a row can be drawn as glyph runs, which
+// takes every character having a glyph in the font itself. Anything that
+// needs a fallback font or an italic face is left to a text layout.
+bool CanDrawGlyphRuns(Renderer *renderer, int row, int left, int right) {
+	uint32_t *chars = GridRowChars(&renderer->model.grid, row);
+	uint8_t *flags = GridRowFlags(&renderer->model.grid, row);
+	for (int i = left; i < right; ++i) {
+		if (flags[i] & GRID_CELL_CONTINUATION) {
+			continue;
+		}
+		bool wide = flags[i] & GRID_CELL_WIDE;
+		uint16_t glyph_index = (!wide && chars[i] < GLYPH_CACHE_LATIN1_CHARS) ?
+			renderer->glyph_cache.latin1[chars[i]].glyph_index :
+			GetCellGlyph(renderer, &chars[i], wide).glyph_index;
+		if (glyph_index == 0) {
+			return false;
+		}
+	}
+
+	int run_count;
+	const HighlightRun *runs = HighlightRunsRow(&renderer->model.hl_runs, row, &run_count);
+	for (int run = HighlightRunsFind(runs, run_count, left); run < run_count && runs[run].start < right; ++run) {
+		if (renderer->model.hl_attribs[runs[run].hl_attrib_id].flags & HL_ATTRIB_ITALIC) {
+			return false;
+		}
 	}
+	return true;
 }
 
-bool IsSurrogatePair(wchar_t left, wchar_t right) {
-	return (0xD800 <= left && left <= 0xDBFF) && (0xDC00 <= right && right <= 0xDFFF);
+// Makes room to shape `cells` cells at once, surrogate pairs taking two
+// code units and the shaper at most 3/2 glyphs per unit
+void ReserveGlyphRunBuffers(Renderer *renderer, int cells) {
+	GlyphRunBuffers *buffers = &renderer->glyph_run_buffers;
+	int text_length = cells * 2;
+	if (text_length > buffers->text_capacity) {
+		buffers->text = static_cast<uint16_t *>(realloc(buffers->text, text_length * sizeof(uint16_t)));
+		buffers->text_cells = static_cast<uint16_t *>(realloc(buffers->text_cells, text_length * sizeof(uint16_t)));
+		buffers->cluster_map = static_cast<uint16_t *>(realloc(buffers->cluster_map, text_length * sizeof(uint16_t)));
+		buffers->text_props = static_cast<DWRITE_SHAPING_TEXT_PROPERTIES *>(
+			realloc(buffers->text_props, text_length * sizeof(DWRITE_SHAPING_TEXT_PROPERTIES)));
+		buffers->text_capacity = text_length;
+	}
+	int glyph_count = text_length * 3 / 2 + 16;
+	if (glyph_count > buffers->glyph_capacity) {
+		buffers->glyph_indices = static_cast<uint16_t *>(realloc(buffers->glyph_indices, glyph_count * sizeof(uint16_t)));
+		buffers->glyph_props = static_cast<DWRITE_SHAPING_GLYPH_PROPERTIES *>(
+			realloc(buffers->glyph_props, glyph_count * sizeof(DWRITE_SHAPING_GLYPH_PROPERTIES)));
+		buffers->glyph_advances = static_cast<float *>(realloc(buffers->glyph_advances, glyph_count * sizeof(float)));
+		buffers->glyph_capacity = glyph_count;
+	}
 }
 
-void DrawGridLines(Renderer *renderer, mpack_node_t grid_lines) {
-	assert(renderer->grid_chars != nullptr);
-	assert(renderer->grid_cell_properties != nullptr);
-	
-	int grid_size = renderer->grid_cols * renderer->grid_rows;
-	size_t line_count = mpack_node_array_length(grid_lines);
-	for (size_t i = 1; i < line_count; ++i) {
-		mpack_node_t grid_line = mpack_node_array_at(grid_lines, i);
-
-		int row = MPackIntFromArray(grid_line, 1);
-		int col_start = MPackIntFromArray(grid_line, 2);
-
-		mpack_node_t cell_array = mpack_node_array_at(grid_line, 3);
-		size_t cell_array_length = mpack_node_array_length(cell_array);
-
-		int hl_attrib_id = 0;
-		int offset = row * renderer->grid_cols + col_start;
-		for (size_t j = 0; j < cell_array_length; ++j) {
-			mpack_node_t cell = mpack_node_array_at(cell_array, j);
-			size_t cell_length = mpack_node_array_length(cell);
-
-			mpack_node_t text = mpack_node_array_at(cell, 0);
-			const char *str = mpack_node_str(text);
-
-			if (cell_length > 1) {
-				hl_attrib_id = MPackIntFromArray(cell, 1);
-			}
-
-			int repeat = 1;
-			if (cell_length > 2) {
-				repeat = MPackIntFromArray(cell, 2);
-			}
-
-			int strlen = static_cast<int>(mpack_node_strlen(text));
-			if (strlen == 0) {
-				// This is the right part of the wide char. Sadly grid_line
-				// event can be splitted at the middle of wide character.
-
-				// Be careful not to overwrite right half of surrogate pair.
-				// It never happens that offset == 0, since it is the right
-				// half of wide char, but add check for safety.
-				if (offset == 0 || !IsSurrogatePair(renderer->grid_chars[offset - 1], renderer->grid_chars[offset])) {
-					renderer->grid_chars[offset] = L'\0';
-				}
-
-				// This cell itself is not a wide character.
-				renderer->grid_cell_properties[offset].is_wide_char = false;
+// Draws columns [left, right) of a row without a text layout. Every
+// highlight run is shaped on its own and its glyphs are placed on the
+// cells, then drawn through the glyph renderer like a layout would.
+void DrawGlyphRuns(Renderer *renderer, int row, int left, int right, D2D1_RECT_F rect) {
+	uint32_t *chars = GridRowChars(&renderer->model.grid, row);
+	uint8_t *flags = GridRowFlags(&renderer->model.grid, row);
+	GlyphRunBuffers *buffers = &renderer->glyph_run_buffers;
+	ReserveGlyphRunBuffers(renderer, right - left);
+
+	// The text is all in the font, so the default analysis is enough
+	DWRITE_SCRIPT_ANALYSIS script_analysis {};
+	DWRITE_FONT_FEATURE no_ligatures {
+		.nameTag = DWRITE_FONT_FEATURE_TAG_STANDARD_LIGATURES,
+		.parameter = 0
+	};
+	DWRITE_TYPOGRAPHIC_FEATURES typographic_features { .features = &no_ligatures, .featureCount = 1 };
+	const DWRITE_TYPOGRAPHIC_FEATURES *features = &typographic_features;
+
+	float baseline_y = rect.top + renderer->font_ascent * renderer->linespace_factor;
+	float line_scale = renderer->font_size / renderer->font_metrics.designUnitsPerEm;
+
+	const uint32_t *id_sets = renderer->model.hl_sets.id_sets;
+	int run_count;
+	const HighlightRun *runs = HighlightRunsRow(&renderer->model.hl_runs, row, &run_count);
+	int run = HighlightRunsFind(runs, run_count, left);
+	for (int run_start = left; run_start < right;) {
+		uint16_t hl_attrib_id = runs[run].hl_attrib_id;
+		int run_end = HighlightRunsJoin(runs, run_count, &run, id_sets);
+		run_end = run_end < right ? run_end : right;
+		HighlightAttributes *hl_attribs = &renderer->model.hl_attribs[hl_attrib_id];
+		const ResolvedColors *colors = &renderer->model.hl_colors.colors[hl_attrib_id];
+
+		bool bold = hl_attribs->flags & HL_ATTRIB_BOLD;
+		IDWriteFontFace1 *font_face = bold ? renderer->font_face_bold : renderer->font_face;
+		int text_length = CellTextBuild(chars + run_start, flags + run_start, run_end - run_start,
+			buffers->text, buffers->text_cells);
+		uint32_t glyph_count = 0;
+		if (text_length > 0) {
+			uint32_t feature_range_length = static_cast<uint32_t>(text_length);
+			WIN_CHECK(renderer->dwrite_text_analyzer->GetGlyphs(
+				reinterpret_cast<wchar_t *>(buffers->text),
+				static_cast<uint32_t>(text_length),
+				font_face,
+				false,
+				false,
+				&script_analysis,
+				L"en-us",
+				nullptr,
+				renderer->disable_ligatures ? &features : nullptr,
+				renderer->disable_ligatures ? &feature_range_length : nullptr,
+				renderer->disable_ligatures ? 1 : 0,
+				static_cast<uint32_t>(buffers->glyph_capacity),
+				buffers->cluster_map,
+				buffers->text_props,
+				buffers->glyph_indices,
+				buffers->glyph_props,
+				&glyph_count
+			));
+			CellGlyphsPlace(buffers->text_cells, buffers->cluster_map, text_length, static_cast<int>(glyph_count),
+				run_end - run_start, renderer->font_width, buffers->glyph_advances);
+		}
 
-				// Adjust properties. Again it never happens that offset == 0,
-				// since it is the right half of wide char, but adding check
-				// for safety.
-				if (offset > 0) {
-					// Set is_wide_char flag for the left cell to true.
-					renderer->grid_cell_properties[offset - 1].is_wide_char = true;
+		GlyphDrawingEffect *drawing_effect = static_cast<GlyphDrawingEffect *>(
+			EffectPoolGet(&renderer->effect_pool, hl_attrib_id, colors));
+		float run_x = run_start * renderer->font_width;
+		if (glyph_count > 0) {
+			DWRITE_GLYPH_RUN glyph_run {
+				.fontFace = font_face,
+				.fontEmSize = bold ? renderer->font_size_scale_bold : renderer->font_size,
+				.glyphCount = glyph_count,
+				.glyphIndices = buffers->glyph_indices,
+				.glyphAdvances = buffers->glyph_advances,
+				.glyphOffsets = nullptr,
+				.isSideways = false,
+				.bidiLevel = 0
+			};
+			DWRITE_GLYPH_RUN_DESCRIPTION glyph_run_description {
+				.localeName = L"en-us",
+				.string = reinterpret_cast<wchar_t *>(buffers->text),
+				.stringLength = static_cast<uint32_t>(text_length),
+				.clusterMap = buffers->cluster_map,
+				.textPosition = 0
+			};
+			renderer->glyph_renderer->DrawGlyphRun(renderer, run_x, baseline_y, DWRITE_MEASURING_MODE_NATURAL,
+				&glyph_run, &glyph_run_description, drawing_effect);
+		}
 
-					// Inherit hl_attrib_id from left half.
-					renderer->grid_cell_properties[offset].hl_attrib_id = renderer->grid_cell_properties[offset - 1].hl_attrib_id;
-				}
+		float run_width = (run_end - run_start) * renderer->font_width;
+		if (hl_attribs->flags & (HL_ATTRIB_UNDERLINE | HL_ATTRIB_UNDERCURL)) {
+			renderer->glyph_renderer->DrawLine(renderer, run_x, baseline_y,
+				-renderer->font_metrics.underlinePosition * line_scale, run_width,
+				renderer->font_metrics.underlineThickness * line_scale, drawing_effect, true);
+		}
+		if (hl_attribs->flags & HL_ATTRIB_STRIKETHROUGH) {
+			renderer->glyph_renderer->DrawLine(renderer, run_x, baseline_y,
+				-renderer->font_metrics.strikethroughPosition * line_scale, run_width,
+				renderer->font_metrics.strikethroughThickness * line_scale, drawing_effect, false);
+		}
+		run_start = run_end;
+	}
+}
 
-				++offset;
-			} else {
-				// This is single width character or left half cell of wide
-				// character.
+void DrawGridLine(Renderer *renderer, int row, DirtyRowSpan span) {
+	// Only the changed columns are laid out, widened so that no ligature
+	// or double width character is cut in half at either end
+	int left = span.left;
+	int right = span.right;
+	GridWidenSpan(&renderer->model.grid, row, !renderer->disable_ligatures, &left, &right);
 
-				// Left cell should not be a wide character, so reset the
-				// flag. This time checking offset > 0 is mandatory.
-				if (offset > 0) {
-					renderer->grid_cell_properties[offset - 1].is_wide_char = false;
-				}
+	D2D1_RECT_F rect {
+		.left = left * renderer->font_width,
+		.top = row * renderer->font_height,
+		.right = right * renderer->font_width,
+		.bottom = (row * renderer->font_height) + renderer->font_height
+	};
+	DrawRowBackground(renderer, row, left, right);
 
-				// Wide character will never be repeated, so we don't have to
-				// handle wide character specially.
-				for (int k = 0; k < repeat; ++k) {
-					wchar_t buffer[2];
-					int wstrlen = MultiByteToWideChar(CP_UTF8, 0, str, strlen, buffer, 2);
-					if (wstrlen == 2) {
-						// If the str takes two wchars, it must be a surrogate pair.
-						bool is_surrogate_pair = IsSurrogatePair(buffer[0], buffer[1]);
-						if (is_surrogate_pair) {
-							// Pack the surrogate pair into a single grid cell.
-							renderer->grid_chars[offset] = (buffer[0] << 16) | buffer[1];
-						} else {
-							// This is an unsupported character (ie: a diacritic), draw a box here instead.
-							renderer->grid_chars[offset] = 0x25a1;
-						}
-					} else {
-						renderer->grid_chars[offset] = buffer[0];
-					}
-
-					renderer->grid_cell_properties[offset].hl_attrib_id = hl_attrib_id;
-
-					// Here we set is_wide_char to be always false. This is
-					// because if it is actually a wide character, then the
-					// right half of the char, empty string, should be appear
-					// soon, and the flag will be set there (first branch of
-					// this `if`).
-					renderer->grid_cell_properties[offset].is_wide_char = false;
-
-					++offset;
-				}
-			}
-		}
+	if (renderer->glyph_runs && CanDrawGlyphRuns(renderer, row, left, right)) {
+		renderer->d2d_context->PushAxisAlignedClip(rect, D2D1_ANTIALIAS_MODE_ALIASED);
+		DrawGlyphRuns(renderer, row, left, right, rect);
+		renderer->d2d_context->PopAxisAlignedClip();
+		return;
+	}
 
-		DrawGridLine(renderer, row);
+	// Layouts don't depend on where the row is drawn, so a row shaped
+	// before is reused wherever it shows up again. The flush just
+	// hashed the row, which covers its contents and highlights.
+	LayoutCacheKey key {
+		.row_hash = renderer->model.drawn_rows.hashes[row],
+		.font_generation = renderer->font_generation,
+		.left = static_cast<uint16_t>(left),
+		.right = static_cast<uint16_t>(right)
+	};
+	void *cached_layout;
+	IDWriteTextLayout1 *text_layout;
+	if (LayoutCacheFind(&renderer->layout_cache, key, &cached_layout)) {
+		text_layout = static_cast<IDWriteTextLayout1 *>(cached_layout);
+	}
+	else {
+		text_layout = CreateRowLayout(renderer, row, left, right, rect);
+		LayoutCacheInsert(&renderer->layout_cache, key, text_layout, right - left);
 	}
+
+	renderer->d2d_context->PushAxisAlignedClip(rect, D2D1_ANTIALIAS_MODE_ALIASED);
+	text_layout->Draw(renderer, renderer->glyph_renderer, rect.left, rect.top);
+	renderer->d2d_context->PopAxisAlignedClip();
 }
 
 void DrawCursor(Renderer *renderer) {
-	if (!renderer->cursor.mode_info) return;
-	int cursor_grid_offset = renderer->cursor.row * renderer->grid_cols + renderer->cursor.col;
+	if (!renderer->model.cursor.mode_info) return;
+	int cursor_row = renderer->model.cursor.row;
+	int cursor_col = renderer->model.cursor.col;
+	if (cursor_row < 0 || cursor_row >= renderer->model.grid.rows ||
+		cursor_col < 0 || cursor_col >= renderer->model.grid.cols) {
+		return;
+	}
+	uint32_t *cursor_chars = GridRowChars(&renderer->model.grid, cursor_row) + cursor_col;
+	uint16_t hl_attrib_id_under_cursor = GridRowHighlights(&renderer->model.grid, cursor_row)[cursor_col];
+	uint8_t cursor_flags = GridRowFlags(&renderer->model.grid, cursor_row)[cursor_col];
 
 	int double_width_char_factor = 1;
-	if (cursor_grid_offset < (renderer->grid_rows * renderer->grid_cols) &&
-		renderer->grid_cell_properties[cursor_grid_offset].is_wide_char) {
+	if (cursor_flags & GRID_CELL_WIDE) {
 		double_width_char_factor += 1;
 	}
 
-	HighlightAttributes cursor_hl_attribs = renderer->hl_attribs[renderer->cursor.mode_info->hl_attrib_id];
+	HighlightAttributes cursor_hl_attribs = renderer->model.hl_attribs[renderer->model.cursor.mode_info->hl_attrib_id];
 
 	// Inherit GUI options for char under cursor (like italic)
-	int hl_attrib_id_under_cursor = renderer->grid_cell_properties[cursor_grid_offset].hl_attrib_id;
-	HighlightAttributes under_cursor_hl_attribs = renderer->hl_attribs[hl_attrib_id_under_cursor];
+	HighlightAttributes under_cursor_hl_attribs = renderer->model.hl_attribs[hl_attrib_id_under_cursor];
 	cursor_hl_attribs.flags = under_cursor_hl_attribs.flags;
 
-	if (renderer->cursor.mode_info->hl_attrib_id == 0) {
+	if (renderer->model.cursor.mode_info->hl_attrib_id == 0) {
 		cursor_hl_attribs.flags |= HL_ATTRIB_REVERSE;
 	}
 
 	D2D1_RECT_F cursor_rect {
-		.left = renderer->cursor.col * renderer->font_width,
-		.top = renderer->cursor.row * renderer->font_height,
-		.right = renderer->cursor.col * renderer->font_width + renderer->font_width * double_width_char_factor,
-		.bottom = (renderer->cursor.row * renderer->font_height) + renderer->font_height
+		.left = renderer->model.cursor.col * renderer->font_width,
+		.top = renderer->model.cursor.row * renderer->font_height,
+		.right = renderer->model.cursor.col * renderer->font_width + renderer->font_width * double_width_char_factor,
+		.bottom = (renderer->model.cursor.row * renderer->font_height) + renderer->font_height
 	};
+	// The cursor takes its flags from the cell under it, so it is
+	// resolved here rather than looked up in the table
+	ResolvedColors cursor_colors = ResolveColors(&renderer->model.hl_attribs[0], &cursor_hl_attribs);
 	D2D1_RECT_F cursor_fg_rect = GetCursorForegroundRect(renderer, cursor_rect);
-	DrawBackgroundRect(renderer, cursor_fg_rect, &cursor_hl_attribs);
+	DrawBackgroundRect(renderer, cursor_fg_rect, &cursor_colors);
 
-	if (renderer->cursor.mode_info->shape == CursorShape::Block) {
-		DrawHighlightedText(renderer, cursor_fg_rect, &renderer->grid_chars[cursor_grid_offset],
-			double_width_char_factor, &cursor_hl_attribs);
+	if (renderer->model.cursor.mode_info->shape == CursorShape::Block) {
+		DrawHighlightedText(renderer, cursor_fg_rect, cursor_chars,
+			double_width_char_factor, &cursor_hl_attribs, &cursor_colors);
 	}
 }
 
-bool UpdateGridSize(Renderer *renderer, mpack_node_t grid_resize) {
-	mpack_node_t grid_resize_params = mpack_node_array_at(grid_resize, 1);
-	int grid_cols = MPackIntFromArray(grid_resize_params, 1);
-	int grid_rows = MPackIntFromArray(grid_resize_params, 2);
-
-	if (renderer->grid_chars == nullptr ||
-		renderer->wchar_buffer == nullptr ||
-		renderer->grid_cell_properties == nullptr ||
-		renderer->grid_cols != grid_cols ||
-		renderer->grid_rows != grid_rows) {
-		
-		renderer->grid_cols = grid_cols;
-		renderer->grid_rows = grid_rows;
-
-		free(renderer->grid_chars);
-		renderer->grid_chars = static_cast<uint32_t *>(malloc(static_cast<size_t>(grid_cols) * grid_rows * sizeof(uint32_t)));
-		// Initialize all grid character to a space. An empty
-		// grid cell is equivalent to a space in a text layout
-		for (int i = 0; i < grid_cols * grid_rows; ++i) {
-			renderer->grid_chars[i] = L' ';
-		}
-		renderer->grid_cell_properties = static_cast<CellProperty *>(calloc(static_cast<size_t>(grid_cols) * grid_rows, sizeof(CellProperty)));
+bool UpdateGridSize(Renderer *renderer, const RedrawOpGridResize *op) {
+	// Only the global grid decides the size of the window
+	bool screen_resized = RedrawApplyGridResize(&renderer->model, op);
+	if (screen_resized || (op->grid == GLOBAL_GRID_ID && renderer->wchar_buffer == nullptr)) {
 		free(renderer->wchar_buffer);
-		renderer->wchar_buffer = static_cast<wchar_t *>(malloc(static_cast<size_t>(grid_cols * 2) * sizeof(wchar_t)));
-
-		renderer->grid_initialized = true;
+		renderer->wchar_buffer = static_cast<wchar_t *>(malloc(static_cast<size_t>(renderer->model.grid.cols * 2) * sizeof(wchar_t)));
 		return true;
 	}
 
 	return false;
 }
 
-void UpdateCursorPos(Renderer *renderer, mpack_node_t cursor_goto) {
-	mpack_node_t cursor_goto_params = mpack_node_array_at(cursor_goto, 1);
-	renderer->cursor.row = MPackIntFromArray(cursor_goto_params, 1);
-	renderer->cursor.col = MPackIntFromArray(cursor_goto_params, 2);
-}
-
 void UpdateImePos(Renderer* renderer) {
 	HIMC input_context = ImmGetContext(renderer->hwnd);
 	COMPOSITIONFORM composition_form {
 		.dwStyle = CFS_POINT,
 		.ptCurrentPos = {
-			.x = static_cast<LONG>(renderer->cursor.col * renderer->font_width),
-			.y = static_cast<LONG>(renderer->cursor.row * renderer->font_height)
+			.x = static_cast<LONG>(renderer->model.cursor.col * renderer->font_width),
+			.y = static_cast<LONG>(renderer->model.cursor.row * renderer->font_height)
 		}
 	};
 
@@ -848,12 +903,10 @@ void UpdateImePos(Renderer* renderer) {
 	ImmReleaseContext(renderer->hwnd, input_context);
 }
 
-void UpdateWindowTitle(Renderer *renderer, mpack_node_t set_title) {
+void UpdateWindowTitle(Renderer *renderer, const RedrawOpString *op) {
 	// Get new title
-	mpack_node_t params = mpack_node_array_at(set_title, 1);
-	mpack_node_t value = mpack_node_array_at(params, 0);
-	const char *new_title = mpack_node_str(value);
-	int len = mpack_node_strlen(value);
+	uint32_t len = op->length;
+	const char *new_title = RedrawOpStringData(op);
 
 	// Append " - Nvy" to the title. If title is empty, do not add " - ".
 	const char *append = len == 0 ? "Nvy" : " - Nvy";
@@ -864,9 +917,9 @@ void UpdateWindowTitle(Renderer *renderer, mpack_node_t set_title) {
 	memcpy(buf + len, append, add_len);
 
 	// Convert to wide string
-	int wstrlen = MultiByteToWideChar(CP_UTF8, 0, buf, len + add_len, NULL, 0);
+	int wstrlen = MultiByteToWideChar(CP_UTF8, 0, buf, static_cast<int>(bytes), NULL, 0);
 	wchar_t *wbuf = static_cast<wchar_t *>(malloc((wstrlen + 1) * sizeof(wchar_t)));
-	MultiByteToWideChar(CP_UTF8, 0, buf, len + add_len, wbuf, wstrlen);
+	MultiByteToWideChar(CP_UTF8, 0, buf, static_cast<int>(bytes), wbuf, wstrlen);
 	wbuf[wstrlen] = '\0';
 
 	// Update title bar text
@@ -876,107 +929,9 @@ void UpdateWindowTitle(Renderer *renderer, mpack_node_t set_title) {
 	free(wbuf);
 }
 
-void UpdateCursorMode(Renderer *renderer, mpack_node_t mode_change) {
-	mpack_node_t mode_change_params = mpack_node_array_at(mode_change, 1);
-	renderer->cursor.mode_info = &renderer->cursor_mode_infos[mpack_node_array_at(mode_change_params, 1).data->value.u];
-}
-
-void UpdateCursorModeInfos(Renderer *renderer, mpack_node_t mode_info_set_params) {
-	mpack_node_t mode_info_params = mpack_node_array_at(mode_info_set_params, 1);
-	mpack_node_t mode_infos = mpack_node_array_at(mode_info_params, 1);
-	size_t mode_infos_length = mpack_node_array_length(mode_infos);
-	assert(mode_infos_length <= MAX_CURSOR_MODE_INFOS);
-
-	for (size_t i = 0; i < mode_infos_length; ++i) {
-		mpack_node_t mode_info_map = mpack_node_array_at(mode_infos, i);
-
-		renderer->cursor_mode_infos[i].shape = CursorShape::None;
-		mpack_node_t cursor_shape = mpack_node_map_cstr_optional(mode_info_map, "cursor_shape");
-		if (!mpack_node_is_missing(cursor_shape)) {
-			const char *cursor_shape_str = mpack_node_str(cursor_shape);
-			size_t strlen = mpack_node_strlen(cursor_shape);
-			if (!strncmp(cursor_shape_str, "block", strlen)) {
-				renderer->cursor_mode_infos[i].shape = CursorShape::Block;
-			}
-			else if (!strncmp(cursor_shape_str, "vertical", strlen)) {
-				renderer->cursor_mode_infos[i].shape = CursorShape::Vertical;
-			}
-			else if (!strncmp(cursor_shape_str, "horizontal", strlen)) {
-				renderer->cursor_mode_infos[i].shape = CursorShape::Horizontal;
-			}
-		}
-
-		renderer->cursor_mode_infos[i].hl_attrib_id = 0;
-		mpack_node_t hl_attrib_index = mpack_node_map_cstr_optional(mode_info_map, "attr_id");
-		if (!mpack_node_is_missing(hl_attrib_index)) {
-			renderer->cursor_mode_infos[i].hl_attrib_id = static_cast<int>(hl_attrib_index.data->value.i);
-		}
-	}
-}
-
-void ScrollRegion(Renderer *renderer, mpack_node_t scroll_region) {
-	size_t scroll_count = mpack_node_array_length(scroll_region);
-
-	for (size_t i = 1; i < scroll_count; ++i) {
-		mpack_node_t scroll_region_params = mpack_node_array_at(scroll_region, i);
-
-		int64_t top = mpack_node_array_at(scroll_region_params, 1).data->value.i;
-		int64_t bottom = mpack_node_array_at(scroll_region_params, 2).data->value.i;
-		int64_t left = mpack_node_array_at(scroll_region_params, 3).data->value.i;
-		int64_t right = mpack_node_array_at(scroll_region_params, 4).data->value.i;
-		int64_t rows = mpack_node_array_at(scroll_region_params, 5).data->value.i;
-		int64_t cols = mpack_node_array_at(scroll_region_params, 6).data->value.i;
-
-		// Currently nvim does not support horizontal scrolling, 
-		// the parameter is reserved for later use
-		assert(cols == 0);
-
-		// This part is slightly cryptic, basically we're just
-		// iterating from top to bottom or vice versa depending on scroll direction.
-		bool scrolling_down = rows > 0;
-		int64_t start_row = scrolling_down ? top : bottom - 1;
-		int64_t end_row = scrolling_down ? bottom - 1 : top;
-		int64_t increment = scrolling_down ? 1 : -1;
-
-		for (int64_t j = start_row; scrolling_down ? j <= end_row : j >= end_row; j += increment) {
-			// Clip anything outside the scroll region
-			int64_t target_row = j - rows;
-			if (target_row < top || target_row >= bottom) {
-				continue;
-			}
-
-			memcpy(
-				&renderer->grid_chars[target_row * renderer->grid_cols + left],
-				&renderer->grid_chars[j * renderer->grid_cols + left],
-				(right - left) * sizeof(uint32_t)
-			);
-
-			memcpy(
-				&renderer->grid_cell_properties[target_row * renderer->grid_cols + left],
-				&renderer->grid_cell_properties[j * renderer->grid_cols + left],
-				(right - left) * sizeof(CellProperty)
-			);
-
-			// Sadly I have given up on making use of IDXGISwapChain1::Present1
-			// scroll_rects or bitmap copies. The former seems insufficient for
-			// nvim since it can require multiple scrolls per frame, the latter
-			// I can't seem to make work with the FLIP_SEQUENTIAL swapchain model.
-			// Thus we fall back to drawing the appropriate scrolled grid lines
-			DrawGridLine(renderer, target_row);
-		}
-
-		// Redraw the line which the cursor has moved to, as it is no
-		// longer guaranteed that the cursor is still there
-		int cursor_row = renderer->cursor.row - rows;
-		if(cursor_row >= 0 && cursor_row < renderer->grid_rows) {
-			DrawGridLine(renderer, cursor_row);
-		}
-	}
-}
-
 void DrawBorderRectangles(Renderer *renderer) {
-	float left_border = renderer->font_width * renderer->grid_cols;
-	float top_border = renderer->font_height * renderer->grid_rows;
+	float left_border = renderer->font_width * renderer->model.grid.cols;
+	float top_border = renderer->font_height * renderer->model.grid.rows;
 
 	if(left_border != static_cast<float>(renderer->pixel_size.width)) {
 		D2D1_RECT_F vertical_rect {
@@ -985,7 +940,7 @@ void DrawBorderRectangles(Renderer *renderer) {
 			.right = static_cast<float>(renderer->pixel_size.width),
 			.bottom = static_cast<float>(renderer->pixel_size.height)
 		};
-		DrawBackgroundRect(renderer, vertical_rect, &renderer->hl_attribs[0]);
+		DrawBackgroundRect(renderer, vertical_rect, &renderer->model.hl_colors.colors[0]);
 	}
 
 	if(top_border != static_cast<float>(renderer->pixel_size.height)) {
@@ -995,7 +950,7 @@ void DrawBorderRectangles(Renderer *renderer) {
 			.right = static_cast<float>(renderer->pixel_size.width),
 			.bottom = static_cast<float>(renderer->pixel_size.height)
 		};
-		DrawBackgroundRect(renderer, horizontal_rect, &renderer->hl_attribs[0]);
+		DrawBackgroundRect(renderer, horizontal_rect, &renderer->model.hl_colors.colors[0]);
 	}
 }
 
@@ -1039,36 +994,11 @@ bool RendererUpdateGuiFont(Renderer *renderer, const char *guifont, size_t strle
 	return RendererUpdateFont(renderer, font_size, guifont, static_cast<int>(font_str_len));
 }
 
-void SetGuiOptions(Renderer *renderer, mpack_node_t option_set) {
-	uint64_t option_set_length = mpack_node_array_length(option_set);
+void SetGuiFont(Renderer *renderer, const RedrawOpString *op) {
+	RendererUpdateGuiFont(renderer, RedrawOpStringData(op), op->length);
 
-	for (uint64_t i = 1; i < option_set_length; ++i) {
-		mpack_node_t name = mpack_node_array_at(mpack_node_array_at(option_set, i), 0);
-		mpack_node_t value = mpack_node_array_at(mpack_node_array_at(option_set, i), 1);
-		if (MPackMatchString(name, "guifont")) {
-			const char *font_str = mpack_node_str(value);
-			size_t strlen = mpack_node_strlen(value);
-			RendererUpdateGuiFont(renderer, font_str, strlen);
-
-			// Send message to window in order to update nvim row/col count
-			PostMessage(renderer->hwnd, WM_RENDERER_FONT_UPDATE, 0, 0);
-		}
-	}
-}
-
-void ClearGrid(Renderer *renderer) {
-	// Initialize all grid character to a space.
-	for (int i = 0; i < renderer->grid_cols * renderer->grid_rows; ++i) {
-		renderer->grid_chars[i] = L' ';
-	}
-	memset(renderer->grid_cell_properties, 0, renderer->grid_cols * renderer->grid_rows * sizeof(CellProperty));
-	D2D1_RECT_F rect {
-		.left = 0.0f,
-		.top = 0.0f,
-		.right = renderer->grid_cols * renderer->font_width,
-		.bottom = renderer->grid_rows * renderer->font_height
-	};
-	DrawBackgroundRect(renderer, rect, &renderer->hl_attribs[0]);
+	// Send message to window in order to update nvim row/col count
+	PostMessage(renderer->hwnd, WM_RENDERER_FONT_UPDATE, 0, 0);
 }
 
 void StartDraw(Renderer *renderer) {
@@ -1112,90 +1042,125 @@ void FinishDraw(Renderer *renderer) {
 
 void RendererFlush(Renderer* renderer) {
 	StartDraw(renderer);
+	DirtyRows *dirty_rows = &renderer->model.dirty_rows;
 	if (renderer->draws_invalidated) {
 		renderer->draws_invalidated = false;
-		DrawAllGridLines(renderer);
+		DirtyRowsMarkAll(dirty_rows);
+		RowHashesInvalidate(&renderer->model.drawn_rows);
+	}
+
+	// The back buffer still holds the last frame, erase the
+	// cursor there unless it is drawn in the same place again
+	const Cursor *cursor = &renderer->model.cursor;
+	bool draw_cursor = !renderer->model.ui_busy && cursor->mode_info;
+	if (renderer->cursor_drawn && (!draw_cursor ||
+		renderer->drawn_cursor_row != cursor->row ||
+		renderer->drawn_cursor_col != cursor->col ||
+		renderer->drawn_cursor_mode.shape != cursor->mode_info->shape ||
+		renderer->drawn_cursor_mode.hl_attrib_id != cursor->mode_info->hl_attrib_id)) {
+		// The row itself may not have changed, but the cursor on it has to
+		// go, two cells wide in case it sat on a double width character
+		DirtyRowsMarkSpan(dirty_rows, renderer->drawn_cursor_row, renderer->drawn_cursor_col, renderer->drawn_cursor_col + 2);
+		RowHashesInvalidateRow(&renderer->model.drawn_rows, renderer->drawn_cursor_row);
 	}
 
-	if (!renderer->ui_busy) {
+	// Every row touched since the last flush is laid out and drawn once,
+	// unless it ended up looking exactly like what is already on screen
+	UIModelFlushRows(&renderer->model, [renderer](int row, DirtyRowSpan span) {
+		DrawGridLine(renderer, row, span);
+	});
+
+	renderer->cursor_drawn = draw_cursor;
+	if (draw_cursor) {
 		DrawCursor(renderer);
+		renderer->drawn_cursor_row = cursor->row;
+		renderer->drawn_cursor_col = cursor->col;
+		renderer->drawn_cursor_mode = *cursor->mode_info;
 	}
 	DrawBorderRectangles(renderer);
 	FinishDraw(renderer);
 }
 
-void RendererRedraw(Renderer *renderer, mpack_node_t params, bool start_maximized) {
+void RendererRedraw(Renderer *renderer, RedrawOps ops, bool start_maximized) {
 	StartDraw(renderer);
 
-	uint64_t redraw_commands_length = mpack_node_array_length(params);
-	for (uint64_t i = 0; i < redraw_commands_length; ++i) {
-		mpack_node_t redraw_command_arr = mpack_node_array_at(params, i);
-		mpack_node_t redraw_command_name = mpack_node_array_at(redraw_command_arr, 0);
-
-		if (MPackMatchString(redraw_command_name, "option_set")) {
-			SetGuiOptions(renderer, redraw_command_arr);
-		}
-		if (MPackMatchString(redraw_command_name, "grid_resize")) {
-			if (UpdateGridSize(renderer, redraw_command_arr))
-			{
-				PixelSize size = RendererGridToPixelSize(renderer, renderer->grid_rows, renderer->grid_cols);
-				SetWindowPos(renderer->hwnd, HWND_TOP, 0, 0, size.width, size.height, SWP_NOMOVE | SWP_NOZORDER | SWP_FRAMECHANGED);
-			}
-		}
-		if (MPackMatchString(redraw_command_name, "grid_clear")) {
-			ClearGrid(renderer);
-		}
-		else if (MPackMatchString(redraw_command_name, "default_colors_set")) {
-			UpdateDefaultColors(renderer, redraw_command_arr);
-			renderer->draws_invalidated = true;
-		}
-		else if (MPackMatchString(redraw_command_name, "hl_attr_define")) {
-			UpdateHighlightAttributes(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "grid_line")) {
-			DrawGridLines(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "grid_cursor_goto")) {
-			// If the old cursor position is still within the row bounds,
-			// redraw the line to get rid of the cursor
-			if(renderer->cursor.row < renderer->grid_rows) {
-				DrawGridLine(renderer, renderer->cursor.row);
-			}
-			UpdateCursorPos(renderer, redraw_command_arr);
+	while (const RedrawOp *op = RedrawOpsNext(&ops)) {
+		switch (op->type) {
+		// Grid changes only mark rows dirty, drawing waits for the flush
+		case RedrawOpType::GridLine: {
+			RedrawApplyGridLine(&renderer->model, reinterpret_cast<const RedrawOpGridLine *>(op));
+		} break;
+		case RedrawOpType::GridScroll: {
+			// Sadly I have given up on making use of IDXGISwapChain1::Present1
+			// scroll_rects or bitmap copies. The former seems insufficient for
+			// nvim since it can require multiple scrolls per frame, the latter
+			// I can't seem to make work with the FLIP_SEQUENTIAL swapchain model.
+			// Thus we fall back to redrawing the scrolled grid lines
+			RedrawApplyGridScroll(&renderer->model, reinterpret_cast<const RedrawOpGridScroll *>(op));
+		} break;
+		case RedrawOpType::GridCursorGoto: {
+			RedrawApplyCursorGoto(&renderer->model, reinterpret_cast<const RedrawOpCursorGoto *>(op));
 			UpdateImePos(renderer);
-		}
-		else if (MPackMatchString(redraw_command_name, "mode_info_set")) {
-			UpdateCursorModeInfos(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "mode_change")) {
-			// Redraw cursor if its inside the bounds
-			if(renderer->cursor.row < renderer->grid_rows) {
-				DrawGridLine(renderer, renderer->cursor.row);
-			}
-			UpdateCursorMode(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "set_title")) {
-			UpdateWindowTitle(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "busy_start")) {
-			renderer->ui_busy = true;
-			// Hide cursor while UI is busy
-			if(renderer->cursor.row < renderer->grid_rows) {
-				DrawGridLine(renderer, renderer->cursor.row);
-			}
-		}
-		else if (MPackMatchString(redraw_command_name, "busy_stop")) {
-			renderer->ui_busy = false;
-		}
-		else if (MPackMatchString(redraw_command_name, "grid_scroll")) {
-			ScrollRegion(renderer, redraw_command_arr);
-		}
-		else if (MPackMatchString(redraw_command_name, "flush")) {
+		} break;
+		case RedrawOpType::Flush: {
 			if (!renderer->has_drawn) {
 				renderer->has_drawn = true;
-				ShowWindow(renderer->hwnd, start_maximized ? SW_MAXIMIZE : SW_SHOWDEFAULT);			}
+				ShowWindow(renderer->hwnd, start_maximized ? SW_MAXIMIZE : SW_SHOWDEFAULT);
+			}
 
 			RendererFlush(renderer);
+		} break;
+		case RedrawOpType::HlAttrDefine: {
+			const RedrawOpHlAttrDefine *hl_op = reinterpret_cast<const RedrawOpHlAttrDefine *>(op);
+			RedrawApplyHighlightDefine(&renderer->model, hl_op);
+			EffectPoolInvalidateId(&renderer->effect_pool, hl_op->hl_attrib_id);
+		} break;
+		case RedrawOpType::GridResize: {
+			if (UpdateGridSize(renderer, reinterpret_cast<const RedrawOpGridResize *>(op))) {
+				PixelSize size = RendererGridToPixelSize(renderer, renderer->model.grid.rows, renderer->model.grid.cols);
+				SetWindowPos(renderer->hwnd, HWND_TOP, 0, 0, size.width, size.height, SWP_NOMOVE | SWP_NOZORDER | SWP_FRAMECHANGED);
+			}
+		} break;
+		case RedrawOpType::GridClear: {
+			RedrawApplyGridClear(&renderer->model, reinterpret_cast<const RedrawOpGrid *>(op));
+		} break;
+		// Window layout only changes the model, the flush composes the
+		// screen cells the grids moved off of and onto
+		case RedrawOpType::WinPos:
+		case RedrawOpType::WinFloatPos:
+		case RedrawOpType::WinHide:
+		case RedrawOpType::WinClose:
+		case RedrawOpType::GridDestroy:
+		case RedrawOpType::MsgSetPos: {
+			RedrawApplyOp(&renderer->model, op);
+			// The cursor moves along with its grid
+			UpdateImePos(renderer);
+		} break;
+		case RedrawOpType::DefaultColorsSet: {
+			RedrawApplyDefaultColors(&renderer->model, reinterpret_cast<const RedrawOpDefaultColors *>(op));
+			EffectPoolClear(&renderer->effect_pool);
+		} break;
+		case RedrawOpType::ModeInfoSet: {
+			RedrawApplyModeInfoSet(&renderer->model, reinterpret_cast<const RedrawOpModeInfoSet *>(op));
+		} break;
+		case RedrawOpType::ModeChange: {
+			RedrawApplyModeChange(&renderer->model, reinterpret_cast<const RedrawOpModeChange *>(op));
+		} break;
+		case RedrawOpType::SetGuiFont: {
+			SetGuiFont(renderer, reinterpret_cast<const RedrawOpString *>(op));
+		} break;
+		case RedrawOpType::SetTitle: {
+			UpdateWindowTitle(renderer, reinterpret_cast<const RedrawOpString *>(op));
+		} break;
+		case RedrawOpType::BusyStart: {
+			// The cursor is hidden by the next flush
+			renderer->model.ui_busy = true;
+		} break;
+		case RedrawOpType::BusyStop: {
+			renderer->model.ui_busy = false;
+		} break;
+		case RedrawOpType::Count: {
+		} break;
 		}
 	}
 }
@@ -1,31 +1,13 @@
 #pragma once
+#include "model/effect_pool.h"
+#include "model/glyph_cache.h"
+#include "model/layout_cache.h"
+#include "model/ui_model.h"
+#include "nvim/redraw_ops.h"
 
 constexpr const char *DEFAULT_FONT = "Consolas";
 constexpr float DEFAULT_FONT_SIZE = 14.0f;
 
-constexpr uint32_t DEFAULT_COLOR = 0x46464646;
-enum HighlightAttributeFlags : uint16_t {
-	HL_ATTRIB_REVERSE			= 1 << 0,
-	HL_ATTRIB_ITALIC			= 1 << 1,
-	HL_ATTRIB_BOLD				= 1 << 2,
-	HL_ATTRIB_STRIKETHROUGH		= 1 << 3,
-	HL_ATTRIB_UNDERLINE			= 1 << 4,
-	HL_ATTRIB_UNDERCURL			= 1 << 5
-};
-struct HighlightAttributes {
-	uint32_t foreground;
-	uint32_t background;
-	uint32_t special;
-	uint16_t flags;
-};
-
-enum class CursorShape {
-	None,
-	Block,
-	Vertical,
-	Horizontal
-};
-
 struct GridPoint {
 	int row;
 	int col;
@@ -39,32 +21,26 @@ struct PixelSize {
 	int height;
 };
 
-struct CursorModeInfo {
-	CursorShape shape;
-	uint16_t hl_attrib_id;
-};
-struct Cursor {
-	CursorModeInfo *mode_info;
-	int row;
-	int col;
-};
-
-struct CellProperty {
-	uint16_t hl_attrib_id;
-	bool is_wide_char;
+// Scratch space for shaping a row into glyph runs, grown as rows get wider
+struct GlyphRunBuffers {
+	uint16_t *text;
+	uint16_t *text_cells;
+	uint16_t *cluster_map;
+	DWRITE_SHAPING_TEXT_PROPERTIES *text_props;
+	uint16_t *glyph_indices;
+	DWRITE_SHAPING_GLYPH_PROPERTIES *glyph_props;
+	float *glyph_advances;
+	int text_capacity;
+	int glyph_capacity;
 };
 
-constexpr int MAX_HIGHLIGHT_ATTRIBS = 0xFFFF;
-constexpr int MAX_CURSOR_MODE_INFOS = 64;
 constexpr int MAX_FONT_LENGTH = 128;
 constexpr float DEFAULT_DPI = 96.0f;
 constexpr float POINTS_PER_INCH = 72.0f;
 struct GlyphDrawingEffect;
 struct GlyphRenderer;
 struct Renderer {
-	CursorModeInfo cursor_mode_infos[MAX_CURSOR_MODE_INFOS];
-	Vec<HighlightAttributes> hl_attribs;
-	Cursor cursor;
+	UIModel model;
 
 	GlyphRenderer *glyph_renderer;
 
@@ -80,6 +56,7 @@ struct Renderer {
 	ID2D1SolidColorBrush *d2d_background_rect_brush;
 
     IDWriteFontFace1 *font_face;
+	IDWriteFontFace1 *font_face_bold;
 
 	IDWriteFactory4 *dwrite_factory;
 	IDWriteTextFormat *dwrite_text_format;
@@ -87,6 +64,22 @@ struct Renderer {
 	bool disable_ligatures;
 	IDWriteTypography *dwrite_typography;
 
+	// Rows the font can draw on its own are shaped run by run and drawn
+	// as glyph runs snapped to the cells, rather than as a text layout
+	bool glyph_runs;
+	IDWriteTextAnalyzer *dwrite_text_analyzer;
+	GlyphRunBuffers glyph_run_buffers;
+
+	// Bumped on every font change, row layouts shaped with
+	// another font generation are never reused
+	uint32_t font_generation;
+	LayoutCache layout_cache;
+	// The glyph index and width of every character fitted to a cell so far
+	GlyphCache glyph_cache;
+	// The drawing effect of every color pair text was drawn with, kept
+	// across frames until the highlights change
+	EffectPool effect_pool;
+
 	float linespace_factor;
 
     float last_requested_font_size;
@@ -102,29 +95,36 @@ struct Renderer {
     float font_descent;
 
 	D2D1_SIZE_U pixel_size;
-	bool grid_initialized;
-	int grid_rows;
-	int grid_cols;
-	uint32_t *grid_chars;
 	wchar_t *wchar_buffer;
 	size_t wchar_buffer_length;
-	CellProperty *grid_cell_properties;
+
+	// Where the last flush drew the cursor, its row is redrawn
+	// to erase the cursor once it moves or changes shape
+	bool cursor_drawn;
+	int drawn_cursor_row;
+	int drawn_cursor_col;
+	CursorModeInfo drawn_cursor_mode;
 
 	HWND hwnd;
 	bool draw_active;
-	bool ui_busy;
 	bool has_drawn;
 	bool draws_invalidated;
 };
 
-void RendererInitialize(Renderer *renderer, HWND hwnd, bool disable_ligatures, float linespace_factor, float monitor_dpi);
+// Resolved colors are kept in the layout of D2D1_COLOR_F
+static_assert(sizeof(ColorRGBA) == sizeof(D2D1_COLOR_F));
+inline D2D1_COLOR_F D2DColor(ColorRGBA color) {
+	return D2D1_COLOR_F { .r = color.r, .g = color.g, .b = color.b, .a = color.a };
+}
+
+void RendererInitialize(Renderer *renderer, HWND hwnd, bool disable_ligatures, bool glyph_runs, float linespace_factor, float monitor_dpi);
 void RendererAttach(Renderer *renderer);
 void RendererShutdown(Renderer *renderer);
 
 void RendererResize(Renderer *renderer, uint32_t width, uint32_t height);
 bool RendererUpdateGuiFont(Renderer *renderer, const char *guifont, size_t strlen);
 bool RendererUpdateFont(Renderer *renderer, float font_size, const char *font_string = "", int strlen = 0);
-void RendererRedraw(Renderer *renderer, mpack_node_t params, bool start_maximized);
+void RendererRedraw(Renderer *renderer, RedrawOps ops, bool start_maximized);
 void RendererFlush(Renderer* renderer);
 
 PixelSize RendererGridToPixelSize(Renderer *renderer, int rows, int cols);
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdio>
+
+// Minimal unit test harness for nvy_core. A failed check prints where it
+// failed and fails the suite, the checks after it still run.
+extern int test_failures;
+
+#define TEST_CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		++test_failures; \
+	} \
+} while (0)
+
+#define TEST_CHECK_EQ(actual, expected) do { \
+	long long actual_value = static_cast<long long>(actual); \
+	long long expected_value = static_cast<long long>(expected); \
+	if (actual_value != expected_value) { \
+		printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, \
+			#actual, #expected, actual_value, expected_value); \
+		++test_failures; \
+	} \
+} while (0)
+
+void TestUtf8();
+void TestQueue();
+void TestRedrawEvents();
+void TestDirtyRows();
+void TestCompositor();
+void TestGlyphCache();
+void TestCellGlyphs();
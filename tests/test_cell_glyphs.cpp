@@ -0,0 +1,85 @@
+#include "test.h"
+#include "model/cell_glyphs.h"
+#include "model/grid.h"
+
+constexpr float CELL_WIDTH = 8.0f;
+constexpr int MAX_GLYPHS = 8;
+
+// Places `glyph_count` glyphs shaped from cells `[0, end_cell)` and checks
+// the advance of each, in cells
+static void CheckPlace(const uint16_t *text_cells, const uint16_t *cluster_map, int text_length,
+	int glyph_count, int end_cell, const int *expected_cells) {
+	float advances[MAX_GLYPHS];
+	for (float &advance : advances) {
+		advance = -1.0f;
+	}
+	CellGlyphsPlace(text_cells, cluster_map, text_length, glyph_count, end_cell, CELL_WIDTH, advances);
+	for (int i = 0; i < glyph_count; ++i) {
+		TEST_CHECK_EQ(advances[i], expected_cells[i] * CELL_WIDTH);
+	}
+	// Nothing past the glyphs is touched
+	TEST_CHECK(advances[glyph_count] == -1.0f);
+}
+
+void TestCellGlyphs() {
+	uint16_t text[MAX_GLYPHS * 2];
+	uint16_t text_cells[MAX_GLYPHS * 2];
+
+	// One glyph per cell
+	const uint16_t plain_cells[] { 0, 1, 2 };
+	const uint16_t plain_map[] { 0, 1, 2 };
+	const int plain_advances[] { 1, 1, 1 };
+	CheckPlace(plain_cells, plain_map, 3, 3, 3, plain_advances);
+
+	// A ligature takes up every cell of its cluster, on its last glyph
+	// when the font draws it as a glyph and spacers
+	const uint16_t ligature_cells[] { 0, 1, 2, 3, 4, 5 };
+	const uint16_t ligature_map[] { 0, 0, 1, 2, 2, 2 };
+	const int ligature_advances[] { 2, 1, 0, 0, 3 };
+	CheckPlace(ligature_cells, ligature_map, 6, 5, 6, ligature_advances);
+	// The last cluster ends at `end_cell`, past trailing cells with no text
+	const int ligature_end_advances[] { 2, 1, 0, 0, 5 };
+	CheckPlace(ligature_cells, ligature_map, 6, 5, 8, ligature_end_advances);
+
+	// A double width character's right half holds no text, so its cluster
+	// covers both cells
+	const uint32_t wide_chars[] { 0x4E00, GRID_CHAR_WIDE_RIGHT_HALF, 'a' };
+	const uint8_t wide_flags[] { GRID_CELL_WIDE, GRID_CELL_CONTINUATION, 0 };
+	int text_length = CellTextBuild(wide_chars, wide_flags, 3, text, text_cells);
+	TEST_CHECK_EQ(text_length, 2);
+	TEST_CHECK_EQ(text[0], 0x4E00);
+	TEST_CHECK_EQ(text[1], 'a');
+	TEST_CHECK_EQ(text_cells[0], 0);
+	TEST_CHECK_EQ(text_cells[1], 2);
+	const uint16_t wide_map[] { 0, 1 };
+	const int wide_advances[] { 2, 1 };
+	CheckPlace(text_cells, wide_map, text_length, 2, 3, wide_advances);
+
+	// Both units of a surrogate pair come from its cell and shape into one
+	// cluster, here a double width emoji between two narrow cells
+	const uint32_t pair_chars[] { 'a', (0xD83Du << 16) | 0xDE00u, GRID_CHAR_WIDE_RIGHT_HALF, 'b' };
+	const uint8_t pair_flags[] { 0, GRID_CELL_WIDE, GRID_CELL_CONTINUATION, 0 };
+	text_length = CellTextBuild(pair_chars, pair_flags, 4, text, text_cells);
+	TEST_CHECK_EQ(text_length, 4);
+	TEST_CHECK_EQ(text[1], 0xD83D);
+	TEST_CHECK_EQ(text[2], 0xDE00);
+	TEST_CHECK_EQ(text_cells[1], 1);
+	TEST_CHECK_EQ(text_cells[2], 1);
+	TEST_CHECK_EQ(text_cells[3], 3);
+	const uint16_t pair_map[] { 0, 1, 1, 2 };
+	const int pair_advances[] { 1, 2, 1 };
+	CheckPlace(text_cells, pair_map, text_length, 3, 4, pair_advances);
+
+	// Glyphs in reverse order, or reordered anywhere in the text, make the
+	// whole text one cluster so the run still covers exactly its cells
+	const uint16_t reversed_map[] { 2, 1, 0 };
+	const int reversed_advances[] { 0, 0, 3 };
+	CheckPlace(plain_cells, reversed_map, 3, 3, 3, reversed_advances);
+	const uint16_t reordered_cells[] { 0, 1, 2, 3 };
+	const uint16_t reordered_map[] { 0, 2, 1, 3 };
+	const int reordered_advances[] { 0, 0, 0, 4 };
+	CheckPlace(reordered_cells, reordered_map, 4, 4, 4, reordered_advances);
+
+	// No text at all
+	CheckPlace(plain_cells, plain_map, 0, 0, 3, plain_advances);
+}
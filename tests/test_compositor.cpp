@@ -0,0 +1,127 @@
+#include "test.h"
+#include "model/compositor.h"
+
+constexpr int SCREEN_ROWS = 10;
+constexpr int SCREEN_COLS = 20;
+
+static uint32_t GridChar(int id) {
+	return 'a' + id;
+}
+
+// A grid placed at (row, col) with every cell holding GridChar(id)
+static UIGrid *AddGrid(Compositor *compositor, int id, int rows, int cols, int row, int col, int zindex) {
+	UIGrid *ui_grid = CompositorGetGrid(compositor, id);
+	GridResize(&ui_grid->grid, rows, cols);
+	for (int r = 0; r < rows; ++r) {
+		GridFillRow(&ui_grid->grid, r, GridChar(id), static_cast<uint16_t>(id));
+	}
+	if (id != GLOBAL_GRID_ID) {
+		CompositorPlaceGrid(compositor, ui_grid, row, col, zindex);
+	}
+	return ui_grid;
+}
+
+// Composes a whole row and returns the char at `col`
+static uint32_t ComposedChar(Compositor *compositor, Grid *screen, int row, int col) {
+	GridFillRow(screen, row, ' ', 0);
+	CompositorComposeSpan(compositor, screen, row, 0, SCREEN_COLS);
+	return GridRowChars(screen, row)[col];
+}
+
+void TestCompositor() {
+	Grid screen {};
+	GridResize(&screen, SCREEN_ROWS, SCREEN_COLS);
+
+	// Grids stack by zindex, then by placement, and the global grid stays
+	// underneath whatever its zindex
+	Compositor *compositor = new Compositor {};
+	AddGrid(compositor, GLOBAL_GRID_ID, SCREEN_ROWS, SCREEN_COLS, 0, 0, 0);
+	compositor->grids[0].zindex = 1000;
+	AddGrid(compositor, 2, SCREEN_ROWS, SCREEN_COLS, 0, 0, 0);
+	AddGrid(compositor, 3, 4, 4, 0, 0, FLOAT_DEFAULT_ZINDEX);
+	AddGrid(compositor, 4, 4, 4, 0, 0, FLOAT_DEFAULT_ZINDEX + 1);
+	AddGrid(compositor, 5, 2, 2, 0, 0, FLOAT_DEFAULT_ZINDEX);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 0), GridChar(4));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 3, 3), GridChar(4));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 5, 5), GridChar(2));
+	TEST_CHECK_EQ(CompositorGridAt(compositor, 0, 0)->id, 4);
+
+	// Placing again moves a grid above the others of its zindex
+	CompositorPlaceGrid(compositor, CompositorFindGrid(compositor, 4), 0, 0, FLOAT_DEFAULT_ZINDEX);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 0), GridChar(4));
+	CompositorPlaceGrid(compositor, CompositorFindGrid(compositor, 5), 0, 0, FLOAT_DEFAULT_ZINDEX);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 0), GridChar(5));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 2), GridChar(4));
+	TEST_CHECK_EQ(CompositorGridAt(compositor, 1, 1)->id, 5);
+	CompositorFree(compositor);
+	delete compositor;
+
+	// Spans are clipped to the part of each grid they cover, grids hanging
+	// off the screen included
+	compositor = new Compositor {};
+	AddGrid(compositor, GLOBAL_GRID_ID, SCREEN_ROWS, SCREEN_COLS, 0, 0, 0);
+	UIGrid *left = AddGrid(compositor, 2, 3, 6, -1, -2, FLOAT_DEFAULT_ZINDEX);
+	AddGrid(compositor, 3, 3, 6, 1, SCREEN_COLS - 4, FLOAT_DEFAULT_ZINDEX);
+	GridRowChars(&left->grid, 1)[3] = 'X';
+	GridFillRow(&screen, 0, ' ', 0);
+	uint64_t cells_composed = compositor->stats.cells_composed;
+	CompositorComposeSpan(compositor, &screen, 0, 1, 8);
+	uint32_t *chars = GridRowChars(&screen, 0);
+	TEST_CHECK_EQ(chars[0], ' ');
+	TEST_CHECK_EQ(chars[1], 'X');
+	TEST_CHECK_EQ(chars[3], GridChar(2));
+	TEST_CHECK_EQ(chars[4], GridChar(1));
+	TEST_CHECK_EQ(chars[7], GridChar(1));
+	TEST_CHECK_EQ(chars[8], ' ');
+	// 7 cells of the global grid and 3 of the float
+	TEST_CHECK_EQ(compositor->stats.cells_composed - cells_composed, 10);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 1, SCREEN_COLS - 5), GridChar(1));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 1, SCREEN_COLS - 4), GridChar(3));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 1, SCREEN_COLS - 1), GridChar(3));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 2, 0), GridChar(1));
+	TEST_CHECK(CompositorGridAt(compositor, 2, -1) == nullptr);
+	CompositorFree(compositor);
+	delete compositor;
+
+	// Moving or hiding a float shows what was underneath it again
+	compositor = new Compositor {};
+	AddGrid(compositor, GLOBAL_GRID_ID, SCREEN_ROWS, SCREEN_COLS, 0, 0, 0);
+	AddGrid(compositor, 2, SCREEN_ROWS, SCREEN_COLS / 2, 0, 0, 0);
+	AddGrid(compositor, 3, SCREEN_ROWS, SCREEN_COLS / 2, 0, SCREEN_COLS / 2, 0);
+	UIGrid *float_grid = AddGrid(compositor, 4, 2, 4, 2, 8, FLOAT_DEFAULT_ZINDEX);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 2, 8), GridChar(4));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 2, 11), GridChar(4));
+	CompositorPlaceGrid(compositor, float_grid, 5, 8, FLOAT_DEFAULT_ZINDEX);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 2, 8), GridChar(2));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 2, 11), GridChar(3));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 6, 9), GridChar(4));
+	CompositorHideGrid(compositor, float_grid);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 6, 9), GridChar(2));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 6, 10), GridChar(3));
+	TEST_CHECK_EQ(CompositorGridAt(compositor, 6, 9)->id, 2);
+
+	// Destroying a grid moves the last one into its place, which must
+	// keep its contents and its place in the stack
+	AddGrid(compositor, 5, 1, 1, 0, 0, FLOAT_DEFAULT_ZINDEX);
+	UIGrid *moved = CompositorFindGrid(compositor, 5);
+	GridRowChars(&moved->grid, 0)[0] = 'Y';
+	CompositorDestroyGrid(compositor, 2);
+	TEST_CHECK_EQ(compositor->grid_count, 4);
+	TEST_CHECK(CompositorFindGrid(compositor, 2) == nullptr);
+	moved = CompositorFindGrid(compositor, 5);
+	TEST_CHECK(moved != nullptr);
+	TEST_CHECK_EQ(moved - compositor->grids, 1);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 0), 'Y');
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 1), GridChar(1));
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 10), GridChar(3));
+	// Destroying the last grid and unknown ids
+	CompositorDestroyGrid(compositor, 4);
+	CompositorDestroyGrid(compositor, 42);
+	TEST_CHECK_EQ(compositor->grid_count, 3);
+	TEST_CHECK(CompositorFindGrid(compositor, 3) != nullptr);
+	TEST_CHECK_EQ(ComposedChar(compositor, &screen, 0, 0), 'Y');
+	CompositorFree(compositor);
+	delete compositor;
+
+	GridFree(&screen);
+}
@@ -0,0 +1,82 @@
+#include <vector>
+#include "test.h"
+#include "model/dirty_rows.h"
+
+struct FlushedRow {
+	int row;
+	DirtyRowSpan span;
+};
+
+static std::vector<FlushedRow> Flush(DirtyRows *dirty_rows) {
+	std::vector<FlushedRow> flushed;
+	int rows_drawn = DirtyRowsFlush(dirty_rows, [&](int row, DirtyRowSpan span) {
+		flushed.push_back(FlushedRow { .row = row, .span = span });
+	});
+	TEST_CHECK_EQ(rows_drawn, flushed.size());
+	return flushed;
+}
+
+void TestDirtyRows() {
+	// More than one word of rows, so flushing crosses a word boundary
+	DirtyRows dirty_rows {};
+	DirtyRowsResize(&dirty_rows, 130, 80);
+
+	// Everything is dirty after a resize
+	std::vector<FlushedRow> flushed = Flush(&dirty_rows);
+	TEST_CHECK_EQ(flushed.size(), 130);
+	TEST_CHECK_EQ(flushed[129].row, 129);
+	TEST_CHECK_EQ(flushed[129].span.left, 0);
+	TEST_CHECK_EQ(flushed[129].span.right, 80);
+	TEST_CHECK(Flush(&dirty_rows).empty());
+
+	// Spans are clipped to the grid, off grid and empty ones mark nothing
+	DirtyRowsMarkSpan(&dirty_rows, 3, -5, 10);
+	DirtyRowsMarkSpan(&dirty_rows, 4, 70, 200);
+	DirtyRowsMarkSpan(&dirty_rows, -1, 0, 80);
+	DirtyRowsMarkSpan(&dirty_rows, 130, 0, 80);
+	DirtyRowsMarkSpan(&dirty_rows, 5, 10, 10);
+	DirtyRowsMarkSpan(&dirty_rows, 6, 80, 90);
+	TEST_CHECK(!DirtyRowsIsDirty(&dirty_rows, 5));
+	TEST_CHECK(!DirtyRowsIsDirty(&dirty_rows, 6));
+	TEST_CHECK(!DirtyRowsIsDirty(&dirty_rows, 130));
+
+	// A row marked again gets the span covering all of its marks
+	DirtyRowsMarkSpan(&dirty_rows, 64, 20, 25);
+	DirtyRowsMarkSpan(&dirty_rows, 64, 40, 45);
+	DirtyRowsMarkSpan(&dirty_rows, 64, 22, 30);
+	uint64_t redundant_marks = dirty_rows.stats.redundant_marks;
+
+	// Rows come out top to bottom, across words, and only once
+	flushed = Flush(&dirty_rows);
+	TEST_CHECK_EQ(flushed.size(), 3);
+	if (flushed.size() == 3) {
+		TEST_CHECK_EQ(flushed[0].row, 3);
+		TEST_CHECK_EQ(flushed[0].span.left, 0);
+		TEST_CHECK_EQ(flushed[0].span.right, 10);
+		TEST_CHECK_EQ(flushed[1].row, 4);
+		TEST_CHECK_EQ(flushed[1].span.left, 70);
+		TEST_CHECK_EQ(flushed[1].span.right, 80);
+		TEST_CHECK_EQ(flushed[2].row, 64);
+		TEST_CHECK_EQ(flushed[2].span.left, 20);
+		TEST_CHECK_EQ(flushed[2].span.right, 45);
+	}
+	TEST_CHECK_EQ(redundant_marks, 2);
+	TEST_CHECK(!DirtyRowsIsDirty(&dirty_rows, 64));
+
+	// A flushed row starts a new span rather than growing the old one
+	DirtyRowsMarkSpan(&dirty_rows, 64, 50, 51);
+	flushed = Flush(&dirty_rows);
+	TEST_CHECK_EQ(flushed.size(), 1);
+	TEST_CHECK_EQ(flushed[0].span.left, 50);
+	TEST_CHECK_EQ(flushed[0].span.right, 51);
+
+	// Rects clip their rows as well
+	DirtyRowsMarkRect(&dirty_rows, -3, 2, 5, 6);
+	DirtyRowsMarkRect(&dirty_rows, 128, 140, 0, 1);
+	flushed = Flush(&dirty_rows);
+	TEST_CHECK_EQ(flushed.size(), 4);
+	TEST_CHECK_EQ(flushed[0].row, 0);
+	TEST_CHECK_EQ(flushed[3].row, 129);
+
+	DirtyRowsFree(&dirty_rows);
+}
@@ -0,0 +1,96 @@
+#include "test.h"
+#include "model/glyph_cache.h"
+
+// Enough to grow the map from its initial 1024 slots twice
+constexpr uint32_t GLYPH_TEST_CHARS = 1500;
+constexpr uint32_t GLYPH_TEST_FIRST_CHAR = 0x4E00;
+
+static GlyphMetrics TestMetrics(uint32_t grid_char, bool wide) {
+	return GlyphMetrics {
+		.glyph_index = static_cast<uint16_t>(grid_char * 2 + (wide ? 1 : 0)),
+		.advance = wide ? 2.0f : 1.0f
+	};
+}
+
+static bool FindsMetrics(GlyphCache *cache, uint32_t grid_char, bool wide) {
+	GlyphMetrics metrics {};
+	if (!GlyphCacheFind(cache, grid_char, wide, &metrics)) {
+		return false;
+	}
+	GlyphMetrics expected = TestMetrics(grid_char, wide);
+	return metrics.glyph_index == expected.glyph_index && metrics.advance == expected.advance;
+}
+
+void TestGlyphCache() {
+	GlyphCache cache {};
+	GlyphCacheInitialize(&cache);
+	uint32_t initial_slots = cache.table_mask + 1;
+
+	// Every char is measured once, by GlyphCacheGet on the first miss
+	int measures = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		GlyphMetrics metrics = GlyphCacheGet(&cache, 0x2500, false, [&]() {
+			++measures;
+			return TestMetrics(0x2500, false);
+		});
+		TEST_CHECK_EQ(metrics.glyph_index, TestMetrics(0x2500, false).glyph_index);
+	}
+	TEST_CHECK_EQ(measures, 1);
+	TEST_CHECK_EQ(cache.stats.misses, 1);
+	TEST_CHECK_EQ(cache.stats.hits, 1);
+
+	// The same char on its own and as a double width cell are kept apart
+	TEST_CHECK(!FindsMetrics(&cache, 0x2500, true));
+	GlyphCacheInsert(&cache, 0x2500, true, TestMetrics(0x2500, true));
+	TEST_CHECK(FindsMetrics(&cache, 0x2500, false));
+	TEST_CHECK(FindsMetrics(&cache, 0x2500, true));
+	// So are packed surrogate pairs and the char their low half would be
+	uint32_t packed_pair = (0xD83Du << 16) | 0xDE00u;
+	GlyphCacheInsert(&cache, packed_pair, true, TestMetrics(packed_pair, true));
+	TEST_CHECK(FindsMetrics(&cache, packed_pair, true));
+	TEST_CHECK(!FindsMetrics(&cache, 0xDE00, true));
+	TEST_CHECK(!FindsMetrics(&cache, packed_pair, false));
+
+	// Growing rehashes every char, it stays at most half full and finds
+	// everything inserted before and after
+	for (uint32_t i = 0; i < GLYPH_TEST_CHARS; ++i) {
+		uint32_t grid_char = GLYPH_TEST_FIRST_CHAR + i;
+		GlyphCacheInsert(&cache, grid_char, i % 2 == 0, TestMetrics(grid_char, i % 2 == 0));
+	}
+	TEST_CHECK_EQ(cache.count, GLYPH_TEST_CHARS + 3);
+	TEST_CHECK_EQ(cache.table_mask + 1, initial_slots * 4);
+	TEST_CHECK(cache.count * 2 <= cache.table_mask + 1);
+	int found = 0;
+	for (uint32_t i = 0; i < GLYPH_TEST_CHARS; ++i) {
+		uint32_t grid_char = GLYPH_TEST_FIRST_CHAR + i;
+		found += FindsMetrics(&cache, grid_char, i % 2 == 0);
+		TEST_CHECK(!FindsMetrics(&cache, grid_char, i % 2 != 0));
+	}
+	TEST_CHECK_EQ(found, GLYPH_TEST_CHARS);
+	TEST_CHECK(FindsMetrics(&cache, 0x2500, false));
+	TEST_CHECK(FindsMetrics(&cache, 0x2500, true));
+	TEST_CHECK(FindsMetrics(&cache, packed_pair, true));
+
+	// Clearing forgets the map and Latin-1 both, for the next font
+	uint16_t glyph_indices[GLYPH_CACHE_LATIN1_CHARS];
+	float advances[GLYPH_CACHE_LATIN1_CHARS];
+	for (uint32_t i = 0; i < GLYPH_CACHE_LATIN1_CHARS; ++i) {
+		glyph_indices[i] = static_cast<uint16_t>(i + 3);
+		advances[i] = 1.0f;
+	}
+	GlyphCacheSetLatin1(&cache, glyph_indices, advances);
+	TEST_CHECK_EQ(cache.latin1['A'].glyph_index, 'A' + 3);
+	GlyphCacheClear(&cache);
+	TEST_CHECK_EQ(cache.stats.clears, 1);
+	TEST_CHECK_EQ(cache.count, 0);
+	TEST_CHECK_EQ(cache.latin1['A'].glyph_index, 0);
+	TEST_CHECK(cache.latin1[0xFF].advance == 0.0f);
+	TEST_CHECK(!FindsMetrics(&cache, 0x2500, false));
+	TEST_CHECK(!FindsMetrics(&cache, packed_pair, true));
+	TEST_CHECK(!FindsMetrics(&cache, GLYPH_TEST_FIRST_CHAR, true));
+	GlyphCacheInsert(&cache, 0x2500, false, TestMetrics(0x2500, false));
+	TEST_CHECK(FindsMetrics(&cache, 0x2500, false));
+	TEST_CHECK(!FindsMetrics(&cache, 0x2500, true));
+
+	GlyphCacheFree(&cache);
+}
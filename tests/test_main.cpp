@@ -0,0 +1,40 @@
+#include <cstring>
+#include "test.h"
+
+int test_failures = 0;
+
+struct TestSuite {
+	const char *name;
+	void (*run)();
+};
+
+constexpr TestSuite TEST_SUITES[] {
+	{ "utf8", TestUtf8 },
+	{ "queue", TestQueue },
+	{ "redraw_events", TestRedrawEvents },
+	{ "dirty_rows", TestDirtyRows },
+	{ "compositor", TestCompositor },
+	{ "glyph_cache", TestGlyphCache },
+	{ "cell_glyphs", TestCellGlyphs },
+};
+
+int main(int argc, char **argv) {
+	// Optionally run a single suite by name, e.g. `nvy_tests utf8`,
+	// which is how ctest runs them
+	const char *filter = argc > 1 ? argv[1] : nullptr;
+	bool ran = false;
+	for (const TestSuite &suite : TEST_SUITES) {
+		if (filter && strcmp(filter, suite.name) != 0) {
+			continue;
+		}
+		int failures_before = test_failures;
+		suite.run();
+		printf("%-12s %s\n", suite.name, test_failures == failures_before ? "ok" : "FAILED");
+		ran = true;
+	}
+	if (!ran) {
+		printf("no test suite named %s\n", filter);
+		return 1;
+	}
+	return test_failures == 0 ? 0 : 1;
+}
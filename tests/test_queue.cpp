@@ -0,0 +1,43 @@
+#include <vector>
+#include "test.h"
+#include "nvim/message_queue.h"
+
+static void CountWake(void *wake_context) {
+	++*static_cast<int *>(wake_context);
+}
+
+// Pushes and pops a message of `size` bytes through the next slot
+static void PushPop(NvimMessageQueue *queue, const std::vector<char> &message, size_t size) {
+	NvimMessageQueuePush(queue, NvimMessageKind::Rpc, message.data(), size);
+	NvimMessageQueueEndBatch(queue);
+	TEST_CHECK_EQ(NvimMessageQueueBeginDrain(queue), 1);
+	NvimQueuedMessage front = NvimMessageQueueFront(queue);
+	TEST_CHECK_EQ(front.size, size);
+	NvimMessageQueuePop(queue);
+}
+
+void TestQueue() {
+	NvimMessageQueue *queue = new NvimMessageQueue;
+	int wakes = 0;
+	NvimMessageQueueInitialize(queue, &wakes, CountWake);
+
+	std::vector<char> message(NVIM_MESSAGE_QUEUE_MAX_SLOT_SIZE * 4, 'x');
+	// Slot 0 takes a full screen repaint, slot 1 a batch under the cap
+	PushPop(queue, message, message.size());
+	PushPop(queue, message, NVIM_MESSAGE_QUEUE_MAX_SLOT_SIZE / 2);
+	TEST_CHECK(queue->slots[0].arena.capacity >= message.size());
+	size_t slot1_capacity = queue->slots[1].arena.capacity;
+	for (size_t i = 2; i < NVIM_MESSAGE_QUEUE_CAPACITY; ++i) {
+		PushPop(queue, message, 16);
+	}
+	TEST_CHECK_EQ(wakes, NVIM_MESSAGE_QUEUE_CAPACITY);
+
+	// Reusing the slots shrinks only the one that grew past the cap
+	PushPop(queue, message, 16);
+	PushPop(queue, message, 16);
+	TEST_CHECK_EQ(queue->slots[0].arena.capacity, NVIM_MESSAGE_QUEUE_INITIAL_SLOT_SIZE);
+	TEST_CHECK_EQ(queue->slots[1].arena.capacity, slot1_capacity);
+
+	NvimMessageQueueDestroy(queue);
+	delete queue;
+}
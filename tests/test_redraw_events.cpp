@@ -0,0 +1,54 @@
+#include <cstring>
+#include "test.h"
+#include "nvim/redraw_events.h"
+
+// Checks the event lookup against nvim's own list of UI events, so an
+// event missing from RedrawEvent or spelled differently shows up here
+void TestRedrawEvents() {
+	const char *path = NVY_TEST_DATA_DIR "/nvim_ui_events.txt";
+	FILE *file = fopen(path, "r");
+	TEST_CHECK(file != nullptr);
+	if (!file) {
+		return;
+	}
+
+	bool listed[REDRAW_EVENT_COUNT] {};
+	int name_count = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		uint32_t length = static_cast<uint32_t>(strcspn(line, "\r\n"));
+		line[length] = '\0';
+		if (length == 0 || line[0] == '#') {
+			continue;
+		}
+		++name_count;
+
+		RedrawEvent event = RedrawEventLookup(line, length);
+		if (event == RedrawEvent::Unknown) {
+			printf("nvim ui event %s is not a RedrawEvent\n", line);
+			++test_failures;
+			continue;
+		}
+		size_t index = static_cast<size_t>(event);
+		TEST_CHECK(strcmp(REDRAW_EVENT_NAMES[index], line) == 0);
+		TEST_CHECK(!listed[index]);
+		listed[index] = true;
+
+		// Any one character off is another event or none at all
+		line[length - 1] ^= 0x20;
+		TEST_CHECK(RedrawEventLookup(line, length) != event);
+	}
+	fclose(file);
+
+	for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+		if (!listed[i]) {
+			printf("RedrawEvent %s is not an nvim ui event\n", REDRAW_EVENT_NAMES[i]);
+			++test_failures;
+		}
+	}
+	TEST_CHECK_EQ(name_count, REDRAW_EVENT_COUNT);
+
+	TEST_CHECK(RedrawEventLookup("", 0) == RedrawEvent::Unknown);
+	TEST_CHECK(RedrawEventLookup("grid_lines", 10) == RedrawEvent::Unknown);
+	TEST_CHECK(RedrawEventLookup("grid_lin", 8) == RedrawEvent::Unknown);
+}
@@ -0,0 +1,52 @@
+#include <cstring>
+#include "test.h"
+#include "common/utf8.h"
+
+static uint32_t DecodeOne(const char *str, size_t *consumed) {
+	size_t index = 0;
+	uint32_t codepoint = Utf8DecodeCodepoint(str, strlen(str), &index);
+	*consumed = index;
+	return codepoint;
+}
+
+void TestUtf8() {
+	size_t consumed;
+	TEST_CHECK_EQ(DecodeOne("a", &consumed), 'a');
+	TEST_CHECK_EQ(consumed, 1);
+	TEST_CHECK_EQ(DecodeOne("\xC3\xA9", &consumed), 0xE9);
+	TEST_CHECK_EQ(consumed, 2);
+	TEST_CHECK_EQ(DecodeOne("\xE4\xB8\x80", &consumed), 0x4E00);
+	TEST_CHECK_EQ(consumed, 3);
+	TEST_CHECK_EQ(DecodeOne("\xF0\x9F\x98\x80", &consumed), 0x1F600);
+	TEST_CHECK_EQ(consumed, 4);
+
+	// Malformed sequences consume a single byte
+	TEST_CHECK_EQ(DecodeOne("\xC0\xAF", &consumed), UNICODE_REPLACEMENT_CHAR);
+	TEST_CHECK_EQ(consumed, 1);
+	TEST_CHECK_EQ(DecodeOne("\xED\xA0\x80", &consumed), UNICODE_REPLACEMENT_CHAR);
+	TEST_CHECK_EQ(consumed, 1);
+	TEST_CHECK_EQ(DecodeOne("\xE4\xB8", &consumed), UNICODE_REPLACEMENT_CHAR);
+	TEST_CHECK_EQ(consumed, 1);
+	TEST_CHECK_EQ(DecodeOne("\x80", &consumed), UNICODE_REPLACEMENT_CHAR);
+	TEST_CHECK_EQ(consumed, 1);
+
+	// Astral codepoints are packed as a surrogate pair and unpacked again
+	uint32_t grinning = Utf8ToGridChar("\xF0\x9F\x98\x80", 4);
+	TEST_CHECK_EQ(grinning, (0xD83Du << 16) | 0xDE00u);
+	TEST_CHECK_EQ(GridCharToCodepoint(grinning), 0x1F600);
+	TEST_CHECK_EQ(Utf8ToGridChar("e\xCC\x81", 3), UNSUPPORTED_CELL_CHAR);
+
+	// The SIMD blocks only take the fast path without surrogate pairs,
+	// put one in every other block and leave a scalar tail
+	uint32_t grid_chars[53];
+	for (uint32_t i = 0; i < 53; ++i) {
+		grid_chars[i] = (i % 32 == 20) ? grinning : 'A' + i;
+	}
+	uint16_t expected[106];
+	uint16_t actual[106];
+	size_t expected_length = GridCharsToUtf16Scalar(grid_chars, 53, expected);
+	size_t actual_length = GridCharsToUtf16(grid_chars, 53, actual);
+	TEST_CHECK_EQ(expected_length, 55);
+	TEST_CHECK_EQ(actual_length, expected_length);
+	TEST_CHECK(memcmp(actual, expected, expected_length * sizeof(uint16_t)) == 0);
+}
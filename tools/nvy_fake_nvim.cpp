@@ -0,0 +1,390 @@
+// A stand-in for `nvim --embed` that speaks just enough msgpack-rpc on
+// stdin/stdout (or on a socket, like `nvim --listen`) for Nvy (or nvy_core
+// based tests) to attach to it, then sends a synthetic or recorded redraw
+// workload. Keys sent with nvim_input are echoed at the cursor, so
+// keystroke to flush latency can be measured without nvim installed.
+//
+// nvy_fake_nvim [--embed] [--listen=<address>] [--workload=<name>] [--frames=<n>]
+//               [--interval-ms=<n>] [--script=<recording>] [--paced] [--exit-after-workload]
+//   --listen=<address>      wait for one client on a Unix socket path or host:port
+//   --workload=<name>       repaint, scroll, page, terminal, wide or hl-churn
+//   --frames=<n>            number of workload batches to send, 1000 by default
+//   --interval-ms=<n>       pause between workload batches
+//   --script=<recording>    send the redraw notifications of a recording instead
+//   --paced                 send script messages at their recorded times
+//   --exit-after-workload   close the connection once the workload is sent
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "common/clock.h"
+#include "common/mpack_cursor.h"
+#include "common/mpack_helper.h"
+#include "nvim/recording.h"
+#include "nvim/redraw.h"
+#include "nvim/rpc.h"
+#include "nvim/transport.h"
+#include "workload.h"
+
+enum class FakeWorkload {
+	None,
+	Repaint,
+	Scroll,
+	Page,
+	Terminal,
+	Wide,
+	HighlightChurn
+};
+
+struct FakeWorkloadName {
+	const char *name;
+	FakeWorkload workload;
+};
+constexpr FakeWorkloadName FAKE_WORKLOAD_NAMES[] {
+	{ "repaint", FakeWorkload::Repaint },
+	{ "scroll", FakeWorkload::Scroll },
+	{ "page", FakeWorkload::Page },
+	{ "terminal", FakeWorkload::Terminal },
+	{ "wide", FakeWorkload::Wide },
+	{ "hl-churn", FakeWorkload::HighlightChurn },
+};
+
+constexpr int FAKE_API_LEVEL = 11;
+// Lines of output per batch of the terminal workload
+constexpr int FAKE_TERMINAL_LINES = 64;
+
+struct FakeNvim {
+	FakeWorkload workload;
+	int frames;
+	int interval_ms;
+	const char *script_path;
+	bool paced;
+	bool exit_after_workload;
+
+	NvimTransport transport;
+	// Guards writes to the transport and everything below, the workload thread
+	// and the request loop both draw into the grid
+	std::mutex mutex;
+	int rows;
+	int cols;
+	int cursor_row;
+	int cursor_col;
+	int64_t next_msg_id;
+	bool attached;
+};
+
+// Callers hold fake->mutex
+static void Send(FakeNvim *fake, const char *data, size_t size) {
+	if (!NvimTransportWrite(&fake->transport, data, size)) {
+		// The UI went away
+		exit(0);
+	}
+}
+
+static void SendWorkloadMessage(FakeNvim *fake, WorkloadMessage *message) {
+	Send(fake, message->data, message->size);
+	WorkloadFree(message);
+}
+
+static void SendResponse(FakeNvim *fake, int64_t msg_id, void (*write_result)(mpack_writer_t *writer, const void *context), const void *context) {
+	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
+	mpack_writer_t writer;
+	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
+	mpack_start_array(&writer, 4);
+	mpack_write_i64(&writer, static_cast<int64_t>(MPackMessageType::Response));
+	mpack_write_i64(&writer, msg_id);
+	mpack_write_nil(&writer);
+	if (write_result) {
+		write_result(&writer, context);
+	}
+	else {
+		mpack_write_nil(&writer);
+	}
+	Send(fake, data, MPackFinishMessage(&writer));
+}
+
+static void WriteApiInfo(mpack_writer_t *writer, const void *) {
+	// [channel_id, {version = {...}}], Nvy only looks at the api level
+	mpack_start_array(writer, 2);
+	mpack_write_int(writer, 1);
+	mpack_start_map(writer, 1);
+	mpack_write_cstr(writer, "version");
+	mpack_start_map(writer, 4);
+	mpack_write_cstr(writer, "major");
+	mpack_write_int(writer, 0);
+	mpack_write_cstr(writer, "minor");
+	mpack_write_int(writer, 9);
+	mpack_write_cstr(writer, "patch");
+	mpack_write_int(writer, 0);
+	mpack_write_cstr(writer, "api_level");
+	mpack_write_int(writer, FAKE_API_LEVEL);
+	mpack_finish_map(writer);
+	mpack_finish_map(writer);
+	mpack_finish_array(writer);
+}
+
+static void WriteEmptyString(mpack_writer_t *writer, const void *) {
+	mpack_write_cstr(writer, "");
+}
+
+static void WriteInt(mpack_writer_t *writer, const void *context) {
+	mpack_write_i64(writer, *static_cast<const int64_t *>(context));
+}
+
+static void SendVimEnter(FakeNvim *fake) {
+	char data[MAX_MPACK_OUTBOUND_MESSAGE_SIZE];
+	mpack_writer_t writer;
+	mpack_writer_init(&writer, data, MAX_MPACK_OUTBOUND_MESSAGE_SIZE);
+	MPackStartRequest(fake->next_msg_id++, "vimenter", &writer);
+	mpack_start_array(&writer, 0);
+	mpack_finish_array(&writer);
+	Send(fake, data, MPackFinishMessage(&writer));
+}
+
+static void SendScript(FakeNvim *fake) {
+	Recording recording;
+	if (!RecordingOpen(&recording, fake->script_path)) {
+		fprintf(stderr, "nvy_fake_nvim: %s is not a valid recording\n", fake->script_path);
+		return;
+	}
+
+	int64_t start_ns = ClockNanoseconds();
+	uint64_t offset = sizeof(RecordingFileHeader);
+	RecordedMessage message;
+	while (RecordingReadMessage(&recording, &offset, &message)) {
+		// Responses and requests in the recording belonged to the old session
+		MPackCursor params;
+		if (!RedrawParseNotification(message.data, message.size, &params)) {
+			continue;
+		}
+		if (fake->paced) {
+			int64_t wait_ns = start_ns + message.time_ns - ClockNanoseconds();
+			if (wait_ns > 0) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+			}
+		}
+		std::lock_guard<std::mutex> lock(fake->mutex);
+		Send(fake, message.data, message.size);
+	}
+	RecordingClose(&recording);
+}
+
+static void SendWorkload(FakeNvim *fake) {
+	if (fake->script_path) {
+		SendScript(fake);
+	}
+	for (int frame = 0; frame < fake->frames && fake->workload != FakeWorkload::None; ++frame) {
+		{
+			std::lock_guard<std::mutex> lock(fake->mutex);
+			uint32_t seed = static_cast<uint32_t>(frame + 1);
+			WorkloadMessage message {};
+			switch (fake->workload) {
+			case FakeWorkload::Repaint: {
+				message = WorkloadFullRepaint(fake->rows, fake->cols, seed);
+			} break;
+			case FakeWorkload::Scroll: {
+				message = WorkloadScroll(fake->rows, fake->cols, 1, seed);
+			} break;
+			case FakeWorkload::Page: {
+				message = WorkloadScroll(fake->rows, fake->cols, fake->rows / 2, seed);
+			} break;
+			case FakeWorkload::Terminal: {
+				message = WorkloadTerminalFlood(fake->rows, fake->cols, FAKE_TERMINAL_LINES, seed);
+			} break;
+			case FakeWorkload::Wide: {
+				message = WorkloadWideText(fake->rows, fake->cols, seed);
+			} break;
+			case FakeWorkload::HighlightChurn: {
+				message = WorkloadHighlightChurn(fake->rows, fake->cols, seed);
+			} break;
+			case FakeWorkload::None: {
+			} break;
+			}
+			SendWorkloadMessage(fake, &message);
+		}
+		if (fake->interval_ms > 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(fake->interval_ms));
+		}
+	}
+
+	if (fake->exit_after_workload) {
+		exit(0);
+	}
+}
+
+// Callers hold fake->mutex
+static void Echo(FakeNvim *fake, const char *input, uint32_t length) {
+	if (fake->rows <= 0 || length == 0) {
+		return;
+	}
+	if (fake->cursor_col + static_cast<int>(length) > fake->cols) {
+		fake->cursor_col = 0;
+		fake->cursor_row = (fake->cursor_row + 1) % fake->rows;
+	}
+	length = length < static_cast<uint32_t>(fake->cols) ? length : fake->cols;
+
+	WorkloadMessage message = WorkloadEcho(fake->cursor_row, fake->cursor_col, input, length);
+	SendWorkloadMessage(fake, &message);
+	fake->cursor_col += length;
+}
+
+static void HandleRequest(FakeNvim *fake, int64_t msg_id, const char *method, uint32_t method_length, MPackCursor *params) {
+	std::lock_guard<std::mutex> lock(fake->mutex);
+	if (MPackStringEquals(method, method_length, "nvim_get_api_info")) {
+		SendResponse(fake, msg_id, WriteApiInfo, nullptr);
+	}
+	else if (MPackStringEquals(method, method_length, "nvim_input")) {
+		uint32_t input_length = 0;
+		const char *input = nullptr;
+		if (MPackCursorReadArray(params) > 0) {
+			input = MPackCursorReadStr(params, &input_length);
+		}
+		// nvim_input returns the number of bytes written
+		int64_t written = input ? input_length : 0;
+		SendResponse(fake, msg_id, WriteInt, &written);
+		if (input && fake->attached) {
+			Echo(fake, input, input_length);
+		}
+	}
+	else if (MPackStringEquals(method, method_length, "nvim_get_option_value")) {
+		SendResponse(fake, msg_id, WriteEmptyString, nullptr);
+	}
+	else if (MPackStringEquals(method, method_length, "nvim_command")) {
+		uint32_t command_length = 0;
+		const char *command = nullptr;
+		if (MPackCursorReadArray(params) > 0) {
+			command = MPackCursorReadStr(params, &command_length);
+		}
+		SendResponse(fake, msg_id, nullptr, nullptr);
+		if (command && (MPackStringEquals(command, command_length, "qa") ||
+			MPackStringEquals(command, command_length, "qa!"))) {
+			exit(0);
+		}
+	}
+	else {
+		SendResponse(fake, msg_id, nullptr, nullptr);
+	}
+}
+
+// Returns true the first time the UI attaches
+static bool HandleNotification(FakeNvim *fake, const char *method, uint32_t method_length, MPackCursor *params) {
+	bool ui_attach = MPackStringEquals(method, method_length, "nvim_ui_attach");
+	if (!ui_attach && !MPackStringEquals(method, method_length, "nvim_ui_try_resize")) {
+		return false;
+	}
+	if (MPackCursorReadArray(params) < 2) {
+		return false;
+	}
+	int cols = static_cast<int>(MPackCursorReadInt(params));
+	int rows = static_cast<int>(MPackCursorReadInt(params));
+	if (params->error || rows <= 0 || cols <= 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(fake->mutex);
+	fake->rows = rows;
+	fake->cols = cols;
+	fake->cursor_row = 0;
+	fake->cursor_col = 0;
+	WorkloadMessage message = WorkloadFullRepaint(rows, cols, 1);
+	SendWorkloadMessage(fake, &message);
+
+	if (ui_attach && !fake->attached) {
+		fake->attached = true;
+		SendVimEnter(fake);
+		return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv) {
+	FakeNvim *fake = new FakeNvim {};
+	fake->frames = 1000;
+	fake->next_msg_id = 1;
+	const char *listen_address = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (!strncmp(argv[i], "--workload=", strlen("--workload="))) {
+			const char *name = &argv[i][11];
+			fake->workload = FakeWorkload::None;
+			for (const FakeWorkloadName &workload : FAKE_WORKLOAD_NAMES) {
+				if (!strcmp(name, workload.name)) {
+					fake->workload = workload.workload;
+				}
+			}
+			if (fake->workload == FakeWorkload::None) {
+				fprintf(stderr, "nvy_fake_nvim: unknown workload %s\n", name);
+				return 1;
+			}
+		}
+		else if (!strncmp(argv[i], "--frames=", strlen("--frames="))) {
+			fake->frames = atoi(&argv[i][9]);
+		}
+		else if (!strncmp(argv[i], "--interval-ms=", strlen("--interval-ms="))) {
+			fake->interval_ms = atoi(&argv[i][14]);
+		}
+		else if (!strncmp(argv[i], "--script=", strlen("--script="))) {
+			fake->script_path = &argv[i][9];
+		}
+		else if (!strncmp(argv[i], "--listen=", strlen("--listen="))) {
+			listen_address = &argv[i][9];
+		}
+		else if (!strcmp(argv[i], "--paced")) {
+			fake->paced = true;
+		}
+		else if (!strcmp(argv[i], "--exit-after-workload")) {
+			fake->exit_after_workload = true;
+		}
+		// Anything else (ie: --embed, files to open) is accepted and ignored,
+		// so this can be dropped in with --neovim-bin=
+	}
+
+	if (listen_address) {
+		if (!NvimTransportAccept(&fake->transport, listen_address)) {
+			fprintf(stderr, "nvy_fake_nvim: could not listen on %s\n", listen_address);
+			return 1;
+		}
+	}
+	else {
+#ifdef _WIN32
+		NvimTransportInitializePipes(&fake->transport, GetStdHandle(STD_INPUT_HANDLE), GetStdHandle(STD_OUTPUT_HANDLE));
+#else
+		NvimTransportInitializePipes(&fake->transport, STDIN_FILENO, STDOUT_FILENO);
+#endif
+	}
+
+	NvimRpcReader reader;
+	NvimRpcReaderInitialize(&reader, &fake->transport, NvimTransportRead);
+	const char *data;
+	size_t size;
+	while (NvimRpcReaderNext(&reader, &data, &size)) {
+		MPackCursor cursor = MPackCursorInit(data, size);
+		uint32_t length = MPackCursorReadArray(&cursor);
+		int64_t type = MPackCursorReadInt(&cursor);
+		if (type == static_cast<int64_t>(MPackMessageType::Request) && length == 4) {
+			int64_t msg_id = MPackCursorReadInt(&cursor);
+			uint32_t method_length;
+			const char *method = MPackCursorReadStr(&cursor, &method_length);
+			if (!cursor.error) {
+				HandleRequest(fake, msg_id, method, method_length, &cursor);
+			}
+		}
+		else if (type == static_cast<int64_t>(MPackMessageType::Notification) && length == 3) {
+			uint32_t method_length;
+			const char *method = MPackCursorReadStr(&cursor, &method_length);
+			if (!cursor.error && HandleNotification(fake, method, method_length, &cursor)) {
+				std::thread(SendWorkload, fake).detach();
+			}
+		}
+		// Responses (ie: to vimenter) need no handling
+	}
+
+	// The UI went away
+	NvimRpcReaderDestroy(&reader);
+	NvimTransportClose(&fake->transport);
+	return 0;
+}
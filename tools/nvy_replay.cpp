@@ -0,0 +1,362 @@
+// Replays a recording made with `Nvy --record=<file>` through the redraw
+// decoder and the grid/highlight model, without a window or renderer.
+//
+// nvy_replay <file> [--paced] [--frame=<n>] [--count=<n>]
+//   --paced      sleep between messages to match the recorded arrival times
+//   --frame=<n>  start timing at the n'th flush, the frames before it are
+//                played untimed so the model matches the recording there.
+//                The counters in the report cover those frames as well.
+//   --count=<n>  stop after n frames
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "common/arena.h"
+#include "common/clock.h"
+#include "model/effect_pool.h"
+#include "model/layout_cache.h"
+#include "nvim/recording.h"
+#include "nvim/redraw.h"
+#include "nvim/redraw_ops.h"
+
+constexpr const char *REDRAW_OP_TYPE_NAMES[] {
+	"GridResize",
+	"GridClear",
+	"GridLine",
+	"GridScroll",
+	"GridCursorGoto",
+	"DefaultColorsSet",
+	"HlAttrDefine",
+	"ModeInfoSet",
+	"ModeChange",
+	"SetGuiFont",
+	"SetTitle",
+	"BusyStart",
+	"BusyStop",
+	"Flush",
+	"WinPos",
+	"WinFloatPos",
+	"WinHide",
+	"WinClose",
+	"GridDestroy",
+	"MsgSetPos",
+};
+static_assert(sizeof(REDRAW_OP_TYPE_NAMES) / sizeof(REDRAW_OP_TYPE_NAMES[0]) == REDRAW_OP_TYPE_COUNT,
+	"REDRAW_OP_TYPE_NAMES is out of sync with RedrawOpType");
+
+struct ReplayTiming {
+	uint64_t count;
+	int64_t total_ns;
+	int64_t max_ns;
+};
+
+struct Replay {
+	UIModel model;
+	Arena arena;
+	RedrawEventStats event_stats;
+	// Which row layouts the renderer would have reused, no layouts are made
+	LayoutCache layout_cache;
+	// The drawing effects the renderer would have made, none are made
+	EffectPool effect_pool;
+	uint64_t first_flush_allocations;
+	bool flushed;
+
+	// Decoding is timed per redraw event, applying per op type
+	ReplayTiming events[REDRAW_EVENT_COUNT];
+	ReplayTiming ops[REDRAW_OP_TYPE_COUNT];
+	// Decode and apply time of every frame played
+	Vec<int64_t> frame_ns;
+	uint64_t rpc_messages;
+	uint64_t redraw_messages;
+};
+
+static void ReplayTimingAdd(ReplayTiming *timing, int64_t ns) {
+	++timing->count;
+	timing->total_ns += ns;
+	timing->max_ns = std::max(timing->max_ns, ns);
+}
+
+// Flushes like the renderer does, looking up the layout of every row drawn
+static void ReplayFlush(Replay *replay) {
+	UIModel *model = &replay->model;
+	UIModelFlushRows(model, [&](int row, DirtyRowSpan span) {
+		GridWidenSpan(&model->grid, row, true, &span.left, &span.right);
+		LayoutCacheKey key {
+			.row_hash = model->drawn_rows.hashes[row],
+			.font_generation = 0,
+			.left = static_cast<uint16_t>(span.left),
+			.right = static_cast<uint16_t>(span.right)
+		};
+		void *layout;
+		if (!LayoutCacheFind(&replay->layout_cache, key, &layout)) {
+			LayoutCacheInsert(&replay->layout_cache, key, nullptr, span.right - span.left);
+		}
+
+		const uint32_t *id_sets = model->hl_sets.id_sets;
+		int run_count;
+		const HighlightRun *runs = HighlightRunsRow(&model->hl_runs, row, &run_count);
+		int run = HighlightRunsFind(runs, run_count, span.left);
+		for (int run_start = span.left; run_start < span.right;) {
+			uint16_t hl_attrib_id = runs[run].hl_attrib_id;
+			run_start = HighlightRunsJoin(runs, run_count, &run, id_sets);
+			EffectPoolGet(&replay->effect_pool, hl_attrib_id, &model->hl_colors.colors[hl_attrib_id]);
+		}
+	});
+	if (!replay->flushed) {
+		replay->flushed = true;
+		replay->first_flush_allocations = replay->effect_pool.stats.allocations;
+	}
+}
+
+// Decodes and applies one recorded message, returns the time spent
+static int64_t ReplayMessage(Replay *replay, const RecordedMessage *message, bool timed) {
+	MPackCursor params;
+	if (!RedrawParseNotification(message->data, message->size, &params)) {
+		// Anything that isn't a redraw is handled by the UI thread
+		// proper (option values, requests), there is no model side to it
+		++replay->rpc_messages;
+		return 0;
+	}
+	++replay->redraw_messages;
+
+	int64_t message_ns = 0;
+	RedrawDecoder decoder;
+	RedrawDecoderInitialize(&decoder, params);
+	while (RedrawNextEvent(&decoder)) {
+		ArenaReset(&replay->arena);
+		int64_t start = ClockNanoseconds();
+		RedrawEvent event = RedrawEncodeEvent(&replay->arena, &decoder, &replay->event_stats);
+		int64_t encoded = ClockNanoseconds();
+		if (timed && event != RedrawEvent::Unknown) {
+			ReplayTimingAdd(&replay->events[static_cast<size_t>(event)], encoded - start);
+		}
+		message_ns += encoded - start;
+
+		RedrawOps ops = RedrawOpsInit(reinterpret_cast<const char *>(replay->arena.data), replay->arena.size);
+		while (const RedrawOp *op = RedrawOpsNext(&ops)) {
+			start = ClockNanoseconds();
+			if (op->type == RedrawOpType::Flush) {
+				ReplayFlush(replay);
+			}
+			else {
+				RedrawApplyOp(&replay->model, op);
+				if (op->type == RedrawOpType::HlAttrDefine) {
+					EffectPoolInvalidateId(&replay->effect_pool,
+						reinterpret_cast<const RedrawOpHlAttrDefine *>(op)->hl_attrib_id);
+				}
+				else if (op->type == RedrawOpType::DefaultColorsSet) {
+					EffectPoolClear(&replay->effect_pool);
+				}
+			}
+			int64_t applied = ClockNanoseconds();
+			if (timed) {
+				ReplayTimingAdd(&replay->ops[static_cast<size_t>(op->type)], applied - start);
+			}
+			message_ns += applied - start;
+		}
+	}
+	return message_ns;
+}
+
+static void ReplayFrame(Replay *replay, const Recording *recording, const RecordingFrame *frame,
+	bool timed, bool paced, int64_t pace_start_ns, int64_t recorded_start_ns) {
+	int64_t frame_ns = 0;
+	uint64_t offset = frame->begin_offset;
+	RecordedMessage message;
+	while (offset < frame->end_offset && RecordingReadMessage(recording, &offset, &message)) {
+		if (paced) {
+			int64_t due_ns = pace_start_ns + (message.time_ns - recorded_start_ns);
+			int64_t wait_ns = due_ns - ClockNanoseconds();
+			if (wait_ns > 0) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+			}
+		}
+		frame_ns += ReplayMessage(replay, &message, timed);
+	}
+	if (timed) {
+		replay->frame_ns.push_back(frame_ns);
+	}
+}
+
+static void PrintTiming(const char *name, const ReplayTiming *timing) {
+	if (timing->count == 0) {
+		return;
+	}
+	printf("  %-24s %10llu calls %12.3f ms %10.1f ns/call %10.1f us max\n", name,
+		static_cast<unsigned long long>(timing->count), timing->total_ns * 1e-6,
+		static_cast<double>(timing->total_ns) / timing->count, timing->max_ns * 1e-3);
+}
+
+static void PrintReport(Replay *replay) {
+	printf("messages: %llu redraw, %llu other\n",
+		static_cast<unsigned long long>(replay->redraw_messages),
+		static_cast<unsigned long long>(replay->rpc_messages));
+
+	printf("decode per event:\n");
+	for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+		PrintTiming(REDRAW_EVENT_NAMES[i], &replay->events[i]);
+	}
+	printf("apply per op:\n");
+	for (size_t i = 0; i < REDRAW_OP_TYPE_COUNT; ++i) {
+		PrintTiming(REDRAW_OP_TYPE_NAMES[i], &replay->ops[i]);
+	}
+
+	printf("unhandled events:");
+	for (size_t i = 0; i < REDRAW_EVENT_COUNT; ++i) {
+		if (replay->event_stats.unhandled[i] > 0) {
+			printf(" %s=%llu", REDRAW_EVENT_NAMES[i],
+				static_cast<unsigned long long>(replay->event_stats.unhandled[i]));
+		}
+	}
+	printf(" unknown=%llu\n", static_cast<unsigned long long>(replay->event_stats.unknown));
+
+	// What drawing only the dirty rows at each flush saves over drawing on every change
+	DirtyRowStats *dirty_stats = &replay->model.dirty_rows.stats;
+	double flushes = static_cast<double>(dirty_stats->flushes ? dirty_stats->flushes : 1);
+	printf("dirty rows: %llu marks, %llu redundant, %llu rows drawn, %.1f rows/flush, %.1f span cells/flush\n",
+		static_cast<unsigned long long>(dirty_stats->marks),
+		static_cast<unsigned long long>(dirty_stats->redundant_marks),
+		static_cast<unsigned long long>(dirty_stats->rows_drawn),
+		static_cast<double>(dirty_stats->rows_drawn) / flushes,
+		static_cast<double>(dirty_stats->span_cells) / flushes);
+	// Dirty rows skipped for looking exactly like what was drawn before
+	RowHashStats *hash_stats = &replay->model.drawn_rows.stats;
+	printf("row hashes: %llu unchanged, %llu changed\n",
+		static_cast<unsigned long long>(hash_stats->hits),
+		static_cast<unsigned long long>(hash_stats->misses));
+
+	HighlightSets *hl_sets = &replay->model.hl_sets;
+	printf("highlight sets: %u sets, %llu of %llu definitions shared one\n", hl_sets->set_count,
+		static_cast<unsigned long long>(hl_sets->stats.shared),
+		static_cast<unsigned long long>(hl_sets->stats.interned));
+
+	ResolvedColorStats *color_stats = &replay->model.hl_colors.stats;
+	printf("resolved colors: %llu updates, %llu rebuilds\n",
+		static_cast<unsigned long long>(color_stats->updates),
+		static_cast<unsigned long long>(color_stats->rebuilds));
+
+	HighlightRunStats *hl_run_stats = &replay->model.hl_runs.stats;
+	printf("highlight runs: %llu rows split, %.1f runs per row\n",
+		static_cast<unsigned long long>(hl_run_stats->rows_built),
+		hl_run_stats->rows_built ? static_cast<double>(hl_run_stats->runs_built) / hl_run_stats->rows_built : 0.0);
+
+	LayoutCache *layout_cache = &replay->layout_cache;
+	uint64_t lookups = layout_cache->stats.hits + layout_cache->stats.misses;
+	printf("layout cache: %llu hits, %llu misses, %.1f%% hit rate, %llu evictions, %d layouts of %llu cells, %zu KB index\n",
+		static_cast<unsigned long long>(layout_cache->stats.hits),
+		static_cast<unsigned long long>(layout_cache->stats.misses),
+		lookups ? 100.0 * layout_cache->stats.hits / lookups : 0.0,
+		static_cast<unsigned long long>(layout_cache->stats.evictions),
+		layout_cache->count,
+		static_cast<unsigned long long>(layout_cache->cached_cells),
+		LayoutCacheSize(layout_cache) / 1024);
+
+	EffectPool *effect_pool = &replay->effect_pool;
+	printf("drawing effects: %llu lookups, %llu allocated, %llu after the first flush, %d color pairs, %llu id invalidations, %llu clears\n",
+		static_cast<unsigned long long>(effect_pool->stats.lookups),
+		static_cast<unsigned long long>(effect_pool->stats.allocations),
+		static_cast<unsigned long long>(effect_pool->stats.allocations - replay->first_flush_allocations),
+		effect_pool->count,
+		static_cast<unsigned long long>(effect_pool->stats.id_invalidations),
+		static_cast<unsigned long long>(effect_pool->stats.clears));
+
+	HighlightRowStats *hl_row_stats = &replay->model.hl_rows.stats;
+	printf("highlight rows: %llu redefinitions on screen, %llu rows marked\n",
+		static_cast<unsigned long long>(hl_row_stats->redefinitions),
+		static_cast<unsigned long long>(hl_row_stats->rows_marked));
+
+	CompositorStats *compositor_stats = &replay->model.compositor.stats;
+	printf("compositor: %llu cells composed, %llu layout changes\n",
+		static_cast<unsigned long long>(compositor_stats->cells_composed),
+		static_cast<unsigned long long>(compositor_stats->layout_changes));
+
+	size_t frame_count = replay->frame_ns.size();
+	if (frame_count == 0) {
+		return;
+	}
+	std::sort(replay->frame_ns.begin(), replay->frame_ns.end());
+	int64_t total_ns = 0;
+	for (int64_t ns : replay->frame_ns) {
+		total_ns += ns;
+	}
+	printf("per flush: %zu frames, mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", frame_count,
+		total_ns * 1e-3 / frame_count,
+		replay->frame_ns[frame_count / 2] * 1e-3,
+		replay->frame_ns[std::min(frame_count - 1, frame_count * 99 / 100)] * 1e-3,
+		replay->frame_ns[frame_count - 1] * 1e-3);
+}
+
+int main(int argc, char **argv) {
+	const char *path = nullptr;
+	bool paced = false;
+	uint64_t first_frame = 0;
+	uint64_t frame_limit = UINT64_MAX;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--paced")) {
+			paced = true;
+		}
+		else if (!strncmp(argv[i], "--frame=", strlen("--frame="))) {
+			first_frame = strtoull(&argv[i][8], nullptr, 10);
+		}
+		else if (!strncmp(argv[i], "--count=", strlen("--count="))) {
+			frame_limit = strtoull(&argv[i][8], nullptr, 10);
+		}
+		else {
+			path = argv[i];
+		}
+	}
+	if (path == nullptr) {
+		fprintf(stderr, "usage: nvy_replay <file> [--paced] [--frame=<n>] [--count=<n>]\n");
+		return 1;
+	}
+
+	Recording recording;
+	if (!RecordingOpen(&recording, path)) {
+		fprintf(stderr, "nvy_replay: %s is not a valid recording\n", path);
+		return 1;
+	}
+	if (first_frame >= recording.frame_count) {
+		fprintf(stderr, "nvy_replay: frame %llu out of range, the recording has %llu frames\n",
+			static_cast<unsigned long long>(first_frame),
+			static_cast<unsigned long long>(recording.frame_count));
+		RecordingClose(&recording);
+		return 1;
+	}
+
+	Replay *replay = new Replay {};
+	UIModelInitialize(&replay->model);
+	ArenaInitialize(&replay->arena, MEGABYTES(1));
+	LayoutCacheInitialize(&replay->layout_cache, DEFAULT_LAYOUT_CACHE_CAPACITY, [](void *) {});
+	EffectPoolInitialize(&replay->effect_pool, MAX_HIGHLIGHT_ATTRIBS,
+		[](const ColorRGBA *, const ColorRGBA *) -> void * { return nullptr; }, [](void *) {});
+
+	// Every frame changes the grid, highlights and windows the next one
+	// draws on top of, so the frames before the first timed one are
+	// played untimed to get the model into the same state
+	for (uint64_t i = 0; i < first_frame; ++i) {
+		ReplayFrame(replay, &recording, &recording.frames[i], false, false, 0, 0);
+	}
+
+	uint64_t last_frame = std::min(recording.frame_count, first_frame + std::min(frame_limit, recording.frame_count));
+	int64_t pace_start_ns = ClockNanoseconds();
+	int64_t recorded_start_ns = first_frame > 0 ? recording.frames[first_frame - 1].time_ns : 0;
+	int64_t start_ns = ClockNanoseconds();
+	for (uint64_t i = first_frame; i < last_frame; ++i) {
+		ReplayFrame(replay, &recording, &recording.frames[i], true, paced, pace_start_ns, recorded_start_ns);
+	}
+	int64_t elapsed_ns = ClockNanoseconds() - start_ns;
+
+	printf("%s: %llu frames replayed in %.3f ms%s\n", path,
+		static_cast<unsigned long long>(last_frame - first_frame), elapsed_ns * 1e-6, paced ? " (paced)" : "");
+	PrintReport(replay);
+
+	LayoutCacheFree(&replay->layout_cache);
+	EffectPoolFree(&replay->effect_pool);
+	ArenaFree(&replay->arena);
+	UIModelShutdown(&replay->model);
+	delete replay;
+	RecordingClose(&recording);
+	return 0;
+}